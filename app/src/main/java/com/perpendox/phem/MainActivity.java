@@ -1345,7 +1345,7 @@ public class MainActivity extends ActionBarActivity implements
 		}*/
 	}
 
-	public static void update_Screen_Bitmap() {
+	public static void update_Screen_Bitmap(int first_line, int last_line) {
 //		if (MainActivity.enable_logging) {
 //			Log.d(LOG_TAG, "update_Screen_Bitmap");
 //		}
@@ -1355,7 +1355,7 @@ public class MainActivity extends ActionBarActivity implements
 //						Log.d(LOG_TAG, "updating screen frag.");
 //					}
 			if (null != screen_frag) {
-				screen_frag.Set_Bitmap();
+				screen_frag.Set_Bitmap(first_line, last_line);
 			} else {
 				if (MainActivity.enable_logging) {
 					Log.d(LOG_TAG, "null screen frag?");
@@ -23,6 +23,10 @@ public class PHEMNativeIF {
 	private static int has_vfs = -1;
 	private static PHEMNativeIF instance;
 	private static ByteBuffer palm_screen_buffer;
+	// Runs of rows changed by the last HandleIdle call, as first and last
+	// (exclusive) pairs. Matches MAX_DIRTY_RUNS in PHEMNativeIF.cpp.
+	private static final int MAX_UPDATE_RUNS = 8;
+	private static int[] updated_lines = new int[2 * MAX_UPDATE_RUNS];
 	private static String LOG_TAG = PHEMNativeIF.class.getSimpleName();
 	public static String phem_base_dir;
 	public static String session_file_name;
@@ -121,11 +125,15 @@ public class PHEMNativeIF {
 	public static void Handle_Idle() {
 		// long init = System.currentTimeMillis();
 		// Log.d(LOG_TAG, "...calling HandleIdle, " + init);
-		if (HandleIdle(palm_screen_buffer) != 0) {
+		int runs = HandleIdle(palm_screen_buffer, updated_lines);
+		if (runs != 0) {
 			// Log.d(LOG_TAG, "idle call took " + (System.currentTimeMillis() -
 			// init));
 			//Log.d(LOG_TAG, "screen update");
-			MainActivity.update_Screen_Bitmap();
+			for (int i = 0; i < runs; i++) {
+				MainActivity.update_Screen_Bitmap(updated_lines[2 * i],
+						updated_lines[2 * i + 1]);
+			}
 		} else {
 			// Log.d(LOG_TAG, "no update took " + (System.currentTimeMillis() -
 			// init));
@@ -298,8 +306,10 @@ public class PHEMNativeIF {
 	// Install a file into the emulated Palm.
 	private static native int InstallPalmFile(String file_name);
 
-	// Update the bitmap with any new screen changes
-	private static native int HandleIdle(ByteBuffer buffer);
+	// Update the bitmap with any new screen changes. Only the rows that
+	// changed get copied; each run of them is returned as a pair in lines,
+	// and the number of runs is returned.
+	private static native int HandleIdle(ByteBuffer buffer, int[] lines);
 
 	// Touch events
 	private static native boolean PenDown(int x, int y);
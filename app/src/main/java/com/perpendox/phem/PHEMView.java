@@ -25,6 +25,12 @@ public class PHEMView extends View {
 	int last_pix_x = 0, last_pix_y = 0;
 	private boolean active_touch = false, out_of_rect = false;
 	private boolean session_bitmap = false;
+	// copyPixelsFromBuffer always fills a whole bitmap, so to copy just
+	// the rows that changed we keep strips a power of two rows high and
+	// draw them onto mBitmap.
+	private Bitmap[] strips = new Bitmap[16];
+	private Canvas strip_canvas;
+	private Bitmap strip_canvas_bitmap;
 
 	// Only needed to make Eclipse be quiet... so far as I can see, anyway.
 	public PHEMView(Context context, AttributeSet attrs) {
@@ -152,38 +158,73 @@ public class PHEMView extends View {
 				Bitmap.Config.RGB_565);
 	}
 
-	void set_Bitmap() {
+	void set_Bitmap(int first_line, int last_line) {
 //		if (MainActivity.enable_logging) {
 //			Log.d(LOG_TAG, "set_Bitmap.");
 //		}
 		if (!session_bitmap) {
 			Log.e(LOG_TAG, "set_Bitmap but not session bitmap!");
 		}
+		if (first_line < 0) {
+			first_line = 0;
+		}
+		if (last_line > bitmap_height) {
+			last_line = bitmap_height;
+		}
+		if (last_line <= first_line) {
+			return;
+		}
+
 		ByteBuffer buffy = PHEMNativeIF.Get_PHEM_Screen_Buffer();
 		// Update our bitmap with the new data in the buffer.
-		buffy.rewind(); // Make sure we start from beginning every time.
-		mBitmap.copyPixelsFromBuffer(buffy);
-		
-		this.postInvalidate();
-		/*this.post(new Runnable() {
-			@Override
-			public void run() {
+		if (first_line == 0 && last_line == bitmap_height) {
+			buffy.rewind(); // Make sure we start from beginning every time.
+			mBitmap.copyPixelsFromBuffer(buffy);
+		} else {
+			copy_Rows(buffy, first_line, last_line);
+		}
 
-				// force a redraw
-				invalidate();
+		// Only redraw the part of the view showing the rows that changed.
+		// Until we've been drawn once we don't know where that is.
+		if (destiny.isEmpty() || bitmap_height == 0) {
+			this.postInvalidate();
+		} else {
+			int top = destiny.top + (first_line * display_bm_h) / bitmap_height;
+			int bottom = destiny.top
+					+ (last_line * display_bm_h + bitmap_height - 1) / bitmap_height;
+			this.postInvalidate(destiny.left, top, destiny.right, bottom);
+		}
+	}
 
-			}
-		});*/
-		
-		
-		/*
-		ByteBuffer buffy = PHEMNativeIF.Get_PHEM_Screen_Buffer();
-		// Update our bitmap with the new data in the buffer.
-		buffy.rewind(); // Make sure we start from beginning every time.
-		mBitmap.copyPixelsFromBuffer(buffy);
-		// force a redraw
-		invalidate();
-		*/
+	// Copy rows first_line..last_line (exclusive) of the screen buffer into
+	// mBitmap. The strip is rounded up to a power of two rows, and slid up
+	// if that would run off the bottom, so a handful of strips covers
+	// every update.
+	private void copy_Rows(ByteBuffer buffy, int first_line, int last_line) {
+		int index = 0;
+		while ((1 << index) < last_line - first_line) {
+			index++;
+		}
+		int rows = Math.min(1 << index, bitmap_height);
+		int top = Math.min(first_line, bitmap_height - rows);
+
+		Bitmap strip = strips[index];
+		if (strip == null || strip.getWidth() != bitmap_width
+				|| strip.getHeight() != rows) {
+			strip = Bitmap.createBitmap(bitmap_width, rows,
+					Bitmap.Config.RGB_565);
+			strips[index] = strip;
+		}
+		if (strip_canvas_bitmap != mBitmap) {
+			strip_canvas = new Canvas(mBitmap);
+			strip_canvas_bitmap = mBitmap;
+		}
+
+		// copyPixelsFromBuffer reads from the buffer's current position.
+		buffy.clear();
+		buffy.position(top * bitmap_width * 2);
+		strip.copyPixelsFromBuffer(buffy);
+		strip_canvas.drawBitmap(strip, 0, top, null);
 	}
 
 	// Utility function, figure out how far the new event is from the
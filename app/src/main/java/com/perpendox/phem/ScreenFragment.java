@@ -73,8 +73,8 @@ public class ScreenFragment extends Fragment {
 	}
 
 	// Pass it on to our view.
-	public void Set_Bitmap() {
-		the_view.set_Bitmap();
+	public void Set_Bitmap(int first_line, int last_line) {
+		the_view.set_Bitmap(first_line, last_line);
 	}
 	
 	public void Load_Bitmap(Context context, int the_drawable) {
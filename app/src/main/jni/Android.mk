@@ -53,6 +53,7 @@ LOCAL_SRC_FILES := \
   $(LOCAL_PATH)/SrcShared/DebugMgr.cpp \
   $(LOCAL_PATH)/SrcShared/EmAction.cpp \
   $(LOCAL_PATH)/SrcShared/EmApplication.cpp \
+  $(LOCAL_PATH)/SrcShared/EmByteRing.cpp \
   $(LOCAL_PATH)/SrcShared/EmCommon.cpp \
   $(LOCAL_PATH)/SrcShared/EmDevice.cpp \
   $(LOCAL_PATH)/SrcShared/EmDirRef.cpp \
@@ -64,6 +65,7 @@ LOCAL_SRC_FILES := \
   $(LOCAL_PATH)/SrcShared/EmExgMgr.cpp \
   $(LOCAL_PATH)/SrcShared/EmFileImport.cpp \
   $(LOCAL_PATH)/SrcShared/EmFileRef.cpp \
+  $(LOCAL_PATH)/SrcShared/EmInputQueue.cpp \
   $(LOCAL_PATH)/SrcShared/EmJPEG.cpp \
   $(LOCAL_PATH)/SrcShared/EmLowMem.cpp \
   $(LOCAL_PATH)/SrcShared/EmMapFile.cpp \
@@ -84,6 +86,8 @@ LOCAL_SRC_FILES := \
   $(LOCAL_PATH)/SrcShared/EmRPC.cpp \
   $(LOCAL_PATH)/SrcShared/EmScreen.cpp \
   $(LOCAL_PATH)/SrcShared/EmSession.cpp \
+  $(LOCAL_PATH)/SrcShared/EmSessionContext.cpp \
+  $(LOCAL_PATH)/SrcShared/EmSessionSnapshot.cpp \
   $(LOCAL_PATH)/SrcShared/EmStream.cpp \
   $(LOCAL_PATH)/SrcShared/EmStreamFile.cpp \
   $(LOCAL_PATH)/SrcShared/EmSubroutine.cpp \
@@ -103,6 +107,7 @@ LOCAL_SRC_FILES := \
   $(LOCAL_PATH)/SrcShared/Hardware/EmCPU68K.cpp \
   $(LOCAL_PATH)/SrcShared/Hardware/EmCPUARM.cpp \
   $(LOCAL_PATH)/SrcShared/Hardware/EmCPU.cpp \
+  $(LOCAL_PATH)/SrcShared/Hardware/EmCodeCache.cpp \
   $(LOCAL_PATH)/SrcShared/Hardware/EmHAL.cpp \
   $(LOCAL_PATH)/SrcShared/Hardware/EmMemory.cpp \
   $(LOCAL_PATH)/SrcShared/Hardware/EmRegs328.cpp \
@@ -250,10 +255,53 @@ LOCAL_CFLAGS := \
   -DPLATFORM_UNIX=1 -D__PALMOS_TRAPS__=0 -DEMULATION_LEVEL=EMULATION_UNIX -O2 -DHAS_PROFILING=0 -DNDEBUG \
   -DHAVE_DIRENT_H=1 -DHAVE_ENDIAN_H=1 -DHAVE_TYPE_SOCKLEN_T=1 \
 
-LOCAL_LDFLAGS := -llog
+# The vector versions of the pixmap converters need NEON turned on for
+# ARMv7.  EmPixMapSIMD checks that the CPU actually has it before they're
+# used.
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_SRC_FILES += $(LOCAL_PATH)/SrcShared/EmPixMapSIMD.cpp.neon
+else
+LOCAL_SRC_FILES += $(LOCAL_PATH)/SrcShared/EmPixMapSIMD.cpp
+endif
 
-LOCAL_STATIC_LIBRARIES := poserjpeg
+LOCAL_LDFLAGS := -llog -ldl
+
+LOCAL_STATIC_LIBRARIES := poserjpeg cpufeatures
 
 LOCAL_MODULE := pose
 
+# The Horde worker below is built from the same sources, less the JNI side.
+POSE_SRC_FILES := $(filter-out %/PHEMNativeIF.cpp,$(LOCAL_SRC_FILES))
+POSE_C_INCLUDES := $(LOCAL_C_INCLUDES)
+POSE_CFLAGS := $(LOCAL_CFLAGS)
+
 include $(BUILD_SHARED_LIBRARY)
+
+##################################
+
+# The program Platform::StartHordeWorker runs to split a Gremlin Horde
+# across processes.  It's named like a library so that it's packaged
+# and installed with libpose.so, in a directory we're allowed to run
+# programs from.  Newer versions of Android only run position
+# independent executables.
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+  $(POSE_SRC_FILES) \
+  $(LOCAL_PATH)/SrcAndroid/PHEMHordeWorker.cpp \
+
+LOCAL_C_INCLUDES := $(POSE_C_INCLUDES)
+
+LOCAL_CFLAGS := $(POSE_CFLAGS) -fPIE
+
+LOCAL_LDFLAGS := -llog -fPIE -pie
+
+LOCAL_STATIC_LIBRARIES := poserjpeg cpufeatures
+
+LOCAL_MODULE := phemhorde
+LOCAL_MODULE_FILENAME := libphemhorde.so
+
+include $(BUILD_EXECUTABLE)
+
+$(call import-module,android/cpufeatures)
@@ -17,6 +17,7 @@
 #include "EmDlgAndroid.h"		// HandleDialogs
 #include "EmDocument.h"			// gDocument
 #include "EmMenus.h"			// MenuInitialize
+#include "EmPixMap.h"			// EmPixMap::BenchmarkConverters
 #include "EmWindowAndroid.h"
 #include "PHEMNativeIF.h"
 
@@ -142,6 +143,10 @@ Bool EmApplicationAndroid::Startup (int argc, char** argv)
 	if (!EmApplication::Startup (argc, argv))
 		return false;
 
+#if BENCHMARK_PIXMAPS
+	EmPixMap::BenchmarkConverters ();
+#endif
+
         PHEM_Log_Place(2);
 	// Create our window.
 	this->PrvCreateWindow (argc, argv);
@@ -14,6 +14,7 @@
 #include "EmCommon.h"
 #include "EmTransportSerialAndroid.h"
 
+#include "EmSession.h"			// gSession, WakeUp
 #include "Logging.h"			// LogSerial
 #include "Platform.h"			// Platform::AllocateMemory
 
@@ -28,6 +29,12 @@
 
 #define PRINTF	if (!LogSerial ()) ; else LogAppendMsg
 
+// Size of the buffers between the serial port threads and the emulated
+// UART.  Bytes arriving while the incoming buffer is full are dropped,
+// as with a real serial port overrun.
+
+const long	kHostBufferSize = 64 * 1024;
+
 
 /***********************************************************************
  *
@@ -186,6 +193,25 @@ long EmTransportSerial::HostBytesInBuffer (long /*minBytes*/)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	EmTransportSerial::HostSpaceInBuffer
+ *
+ * DESCRIPTION:	Returns the number of bytes that can be written with
+ *				the Write method without any of them being dropped.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	Number of bytes that can be written.
+ *
+ ***********************************************************************/
+
+long EmTransportSerial::HostSpaceInBuffer (void)
+{
+	return fHost->OutgoingDataSpace ();
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	EmTransportSerial::HostSetConfig
@@ -623,9 +649,8 @@ EmHostTransportSerial::EmHostTransportSerial (void) :
 	fDataMutex (),
 	fDataCondition (&fDataMutex),
 	fReadMutex (),
-	fReadBuffer (),
-	fWriteMutex (),
-	fWriteBuffer ()
+	fReadBuffer (kHostBufferSize),
+	fWriteBuffer (kHostBufferSize)
 {
 }
 
@@ -829,10 +854,13 @@ ErrCode EmHostTransportSerial::CloseCommPort (void)
  * FUNCTION:	EmHostTransportSerial::PutIncomingData
  *
  * DESCRIPTION:	Thread-safe method for adding data to the queue that
- *				holds data read from the serial port.
+ *				holds data read from the serial port.  The caller should
+ *				check that there's room first (see CommRead); anything
+ *				that doesn't fit is dropped.
  *
  * PARAMETERS:	data - pointer to the read data.
- *				len - number of bytes pointed to by "data".
+ *				len - on input, number of bytes pointed to by "data".
+ *					On exit, number of bytes added to the queue.
  *
  * RETURNED:	Nothing
  *
@@ -843,12 +871,22 @@ void EmHostTransportSerial::PutIncomingData	(const void* data, long& len)
 	if (len == 0)
 		return;
 
-	omni_mutex_lock lock (fReadMutex);
+	{
+		omni_mutex_lock lock (fReadMutex);
+
+		long	amtPut = fReadBuffer.Put (data, len);
 
-	char*	begin = (char*) data;
-	char*	end = begin + len;
-	while (begin < end)
-		fReadBuffer.push_back (*begin++);
+		if (amtPut < len)
+			PRINTF ("EmHostTransportSerial::PutIncomingData: Dropped %ld serial bytes.", len - amtPut);
+
+		len = amtPut;
+	}
+
+	// Let the UART know there's new data, and make sure the CPU isn't
+	// sleeping through it.
+
+	if (gSession)
+		gSession->RingUARTDoorbell ();
 }
 
 
@@ -869,17 +907,7 @@ void EmHostTransportSerial::PutIncomingData	(const void* data, long& len)
 
 void EmHostTransportSerial::GetIncomingData	(void* data, long& len)
 {
-	omni_mutex_lock lock (fReadMutex);
-
-	if (len > (long) fReadBuffer.size ())
-		len = (long) fReadBuffer.size ();
-
-	char*	p = (char*) data;
-	deque<char>::iterator	begin = fReadBuffer.begin ();
-	deque<char>::iterator	end = begin + len;
-
-	copy (begin, end, p);
-	fReadBuffer.erase (begin, end);
+	len = fReadBuffer.Get (data, len);
 }
 
 
@@ -898,9 +926,7 @@ void EmHostTransportSerial::GetIncomingData	(void* data, long& len)
 
 long EmHostTransportSerial::IncomingDataSize (void)
 {
-	omni_mutex_lock lock (fReadMutex);
-
-	return fReadBuffer.size ();
+	return fReadBuffer.GetUsed ();
 }
 
 
@@ -909,10 +935,14 @@ long EmHostTransportSerial::IncomingDataSize (void)
  * FUNCTION:	EmHostTransportSerial::PutOutgoingData
  *
  * DESCRIPTION:	Thread-safe method for adding data to the queue that
- *				holds data to be written to the serial port.
+ *				holds data to be written to the serial port.  The
+ *				caller should check that there's room first (see
+ *				OutgoingDataSpace); anything that doesn't fit is
+ *				dropped.
  *
  * PARAMETERS:	data - pointer to the read data.
- *				len - number of bytes pointed to by "data".
+ *				len - on input, number of bytes pointed to by "data".
+ *					On exit, number of bytes added to the queue.
  *
  * RETURNED:	Nothing
  *
@@ -923,12 +953,12 @@ void EmHostTransportSerial::PutOutgoingData	(const void* data, long& len)
 	if (len == 0)
 		return;
 
-	omni_mutex_lock lock (fWriteMutex);
+	long	amtPut = fWriteBuffer.Put (data, len);
 
-	char*	begin = (char*) data;
-	char*	end = begin + len;
-	while (begin < end)
-		fWriteBuffer.push_back (*begin++);
+	if (amtPut < len)
+		PRINTF ("EmHostTransportSerial::PutOutgoingData: Dropped %ld serial bytes.", len - amtPut);
+
+	len = amtPut;
 
 	// Wake up CommWrite.
 
@@ -955,17 +985,7 @@ void EmHostTransportSerial::PutOutgoingData	(const void* data, long& len)
 
 void EmHostTransportSerial::GetOutgoingData	(void* data, long& len)
 {
-	omni_mutex_lock lock (fWriteMutex);
-
-	if (len > (long) fWriteBuffer.size ())
-		len = (long) fWriteBuffer.size ();
-
-	char*	p = (char*) data;
-	deque<char>::iterator	begin = fWriteBuffer.begin ();
-	deque<char>::iterator	end = begin + len;
-
-	copy (begin, end, p);
-	fWriteBuffer.erase (begin, end);
+	len = fWriteBuffer.Get (data, len);
 }
 
 
@@ -984,9 +1004,26 @@ void EmHostTransportSerial::GetOutgoingData	(void* data, long& len)
 
 long EmHostTransportSerial::OutgoingDataSize (void)
 {
-	omni_mutex_lock lock (fWriteMutex);
+	return fWriteBuffer.GetUsed ();
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EmHostTransportSerial::OutgoingDataSpace
+ *
+ * DESCRIPTION:	Thread-safe method returning the number of bytes that
+ *				can be added to the write queue.
+ *
+ * PARAMETERS:	None.
+ *
+ * RETURNED:	Number of free bytes in the write queue.
+ *
+ ***********************************************************************/
 
-	return fWriteBuffer.size ();
+long EmHostTransportSerial::OutgoingDataSpace (void)
+{
+	return fWriteBuffer.GetFree ();
 }
 
 
@@ -1020,7 +1057,14 @@ void* EmHostTransportSerial::CommRead (void* data)
 		fd1 = This->fCommHandle;
 		fd2 = This->fCommSignalPipeA;
 
-                if (This->fCommHandle > 0) {
+		// While the read buffer is full, leave the data in the port, so
+		// that the port's own flow control holds the sender back.  Check
+		// back every so often to see if the UART has made room.
+
+		long	room = This->fReadBuffer.GetFree ();
+		struct timeval	fullWait = { 0, 10 * 1000 };
+
+                if (This->fCommHandle > 0 && room > 0) {
 		  maxfd = max (fd1, fd2);
 		  FD_SET (fd1, &read_fds);
 		  FD_SET (fd2, &read_fds);
@@ -1030,7 +1074,8 @@ void* EmHostTransportSerial::CommRead (void* data)
 		  FD_SET (fd2, &read_fds);
                 }
 
-		status = select (maxfd + 1, &read_fds, NULL, NULL, NULL);
+		status = select (maxfd + 1, &read_fds, NULL, NULL,
+				(This->fCommHandle > 0 && room == 0) ? &fullWait : NULL);
 
 		if (This->fTimeToQuit) {
 			break;
@@ -1040,7 +1085,7 @@ void* EmHostTransportSerial::CommRead (void* data)
 		{
 			if ((This->fCommHandle > 0) && FD_ISSET (fd1, &read_fds)) {
 				char	buf[1024];
-				int		len = 1024;
+				int		len = min (room, (long) sizeof (buf));
 				len = read (fd1, buf, len);
 
 				if (len == 0)
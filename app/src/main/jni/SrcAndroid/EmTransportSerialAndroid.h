@@ -16,8 +16,8 @@
 
 #include "EmTransportSerial.h"
 
+#include "EmByteRing.h"			// EmByteRing
 #include "omnithread.h"			// omni_mutex
-#include <deque>				// deque
 
 
 class EmHostTransportSerial
@@ -40,6 +40,7 @@ class EmHostTransportSerial
 		void					PutOutgoingData		(const void*, long&);
 		void					GetOutgoingData		(void*, long&);
 		long					OutgoingDataSize	(void);
+		long					OutgoingDataSpace	(void);
 
 		static void*			CommRead			(void*);
 		static void*			CommWrite			(void*);
@@ -58,11 +59,14 @@ class EmHostTransportSerial
 		omni_mutex				fDataMutex;
 		omni_condition			fDataCondition;
 
+		// Each buffer has a single consumer: the CPU thread for fReadBuffer,
+		// CommWrite for fWriteBuffer.  fReadMutex keeps the two producers
+		// of fReadBuffer (CommRead and PassNMEA) out of each others' way.
+
 		omni_mutex				fReadMutex;
-		deque<char>				fReadBuffer;
+		EmByteRing				fReadBuffer;
 
-		omni_mutex				fWriteMutex;
-		deque<char>				fWriteBuffer;
+		EmByteRing				fWriteBuffer;
 };
 
 #endif /* EmTransportSerialAndroid_h */
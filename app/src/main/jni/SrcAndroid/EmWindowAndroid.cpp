@@ -69,7 +69,9 @@ EmWindowAndroid::EmWindowAndroid(void) :
 //	Fl_Window (kDefaultWidth, kDefaultHeight, "pose"),
 //	fMessage (NULL),
 //	fCachedSkin (NULL),
-	EmWindow ()
+	EmWindow (),
+	fLCDBuffer (NULL),
+	fLCDBufferSize (0)
 {
 	EmAssert (gHostWindow == NULL);
 	gHostWindow = this;
@@ -128,6 +130,8 @@ EmWindowAndroid::~EmWindowAndroid (void)
 
 	this->CacheFlush ();
 #endif
+	Platform::DisposeMemory (fLCDBuffer);
+
 	EmAssert (gHostWindow == this);
 	gHostWindow = NULL;
 }
@@ -658,24 +662,32 @@ void EmWindowAndroid::HostPaintCase (const EmScreenUpdateInfo&)
 // ---------------------------------------------------------------------------
 // Draw the LCD area.  info contains the raw LCD data, including a partially
 // updated fImage, and fFirstList and fLastLine which indicate the valid
-// range of the image.  srcRect and destRect also indicate the range that
-// needs to be updated, and have also been scaled appropriately.  scaled is
-// true if we need to scale info.fImage during the process of converting it
-// to a host pixmap.
+// range of the image.  srcRect and destRect indicate the range that needs
+// to be updated, which may be just part of that, and have also been scaled
+// appropriately.  scaled is true if we need to scale info.fImage during the
+// process of converting it to a host pixmap.
 
 void EmWindowAndroid::HostPaintLCD (const EmScreenUpdateInfo& info, const EmRect& srcRect,
 						  const EmRect& destRect, Bool scaled)
 {
-	// Determine the buffer size and allocate it.
+	// Determine the buffer size, and grow our buffer if it's too small.
+	// We hang onto it between calls, as we get called for every change
+	// to the LCD.
 	// We assume that ConvertPixMapToHost is converting to 16-bit RGB 565.
 
         int i;
 	int		rowBytes	= srcRect.fRight * 2; // 2 bytes per pixel
 	int		lcd_bufferSize	= srcRect.fBottom * rowBytes;
-	uint8 *	lcd_buffer		= (uint8 *) Platform::AllocateMemory (lcd_bufferSize);
-        uint8 * saved_lcd_buffer;
+
+	if (lcd_bufferSize > fLCDBufferSize)
+	{
+		Platform::DisposeMemory (fLCDBuffer);
+		fLCDBuffer = (uint8 *) Platform::AllocateMemory (lcd_bufferSize);
+		fLCDBufferSize = lcd_bufferSize;
+	}
+
+	uint8 *	lcd_buffer		= fLCDBuffer;
         uint8 * target_buffer = PHEM_Get_Buffer();
-        saved_lcd_buffer = lcd_buffer; // so we can free it
 
         const EmPixMap& p = this->GetCurrentSkin ();
         EmPoint size = p.GetSize ();
@@ -714,8 +726,10 @@ void EmWindowAndroid::HostPaintLCD (const EmScreenUpdateInfo& info, const EmRect
 
 	// Convert the image, scaling along the way.
 
+	int		factor		= scaled ? 2 : 1;
+
 	::ConvertPixMapToHost (info.fImage, lcd_buffer,
-				 info.fFirstLine, info.fLastLine, scaled);
+				 srcRect.fTop / factor, srcRect.fBottom / factor, scaled);
 
 	// Draw the converted image.
 
@@ -730,9 +744,6 @@ void EmWindowAndroid::HostPaintLCD (const EmScreenUpdateInfo& info, const EmRect
           target_buffer += (size.fX * 2);
           lcd_buffer += rowBytes;
         }
-	// Clean up.
-
-	Platform::DisposeMemory (saved_lcd_buffer);
 #if 0
   // Set the flag to tell the Android side to update the screen
   if (scaled) {
@@ -69,6 +69,10 @@ class EmWindowAndroid : public EmWindow
 	private:
                 EmCoord				m_width;
                 EmCoord				m_height;
+
+		// Staging buffer for HostPaintLCD, kept between calls.
+		uint8*					fLCDBuffer;
+		long					fLCDBufferSize;
 //		Fl_Box*					fMessage;
 //		Fl_Image*				fCachedSkin;
 };
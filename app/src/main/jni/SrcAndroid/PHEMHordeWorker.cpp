@@ -0,0 +1,227 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#include <time.h>
+#include <android/log.h>
+
+#include <stdlib.h>
+#include <string>
+#include "EmCommon.h"
+#include "EmApplicationAndroid.h"
+#include "omnithread.h"
+#include "PHEMNativeIF.h"
+
+#define  LOG_TAG    "phemhorde"
+#ifdef PHEM_LOGGING
+#define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,LOG_TAG,__VA_ARGS__)
+#else
+#define  LOGI(...)
+#endif
+#define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
+
+// This is the program Platform::StartHordeWorker runs to take a share of
+// a Gremlin Horde (see Hordes::StartWorkers). It's the emulator without
+// PHEMNativeIF.cpp: there's no Java side to show the screen, play sounds
+// or answer dialogs, so the functions below stand in for it. Startup makes
+// the session headless (see EmSession::IsHeadless) when it's given
+// -horde_worker, so the idle calls below seldom stop the CPU.
+//
+// Usage: libphemhorde.so <base dir> <emulator options...>
+
+// How long to wait between idle calls; about what the Java side does.
+#define IDLE_NANOSECONDS (10*1000*1000)
+
+static std::string PHEM_base_dir = "";
+static unsigned char *PHEM_buffer = NULL;
+
+int PHEM_mouse_x=0;
+int PHEM_mouse_y=0;
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    LOGE("Usage: %s <base dir> <emulator options...>", argv[0]);
+    return 1;
+  }
+
+  PHEM_base_dir = argv[1];
+
+  // The emulator wants its options right after the program name.
+  argv[1] = argv[0];
+  argc--;
+  argv++;
+
+  EmApplicationAndroid the_app;
+
+  try {
+    LOGI("Startup.");
+    if (!the_app.Startup(argc, argv)) {
+      LOGE("Bad options for a Horde worker!");
+      return 1;
+    }
+    LOGI("HandleStartupActions.");
+    the_app.HandleStartupActions();
+  } catch (...) {
+    LOGE("Yikes! Got exception starting up Horde worker!");
+    return 1;
+  }
+
+  // Hordes::EndHordes tells us when to quit, once our share is done.
+  while (!the_app.GetTimeToQuit()) {
+    omni_thread::sleep(0, IDLE_NANOSECONDS);
+    the_app.HandleIdle();
+  }
+
+  LOGI("Shutting down.");
+  the_app.Shutdown();
+
+  if (PHEM_buffer) {
+    free(PHEM_buffer);
+    PHEM_buffer = NULL;
+  }
+
+  return 0;
+}
+
+// *******************************************************
+// *** Functions called from elsewhere in the emulator ***
+// *******************************************************
+
+#ifdef PHEM_LOGGING
+void PHEM_Logger_Hex(unsigned int code)
+{
+  LOGI("PHEM code: %x", code);
+}
+
+void PHEM_Logger_Place(int code)
+{
+  LOGI("PHEM code: %d", code);
+}
+
+void PHEM_Logger_Msg(const char *msg)
+{
+  LOGI("PHEM msg: %s", msg);
+}
+#endif
+
+// Nobody's looking.
+void PHEM_Mark_Screen_Updated(int first, int last)
+{
+  UNUSED_PARAM(first);
+  UNUSED_PARAM(last);
+}
+
+// Where in the filesystem our roms and save files and stuff are
+const char *PHEM_Get_Base_Dir()
+{
+   return PHEM_base_dir.c_str();
+}
+
+// The emulator still draws the screen, so it needs somewhere to draw it.
+unsigned char *PHEM_Get_Buffer()
+{
+   return PHEM_buffer;
+}
+
+void PHEM_Reset_Window(int w, int h)
+{
+  if (PHEM_buffer) {
+    free(PHEM_buffer);
+  }
+  PHEM_buffer = (unsigned char *)calloc(1, w*h*2);
+  if (!PHEM_buffer) {
+    LOGE("Unable to allocate screen buffer!");
+  }
+}
+
+// No JVM to bind to.
+void PHEM_Bind_CPU_Thread()
+{
+}
+
+void PHEM_Unbind_CPU_Thread()
+{
+}
+
+// No host clipboard.
+const char *PHEM_Get_Host_Clip()
+{
+  return NULL;
+}
+
+void PHEM_Set_Host_Clip(const char *clip)
+{
+  UNUSED_PARAM(clip);
+}
+
+void PHEM_Queue_Sound(int freq, int dur, int amp)
+{
+  UNUSED_PARAM(freq);
+  UNUSED_PARAM(dur);
+  UNUSED_PARAM(amp);
+}
+
+void PHEM_Begin_Vibration()
+{
+}
+
+void PHEM_End_Vibration()
+{
+}
+
+void PHEM_Enable_LED(Bool draw)
+{
+  UNUSED_PARAM(draw);
+}
+
+void PHEM_Set_LED(RGBType color)
+{
+  UNUSED_PARAM(color);
+}
+
+// Dialogs
+// ******
+
+// Answer a dialog the way the user would by just hitting return: with the
+// default button, or else the cancel button.
+static EmDlgItemID PHEM_Answer_Dialog(PHEM_Dialog *dlg, int num_widgets)
+{
+  int i;
+
+  for (i=0; i<num_widgets; i++) {
+    if (dlg->widgets[i].visible && dlg->widgets[i].is_default) {
+      return dlg->widgets[i].item_id;
+    }
+  }
+  for (i=0; i<num_widgets; i++) {
+    if (dlg->widgets[i].visible && dlg->widgets[i].is_cancel) {
+      return dlg->widgets[i].item_id;
+    }
+  }
+  return kDlgItemNone;
+}
+
+#define NUM_COMMON_WIDGETS 4
+
+EmDlgItemID PHEM_Do_Common_Dialog(PHEM_Dialog *dlg)
+{
+  LOGI("Common dialog: %s", dlg->widgets[NUM_COMMON_WIDGETS-1].label);
+  return PHEM_Answer_Dialog(dlg, NUM_COMMON_WIDGETS);
+}
+
+#define NUM_RESET_WIDGETS 3
+
+EmDlgItemID PHEM_Do_Reset_Dialog(PHEM_Dialog *dlg)
+{
+  return PHEM_Answer_Dialog(dlg, NUM_RESET_WIDGETS);
+}
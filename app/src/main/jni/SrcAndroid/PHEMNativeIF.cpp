@@ -69,7 +69,12 @@ int g_allow_led;
 
 int g_screen_updated=0;
 int g_win_w, g_win_h;
-int g_first_line, g_last_line;
+// Rows changed since the last HandleIdle, as separate [first, last) runs,
+// so a change at the top of the screen and one at the bottom don't cost a
+// copy of everything in between. PHEMNativeIF.java allows for as many.
+#define MAX_DIRTY_RUNS 8
+int g_dirty_runs[MAX_DIRTY_RUNS][2];
+int g_num_dirty_runs = 0;
 
 // Reset handling
 int g_in_reset=0;
@@ -408,6 +413,7 @@ void Start_App(int argc, char *argv[])
 {
   // Clear this from the last time.
   g_screen_updated = 0;
+  g_num_dirty_runs = 0;
 
   // We have to create a thread to bind to the JVM, so we can get class
   // and method references to call.
@@ -444,16 +450,55 @@ static double now_ms(void) {
   return 1000.0 * res.tv_sec + (double) res.tv_nsec / 1e6;
 }
 
+// Add rows first..last (exclusive) to the dirty runs, merging it with any
+// runs it overlaps or touches. If we're out of room, merge it with the
+// closest one instead.
+static void Add_Dirty_Run(int first, int last)
+{
+  int i;
+
+  if (first >= last) {
+    return;
+  }
+  i = 0;
+  while (i < g_num_dirty_runs) {
+    if (first <= g_dirty_runs[i][1] && g_dirty_runs[i][0] <= last) {
+      first = std::min(first, g_dirty_runs[i][0]);
+      last = std::max(last, g_dirty_runs[i][1]);
+      g_num_dirty_runs--;
+      g_dirty_runs[i][0] = g_dirty_runs[g_num_dirty_runs][0];
+      g_dirty_runs[i][1] = g_dirty_runs[g_num_dirty_runs][1];
+    } else {
+      i++;
+    }
+  }
+  if (g_num_dirty_runs == MAX_DIRTY_RUNS) {
+    int closest = 0;
+    int closest_gap = 0;
+    for (i=0; i<g_num_dirty_runs; i++) {
+      int gap = (first > g_dirty_runs[i][1]) ? first - g_dirty_runs[i][1]
+                                             : g_dirty_runs[i][0] - last;
+      if (i == 0 || gap < closest_gap) {
+        closest = i;
+        closest_gap = gap;
+      }
+    }
+    first = std::min(first, g_dirty_runs[closest][0]);
+    last = std::max(last, g_dirty_runs[closest][1]);
+    g_num_dirty_runs--;
+    g_dirty_runs[closest][0] = g_dirty_runs[g_num_dirty_runs][0];
+    g_dirty_runs[closest][1] = g_dirty_runs[g_num_dirty_runs][1];
+  }
+  g_dirty_runs[g_num_dirty_runs][0] = first;
+  g_dirty_runs[g_num_dirty_runs][1] = last;
+  g_num_dirty_runs++;
+}
+
 // Flag so we know when to post changes to host
 void PHEM_Mark_Screen_Updated(int first, int last)
 {
   g_screen_updated = 1;
-  if (first < g_first_line) {
-    g_first_line = first;
-  }
-  if (last > g_last_line) {
-    g_last_line = last;
-  }
+  Add_Dirty_Run(first, last);
 
   // Try to detect when Palm OS has finished booting.
   if (g_in_reset) {
@@ -477,7 +522,7 @@ void PHEM_Mark_Screen_Updated(int first, int last)
   }
 
 #if 0
-  LOGI("Update lines: %d, %d", g_first_line, g_last_line);
+  LOGI("Update lines: %d, %d", first, last);
 #endif
 }
 
@@ -1400,12 +1445,15 @@ JNIEXPORT jint JNICALL Java_com_perpendox_phem_PHEMNativeIF_InstallPalmFile
 /*
  * Class:     com_perpendox_phem_PHEMNativeIF
  * Method:    HandleIdle
- * Signature: (Ljava/nio/ByteBuffer;)I
+ * Signature: (Ljava/nio/ByteBuffer;[I)I
  */
 JNIEXPORT jint JNICALL Java_com_perpendox_phem_PHEMNativeIF_HandleIdle
-  (JNIEnv *env, jclass clazz, jobject buf) {
+  (JNIEnv *env, jclass clazz, jobject buf, jintArray lines) {
   unsigned char *Java_buffer;
   //static int count = 0;
+  // The Java buffer we last copied into. A different one (new skin, say)
+  // doesn't have any of our pixels in it yet, so it gets everything.
+  static unsigned char *last_Java_buffer = NULL;
 
   // This function is called by the Java side to get updates on the emulator
   // state, in particular screen updates.
@@ -1423,25 +1471,67 @@ JNIEXPORT jint JNICALL Java_com_perpendox_phem_PHEMNativeIF_HandleIdle
 //                                      gApplication->avg_tps);
       if (g_screen_updated) {
         // Copying data from native to Android is expensive.
-        // So we only copy the changed region.
-        //LOGI("Updating buffer, lines: %d, %d", g_first_line, g_last_line);
-        if (g_last_line >= g_win_h) {
-          // For some reason, this can happen when the whole skin gets painted.
-          LOGI("Last line > skin size?");
-          g_last_line = g_win_h-1;
+        // So we only copy the changed runs of rows. Note that the last
+        // line of a run is exclusive; callers pass the bottom of the rect
+        // they painted.
+        if (Java_buffer != last_Java_buffer ||
+            env->GetDirectBufferCapacity(buf) != (jlong) PHEM_buffer_size) {
+          g_num_dirty_runs = 0;
+          Add_Dirty_Run(0, g_win_h);
+          last_Java_buffer = Java_buffer;
         }
-        long offset = g_first_line * (g_win_w * 2);
-        long updt_size = ((g_last_line - g_first_line) + 1) * (g_win_w * 2);
-        if (offset < 0 || offset+updt_size > PHEM_buffer_size) {
-           LOGE("Yikes! offset: %ld updt_size: %ld buffer size: %u",
+        // Tell the Java side which runs changed, in pairs, so it only has
+        // to invalidate those parts of the view. If it didn't leave room
+        // for them all, the last pair covers the rest.
+        jint ranges[MAX_DIRTY_RUNS*2];
+        int max_runs = (lines != NULL) ? env->GetArrayLength(lines) / 2 : 0;
+        if (max_runs > MAX_DIRTY_RUNS) {
+          max_runs = MAX_DIRTY_RUNS;
+        }
+        long row_bytes = g_win_w * 2;
+        int result = 0;
+        int copied = 0;
+        for (int i=0; i<g_num_dirty_runs; i++) {
+          int first = std::max(g_dirty_runs[i][0], 0);
+          // For some reason, the end can run past the bottom when the
+          // whole skin gets painted.
+          int last = std::min(g_dirty_runs[i][1], g_win_h);
+          long offset = first * row_bytes;
+          long updt_size = (last - first) * row_bytes;
+          if (offset+updt_size > (long) PHEM_buffer_size) {
+            LOGE("Yikes! offset: %ld updt_size: %ld buffer size: %u",
                  offset, updt_size, PHEM_buffer_size);
+            memcpy(Java_buffer, PHEM_buffer, PHEM_buffer_size);
+            ranges[0] = 0;
+            ranges[1] = g_win_h;
+            result = 1;
+            copied = 1;
+            break;
+          }
+          if (updt_size <= 0) {
+            continue;
+          }
+          //LOGI("Updating buffer, lines: %d, %d", first, last);
+          memcpy(Java_buffer+offset, PHEM_buffer+offset, updt_size);
+          copied = 1;
+          if (result < max_runs) {
+            ranges[result*2] = first;
+            ranges[result*2+1] = last;
+            result++;
+          } else if (max_runs > 0) {
+            ranges[result*2-2] = std::min((int) ranges[result*2-2], first);
+            ranges[result*2-1] = std::max((int) ranges[result*2-1], last);
+          }
+        }
+        if (result > 0 && max_runs > 0) {
+          env->SetIntArrayRegion(lines, 0, result*2, ranges);
+        } else if (copied) {
+          // Nowhere to say what changed; say there was something.
+          result = 1;
         }
-        //memcpy(Java_buffer+offset, PHEM_buffer+offset, updt_size);
-        memcpy(Java_buffer, PHEM_buffer, PHEM_buffer_size);
         g_screen_updated = 0; // clear for next time.
-        g_first_line = g_win_h+1;
-        g_last_line = 0;
-        return 1;
+        g_num_dirty_runs = 0;
+        return result;
       } else {
         //LOGI("No screen update.");
       }
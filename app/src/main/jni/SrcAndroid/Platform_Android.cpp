@@ -21,10 +21,15 @@
 #include "SessionFile.h"
 #include "Strings.r.h"			// kStr_ ...
 
+#include <dlfcn.h>				// dladdr
 #include <errno.h>				// EPERM, ENOENT, etc.
+#include <signal.h>				// kill
 #include <unistd.h>
+#include <sys/wait.h>			// waitpid
 #include <sys/time.h>
 #include <sys/stat.h>			// mkdir
+#include <sys/mman.h>			// mmap, munmap
+#include <fcntl.h>				// open
 #include <time.h>
 #include <ctype.h>
 
@@ -694,6 +699,113 @@ void Platform::RealDisposeMemory (void* p)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 Platform::AllocatePages
+// ---------------------------------------------------------------------------
+
+void* Platform::AllocatePages (size_t size)
+{
+	void*	result = mmap (NULL, size, PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (result == MAP_FAILED)
+		result = NULL;
+
+	Errors::ThrowIfNULL (result);
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 Platform::DisposePages
+// ---------------------------------------------------------------------------
+
+void Platform::DisposePages (void* p, size_t size)
+{
+	if (p)
+	{
+		munmap (p, size);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 Platform::MapFilePages
+// ---------------------------------------------------------------------------
+// Map part of a file over pages from AllocatePages.  The mapping is private,
+// so writes go to copies of the pages and never to the file, and pages are
+// only read in from the file when they're first touched.
+
+Bool Platform::MapFilePages (void* p, size_t size, const EmFileRef& f, long offset)
+{
+	long	pageSize = sysconf (_SC_PAGESIZE);
+
+	if (pageSize <= 0 ||
+		((size_t) p % pageSize) != 0 ||
+		(size % pageSize) != 0 ||
+		(offset % pageSize) != 0)
+	{
+		return false;
+	}
+
+	int		fd = open (f.GetFullPath ().c_str (), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	// Touching a page past the end of the file raises SIGBUS, so make
+	// sure it's all there.
+
+	struct stat	st;
+	if (fstat (fd, &st) != 0 || st.st_size < (off_t) (offset + size))
+	{
+		close (fd);
+		return false;
+	}
+
+	void*	result = mmap (p, size, PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_FIXED, fd, offset);
+
+	// The mapping holds its own reference to the file.
+
+	close (fd);
+
+	if (result == MAP_FAILED)
+	{
+		// The old pages may be gone; put some memory back.
+
+		mmap (p, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+
+		return false;
+	}
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 Platform::UnmapFilePages
+// ---------------------------------------------------------------------------
+
+void Platform::UnmapFilePages (void* p, size_t size)
+{
+	StMemory	copy (size);
+
+	memcpy (copy.Get (), p, size);
+
+	void*	result = mmap (p, size, PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+
+	if (result == MAP_FAILED)
+		result = NULL;
+
+	Errors::ThrowIfNULL (result);
+
+	memcpy (p, copy.Get (), size);
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	Platform::ForceStartupScreen
@@ -736,6 +848,90 @@ Bool Platform::StopOnResetKeyDown( void )
 }
 
 
+// ---------------------------------------------------------------------------
+//		 Platform::StartHordeWorker
+// ---------------------------------------------------------------------------
+// Horde workers are separate runs of the phemhorde program (see Android.mk
+// and PHEMHordeWorker.cpp).  It's packaged as a library so that it gets
+// installed next to ours, which is where we look for it.
+
+long Platform::StartHordeWorker (const StringList& options)
+{
+	Dl_info	info;
+
+	if (!dladdr ((void*) &Platform::StartHordeWorker, &info) || !info.dli_fname)
+		return -1;
+
+	string	path (info.dli_fname);
+	string::size_type	slash = path.rfind ('/');
+
+	if (slash == string::npos)
+		return -1;
+
+	path.replace (slash + 1, string::npos, "libphemhorde.so");
+
+	// Build the argument list before forking.  We're a multi-threaded
+	// process, so between fork and exec the child can't touch anything
+	// that another thread might have been holding a lock on -- including
+	// the heap.
+
+	vector<char*>	argv;
+
+	argv.push_back ((char*) path.c_str ());
+	argv.push_back ((char*) PHEM_Get_Base_Dir ());
+
+	StringList::const_iterator	iter = options.begin ();
+	while (iter != options.end ())
+	{
+		argv.push_back ((char*) iter->c_str ());
+		++iter;
+	}
+
+	argv.push_back (NULL);
+
+	pid_t	pid = fork ();
+
+	if (pid == 0)
+	{
+		execv (argv[0], &argv[0]);
+		_exit (127);
+	}
+
+	return pid;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 Platform::WaitForHordeWorker
+// ---------------------------------------------------------------------------
+
+Bool Platform::WaitForHordeWorker (long worker)
+{
+	int		status;
+	pid_t	result;
+
+	do
+	{
+		result = waitpid ((pid_t) worker, &status, 0);
+	}
+	while (result < 0 && errno == EINTR);
+
+	return result == (pid_t) worker && WIFEXITED (status) && WEXITSTATUS (status) == 0;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 Platform::KillHordeWorker
+// ---------------------------------------------------------------------------
+
+void Platform::KillHordeWorker (long worker)
+{
+	kill ((pid_t) worker, SIGKILL);
+
+	(void) Platform::WaitForHordeWorker (worker);
+}
+
+
 // ---------------------------------------------------------------------------
 //		 Platform::CollectOptions
 // ---------------------------------------------------------------------------
@@ -82,10 +82,10 @@ JNIEXPORT jint JNICALL Java_com_perpendox_phem_PHEMNativeIF_InstallPalmFile
 /*
  * Class:     com_perpendox_phem_PHEMNativeIF
  * Method:    HandleIdle
- * Signature: (Ljava/nio/ByteBuffer;)I
+ * Signature: (Ljava/nio/ByteBuffer;[I)I
  */
 JNIEXPORT jint JNICALL Java_com_perpendox_phem_PHEMNativeIF_HandleIdle
-  (JNIEnv *, jclass, jobject);
+  (JNIEnv *, jclass, jobject, jintArray);
 
 /*
  * Class:     com_perpendox_phem_PHEMNativeIF
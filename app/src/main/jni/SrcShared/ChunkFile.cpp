@@ -34,7 +34,12 @@
  ***********************************************************************/
 
 ChunkFile::ChunkFile (EmStream& s) :
-	fStream (s)
+	fStream (s),
+	fIndex (),
+	fHaveIndex (false),
+	fWritten (),
+	fWriteEnd (0),
+	fWroteAll (true)
 {
 }
 
@@ -43,7 +48,9 @@ ChunkFile::ChunkFile (EmStream& s) :
  *
  * FUNCTION:	ChunkFile destructor
  *
- * DESCRIPTION:	Releases ChunkFile resources.  Currently does nothing.
+ * DESCRIPTION:	Releases ChunkFile resources.  If this object wrote
+ *				every chunk in the file, a chunk directory is appended
+ *				to it.
  *
  * PARAMETERS:	None
  *
@@ -53,6 +60,22 @@ ChunkFile::ChunkFile (EmStream& s) :
 
 ChunkFile::~ChunkFile (void)
 {
+	if (!fWritten.empty () && fWroteAll)
+	{
+		// Don't let exceptions escape from the destructor.  If the
+		// directory can't be written, readers fall back to scanning.
+
+		try
+		{
+			if (fStream.GetLength () == fWriteEnd)
+			{
+				this->WriteDirectory ();
+			}
+		}
+		catch (...)
+		{
+		}
+	}
 }
 
 
@@ -75,34 +98,19 @@ ChunkFile::~ChunkFile (void)
 
 long ChunkFile::FindChunk (Tag targetTag)
 {
-	long	len = kChunkNotFound;
-	long	fileOffset = 0;
-	long	fileLength = fStream.GetLength ();
-
-	fStream.SetMarker (fileOffset, kStreamFromStart);
-
-	while (fileOffset < fileLength)
+	if (!fHaveIndex)
 	{
-		Tag		chunkTag;
-		long	chunkLen;
+		this->BuildIndex ();
+	}
 
-		fStream.GetBytes (&chunkTag, sizeof (chunkTag));
-		fStream.GetBytes (&chunkLen, sizeof (chunkLen));
+	Index::iterator	iter = fIndex.find (targetTag);
 
-		Canonical (chunkTag);
-		Canonical (chunkLen);
+	if (iter == fIndex.end ())
+		return kChunkNotFound;
 
-		if (chunkTag == targetTag)
-		{
-			len = chunkLen;
-			break;
-		}
+	fStream.SetMarker (iter->second.fOffset, kStreamFromStart);
 
-		fStream.SetMarker (chunkLen, kStreamFromMarker);
-		fileOffset += sizeof (chunkTag) + sizeof (chunkLen) + chunkLen;
-	}
-
-	return len;
+	return iter->second.fSize;
 }
 
 
@@ -141,6 +149,17 @@ Bool ChunkFile::ReadChunk (int index, Tag& tag, Chunk& chunk)
 		Canonical (chunkTag);
 		Canonical (chunkLen);
 
+		// Skip over the chunk directory.  It describes this file only,
+		// and callers iterating over the chunks are usually copying them
+		// to another file.
+
+		if (chunkTag == kDirectoryTag || chunkTag == kTrailerTag)
+		{
+			fStream.SetMarker (chunkLen, kStreamFromMarker);
+			fileOffset += sizeof (chunkTag) + sizeof (chunkLen) + chunkLen;
+			continue;
+		}
+
 		// If this is the chunk we're looking for, read it in.
 
 		if (index == 0)
@@ -483,23 +502,313 @@ void ChunkFile::ReadChunk (uint32 size, void* data)
  ***********************************************************************/
 
 void ChunkFile::WriteChunk (Tag tag, uint32 size, const void* data)
+{
+	this->WriteChunk (tag, 0, NULL, size, data);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ChunkFile::WriteChunk
+ *
+ * DESCRIPTION:	Write a chunk whose data is in two pieces: a header,
+ *				and the data that follows it.  This saves having to
+ *				copy a large block of data just to put something in
+ *				front of it.
+ *
+ * PARAMETERS:	tag - marker for the data being written.
+ *
+ *				headerSize - number of bytes in the header.
+ *
+ *				header - pointer to buffer containing the header.
+ *
+ *				size - number of bytes following the header.
+ *
+ *				data - pointer to buffer containing those bytes.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void ChunkFile::WriteChunk (Tag tag, uint32 headerSize, const void* header,
+							uint32 size, const void* data)
 {
 	// Write the 4-byte tag in Big Endian format.
 
 	Canonical (tag);
 	fStream.PutBytes (&tag, sizeof (tag));
+	Canonical (tag);
 
-	// Write the chunk size in Big Endian format.  Return the size
-	// back to host format when done so that it can be used to write
-	// the actual data.
+	// Write the chunk size in Big Endian format.
 
-	Canonical (size);
-	fStream.PutBytes (&size, sizeof (size));
-	Canonical (size);
+	uint32	chunkSize = headerSize + size;
+
+	Canonical (chunkSize);
+	fStream.PutBytes (&chunkSize, sizeof (chunkSize));
+	Canonical (chunkSize);
 
 	// Write the chunk data.
 
+	long	offset = fStream.GetMarker ();
+
+	if (headerSize > 0)
+	{
+		fStream.PutBytes (header, headerSize);
+	}
+
 	fStream.PutBytes (data, size);
+
+	// Remember where the chunk went.  The directory is only written if
+	// all of the chunks were written back-to-back from the start of the
+	// file; anything else (data copied in through the stream, seeking
+	// back over earlier chunks) means we don't know everything that's
+	// in the file.
+
+	if (offset != fWriteEnd + (long) (sizeof (tag) + sizeof (chunkSize)))
+	{
+		fWroteAll = false;
+	}
+
+	IndexEntry	entry;
+	entry.fOffset = offset;
+	entry.fSize = chunkSize;
+
+	fWritten.insert (Index::value_type (tag, entry));
+	fWriteEnd = offset + chunkSize;
+
+	// Any index we read in no longer describes the file.  Throw it
+	// away; it will be rebuilt if needed.
+
+	fIndex.clear ();
+	fHaveIndex = false;
+}
+
+
+#pragma mark -
+
+/***********************************************************************
+ *
+ * FUNCTION:	ChunkFile::BuildIndex
+ *
+ * DESCRIPTION:	Build the in-memory map from tags to chunk locations.
+ *				The directory at the end of the file is used if there
+ *				is a valid one; otherwise, the chunk headers are
+ *				walked once.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void ChunkFile::BuildIndex (void)
+{
+	if (!this->ReadDirectory ())
+	{
+		this->ScanChunks ();
+	}
+
+	fHaveIndex = true;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ChunkFile::ReadDirectory
+ *
+ * DESCRIPTION:	Fill in the index from the chunk directory at the end
+ *				of the file.  Every offset and size is checked against
+ *				the file length before it is accepted.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	True if the file had a valid directory.
+ *
+ ***********************************************************************/
+
+Bool ChunkFile::ReadDirectory (void)
+{
+	fIndex.clear ();
+
+	long	fileLength = fStream.GetLength ();
+
+	if (fileLength < kTrailerSize)
+		return false;
+
+	// Read the trailer.
+
+	Tag		chunkTag;
+	long	chunkLen;
+	long	dirOffset;
+
+	fStream.SetMarker (fileLength - kTrailerSize, kStreamFromStart);
+	fStream.GetBytes (&chunkTag, sizeof (chunkTag));
+	fStream.GetBytes (&chunkLen, sizeof (chunkLen));
+	fStream.GetBytes (&dirOffset, sizeof (dirOffset));
+
+	Canonical (chunkTag);
+	Canonical (chunkLen);
+	Canonical (dirOffset);
+
+	if (chunkTag != kTrailerTag || chunkLen != sizeof (dirOffset))
+		return false;
+
+	long	dirLimit = fileLength - kTrailerSize;
+
+	if (dirOffset < 0 || dirOffset > dirLimit - (long) (sizeof (chunkTag) + sizeof (chunkLen)))
+		return false;
+
+	// Read the directory.
+
+	fStream.SetMarker (dirOffset, kStreamFromStart);
+	fStream.GetBytes (&chunkTag, sizeof (chunkTag));
+	fStream.GetBytes (&chunkLen, sizeof (chunkLen));
+
+	Canonical (chunkTag);
+	Canonical (chunkLen);
+
+	long	dataOffset = dirOffset + sizeof (chunkTag) + sizeof (chunkLen);
+
+	if (chunkTag != kDirectoryTag || chunkLen < 8 || chunkLen > dirLimit - dataOffset)
+		return false;
+
+	Chunk	directory (chunkLen);
+	this->ReadChunk (chunkLen, directory.GetPointer ());
+
+	EmStreamChunk	s (directory);
+	uint32			version;
+	uint32			count;
+
+	s >> version;
+	s >> count;
+
+	if (version != kDirectoryVersion || count > (uint32) (chunkLen - 8) / 12)
+		return false;
+
+	for (uint32 ii = 0; ii < count; ++ii)
+	{
+		uint32	tag;
+		uint32	offset;
+		uint32	size;
+
+		s >> tag;
+		s >> offset;
+		s >> size;
+
+		if (offset > (uint32) dirOffset || size > (uint32) dirOffset - offset)
+		{
+			fIndex.clear ();
+			return false;
+		}
+
+		IndexEntry	entry;
+		entry.fOffset = offset;
+		entry.fSize = size;
+
+		fIndex.insert (Index::value_type (tag, entry));
+	}
+
+	return true;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ChunkFile::ScanChunks
+ *
+ * DESCRIPTION:	Fill in the index by walking the chunk headers from the
+ *				start of the file.  If a tag appears more than once,
+ *				the first chunk wins, as it always has.  Directory
+ *				chunks are not indexed.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void ChunkFile::ScanChunks (void)
+{
+	fIndex.clear ();
+
+	long	fileOffset = 0;
+	long	fileLength = fStream.GetLength ();
+
+	fStream.SetMarker (fileOffset, kStreamFromStart);
+
+	while (fileOffset < fileLength)
+	{
+		Tag		chunkTag;
+		long	chunkLen;
+
+		if (fileLength - fileOffset < (long) (sizeof (chunkTag) + sizeof (chunkLen)))
+			break;
+
+		fStream.GetBytes (&chunkTag, sizeof (chunkTag));
+		fStream.GetBytes (&chunkLen, sizeof (chunkLen));
+
+		Canonical (chunkTag);
+		Canonical (chunkLen);
+
+		fileOffset += sizeof (chunkTag) + sizeof (chunkLen);
+
+		if (chunkLen < 0 || chunkLen > fileLength - fileOffset)
+			break;
+
+		if (chunkTag != kDirectoryTag && chunkTag != kTrailerTag)
+		{
+			IndexEntry	entry;
+			entry.fOffset = fileOffset;
+			entry.fSize = chunkLen;
+
+			// insert() leaves any existing entry alone.
+
+			fIndex.insert (Index::value_type (chunkTag, entry));
+		}
+
+		fStream.SetMarker (chunkLen, kStreamFromMarker);
+		fileOffset += chunkLen;
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ChunkFile::WriteDirectory
+ *
+ * DESCRIPTION:	Append the chunk directory and its trailer to the end
+ *				of the file, describing the chunks this object wrote.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	Nothing (exceptions can be thrown).
+ *
+ ***********************************************************************/
+
+void ChunkFile::WriteDirectory (void)
+{
+	Chunk			directory;
+	EmStreamChunk	s (directory);
+
+	s << (uint32) kDirectoryVersion;
+	s << (uint32) fWritten.size ();
+
+	Index::iterator	iter = fWritten.begin ();
+	while (iter != fWritten.end ())
+	{
+		s << (uint32) iter->first;
+		s << (uint32) iter->second.fOffset;
+		s << (uint32) iter->second.fSize;
+
+		++iter;
+	}
+
+	long	dirOffset = fWriteEnd;
+
+	fStream.SetMarker (dirOffset, kStreamFromStart);
+
+	this->WriteChunk (kDirectoryTag, directory);
+	this->WriteInt (kTrailerTag, (uint32) dirOffset);
 }
 
 
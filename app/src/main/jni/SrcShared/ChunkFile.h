@@ -16,6 +16,8 @@
 
 #include "EmStream.h"			// EmStream
 
+#include <map>					// map
+
 class Chunk;
 
 
@@ -43,6 +45,26 @@ class Chunk;
 	are stored in Big Endian format.  Strings are stored without
 	the NULL terminator.  Data is packed as tightly as possible;
 	there's no word or longword alignment.
+
+	When a ChunkFile has written every chunk in a file, it appends
+	a directory when it's destroyed:
+
+		tag: 'cdir'
+		size: 8 + 12 * count
+		data: version (4 bytes), count (4 bytes), and then "count"
+			entries of tag, data offset, and size (4 bytes each)
+
+		tag: 'cdx '
+		size: 4
+		data: offset of the 'cdir' chunk from the start of the file
+
+	The 'cdx ' chunk is always the last 12 bytes of the file, so a
+	reader can find the directory with two seeks and then locate any
+	chunk directly.  Files without a directory (or with one that
+	doesn't check out) are indexed by walking the chunk headers once.
+	Either way, the index is built the first time a chunk is looked
+	up by tag.  Older readers skip the directory chunks as they would
+	any other unknown chunk.
  */
 
 class ChunkFile
@@ -71,6 +93,8 @@ class ChunkFile
 
 		void					WriteChunk		(Tag tag, const Chunk&);
 		void					WriteChunk		(Tag tag, uint32 size, const void* data);
+		void					WriteChunk		(Tag tag, uint32 headerSize, const void* header,
+												 uint32 size, const void* data);
 		void					WriteInt		(Tag tag, uint8);
 		void					WriteInt		(Tag tag, int8);
 		void					WriteInt		(Tag tag, uint16);
@@ -83,7 +107,33 @@ class ChunkFile
 		EmStream&				GetStream		(void) const;
 
 	private:
+		enum
+		{
+			kDirectoryTag		= 'cdir',
+			kTrailerTag			= 'cdx ',
+			kDirectoryVersion	= 1,
+			kTrailerSize		= 12
+		};
+
+		struct IndexEntry
+		{
+			long	fOffset;		// Offset of the chunk data
+			long	fSize;			// Size of the chunk data
+		};
+
+		typedef map<Tag, IndexEntry>	Index;
+
+		void					BuildIndex		(void);
+		Bool					ReadDirectory	(void);
+		void					ScanChunks		(void);
+		void					WriteDirectory	(void);
+
 		EmStream&				fStream;
+		Index					fIndex;			// Chunks found when reading
+		Bool					fHaveIndex;
+		Index					fWritten;		// Chunks we've written
+		long					fWriteEnd;		// End of the last chunk written
+		Bool					fWroteAll;		// Wrote every chunk in the file
 };
 
 
@@ -27,6 +27,7 @@
 #include "EmPalmFunction.h"		// SysTrapIndex, IsSystemTrap
 #include "EmPatchState.h"		// EmPatchState::UIInitialized
 #include "EmSession.h"			// EmSessionStopper, SuspendByDebugger
+#include "EmSessionContext.h"	// EM_SESSION_GLOBAL
 #include "ErrorHandling.h"		// ReportUnhandledException
 #include "Logging.h"			// gErrLog
 #include "MetaMemory.h"			// MetaMemory::MarkInstructionBreak
@@ -93,6 +94,7 @@ static Bool			PrvParseUnsigned		(const char **ps, uint32 *u);
 // ----- Saved variables -----------------------------------------------------
 
 DebugGlobalsType		gDebuggerGlobals;
+EM_SESSION_GLOBAL (gDebuggerGlobals);
 
 
 // ----- UnSaved variables ---------------------------------------------------
@@ -112,6 +114,10 @@ emuptr	gExceptionAddress;
 int		gExceptionSize;
 Bool	gExceptionForRead;
 
+EM_SESSION_GLOBAL (gExceptionAddress);
+EM_SESSION_GLOBAL (gExceptionSize);
+EM_SESSION_GLOBAL (gExceptionForRead);
+
 
 // If we're listening for a debugger connection, the first three sockets
 // contain references to those listening entities.	As soon as a connection
@@ -28,7 +28,7 @@
 #include "EmWindow.h"			// gWindow
 #include "ErrorHandling.h"		// Errors::ReportIfError
 #include "HostControl.h"		// hostSignalQuit
-#include "Startup.h"			// CreateSession, OpenSession, DetermineStartupActions
+#include "Startup.h"			// CreateSession, OpenSession, DetermineStartupActions, HordeWorker
 #include "Strings.r.h"			// kStr_CmdAbout, etc.
 
 #include "DebugMgr.h"			// Debug::Startup
@@ -271,9 +271,18 @@ void EmApplication::Shutdown (void)
 	gTracer.Dispose ();
 #endif
 
-	// Save the preferences.
+	// Save the preferences.  A process running part of a Horde shares
+	// the preferences file with the one that started it, and leaves it
+	// to that one to save them.
 
-	gPrefs->Save ();
+	long		index;
+	long		count;
+	EmDirRef	dir;
+
+	if (!Startup::HordeWorker (index, count, dir))
+	{
+		gPrefs->Save ();
+	}
 }
 
 
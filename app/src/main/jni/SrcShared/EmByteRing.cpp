@@ -0,0 +1,209 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+
+#include "EmCommon.h"
+#include "EmByteRing.h"
+
+#include "Platform.h"			// Platform::AllocateMemory
+
+#include <string.h>				// memcpy
+
+
+// The ring indices are shared between threads.  The producer stores its
+// bytes and then publishes the new fHead; the consumer reads fHead and
+// then the bytes, and publishes fTail once it's done with them.
+
+#define PrvLoadAcquire(p)		__atomic_load_n (p, __ATOMIC_ACQUIRE)
+#define PrvStoreRelease(p, v)	__atomic_store_n (p, v, __ATOMIC_RELEASE)
+
+
+// ---------------------------------------------------------------------------
+//		 EmByteRing::EmByteRing
+// ---------------------------------------------------------------------------
+
+EmByteRing::EmByteRing (long capacity) :
+	fBuffer (NULL),
+	fMask (0),
+	fCapacity ((uint32) capacity),
+	fHead (0),
+	fTail (0)
+{
+	// Round the buffer up to a power of two so that we can wrap the
+	// indices with a mask.
+
+	uint32	size = 1;
+	while (size < fCapacity)
+		size <<= 1;
+
+	fBuffer = (uint8*) Platform::AllocateMemory (size);
+	fMask = size - 1;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmByteRing::~EmByteRing
+// ---------------------------------------------------------------------------
+
+EmByteRing::~EmByteRing (void)
+{
+	Platform::DisposeMemory (fBuffer);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmByteRing::Put
+// ---------------------------------------------------------------------------
+
+long EmByteRing::Put (const void* data, long len)
+{
+	uint32	head = fHead;
+	uint32	tail = PrvLoadAcquire (&fTail);
+	uint32	room = fCapacity - (head - tail);
+
+	if (len <= 0)
+		return 0;
+
+	if ((uint32) len > room)
+		len = (long) room;
+
+	// Copy up to the end of the buffer, then wrap around to the start.
+
+	uint32	offset	= head & fMask;
+	uint32	first	= fMask + 1 - offset;
+
+	if (first > (uint32) len)
+		first = (uint32) len;
+
+	memcpy (fBuffer + offset, data, first);
+	memcpy (fBuffer, ((const uint8*) data) + first, len - first);
+
+	PrvStoreRelease (&fHead, head + (uint32) len);
+
+	return len;
+}
+
+
+void EmByteRing::Put (uint8 value)
+{
+	uint32	head = fHead;
+	uint32	tail = PrvLoadAcquire (&fTail);
+
+	// Make sure there's room in the ring (this shouldn't happen,
+	// because the caller should always call GetFree before Put).
+
+	if (head - tail >= fCapacity)
+	{
+		EmAssert (false);
+		return;
+	}
+
+	fBuffer[head & fMask] = value;
+
+	PrvStoreRelease (&fHead, head + 1);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmByteRing::GetFree
+// ---------------------------------------------------------------------------
+
+long EmByteRing::GetFree (void)
+{
+	return (long) (fCapacity - (fHead - PrvLoadAcquire (&fTail)));
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmByteRing::Get
+// ---------------------------------------------------------------------------
+
+long EmByteRing::Get (void* data, long len)
+{
+	uint32	head = PrvLoadAcquire (&fHead);
+	uint32	tail = fTail;
+	uint32	used = head - tail;
+
+	if (len <= 0)
+		return 0;
+
+	if ((uint32) len > used)
+		len = (long) used;
+
+	uint32	offset	= tail & fMask;
+	uint32	first	= fMask + 1 - offset;
+
+	if (first > (uint32) len)
+		first = (uint32) len;
+
+	memcpy (data, fBuffer + offset, first);
+	memcpy (((uint8*) data) + first, fBuffer, len - first);
+
+	// Hand the space back to the producer.
+
+	PrvStoreRelease (&fTail, tail + (uint32) len);
+
+	return len;
+}
+
+
+uint8 EmByteRing::Get (void)
+{
+	uint32	head = PrvLoadAcquire (&fHead);
+	uint32	tail = fTail;
+
+	// Make sure there's something in the ring (this shouldn't happen,
+	// because the caller should always call GetUsed before Get).
+
+	if (head == tail)
+	{
+		EmAssert (false);
+		return 0;
+	}
+
+	uint8	result = fBuffer[tail & fMask];
+
+	PrvStoreRelease (&fTail, tail + 1);
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmByteRing::GetUsed
+// ---------------------------------------------------------------------------
+
+long EmByteRing::GetUsed (void)
+{
+	return (long) (PrvLoadAcquire (&fHead) - fTail);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmByteRing::Clear
+// ---------------------------------------------------------------------------
+
+void EmByteRing::Clear (void)
+{
+	PrvStoreRelease (&fTail, PrvLoadAcquire (&fHead));
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmByteRing::GetMaxSize
+// ---------------------------------------------------------------------------
+
+long EmByteRing::GetMaxSize (void) const
+{
+	return (long) fCapacity;
+}
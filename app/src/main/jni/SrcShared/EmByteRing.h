@@ -0,0 +1,64 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+
+#ifndef EmByteRing_h
+#define EmByteRing_h
+
+/*
+	EmByteRing is a fixed-capacity byte FIFO shared by exactly one
+	producer thread and one consumer thread.  Neither side takes a lock:
+	bytes go into a ring buffer, and the two sides only share the ring
+	indices.  Bytes move in and out with at most two memcpys per call,
+	so a burst of serial data costs the same as a single byte.
+
+	Put stores as many bytes as fit and returns how many that was; it
+	never blocks.  The capacity is exact (the UART FIFOs report "full"
+	and "half full" against it), even though the buffer behind it is
+	rounded up to a power of two.
+
+	Clear belongs to the consumer side; it discards whatever hasn't been
+	read yet.  If more than one thread can produce, the owner must keep
+	them out of each others' way itself.
+*/
+
+class EmByteRing
+{
+	public:
+								EmByteRing			(long capacity);
+								~EmByteRing			(void);
+
+		// Producer side.
+
+		long					Put 				(const void* data, long len);
+		void					Put 				(uint8 value);
+		long 					GetFree				(void);
+
+		// Consumer side.
+
+		long					Get 				(void* data, long len);
+		uint8					Get 				(void);
+		long 					GetUsed				(void);
+		void					Clear				(void);
+
+		long					GetMaxSize			(void) const;
+
+	private:
+		uint8*					fBuffer;
+		uint32					fMask;
+		uint32					fCapacity;
+		uint32					fHead;				// Next byte to fill.  Only the producer writes this.
+		uint32					fTail;				// Next byte to empty.  Only the consumer writes this.
+};
+
+#endif	// EmByteRing_h
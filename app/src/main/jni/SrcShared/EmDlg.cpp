@@ -21,6 +21,7 @@
 #include "EmBankSRAM.h"			// EmBankSRAM::ValidAddress
 #include "EmEventPlayback.h"	// GetCurrentEvent, GetNumEvents
 #include "EmFileImport.h"		// EmFileImport
+#include "EmMemory.h"			// Memory::InvalidateFastPages
 #include "EmMinimize.h"			// EmMinimize::Stop
 #include "EmPatchState.h"		// EmPatchState::UIInitialized
 #include "EmROMTransfer.h"		// EmROMTransfer
@@ -4003,6 +4004,10 @@ EmDlgFnResult EmDlg::PrvEditBreakpoints (EmDlgContext& context)
 					{
 						gDebuggerGlobals.watchAddr = EmDlg::GetItemValue (dlg, kDlgItemBrkStartAddress);
 						gDebuggerGlobals.watchBytes = EmDlg::GetItemValue (dlg, kDlgItemBrkNumberOfBytes);
+
+						// Writes need to go through the handlers for CheckStepSpy to see them.
+
+						Memory::InvalidateFastPages ();
 					}
 
 					// Fall thru...
@@ -0,0 +1,237 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#include "EmCommon.h"
+#include "EmInputQueue.h"
+
+#include "Platform.h"			// Platform::AllocateMemory
+
+#include <new>					// placement new
+
+
+// The ring indices are shared between threads.  A producer stores an
+// event and then publishes the new fHead; the consumer reads fHead and
+// then the event.  The acquire/release pairs make sure each side sees the
+// other's event data by the time it sees the index that covers it.
+
+#define PrvLoadAcquire(p)		__atomic_load_n (p, __ATOMIC_ACQUIRE)
+#define PrvStoreRelease(p, v)	__atomic_store_n (p, v, __ATOMIC_RELEASE)
+
+
+// ---------------------------------------------------------------------------
+//		 EmInputQueue::EmInputQueue
+// ---------------------------------------------------------------------------
+
+template <class T>
+EmInputQueue<T>::EmInputQueue (int maxSize) :
+	fPutMutex (),
+	fOverflow (),
+	fOverflowUsed (0),
+	fBuffer (NULL),
+	fMask (0),
+	fHead (0),
+	fTail (0)
+{
+	// Round the size up to a power of two so that we can wrap the indices
+	// with a mask.
+
+	uint32	size = 1;
+	while (size < (uint32) maxSize)
+		size <<= 1;
+
+	fBuffer = (uint8*) Platform::AllocateMemory (size * sizeof (T));
+	fMask = size - 1;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmInputQueue::~EmInputQueue
+// ---------------------------------------------------------------------------
+
+template <class T>
+EmInputQueue<T>::~EmInputQueue (void)
+{
+	this->Clear ();
+
+	Platform::DisposeMemory (fBuffer);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmInputQueue::Put
+// ---------------------------------------------------------------------------
+
+template <class T>
+void EmInputQueue<T>::Put (const T& value)
+{
+	omni_mutex_lock	lock (fPutMutex);
+
+	uint32	head = fHead;
+	uint32	tail = PrvLoadAcquire (&fTail);
+
+	// Keep events in order: once anything's gone to the overflow list,
+	// everything does until the consumer's caught up.
+
+	if (fOverflow.empty () && head - tail <= fMask)
+	{
+		new (this->Slot (head)) T (value);
+		PrvStoreRelease (&fHead, head + 1);
+	}
+	else
+	{
+		fOverflow.push_back (value);
+		PrvStoreRelease (&fOverflowUsed, (uint32) fOverflow.size ());
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmInputQueue::IsEmpty
+// ---------------------------------------------------------------------------
+
+template <class T>
+Bool EmInputQueue<T>::IsEmpty (void)
+{
+	return	PrvLoadAcquire (&fHead) == fTail &&
+			PrvLoadAcquire (&fOverflowUsed) == 0;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmInputQueue::Peek
+// ---------------------------------------------------------------------------
+
+template <class T>
+T EmInputQueue<T>::Peek (void)
+{
+	// Make sure there's something in the queue (this shouldn't happen,
+	// because the caller should always call IsEmpty before Peek).
+
+	if (PrvLoadAcquire (&fHead) == fTail && !this->Refill ())
+	{
+		EmAssert (false);
+	}
+
+	return *this->Slot (fTail);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmInputQueue::Get
+// ---------------------------------------------------------------------------
+
+template <class T>
+T EmInputQueue<T>::Get (void)
+{
+	// Make sure there's something in the queue (this shouldn't happen,
+	// because the caller should always call IsEmpty before Get).
+
+	if (PrvLoadAcquire (&fHead) == fTail && !this->Refill ())
+	{
+		EmAssert (false);
+	}
+
+	T*	slot	= this->Slot (fTail);
+	T	result	= *slot;
+
+	slot->~T ();
+
+	// Hand the slot back to the producers.
+
+	PrvStoreRelease (&fTail, fTail + 1);
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmInputQueue::GetUsed
+// ---------------------------------------------------------------------------
+
+template <class T>
+int EmInputQueue<T>::GetUsed (void)
+{
+	return	(int) (PrvLoadAcquire (&fHead) - fTail) +
+			(int) PrvLoadAcquire (&fOverflowUsed);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmInputQueue::Clear
+// ---------------------------------------------------------------------------
+
+template <class T>
+void EmInputQueue<T>::Clear (void)
+{
+	omni_mutex_lock	lock (fPutMutex);
+
+	fOverflow.clear ();
+	fOverflowUsed = 0;
+
+	while (fTail != fHead)
+	{
+		this->Slot (fTail)->~T ();
+		++fTail;
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmInputQueue::Slot
+// ---------------------------------------------------------------------------
+
+template <class T>
+T* EmInputQueue<T>::Slot (uint32 index)
+{
+	return ((T*) fBuffer) + (index & fMask);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmInputQueue::Refill
+// ---------------------------------------------------------------------------
+// Called by the consumer when the ring's empty.  Move whatever's in the
+// overflow list into the ring.  Returns true if there's now something in
+// the ring.
+
+template <class T>
+Bool EmInputQueue<T>::Refill (void)
+{
+	if (PrvLoadAcquire (&fOverflowUsed) == 0)
+		return false;
+
+	omni_mutex_lock	lock (fPutMutex);
+
+	uint32	head = fHead;
+
+	while (!fOverflow.empty () && head - fTail <= fMask)
+	{
+		new (this->Slot (head)) T (fOverflow.front ());
+		fOverflow.pop_front ();
+		++head;
+	}
+
+	PrvStoreRelease (&fHead, head);
+	PrvStoreRelease (&fOverflowUsed, (uint32) fOverflow.size ());
+
+	return head != fTail;
+}
+
+
+// Instantiate the ones we want.
+
+#include "EmSession.h"			// EmButtonEvent, EmKeyEvent, EmPenEvent
+
+template class EmInputQueue<EmButtonEvent>;
+template class EmInputQueue<EmKeyEvent>;
+template class EmInputQueue<EmPenEvent>;
@@ -0,0 +1,74 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#ifndef EmInputQueue_h
+#define EmInputQueue_h
+
+#include "omnithread.h"
+
+#include <deque>
+
+/*
+	EmInputQueue carries pen, key, and button events from the UI thread
+	to the CPU thread.  The CPU thread polls it all the time, so unlike
+	EmThreadSafeQueue, the consumer side never takes a lock: events go
+	into a fixed-size ring buffer, and the two sides only share the ring
+	indices.
+
+	The producer side does take a lock, but only to keep producers out
+	of each others' way; the CPU thread occasionally posts events of its
+	own.  If the ring fills up (say, the CPU thread is stopped while the
+	user scribbles on the screen) events go into an overflow list
+	instead, and the consumer moves them into the ring, under the
+	producer lock, once it's drained.  So nothing is ever dropped.
+
+	Only one thread at a time may call the consumer methods.  That's
+	normally the CPU thread, or a thread that's stopped it with an
+	EmSessionStopper.
+*/
+
+template <class T>
+class EmInputQueue
+{
+	public:
+								EmInputQueue		(int maxSize = 256);
+								~EmInputQueue		(void);
+
+		// Producer side.
+
+		void					Put 				(const T&);
+
+		// Consumer side.
+
+		Bool					IsEmpty				(void);
+		T						Peek 				(void);
+		T						Get 				(void);
+		int 					GetUsed				(void);
+		void					Clear				(void);
+
+	private:
+		T*						Slot				(uint32 index);
+		Bool					Refill				(void);
+
+	private:
+		omni_mutex				fPutMutex;
+		deque<T>				fOverflow;			// Guarded by fPutMutex.
+		uint32					fOverflowUsed;		// fOverflow.size (), for lock-free peeking.
+
+		uint8*					fBuffer;
+		uint32					fMask;
+		uint32					fHead;				// Next slot to fill.  Only producers write this.
+		uint32					fTail;				// Next slot to empty.  Only the consumer writes this.
+};
+
+#endif	// EmInputQueue_h
@@ -381,6 +381,11 @@ void EmMinimize::Start (void)
 
 	EmMinimize::LoadEvents ();
 
+	// Throw away any snapshot left over from something else.  The first
+	// call to RealLoadInitialState will take a new one.
+
+	gSession->DiscardSnapshot ();
+
 	// Enable all events
 
 	EmEventPlayback::EnableEvents ();
@@ -433,6 +438,7 @@ void EmMinimize::Start (void)
 void EmMinimize::Stop (void)
 {
 	EmMinimize::TurnOn (false);
+	gSession->DiscardSnapshot ();
 	EmEventPlayback::ReplayEvents (false);
 	EmEventOutput::GatherInfo (false);
 }
@@ -686,6 +692,8 @@ void EmMinimize::MinimizationComplete (void)
 	EmEventPlayback::ReplayEvents (false);
 	EmEventOutput::GatherInfo (false);
 
+	gSession->DiscardSnapshot ();
+
 	// Save the minimal set of events.
 
 	EmMinimize::SaveMinimalEvents ();
@@ -1233,7 +1241,15 @@ void EmMinimize::RealLoadInitialState (void)
 	try
 	{
 		EmAssert (gSession);
-		gSession->Load (gSession->GetFile ());
+
+		// The initial state is reloaded for every subset of events we try,
+		// so load it from the file once and keep a copy in memory.
+
+		if (!gSession->RestoreSnapshot ())
+		{
+			gSession->Load (gSession->GetFile ());
+			gSession->SaveSnapshot ();
+		}
 
 		PRINTF ("EmMinimize::RealLoadInitialState: Reloaded initial state.");
 	}
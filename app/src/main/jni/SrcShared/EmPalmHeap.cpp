@@ -17,10 +17,12 @@
 #include "ChunkFile.h"			// Chunk, EmStreamChunk
 #include "EmErrCodes.h"			// kError_CorruptedHeap_Foo
 #include "EmMemory.h"			// CEnableFullAccess, EmMemGet32, EmMemGet16, EmMemGet8
+#include "EmSessionContext.h"	// EmSessionGlobalObject
 #include "ErrorHandling.h"		// Errors::ReportErrCorruptedHeap
 #include "ROMStubs.h"			// MemNumHeaps, MemHeapID, MemHeapPtr
 #include "SessionFile.h"		// SessionFile
 
+#include <algorithm>			// upper_bound
 #include <stdio.h>				// sprintf
 #include <cstddef>
 
@@ -30,6 +32,7 @@
 // ===========================================================================
 
 EmPalmHeapList	EmPalmHeap::fgHeapList;
+EmSessionGlobalObject<EmPalmHeapList>	EmPalmHeap::fgHeapListGlobal (&fgHeapList);
 
 
 /***********************************************************************
@@ -244,20 +247,28 @@ const EmPalmHeap* EmPalmHeap::GetHeapByPtr (emuptr p)
 	return GetHeapByPtr ((MemPtr) p);
 }
 
+static bool PrvHeapStartsAfter (emuptr p, const EmPalmHeap& heap)
+{
+	return p < heap.Start ();
+}
+
 const EmPalmHeap* EmPalmHeap::GetHeapByPtr (MemPtr p)
 {
-	// !!! Could do a binary search here, if needed.
+	// AddHeap keeps the list sorted by heap location, and heaps don't
+	// overlap, so the only candidate is the last heap starting at or
+	// before the pointer.
 
-	EmPalmHeapList::iterator	iter = fgHeapList.begin ();
+	EmPalmHeapList::iterator	iter = upper_bound (fgHeapList.begin (),
+									fgHeapList.end (), (emuptr) p, PrvHeapStartsAfter);
 
-	while (iter != fgHeapList.end ())
+	if (iter != fgHeapList.begin ())
 	{
+		--iter;
+
 		if (iter->Contains ((emuptr) p))
 		{
 			return &*iter;
 		}
-
-		++iter;
 	}
 
 	return NULL;
@@ -385,6 +396,8 @@ void EmPalmHeap::MemHeapInit (UInt16 heapID, Int16, Boolean)
  *
  * DESCRIPTION:	All of these functions alter the heap in some way.
  *				Resync our notion of the state of the heap with reality.
+ *				Where we know which chunk the call touched, we resync
+ *				only the chunks around it rather than the whole heap.
  *
  * PARAMETERS:	Parameters to the Memory Manager functions that altered
  *				the heap.
@@ -420,65 +433,64 @@ void EmPalmHeap::MemHeapScramble (UInt16 heapID, EmPalmChunkList* delta)
 
 void EmPalmHeap::MemChunkNew (UInt16 heapID, MemPtr p, UInt16 attr, EmPalmChunkList* delta)
 {
-	UNUSED_PARAM (p);
 	UNUSED_PARAM (attr);
 
 	EmPalmHeap*	heap = const_cast <EmPalmHeap*> (GetHeapByID (heapID));
 
 	if (heap)
-		heap->ResyncAll (delta);
+		heap->ResyncNew (p, delta);
 }
 
-void EmPalmHeap::MemChunkFree (EmPalmHeap* heap, EmPalmChunkList* delta)
+void EmPalmHeap::MemChunkFree (EmPalmHeap* heap, MemPtr p, EmPalmChunkList* delta)
 {
 //	EmPalmHeap*	heap = const_cast <EmPalmHeap*> (GetHeapByPtr (p));
 
 	if (heap)
-		heap->ResyncAll (delta);
+		heap->ResyncFree (p, delta);
 }
 
 void EmPalmHeap::MemPtrNew (MemPtr p, EmPalmChunkList* delta)
 {
-	UNUSED_PARAM (p);
 //	EmPalmHeap*	heap = const_cast <EmPalmHeap*> (GetHeapByPtr (p));
 	EmPalmHeap*	heap = const_cast <EmPalmHeap*> (GetHeapByID (0));
 
 	if (heap)
-		heap->ResyncAll (delta);
+		heap->ResyncNew (p, delta);
 }
 
 void EmPalmHeap::MemPtrResize (MemPtr p, EmPalmChunkList* delta)
 {
 	EmPalmHeap*	heap = const_cast <EmPalmHeap*> (GetHeapByPtr (p));
 
+	// Pointer chunks are locked, so they're never moved.
+
 	if (heap)
-		heap->ResyncAll (delta);
+		heap->ResyncResize (p, p, delta);
 }
 
 void EmPalmHeap::MemHandleNew (MemHandle h, EmPalmChunkList* delta)
 {
-	UNUSED_PARAM (h);
 //	EmPalmHeap*	heap = const_cast <EmPalmHeap*> (GetHeapByHdl (h));
 	EmPalmHeap*	heap = const_cast <EmPalmHeap*> (GetHeapByID (0));
 
 	if (heap)
-		heap->ResyncAll (delta);
+		heap->ResyncNew (h ? DerefHandle (h) : NULL, delta);
 }
 
-void EmPalmHeap::MemHandleResize (MemHandle h, EmPalmChunkList* delta)
+void EmPalmHeap::MemHandleResize (EmPalmHeap* heap, MemHandle h, MemPtr p, EmPalmChunkList* delta)
 {
-	EmPalmHeap*	heap = const_cast <EmPalmHeap*> (GetHeapByHdl (h));
+//	EmPalmHeap*	heap = const_cast <EmPalmHeap*> (GetHeapByHdl (h));
 
 	if (heap)
-		heap->ResyncAll (delta);
+		heap->ResyncResize (p, h ? DerefHandle (h) : NULL, delta);
 }
 
-void EmPalmHeap::MemHandleFree (EmPalmHeap* heap, EmPalmChunkList* delta)
+void EmPalmHeap::MemHandleFree (EmPalmHeap* heap, MemPtr p, EmPalmChunkList* delta)
 {
 //	EmPalmHeap*	heap = const_cast <EmPalmHeap*> (GetHeapByHdl (h));
 
 	if (heap)
-		heap->ResyncAll (delta);
+		heap->ResyncFree (p, delta);
 }
 
 void EmPalmHeap::MemLocalIDToLockedPtr (MemPtr p, EmPalmChunkList* delta)
@@ -571,37 +583,22 @@ void EmPalmHeap::AddHeap (UInt16 heapID)
 	EmPalmHeap	heap (heapID);
 
 	// Find where to add this heap to our list of heaps.  We keep this
-	// list sorted by heap location for easy lookup on that basis.
+	// list sorted by heap location for easy lookup on that basis (see
+	// GetHeapByPtr).
 
-	EmPalmHeapList::iterator	iter = fgHeapList.begin ();
-
-	while (iter != fgHeapList.end ())
-	{
-		// If we already had an entry for this heap, replace it.
-
-		if (iter->Start () == heap.Start ())
-		{
-			*iter = heap;
-			break;
-		}
-
-		// Found a place to insert this heap.
+	EmPalmHeapList::iterator	iter = upper_bound (fgHeapList.begin (),
+									fgHeapList.end (), heap.Start (), PrvHeapStartsAfter);
 
-		if (iter->Start () > heap.Start ())
-		{
-			fgHeapList.insert (iter, heap);
-			break;
-		}
+	// If we already had an entry for this heap, replace it.  Otherwise,
+	// insert it before the first heap after it.
 
-		++iter;
+	if (iter != fgHeapList.begin () && (iter - 1)->Start () == heap.Start ())
+	{
+		*(iter - 1) = heap;
 	}
-
-	// If the new heap couldn't be inserted before a currently existing
-	// heap, then add it to the end.
-
-	if (iter == fgHeapList.end ())
+	else
 	{
-		fgHeapList.push_back (heap);
+		fgHeapList.insert (iter, heap);
 	}
 }
 
@@ -906,8 +903,7 @@ EmPalmChunkList::const_iterator EmPalmHeap::GetChunkListEnd (void) const
  *
  * FUNCTION:	EmPalmHeap::GetChunkReferencedBy
  *
- * DESCRIPTION:	Iterate over our list of chunks, finding the one
- *				referenced by the given handle.
+ * DESCRIPTION:	Find the chunk referenced by the given handle.
  *
  * PARAMETERS:	h - test handle
  *
@@ -918,21 +914,9 @@ EmPalmChunkList::const_iterator EmPalmHeap::GetChunkListEnd (void) const
 
 const EmPalmChunk* EmPalmHeap::GetChunkReferencedBy (MemHandle h) const
 {
-	// !!! Could do a binary search here, if needed.
-
 	emuptr	p = (emuptr) EmPalmHeap::DerefHandle (h);
 
-	ITERATE_CHUNKS (*this, iter, end)
-	{
-		if (iter->Contains (p))
-		{
-			return &*iter;
-		}
-
-		++iter;
-	}
-
-	return NULL;
+	return this->GetChunkContaining (p);
 }
 
 
@@ -940,9 +924,8 @@ const EmPalmChunk* EmPalmHeap::GetChunkReferencedBy (MemHandle h) const
  *
  * FUNCTION:	EmPalmHeap::GetChunkContaining
  *
- * DESCRIPTION:	Iterate over our list of chunks, finding the one
- *				containing the given pointer.  The range includes the
- *				chunk header and trailer.
+ * DESCRIPTION:	Find the chunk containing the given pointer.  The
+ *				range includes the chunk header and trailer.
  *
  * PARAMETERS:	p - probe address
  *
@@ -953,16 +936,11 @@ const EmPalmChunk* EmPalmHeap::GetChunkReferencedBy (MemHandle h) const
 
 const EmPalmChunk* EmPalmHeap::GetChunkContaining (emuptr p) const
 {
-	// !!! Could do a binary search here, if needed.
+	EmPalmChunkList::const_iterator	iter = this->FindChunk (p);
 
-	ITERATE_CHUNKS (*this, iter, end)
+	if (iter != fChunkList.end ())
 	{
-		if (iter->Contains (p))
-		{
-			return &*iter;
-		}
-
-		++iter;
+		return &*iter;
 	}
 
 	return NULL;
@@ -973,9 +951,8 @@ const EmPalmChunk* EmPalmHeap::GetChunkContaining (emuptr p) const
  *
  * FUNCTION:	EmPalmHeap::GetChunkBodyContaining
  *
- * DESCRIPTION:	Iterate over our list of chunks, finding the one
- *				containing the given pointer.  The range does not
- *				include the chunk header or trailer.
+ * DESCRIPTION:	Find the chunk containing the given pointer.  The
+ *				range does not include the chunk header or trailer.
  *
  * PARAMETERS:	p - probe address
  *
@@ -986,16 +963,14 @@ const EmPalmChunk* EmPalmHeap::GetChunkContaining (emuptr p) const
 
 const EmPalmChunk* EmPalmHeap::GetChunkBodyContaining (emuptr p) const
 {
-	// !!! Could do a binary search here, if needed.
+	// Chunks don't overlap, so the only chunk whose body could contain
+	// the pointer is the one that contains it.
 
-	ITERATE_CHUNKS (*this, iter, end)
-	{
-		if (iter->BodyContains (p))
-		{
-			return &*iter;
-		}
+	EmPalmChunkList::const_iterator	iter = this->FindChunk (p);
 
-		++iter;
+	if (iter != fChunkList.end () && iter->BodyContains (p))
+	{
+		return &*iter;
 	}
 
 	return NULL;
@@ -1307,18 +1282,20 @@ void EmPalmHeap::ResyncAll (EmPalmChunkList* delta)
  *
  * PARAMETERS:	None
  *
- * RETURNED:	Nothing
+ * RETURNED:	True if the set of tables changed (one was added or
+ *				removed).
  *
  ***********************************************************************/
 
-void EmPalmHeap::ResyncMPTList (void)
+Bool EmPalmHeap::ResyncMPTList (void)
 {
 	if (!this->Tracked ())
-		return;
+		return false;
 
 	emuptr	p = this->MptStart ();
 
-	fMPTList.clear ();
+	EmPalmMPTList	oldList;
+	oldList.swap (fMPTList);
 
 	while (1)
 	{
@@ -1335,6 +1312,20 @@ void EmPalmHeap::ResyncMPTList (void)
 
 		p = this->fHeapHdrStart + mpt.NextTableOffset ();
 	}
+
+	if (oldList.size () != fMPTList.size ())
+		return true;
+
+	for (size_t ii = 0; ii < fMPTList.size (); ++ii)
+	{
+		if (oldList[ii].Start () != fMPTList[ii].Start () ||
+			oldList[ii].Size () != fMPTList[ii].Size ())
+		{
+			return true;
+		}
+	}
+
+	return false;
 }
 
 
@@ -1433,23 +1424,18 @@ void EmPalmHeap::ResyncPtr (MemPtr p, EmPalmChunkList* delta)
 	if (!this->Tracked ())
 		return;
 
-	EmPalmChunkList::iterator	iter = fChunkList.begin ();
-
 	emuptr	chunkStart = ((emuptr) p) - fChunkHdrSize;
-	
-	while (iter != fChunkList.end ())
+
+	EmPalmChunkList::iterator	iter = this->FindChunk (chunkStart);
+
+	if (iter != fChunkList.end () && iter->HeaderStart () == chunkStart)
 	{
-		if (iter->HeaderStart () == chunkStart)
-		{
-			*iter = EmPalmChunk (*this, chunkStart);
-			
-			if (delta)
-				delta->push_back (*iter);
+		*iter = EmPalmChunk (*this, chunkStart);
 
-			return;
-		}
+		if (delta)
+			delta->push_back (*iter);
 
-		++iter;
+		return;
 	}
 
 	EmAssert (false);
@@ -1495,6 +1481,336 @@ void EmPalmHeap::ResyncHdl (MemHandle h, EmPalmChunkList* delta)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	EmPalmHeap::ResyncNew
+ *
+ * DESCRIPTION:	Resynchronize our notion of the heap after a chunk
+ *				has been allocated.  If the new chunk was carved out
+ *				of a single free chunk we already knew about, then
+ *				nothing else in the heap could have changed, so only
+ *				that part of the heap is re-examined.  Otherwise, the
+ *				Memory Manager must have compacted the heap to make
+ *				room, so we fall back to examining the whole thing.
+ *
+ *				Does nothing if the heap is not "tracked".
+ *
+ * PARAMETERS:	p - pointer to the body of the new chunk.  May be NULL
+ *					if the allocation failed or was of an empty handle.
+ *
+ *				delta - optional collection to receive the list of
+ *					chunks that are different between the current and
+ *					previous states of the heap.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void EmPalmHeap::ResyncNew (MemPtr p, EmPalmChunkList* delta)
+{
+	if (!this->Tracked ())
+		return;
+
+	// Allocating a handle may have added a master pointer table, which
+	// is a chunk somewhere else in the heap.
+
+	if (this->ResyncMPTList ())
+	{
+		this->ResyncChunkList (delta);
+		return;
+	}
+
+	if (p == NULL)
+	{
+		if (delta)
+			delta->clear ();
+		return;
+	}
+
+	emuptr	chunkStart = ((emuptr) p) - fChunkHdrSize;
+
+	EmPalmChunkList::iterator	iter = this->FindChunk (chunkStart);
+
+	if (iter != fChunkList.end () && iter->Free ())
+	{
+		EmPalmChunk	chunk (*this, chunkStart);
+
+		if (chunk.End () <= iter->End ())
+		{
+			this->ResyncRange (iter->Start (), iter->End (), delta);
+			return;
+		}
+	}
+
+	this->ResyncChunkList (delta);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EmPalmHeap::ResyncResize
+ *
+ * DESCRIPTION:	Resynchronize our notion of the heap after a chunk
+ *				has been resized.  If the chunk stayed where it was,
+ *				and didn't grow past the free chunk (if any) that
+ *				followed it, only that part of the heap is
+ *				re-examined.  Otherwise, the chunk was moved or the
+ *				heap was compacted, so we examine the whole thing.
+ *
+ *				Does nothing if the heap is not "tracked".
+ *
+ * PARAMETERS:	oldP - pointer to the body of the chunk before it was
+ *					resized.
+ *
+ *				newP - pointer to the body of the chunk after it was
+ *					resized.
+ *
+ *				delta - optional collection to receive the list of
+ *					chunks that are different between the current and
+ *					previous states of the heap.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void EmPalmHeap::ResyncResize (MemPtr oldP, MemPtr newP, EmPalmChunkList* delta)
+{
+	if (!this->Tracked ())
+		return;
+
+	if (this->ResyncMPTList () || oldP == NULL || newP != oldP)
+	{
+		this->ResyncChunkList (delta);
+		return;
+	}
+
+	emuptr	chunkStart = ((emuptr) newP) - fChunkHdrSize;
+
+	EmPalmChunkList::iterator	iter = this->FindChunk (chunkStart);
+
+	if (iter != fChunkList.end () && iter->HeaderStart () == chunkStart && !iter->Free ())
+	{
+		emuptr	limit = iter->End ();
+
+		EmPalmChunkList::iterator	next = iter + 1;
+		if (next != fChunkList.end () && next->Free ())
+		{
+			limit = next->End ();
+		}
+
+		EmPalmChunk	chunk (*this, chunkStart);
+
+		// Make sure the chunk we knew about there is the same one:
+		// same handle (if any), and no bigger than it's allowed to be.
+
+		if (!chunk.Free () && chunk.HOffset () == iter->HOffset () && chunk.End () <= limit)
+		{
+			this->ResyncRange (chunkStart, limit, delta);
+			return;
+		}
+	}
+
+	this->ResyncChunkList (delta);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EmPalmHeap::ResyncFree
+ *
+ * DESCRIPTION:	Resynchronize our notion of the heap after a chunk
+ *				has been freed.  Freeing a chunk never moves any
+ *				others, so only the chunk and its neighbors (with
+ *				which it may have been merged) are re-examined.
+ *
+ *				Does nothing if the heap is not "tracked".
+ *
+ * PARAMETERS:	p - pointer to the body of the chunk as it was before
+ *					it was freed.  May be NULL if an empty handle was
+ *					freed.
+ *
+ *				delta - optional collection to receive the list of
+ *					chunks that are different between the current and
+ *					previous states of the heap.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void EmPalmHeap::ResyncFree (MemPtr p, EmPalmChunkList* delta)
+{
+	if (!this->Tracked ())
+		return;
+
+	if (this->ResyncMPTList ())
+	{
+		this->ResyncChunkList (delta);
+		return;
+	}
+
+	if (p == NULL)
+	{
+		if (delta)
+			delta->clear ();
+		return;
+	}
+
+	emuptr	chunkStart = ((emuptr) p) - fChunkHdrSize;
+
+	EmPalmChunkList::iterator	iter = this->FindChunk (chunkStart);
+
+	if (iter != fChunkList.end () && iter->HeaderStart () == chunkStart)
+	{
+		this->ResyncRange (chunkStart, iter->End (), delta);
+		return;
+	}
+
+	this->ResyncChunkList (delta);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EmPalmHeap::ResyncRange
+ *
+ * DESCRIPTION:	Resynchronize our notion of what memory chunks exist
+ *				in the given range of the heap.  We start walking the
+ *				heap at the chunk before the one containing "start"
+ *				(in case a free chunk was merged into it), and keep
+ *				going until we're past "end" and find a chunk that's
+ *				the same as the one we had at that address.  The
+ *				chunks we walked over replace the ones we had for
+ *				that part of the heap.
+ *
+ *				With version 3 and later heaps, the free chunks link
+ *				to each other through their hOffset fields, and those
+ *				links may change outside of the range.  We don't pick
+ *				those changes up, but nothing looks at the links.
+ *
+ * PARAMETERS:	start, end - the range of the heap that changed.
+ *
+ *				delta - optional collection to receive the list of
+ *					chunks that are different between the current and
+ *					previous states of the heap.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void EmPalmHeap::ResyncRange (emuptr start, emuptr end, EmPalmChunkList* delta)
+{
+	EmPalmChunkList::iterator	first = this->FindChunk (start);
+
+	if (first == fChunkList.end ())
+	{
+		this->ResyncChunkList (delta);
+		return;
+	}
+
+	if (first != fChunkList.begin ())
+	{
+		--first;
+	}
+
+	EmPalmChunkList::iterator	last = first;
+	EmPalmChunkList				newChunks;
+	emuptr						chunkHdr = first->HeaderStart ();
+
+	while (1)
+	{
+		EmPalmChunk		chunk (*this, chunkHdr);
+
+		// If the size is zero, we've reached the sentinel at the end.
+
+		if (chunk.Size () == 0)
+		{
+			last = fChunkList.end ();
+			break;
+		}
+
+		// Skip over the old chunks that this one replaces, and see if
+		// we're back in sync.
+
+		while (last != fChunkList.end () && last->HeaderStart () < chunkHdr)
+		{
+			++last;
+		}
+
+		if (chunkHdr >= end &&
+			last != fChunkList.end () &&
+			last->HeaderStart () == chunkHdr &&
+			last->CompareForDelta (chunk))
+		{
+			break;
+		}
+
+		// See if this chunk looks valid.  An exception is thrown if not.
+
+		chunk.Validate (*this);
+
+		newChunks.push_back (chunk);
+
+		chunkHdr += chunk.Size ();
+	}
+
+	if (delta)
+	{
+		EmPalmChunkList	oldChunks (first, last);
+		this->GenerateDeltas (oldChunks, newChunks, *delta);
+	}
+
+	first = fChunkList.erase (first, last);
+	fChunkList.insert (first, newChunks.begin (), newChunks.end ());
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EmPalmHeap::FindChunk
+ *
+ * DESCRIPTION:	Find the chunk containing the given address, including
+ *				its header and trailer.  fChunkList is in address
+ *				order, so we can do a binary search.
+ *
+ * PARAMETERS:	p - probe address
+ *
+ * RETURNED:	Iterator referencing the chunk.  fChunkList.end () if
+ *				not found.
+ *
+ ***********************************************************************/
+
+static bool PrvChunkStartsAfter (emuptr p, const EmPalmChunk& chunk)
+{
+	return p < chunk.HeaderStart ();
+}
+
+EmPalmChunkList::const_iterator EmPalmHeap::FindChunk (emuptr p) const
+{
+	EmPalmChunkList::const_iterator	iter = upper_bound (fChunkList.begin (),
+									fChunkList.end (), p, PrvChunkStartsAfter);
+
+	if (iter != fChunkList.begin ())
+	{
+		--iter;
+
+		if (iter->Contains (p))
+		{
+			return iter;
+		}
+	}
+
+	return fChunkList.end ();
+}
+
+EmPalmChunkList::iterator EmPalmHeap::FindChunk (emuptr p)
+{
+	const EmPalmHeap*					constThis = this;
+	EmPalmChunkList::const_iterator		iter = constThis->FindChunk (p);
+
+	return fChunkList.begin () + (iter - fChunkList.begin ());
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	EmPalmHeap::GenerateDeltas
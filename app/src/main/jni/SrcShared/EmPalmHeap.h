@@ -26,6 +26,8 @@ typedef vector<EmPalmChunk>		EmPalmChunkList;
 typedef vector<EmPalmMPT>		EmPalmMPTList;
 typedef vector<EmPalmHeap>		EmPalmHeapList;
 
+template <class T> class EmSessionGlobalObject;
+
 class EmStream;
 EmStream& operator << (EmStream&, const EmPalmChunk&);
 EmStream& operator >> (EmStream&, EmPalmChunk&);
@@ -80,6 +82,7 @@ class EmPalmHeap
 														 UInt16 attributes,
 														 EmPalmChunkList* = NULL);
 		static void				MemChunkFree			(EmPalmHeap* heap,
+														 MemPtr,
 														 EmPalmChunkList* = NULL);
 
 		static void				MemPtrNew				(MemPtr,
@@ -89,9 +92,12 @@ class EmPalmHeap
 
 		static void				MemHandleNew			(MemHandle,
 														 EmPalmChunkList* = NULL);
-		static void				MemHandleResize			(MemHandle,
+		static void				MemHandleResize			(EmPalmHeap* heap,
+														 MemHandle,
+														 MemPtr,
 														 EmPalmChunkList* = NULL);
 		static void				MemHandleFree			(EmPalmHeap* heap,
+														 MemPtr,
 														 EmPalmChunkList* = NULL);
 
 		static void				MemLocalIDToLockedPtr	(MemPtr,
@@ -121,6 +127,7 @@ class EmPalmHeap
 	private:
 	
 		static EmPalmHeapList	fgHeapList;
+		static EmSessionGlobalObject<EmPalmHeapList>	fgHeapListGlobal;	// Registers fgHeapList with EmSessionContext.
 
 
 // ===== Object member functions =====
@@ -192,13 +199,29 @@ class EmPalmHeap
 		void					GetHeapHeaderInfo		(emuptr	heapHdr);
 
 		void					ResyncAll				(EmPalmChunkList* delta);
-		void					ResyncMPTList			(void);
+		Bool					ResyncMPTList			(void);
 		void					ResyncChunkList			(EmPalmChunkList* delta);
 		void					ResyncPtr				(MemPtr,
 														 EmPalmChunkList* delta);
 		void					ResyncHdl				(MemHandle,
 														 EmPalmChunkList* delta);
 
+		void					ResyncNew				(MemPtr,
+														 EmPalmChunkList* delta);
+		void					ResyncResize			(MemPtr oldP,
+														 MemPtr newP,
+														 EmPalmChunkList* delta);
+		void					ResyncFree				(MemPtr,
+														 EmPalmChunkList* delta);
+		void					ResyncRange				(emuptr start,
+														 emuptr end,
+														 EmPalmChunkList* delta);
+
+		EmPalmChunkList::iterator
+								FindChunk				(emuptr);
+		EmPalmChunkList::const_iterator
+								FindChunk				(emuptr) const;
+
 		void					GenerateDeltas			(const EmPalmChunkList& oldList,
 														 const EmPalmChunkList& newList,
 														 EmPalmChunkList& delta);
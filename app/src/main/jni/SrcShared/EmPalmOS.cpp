@@ -23,13 +23,14 @@
 #include "DebugMgr.h"			// Debug::HandleSystemCall
 #include "EmCPU68K.h"			// gCPU68K, gStackHigh, etc.
 #include "EmErrCodes.h"			// kError_UnimplementedTrap, kError_InvalidLibraryRefNum
-#include "EmMemory.h"			// CEnableFullAccess
+#include "EmMemory.h"			// CEnableFullAccess, Memory::InvalidateFastPages
 #include "EmPalmHeap.h"			// EmPalmHeap, GetHeapByPtr
 #include "EmPalmFunction.h"		// ProscribedFunction
 #include "EmPalmStructs.h"		// EmAliasCardHeaderType
 #include "EmPatchMgr.h"			// EmPatchMgr
 #include "EmPatchState.h"		// EmPatchState
 #include "EmSession.h"			// gSession->Reset
+#include "EmSessionContext.h"	// EM_SESSION_GLOBAL, EM_SESSION_OBJECT
 #include "ErrorHandling.h"		// Errors::ReportInvalidPC
 #include "Logging.h"			// LogSystemCalls
 #include "MetaMemory.h"			// MetaMemory::InRAMOSComponent
@@ -55,6 +56,12 @@ static StackRange			gInterruptStack;
 
 static emuptr				gBigROMEntry;
 
+EM_SESSION_OBJECT (StackList, gStackList);
+EM_SESSION_OBJECT (StackRange, gBootStack);
+EM_SESSION_OBJECT (StackRange, gKernelStack);
+EM_SESSION_OBJECT (StackRange, gInterruptStack);
+EM_SESSION_GLOBAL (gBigROMEntry);
+
 static const uint32			CJ_TAGAMX	= 0x414D5800;
 static const uint32			CJ_TAGFENCE	= 0x55555555;
 
@@ -71,6 +78,7 @@ static const uint32			CJ_TAGFENCE	= 0x55555555;
 
 static const int	kInterruptOverhead = 34;
 static emuptr		gStackLowWaterMark = 0;
+EM_SESSION_GLOBAL (gStackLowWaterMark);
 
 
 /***********************************************************************
@@ -687,10 +695,21 @@ void EmPalmOS::SetCurrentStack (const StackRange& range)
 	if (range == gKernelStack)
 		stackSlush = kKernelStackSlush;
 
+	// Memory in the current stack can't be in the fast page tables, since
+	// EmBankDRAM checks for accesses below the stack pointer.  Let the
+	// tables take another look at both the old and new stacks.
+
+	if (gStackLow != EmMemNULL)
+	{
+		Memory::InvalidateFastPages (gStackLow, gStackHigh);
+	}
+
 	gStackHigh			= range.fTop;
 	gStackLowWaterMark	= range.fLowWaterMark;
 	gStackLowWarn		= range.fBottom + kInterruptOverhead + stackSlush;
 	gStackLow			= range.fBottom + kInterruptOverhead;
+
+	Memory::InvalidateFastPages (gStackLow, gStackHigh);
 }
 
 
@@ -14,6 +14,8 @@
 #include "EmCommon.h"
 #include "EmPixMap.h"
 
+#include "EmPixMapSIMD.h"		// EmPixMapSIMD
+#include "Logging.h"			// LogAppendMsg
 #include "Platform.h"			// Platform::AllocateMemory
 
 #include <string.h>
@@ -54,6 +56,9 @@ static uint32*	gConvert2To8;	// Used to convert an 8-bit byte consisting of 4 2-
 static uint16*	gConvert4To8;	// Used to convert an 8-bit byte consisting of 2 4-bit pixels
 								// to a 16-bit value containing 4 8-bit pixels.
 
+static Bool		gFastConvert = true;	// Use PrvCopyRectFast when we can.
+static int		gUseSIMD = -1;			// Use EmPixMapSIMD (-1 == not checked yet).
+
 struct ScanlineParms
 {
 	uint8*			fDestScanline;
@@ -75,6 +80,8 @@ typedef void (*ScanlineConverter) (const ScanlineParms&);
 static void				PrvMakeMask		(void* dstPtr, void* srcPtr, long rowBytes, long width, long height);
 static void				PrvAddToRegion	(EmRegion& region, int top, int left, int right);
 static EmPixMapDepth	PrvGetDepth		(EmPixMapFormat);
+static Bool				PrvCopyRectFast	(EmPixMap& dest, const EmPixMap& src,
+										 const EmRect& destRect, const EmRect& srcRect);
 
 #define DECLARE_CONVERTER(src_format, dest_format)				\
 	static void PrvConvert##src_format##To##dest_format (const ScanlineParms&);
@@ -1251,6 +1258,12 @@ EmPixMap::CopyRect	(EmPixMap& dest, const EmPixMap& src,
 	EmAssert (srcRect.fTop	== destRect.fTop	|| srcRect.fTop * 2		== destRect.fTop);
 	EmAssert (srcRect.fBottom	== destRect.fBottom	|| srcRect.fBottom * 2	== destRect.fBottom);
 
+	// Handle the common cases (the ones we hit when drawing the LCD)
+	// with converters that work from a palette of pre-converted colors.
+
+	if (::PrvCopyRectFast (dest, src, destRect, srcRect))
+		return;
+
 	// Gather data common to all conversions.
 
 	EmPixMapRowBytes	destRowBytes	= dest.GetRowBytes ();
@@ -1395,6 +1408,136 @@ EmPixMap::CopyRect	(EmPixMap& dest, const EmPixMap& src,
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	EmPixMap::BenchmarkConverters
+ *
+ * DESCRIPTION:	Time CopyRect on the conversions done when drawing the
+ *				LCD, first with the PrvConvertMToN scanline converters,
+ *				then with PrvCopyRectFast, and then with PrvCopyRectFast
+ *				using EmPixMapSIMD.  Results are written to the log,
+ *				along with a warning if the three don't produce the same
+ *				pixels.
+ *
+ * PARAMETERS:	None.
+ *
+ * RETURNED:	Nothing.
+ *
+ ***********************************************************************/
+
+void
+EmPixMap::BenchmarkConverters (void)
+{
+	const int			kIterations	= 200;
+	const EmPoint		kSize (160, 160);
+
+	struct
+	{
+		EmPixMapFormat	fFormat;
+		const char*		fName;
+	}
+	kFormats[] =
+	{
+		{ kPixMapFormat1,			"1" },
+		{ kPixMapFormat2,			"2" },
+		{ kPixMapFormat4,			"4" },
+		{ kPixMapFormat8,			"8" },
+		{ kPixMapFormat16RGB565,	"16RGB565" }
+	};
+
+	Bool	oldFastConvert	= gFastConvert;
+	int		oldUseSIMD		= gUseSIMD;
+
+	for (size_t ii = 0; ii < countof (kFormats); ++ii)
+	{
+		// Make a source pixmap filled with garbage, with a gray ramp for a
+		// color table.
+
+		EmPixMap	src;
+		src.SetSize (kSize);
+		src.SetFormat (kFormats[ii].fFormat);
+
+		if (src.GetDepth () <= 8)
+		{
+			RGBList		colors;
+			int			numColors = 1 << src.GetDepth ();
+
+			for (int color = 0; color < numColors; ++color)
+			{
+				uint8	level = (uint8) (255 - color * 255 / (numColors - 1));
+				colors.push_back (RGBType (level, level, level));
+			}
+
+			src.SetColorTable (colors);
+		}
+
+		uint8*	bits	= (uint8*) src.GetBits ();
+		long	size	= kSize.fY * src.GetRowBytes ();
+		uint32	seed	= 1;
+
+		for (long byte = 0; byte < size; ++byte)
+		{
+			seed = seed * 1103515245 + 12345;
+			bits[byte] = (uint8) (seed >> 16);
+		}
+
+		for (int factor = 1; factor <= 2; ++factor)
+		{
+			for (int destFormat = 0; destFormat < 2; ++destFormat)
+			{
+				EmPixMapFormat	format = destFormat == 0 ? kPixMapFormat16RGB565 : kPixMapFormat32ARGB;
+
+				EmRect		srcRect (EmPoint (0, 0), kSize);
+				EmRect		destRect (EmPoint (0, 0), kSize * EmPoint (factor, factor));
+
+				EmPixMap	dest[3];
+				uint32		elapsed[3];
+
+				for (int method = 0; method < 3; ++method)
+				{
+					dest[method].SetSize (destRect.Size ());
+					dest[method].SetFormat (format);
+
+					gFastConvert	= method > 0;
+					gUseSIMD		= method > 1 && EmPixMapSIMD::IsAvailable ();
+
+					uint32	start = Platform::GetMilliseconds ();
+
+					for (int count = 0; count < kIterations; ++count)
+					{
+						EmPixMap::CopyRect (dest[method], src, destRect, srcRect);
+					}
+
+					elapsed[method] = Platform::GetMilliseconds () - start;
+				}
+
+				LogAppendMsg ("EmPixMap: %s to %s%s: scalar %ld ms, palette %ld ms, %s %ld ms",
+					kFormats[ii].fName,
+					destFormat == 0 ? "16RGB565" : "32ARGB",
+					factor == 2 ? " (2x)" : "",
+					elapsed[0], elapsed[1],
+					EmPixMapSIMD::IsAvailable () ? "vector" : "palette (no vector unit)",
+					elapsed[2]);
+
+				long	destSize = dest[0].GetSize ().fY * dest[0].GetRowBytes ();
+
+				if (memcmp (dest[0].GetBits (), dest[1].GetBits (), destSize) != 0 ||
+					memcmp (dest[0].GetBits (), dest[2].GetBits (), destSize) != 0)
+				{
+					LogAppendMsg ("EmPixMap: %s to %s%s: results differ!",
+						kFormats[ii].fName,
+						destFormat == 0 ? "16RGB565" : "32ARGB",
+						factor == 2 ? " (2x)" : "");
+				}
+			}
+		}
+	}
+
+	gFastConvert	= oldFastConvert;
+	gUseSIMD		= oldUseSIMD;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	EmPixMap::DetermineRowBytes
@@ -1886,6 +2029,229 @@ EmPixMapDepth PrvGetDepth (EmPixMapFormat f)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	PrvConvertIndexed
+ *
+ * DESCRIPTION:	Convert a scanline of 1-, 2-, 4-, or 8-bit indexed pixels
+ *				to direct pixels by looking them up in a palette.
+ *
+ * PARAMETERS:	dest - scanline to receive the pixels.
+ *
+ *				src - scanline of indexed pixels.
+ *
+ *				width - number of pixels to convert.
+ *
+ *				depth - depth of the indexed pixels.
+ *
+ *				palette - direct pixel to use for each index.
+ *
+ * RETURNED:	Nothing.
+ *
+ ***********************************************************************/
+
+template <class T>
+static void PrvConvertIndexed (T* dest, const uint8* src, long width,
+							   EmPixMapDepth depth, const T* palette)
+{
+	if (depth == 8)
+	{
+		while (width-- > 0)
+		{
+			*dest++ = palette[*src++];
+		}
+
+		return;
+	}
+
+	int		mask	= (1 << depth) - 1;
+	int		shift	= 8 - depth;
+
+	while (width-- > 0)
+	{
+		*dest++ = palette[(*src >> shift) & mask];
+
+		shift -= depth;
+		if (shift < 0)
+		{
+			shift = 8 - depth;
+			++src;
+		}
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	PrvScale
+ *
+ * DESCRIPTION:	Double the pixels in a scanline, writing the results to
+ *				two destination scanlines.  Works from right to left so
+ *				that src can be the start of dest2.
+ *
+ * PARAMETERS:	dest1, dest2 - scanlines to receive the pixels.
+ *
+ *				src - scanline to double.
+ *
+ *				width - number of pixels in src.
+ *
+ * RETURNED:	Nothing.
+ *
+ ***********************************************************************/
+
+template <class T>
+static void PrvScale (T* dest1, T* dest2, const T* src, long width)
+{
+	while (width-- > 0)
+	{
+		T	pixel = src[width];
+
+		dest1[width * 2] = dest1[width * 2 + 1] = pixel;
+		dest2[width * 2] = dest2[width * 2 + 1] = pixel;
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	PrvCopyRectFast
+ *
+ * DESCRIPTION:	Fast path for EmPixMap::CopyRect.  Handles converting
+ *				indexed pixels to 16-bit RGB 565 or 32-bit ARGB, and
+ *				copying 16-bit RGB 565 pixels, with or without scaling.
+ *				The source color table is converted to the destination
+ *				format once up front, and each scanline is converted by
+ *				looking pixels up in it instead of converting each
+ *				pixel's RGBType.  When scaling, each scanline is
+ *				converted into the second of the two destination
+ *				scanlines it maps to, and then doubled from there.
+ *				Where the CPU has one, the vector unit does the 1-, 2-,
+ *				and 4-bit lookups and the doubling.
+ *
+ * PARAMETERS:	Same as EmPixMap::CopyRect.
+ *
+ * RETURNED:	True if the pixels were copied.  False if this is a
+ *				conversion that should be left to the PrvConvertMToN
+ *				scanline converters.
+ *
+ ***********************************************************************/
+
+Bool PrvCopyRectFast (EmPixMap& dest, const EmPixMap& src,
+					  const EmRect& destRect, const EmRect& srcRect)
+{
+	if (!gFastConvert)
+		return false;
+
+	EmPixMapFormat	srcFormat	= src.GetFormat ();
+	EmPixMapFormat	destFormat	= dest.GetFormat ();
+	EmPixMapDepth	srcDepth	= src.GetDepth ();
+
+	Bool	to16 = destFormat == kPixMapFormat16RGB565 &&
+				(srcDepth <= 8 || srcFormat == kPixMapFormat16RGB565);
+	Bool	to32 = destFormat == kPixMapFormat32ARGB && srcDepth <= 8;
+
+	if (!to16 && !to32)
+		return false;
+
+	if (gUseSIMD < 0)
+	{
+		gUseSIMD = EmPixMapSIMD::IsAvailable ();
+	}
+
+	// Convert the color table.
+
+	uint16	palette16[256];
+	uint32	palette32[256];
+
+	if (srcDepth <= 8)
+	{
+		const RGBList&	colors		= src.GetColorTable ();
+		int				numColors	= 1 << srcDepth;
+
+		for (int ii = 0; ii < numColors; ++ii)
+		{
+			uint8	r = 0, g = 0, b = 0;
+
+			if (ii < (int) colors.size ())
+			{
+				r = colors[ii].fRed;
+				g = colors[ii].fGreen;
+				b = colors[ii].fBlue;
+			}
+
+			uint8*	destPtr;
+
+			destPtr = (uint8*) &palette16[ii];
+			PUT_16RGB565 (destPtr, r, g, b, 0)
+
+			destPtr = (uint8*) &palette32[ii];
+			PUT_32ARGB (destPtr, r, g, b, 0)
+		}
+	}
+
+	// Convert the scanlines.
+
+	Bool				scale			= destRect != srcRect;
+	EmCoord				width			= srcRect.fRight;
+	EmPixMapRowBytes	destRowBytes	= dest.GetRowBytes ();
+	EmPixMapRowBytes	srcRowBytes		= src.GetRowBytes ();
+
+	uint8*			destBase	= (uint8*) dest.GetBits ();
+	const uint8*	srcLine		= ((const uint8*) src.GetBits ()) + srcRect.fTop * srcRowBytes;
+
+	for (EmCoord yy = srcRect.fTop; yy < srcRect.fBottom; ++yy)
+	{
+		uint8*	destLine = destBase + (scale ? yy * 2 + 1 : yy) * destRowBytes;
+
+		if (to16)
+		{
+			uint16*	dest16 = (uint16*) destLine;
+
+			if (srcFormat == kPixMapFormat16RGB565)
+				memcpy (dest16, srcLine, width * sizeof (uint16));
+			else if (gUseSIMD && srcDepth == 1)
+				EmPixMapSIMD::Convert1To16 (dest16, srcLine, width, palette16);
+			else if (gUseSIMD && srcDepth == 2)
+				EmPixMapSIMD::Convert2To16 (dest16, srcLine, width, palette16);
+			else if (gUseSIMD && srcDepth == 4)
+				EmPixMapSIMD::Convert4To16 (dest16, srcLine, width, palette16);
+			else
+				::PrvConvertIndexed (dest16, srcLine, width, srcDepth, palette16);
+
+			if (scale)
+			{
+				uint16*	dest1 = (uint16*) (destLine - destRowBytes);
+
+				if (gUseSIMD)
+					EmPixMapSIMD::Scale16 (dest1, dest16, dest16, width);
+				else
+					::PrvScale (dest1, dest16, dest16, width);
+			}
+		}
+		else
+		{
+			uint32*	dest32 = (uint32*) destLine;
+
+			::PrvConvertIndexed (dest32, srcLine, width, srcDepth, palette32);
+
+			if (scale)
+			{
+				uint32*	dest1 = (uint32*) (destLine - destRowBytes);
+
+				if (gUseSIMD)
+					EmPixMapSIMD::Scale32 (dest1, dest32, dest32, width);
+				else
+					::PrvScale (dest1, dest32, dest32, width);
+			}
+		}
+
+		srcLine += srcRowBytes;
+	}
+
+	return true;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	PrvConvertMToN
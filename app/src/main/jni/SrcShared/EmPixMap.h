@@ -81,6 +81,7 @@ class EmPixMap
 
 		static void				CopyRect		(EmPixMap& dest, const EmPixMap& src,
 												 const EmRect& destRect, const EmRect& srcRect);
+		static void				BenchmarkConverters	(void);
 
 	private:
 		EmPixMapRowBytes		DetermineRowBytes	(void) const;
@@ -0,0 +1,389 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#include "EmCommon.h"
+#include "EmPixMapSIMD.h"
+
+// The Android makefile builds this file with NEON turned on for ARMv7.
+// Everything else is built without it, so keep the NEON code in here.
+// (Note that the plain C tail loops below are also compiled with NEON
+// enabled; that's OK as long as we don't ask the compiler to
+// auto-vectorize them, which -O2 doesn't.)
+
+#if defined (__ARM_NEON__) || defined (__ARM_NEON)
+	#define USE_NEON	1
+	#include <arm_neon.h>
+
+	#if defined (__ANDROID__) && !defined (__aarch64__)
+		#include <cpu-features.h>	// android_getCpuFeatures
+	#endif
+#elif defined (__SSE2__)
+	#define USE_SSE2	1
+	#include <emmintrin.h>
+#endif
+
+
+#if USE_NEON
+
+// ---------------------------------------------------------------------------
+//		 PrvSplitPalette
+// ---------------------------------------------------------------------------
+// vtbl looks up bytes, so split the first 16 entries of the palette into
+// tables of low and high bytes.
+
+static void PrvSplitPalette (const uint16* palette, int count,
+							 uint8x8x2_t& lo, uint8x8x2_t& hi)
+{
+	uint8	loBytes[16] = { 0 };
+	uint8	hiBytes[16] = { 0 };
+
+	for (int ii = 0; ii < count; ++ii)
+	{
+		loBytes[ii] = (uint8) (palette[ii] >> 0);
+		hiBytes[ii] = (uint8) (palette[ii] >> 8);
+	}
+
+	lo.val[0] = vld1_u8 (loBytes + 0);
+	lo.val[1] = vld1_u8 (loBytes + 8);
+	hi.val[0] = vld1_u8 (hiBytes + 0);
+	hi.val[1] = vld1_u8 (hiBytes + 8);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 PrvLookup8
+// ---------------------------------------------------------------------------
+// Look up 8 pixels at once and store them.  Interleaving the low and high
+// bytes puts the 16-bit results in little-endian order.
+
+static inline void PrvLookup8 (uint16* dest, uint8x8_t index,
+							   const uint8x8x2_t& lo, const uint8x8x2_t& hi)
+{
+	uint8x8x2_t	pixels = vzip_u8 (vtbl2_u8 (lo, index), vtbl2_u8 (hi, index));
+
+	vst1q_u16 (dest, vreinterpretq_u16_u8 (vcombine_u8 (pixels.val[0], pixels.val[1])));
+}
+
+#endif	// USE_NEON
+
+
+// ---------------------------------------------------------------------------
+//		 PrvConvertTail
+// ---------------------------------------------------------------------------
+// Convert whatever's left over after the vector loop.  width can be less
+// than a full byte's worth of pixels.
+
+static void PrvConvertTail (uint16* dest, const uint8* src, long width,
+							const uint16* palette, int depth)
+{
+	int		mask	= (1 << depth) - 1;
+	int		shift	= 8 - depth;
+
+	while (width-- > 0)
+	{
+		*dest++ = palette[(*src >> shift) & mask];
+
+		shift -= depth;
+		if (shift < 0)
+		{
+			shift = 8 - depth;
+			++src;
+		}
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmPixMapSIMD::IsAvailable
+// ---------------------------------------------------------------------------
+
+Bool EmPixMapSIMD::IsAvailable (void)
+{
+#if USE_NEON && defined (__ANDROID__) && !defined (__aarch64__)
+	static int	available = -1;
+
+	if (available < 0)
+	{
+		available =
+			android_getCpuFamily () == ANDROID_CPU_FAMILY_ARM &&
+			(android_getCpuFeatures () & ANDROID_CPU_ARM_FEATURE_NEON) != 0;
+	}
+
+	return available != 0;
+#elif USE_NEON || USE_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmPixMapSIMD::Convert1To16
+// ---------------------------------------------------------------------------
+
+void EmPixMapSIMD::Convert1To16 (uint16* dest, const uint8* src, long width,
+								 const uint16* palette)
+{
+#if USE_NEON
+	static const uint8	kBits[8] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+
+	uint8x8x2_t	lo, hi;
+	::PrvSplitPalette (palette, 2, lo, hi);
+
+	uint8x8_t	bits	= vld1_u8 (kBits);
+	uint8x8_t	one		= vdup_n_u8 (1);
+
+	while (width >= 8)
+	{
+		uint8x8_t	index = vand_u8 (vtst_u8 (vdup_n_u8 (*src++), bits), one);
+
+		::PrvLookup8 (dest, index, lo, hi);
+
+		dest += 8;
+		width -= 8;
+	}
+#elif USE_SSE2
+	__m128i	bits	= _mm_setr_epi16 (0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+	__m128i	color0	= _mm_set1_epi16 ((short) palette[0]);
+	__m128i	color1	= _mm_set1_epi16 ((short) palette[1]);
+
+	while (width >= 8)
+	{
+		__m128i	set = _mm_cmpeq_epi16 (_mm_and_si128 (_mm_set1_epi16 (*src++), bits), bits);
+
+		_mm_storeu_si128 ((__m128i*) dest,
+			_mm_or_si128 (_mm_and_si128 (set, color1), _mm_andnot_si128 (set, color0)));
+
+		dest += 8;
+		width -= 8;
+	}
+#endif
+
+	::PrvConvertTail (dest, src, width, palette, 1);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmPixMapSIMD::Convert2To16
+// ---------------------------------------------------------------------------
+
+void EmPixMapSIMD::Convert2To16 (uint16* dest, const uint8* src, long width,
+								 const uint16* palette)
+{
+#if USE_NEON
+	uint8x8x2_t	lo, hi;
+	::PrvSplitPalette (palette, 4, lo, hi);
+
+	uint8x8_t	mask = vdup_n_u8 (0x03);
+
+	while (width >= 32)
+	{
+		// Pull the four pixels out of each of 8 bytes, and put them back
+		// in order: p0 p1 from the first zip, p2 p3 from the second, and
+		// then pairs of those together as 16-bit lanes.
+
+		uint8x8_t	bytes	= vld1_u8 (src);
+		uint8x8x2_t	p01		= vzip_u8 (vshr_n_u8 (bytes, 6), vand_u8 (vshr_n_u8 (bytes, 4), mask));
+		uint8x8x2_t	p23		= vzip_u8 (vand_u8 (vshr_n_u8 (bytes, 2), mask), vand_u8 (bytes, mask));
+
+		uint16x4x2_t	first	= vzip_u16 (vreinterpret_u16_u8 (p01.val[0]), vreinterpret_u16_u8 (p23.val[0]));
+		uint16x4x2_t	second	= vzip_u16 (vreinterpret_u16_u8 (p01.val[1]), vreinterpret_u16_u8 (p23.val[1]));
+
+		::PrvLookup8 (dest +  0, vreinterpret_u8_u16 (first.val[0]), lo, hi);
+		::PrvLookup8 (dest +  8, vreinterpret_u8_u16 (first.val[1]), lo, hi);
+		::PrvLookup8 (dest + 16, vreinterpret_u8_u16 (second.val[0]), lo, hi);
+		::PrvLookup8 (dest + 24, vreinterpret_u8_u16 (second.val[1]), lo, hi);
+
+		src += 8;
+		dest += 32;
+		width -= 32;
+	}
+#elif USE_SSE2
+	// No byte shuffle in SSE2, so compare each pixel against all four
+	// possible values, and OR together the colors of the ones that match.
+
+	__m128i	mask = _mm_setr_epi16 (0xC0, 0x30, 0x0C, 0x03, 0xC0, 0x30, 0x0C, 0x03);
+	__m128i	key[4];
+	__m128i	color[4];
+
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		key[ii]		= _mm_setr_epi16 (ii << 6, ii << 4, ii << 2, ii, ii << 6, ii << 4, ii << 2, ii);
+		color[ii]	= _mm_set1_epi16 ((short) palette[ii]);
+	}
+
+	while (width >= 8)
+	{
+		__m128i	pixels = _mm_and_si128 (_mm_setr_epi16 (src[0], src[0], src[0], src[0],
+														 src[1], src[1], src[1], src[1]), mask);
+
+		__m128i	result = _mm_and_si128 (_mm_cmpeq_epi16 (pixels, key[0]), color[0]);
+		result = _mm_or_si128 (result, _mm_and_si128 (_mm_cmpeq_epi16 (pixels, key[1]), color[1]));
+		result = _mm_or_si128 (result, _mm_and_si128 (_mm_cmpeq_epi16 (pixels, key[2]), color[2]));
+		result = _mm_or_si128 (result, _mm_and_si128 (_mm_cmpeq_epi16 (pixels, key[3]), color[3]));
+
+		_mm_storeu_si128 ((__m128i*) dest, result);
+
+		src += 2;
+		dest += 8;
+		width -= 8;
+	}
+#endif
+
+	::PrvConvertTail (dest, src, width, palette, 2);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmPixMapSIMD::Convert4To16
+// ---------------------------------------------------------------------------
+// SSE2 would need 16 compares per 8 pixels for this one, which is no
+// better than the table lookup, so only NEON gets a vector version.
+
+void EmPixMapSIMD::Convert4To16 (uint16* dest, const uint8* src, long width,
+								 const uint16* palette)
+{
+#if USE_NEON
+	uint8x8x2_t	lo, hi;
+	::PrvSplitPalette (palette, 16, lo, hi);
+
+	uint8x8_t	mask = vdup_n_u8 (0x0F);
+
+	while (width >= 16)
+	{
+		uint8x8_t	bytes = vld1_u8 (src);
+		uint8x8x2_t	index = vzip_u8 (vshr_n_u8 (bytes, 4), vand_u8 (bytes, mask));
+
+		::PrvLookup8 (dest + 0, index.val[0], lo, hi);
+		::PrvLookup8 (dest + 8, index.val[1], lo, hi);
+
+		src += 8;
+		dest += 16;
+		width -= 16;
+	}
+#endif
+
+	::PrvConvertTail (dest, src, width, palette, 4);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmPixMapSIMD::Scale16
+// ---------------------------------------------------------------------------
+// Work from the right so that src can overlap the start of dest2.  Each
+// step reads its source pixels before writing anything, and writes only at
+// or beyond twice its read position, so no pixel is overwritten before
+// it's been read.
+
+void EmPixMapSIMD::Scale16 (uint16* dest1, uint16* dest2, const uint16* src, long width)
+{
+	long	xx = width;
+
+	while ((xx & 7) != 0)
+	{
+		--xx;
+
+		uint16	pixel = src[xx];
+
+		dest1[xx * 2] = dest1[xx * 2 + 1] = pixel;
+		dest2[xx * 2] = dest2[xx * 2 + 1] = pixel;
+	}
+
+	while (xx > 0)
+	{
+		xx -= 8;
+
+#if USE_NEON
+		uint16x8_t		pixels	= vld1q_u16 (src + xx);
+		uint16x8x2_t	doubled	= vzipq_u16 (pixels, pixels);
+
+		vst1q_u16 (dest1 + xx * 2 + 0, doubled.val[0]);
+		vst1q_u16 (dest1 + xx * 2 + 8, doubled.val[1]);
+		vst1q_u16 (dest2 + xx * 2 + 0, doubled.val[0]);
+		vst1q_u16 (dest2 + xx * 2 + 8, doubled.val[1]);
+#elif USE_SSE2
+		__m128i	pixels	= _mm_loadu_si128 ((const __m128i*) (src + xx));
+		__m128i	left	= _mm_unpacklo_epi16 (pixels, pixels);
+		__m128i	right	= _mm_unpackhi_epi16 (pixels, pixels);
+
+		_mm_storeu_si128 ((__m128i*) (dest1 + xx * 2 + 0), left);
+		_mm_storeu_si128 ((__m128i*) (dest1 + xx * 2 + 8), right);
+		_mm_storeu_si128 ((__m128i*) (dest2 + xx * 2 + 0), left);
+		_mm_storeu_si128 ((__m128i*) (dest2 + xx * 2 + 8), right);
+#else
+		for (int ii = 7; ii >= 0; --ii)
+		{
+			uint16	pixel = src[xx + ii];
+
+			dest1[(xx + ii) * 2] = dest1[(xx + ii) * 2 + 1] = pixel;
+			dest2[(xx + ii) * 2] = dest2[(xx + ii) * 2 + 1] = pixel;
+		}
+#endif
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmPixMapSIMD::Scale32
+// ---------------------------------------------------------------------------
+// Same as Scale16, four 32-bit pixels at a time.
+
+void EmPixMapSIMD::Scale32 (uint32* dest1, uint32* dest2, const uint32* src, long width)
+{
+	long	xx = width;
+
+	while ((xx & 3) != 0)
+	{
+		--xx;
+
+		uint32	pixel = src[xx];
+
+		dest1[xx * 2] = dest1[xx * 2 + 1] = pixel;
+		dest2[xx * 2] = dest2[xx * 2 + 1] = pixel;
+	}
+
+	while (xx > 0)
+	{
+		xx -= 4;
+
+#if USE_NEON
+		// uint32 is an unsigned long, which NEON's uint32_t isn't.
+
+		uint32x4_t		pixels	= vld1q_u32 ((const uint32_t*) (src + xx));
+		uint32x4x2_t	doubled	= vzipq_u32 (pixels, pixels);
+
+		vst1q_u32 ((uint32_t*) (dest1 + xx * 2 + 0), doubled.val[0]);
+		vst1q_u32 ((uint32_t*) (dest1 + xx * 2 + 4), doubled.val[1]);
+		vst1q_u32 ((uint32_t*) (dest2 + xx * 2 + 0), doubled.val[0]);
+		vst1q_u32 ((uint32_t*) (dest2 + xx * 2 + 4), doubled.val[1]);
+#elif USE_SSE2
+		__m128i	pixels	= _mm_loadu_si128 ((const __m128i*) (src + xx));
+		__m128i	left	= _mm_unpacklo_epi32 (pixels, pixels);
+		__m128i	right	= _mm_unpackhi_epi32 (pixels, pixels);
+
+		_mm_storeu_si128 ((__m128i*) (dest1 + xx * 2 + 0), left);
+		_mm_storeu_si128 ((__m128i*) (dest1 + xx * 2 + 4), right);
+		_mm_storeu_si128 ((__m128i*) (dest2 + xx * 2 + 0), left);
+		_mm_storeu_si128 ((__m128i*) (dest2 + xx * 2 + 4), right);
+#else
+		for (int ii = 3; ii >= 0; --ii)
+		{
+			uint32	pixel = src[xx + ii];
+
+			dest1[(xx + ii) * 2] = dest1[(xx + ii) * 2 + 1] = pixel;
+			dest2[(xx + ii) * 2] = dest2[(xx + ii) * 2 + 1] = pixel;
+		}
+#endif
+	}
+}
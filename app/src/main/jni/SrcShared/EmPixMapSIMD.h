@@ -0,0 +1,49 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#ifndef EmPixMapSIMD_h
+#define EmPixMapSIMD_h
+
+/*
+	Vector versions of the scanline operations that EmPixMap::CopyRect
+	spends its time in when converting the LCD to the host's format:
+	expanding 1-, 2-, and 4-bit indexed pixels through a 16-bit
+	palette, and doubling 16- and 32-bit scanlines for the 2x skins.
+
+	They're written with NEON intrinsics on ARM and SSE2 intrinsics on
+	x86.  ARMv7 doesn't guarantee NEON, so this file is compiled with
+	NEON enabled but the routines are only used if IsAvailable says the
+	CPU we're running on has it.  Routines that don't have a vector
+	version on a given CPU (SSE2 has no byte shuffle to do the 4-bit
+	lookup with) fall back to plain C, so callers don't need to care.
+
+	Pixels are expected in host byte order, and the palettes are indexed
+	by the pixel value.  The Scale routines write each source pixel twice
+	to both destination rows.  They work from right to left, so src may
+	be the start of dest2.
+*/
+
+class EmPixMapSIMD
+{
+	public:
+		static Bool				IsAvailable			(void);
+
+		static void				Convert1To16		(uint16* dest, const uint8* src, long width, const uint16* palette);
+		static void				Convert2To16		(uint16* dest, const uint8* src, long width, const uint16* palette);
+		static void				Convert4To16		(uint16* dest, const uint8* src, long width, const uint16* palette);
+
+		static void				Scale16				(uint16* dest1, uint16* dest2, const uint16* src, long width);
+		static void				Scale32				(uint32* dest1, uint32* dest2, const uint32* src, long width);
+};
+
+#endif	// EmPixMapSIMD_h
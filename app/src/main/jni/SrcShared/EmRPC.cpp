@@ -300,6 +300,10 @@ ErrCode RPC::HandleNewPacket (SLP& slp)
 				result = SystemPacket::RPC2 (slp);
 				break;
 
+			case sysPktMemBatchCmd:
+				result = SystemPacket::MemBatch (slp);
+				break;
+
 			default:
 				break;
 		}
@@ -24,6 +24,34 @@ class CSocket;
 #define sysPktRPC2Cmd			0x70
 #define sysPktRPC2Rsp			0xF0
 
+// Scatter-gather memory access: any number of reads and writes in one
+// packet.  Big-endian body layout:
+//
+//		UInt8	command			sysPktMemBatchCmd
+//		UInt8	_filler
+//		UInt16	numOps
+//		numOps times:
+//			UInt8	kind		kMemBatchRead or kMemBatchWrite
+//			UInt8	_filler
+//			UInt32	address
+//			UInt16	numBytes
+//			UInt8	data[numBytes]	(writes only)
+//
+// The response holds command (sysPktMemBatchRsp), _filler and numOps,
+// followed by the bytes of each read in order.  Unreadable ranges come
+// back as 0xFF, unwritable ones are skipped, same as ReadMem/WriteMem.
+// The body may exceed sysPktMaxBodySize, but the response body must
+// fit in the 16-bit SLP bodySize field.
+
+#define sysPktMemBatchCmd		0x71
+#define sysPktMemBatchRsp		0xF1
+
+enum
+{
+	kMemBatchRead,
+	kMemBatchWrite
+};
+
 class RPC
 {
 	public:
@@ -16,6 +16,7 @@
 
 #include "EmHAL.h"				// EmHAL:: GetLCDBeginEnd
 #include "EmMemory.h"			// CEnableFullAccess
+#include "EmSessionContext.h"	// EM_SESSION_GLOBAL, EM_SESSION_OBJECT
 #include "MetaMemory.h"			// MetaMemory::MarkScreen
 
 
@@ -25,6 +26,27 @@ static emuptr	gScreenDirtyHigh;
 static emuptr	gScreenBegin;
 static emuptr	gScreenEnd;
 
+// One bit for each kDirtyBlockSize bytes of the frame buffer between
+// gScreenBegin and gScreenEnd, set when those bytes are written to.
+// gScreenDirtyLow/High give the extent of the damage; this tells
+// GetBits which scanlines in that extent were actually touched.
+
+const int		kDirtyBlockShift	= 4;
+const uint32	kDirtyBlockSize		= 1 << kDirtyBlockShift;
+
+static vector<uint32>	gScreenDirtyBlocks;
+static vector<uint32>	gScreenDirtyBlocksOld;	// Scratch for GetBits.
+
+EM_SESSION_GLOBAL (gScreenDirtyLow);
+EM_SESSION_GLOBAL (gScreenDirtyHigh);
+EM_SESSION_GLOBAL (gScreenBegin);
+EM_SESSION_GLOBAL (gScreenEnd);
+EM_SESSION_OBJECT (vector<uint32>, gScreenDirtyBlocks);
+
+static void PrvResetDirtyBlocks (uint32 fill);
+static void PrvGetDirtyLines (EmScreenUpdateInfo& info, const vector<uint32>& dirtyBlocks,
+							  emuptr screenBegin, emuptr screenEnd);
+
 
 /***********************************************************************
  *
@@ -48,6 +70,8 @@ void EmScreen::Initialize (void)
 
 	gScreenBegin		= EmMemNULL;
 	gScreenEnd			= EmMemNULL;
+
+	::PrvResetDirtyBlocks (0);
 }
 
 
@@ -75,6 +99,8 @@ void EmScreen::Reset (void)
 
 	gScreenBegin		= EmMemNULL;
 	gScreenEnd			= EmMemNULL;
+
+	::PrvResetDirtyBlocks (~0);
 }
 
 
@@ -115,6 +141,8 @@ void EmScreen::Load (SessionFile&)
 	gScreenDirtyHigh	= EmMemEOM;
 
 	EmHAL::GetLCDBeginEnd (gScreenBegin, gScreenEnd);
+
+	::PrvResetDirtyBlocks (~0);
 }
 
 
@@ -134,6 +162,7 @@ void EmScreen::Load (SessionFile&)
 
 void EmScreen::Dispose (void)
 {
+	gScreenDirtyBlocks.clear ();
 }
 
 
@@ -179,6 +208,21 @@ void EmScreen::MarkDirty (emuptr address, uint32 size)
 	{
 		gScreenDirtyHigh = address + size;
 	}
+
+	// Note which blocks of the frame buffer were hit.
+
+	if (address < gScreenEnd && address + size > gScreenBegin)
+	{
+		emuptr	begin	= max (address, gScreenBegin);
+		emuptr	end		= min (address + size, gScreenEnd);
+		uint32	block	= (begin - gScreenBegin) >> kDirtyBlockShift;
+		uint32	last	= (end - 1 - gScreenBegin) >> kDirtyBlockShift;
+
+		for (; block <= last; ++block)
+		{
+			gScreenDirtyBlocks[block >> 5] |= 1UL << (block & 31);
+		}
+	}
 }
 
 
@@ -212,6 +256,8 @@ void EmScreen::InvalidateAll (void)
 
 		MetaMemory::MarkScreen (gScreenBegin, gScreenEnd);
 	}
+
+	::PrvResetDirtyBlocks (~0);
 }
 
 
@@ -259,6 +305,15 @@ Bool EmScreen::GetBits (EmScreenUpdateInfo& info)
 	gScreenDirtyLow		= EmMemEOM;
 	gScreenDirtyHigh	= EmMemNULL;
 
+	// Do the same with the dirty blocks, hanging onto the old ones
+	// so that we can figure out which scanlines they cover.  Trade
+	// buffers with gScreenDirtyBlocksOld rather than making a new one
+	// each frame; once both are big enough, assign doesn't allocate.
+
+	vector<uint32>&	dirtyBlocks = gScreenDirtyBlocksOld;
+	dirtyBlocks.swap (gScreenDirtyBlocks);
+	gScreenDirtyBlocks.assign (dirtyBlocks.size (), 0);
+
 	// If no lines need to be updated, we can return now.
 
 	if (info.fScreenLow >= info.fScreenHigh)
@@ -275,7 +330,72 @@ Bool EmScreen::GetBits (EmScreenUpdateInfo& info)
 		CEnableFullAccess	munge;	// Remove blocks on memory access.
 
 		EmHAL::GetLCDScanlines (info);
+
+		::PrvGetDirtyLines (info, dirtyBlocks, screenBegin, screenEnd);
 	}
 
 	return true;
 }
+
+
+// ---------------------------------------------------------------------------
+//		 PrvResetDirtyBlocks
+// ---------------------------------------------------------------------------
+// Size the dirty block bitmap to the current screen range, and set all of
+// its bits to the given value.
+
+static void PrvResetDirtyBlocks (uint32 fill)
+{
+	uint32	numBlocks	= (gScreenEnd - gScreenBegin + kDirtyBlockSize - 1) >> kDirtyBlockShift;
+	uint32	numWords	= (numBlocks + 31) >> 5;
+
+	gScreenDirtyBlocks.assign (numWords, fill);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 PrvGetDirtyLines
+// ---------------------------------------------------------------------------
+// Fill in info.fDirtyLines for the scanlines from fFirstLine to fLastLine,
+// now that GetLCDScanlines has told us how big they are.  Each scanline is
+// (screenEnd - screenBegin) / height bytes long, and is dirty if any of
+// the blocks it overlaps are.  If the screen moved since the blocks were
+// last sized, leave fDirtyLines empty so that every line gets updated.
+
+static void PrvGetDirtyLines (EmScreenUpdateInfo& info, const vector<uint32>& dirtyBlocks,
+							  emuptr screenBegin, emuptr screenEnd)
+{
+	info.fDirtyLines.clear ();
+
+	long	height = info.fImage.GetSize ().fY;
+
+	if (screenBegin != gScreenBegin || screenEnd != gScreenEnd ||
+		height <= 0 || dirtyBlocks.empty ())
+	{
+		return;
+	}
+
+	uint32	rowBytes = (screenEnd - screenBegin) / height;
+
+	if (rowBytes == 0)
+	{
+		return;
+	}
+
+	info.fDirtyLines.resize (height, false);
+
+	for (long line = max (info.fFirstLine, 0L); line < info.fLastLine && line < height; ++line)
+	{
+		uint32	block	= (line * rowBytes) >> kDirtyBlockShift;
+		uint32	last	= (line * rowBytes + rowBytes - 1) >> kDirtyBlockShift;
+
+		for (; block <= last; ++block)
+		{
+			if (dirtyBlocks[block >> 5] & (1UL << (block & 31)))
+			{
+				info.fDirtyLines[line] = true;
+				break;
+			}
+		}
+	}
+}
@@ -16,6 +16,8 @@
 
 #include "EmPixMap.h"			// EmPixMap
 
+#include <vector>
+
 class SessionFile;
 
 class EmScreenUpdateInfo
@@ -33,6 +35,20 @@ class EmScreenUpdateInfo
 									// this contains that amount.
 		Bool		fLCDOn;			// True if LCD is on at all
 
+		// Which of the lines from fFirstLine to fLastLine were actually
+		// written to.  A clock tick in the title bar and a blinking
+		// insertion point near the bottom make fFirstLine to fLastLine
+		// span most of the screen; fDirtyLines says to paint just those
+		// two areas.  If empty, all of the lines in that range changed.
+
+		vector<bool>	fDirtyLines;
+
+		Bool		IsLineDirty (long line) const
+					{
+						return fDirtyLines.empty () ||
+							(line < (long) fDirtyLines.size () && fDirtyLines[line]);
+					}
+
 		// Input parameters.  Set by Screen::GetBits and
 		// passed to EmHAL::GetLCDScanlines.
 
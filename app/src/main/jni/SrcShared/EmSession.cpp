@@ -16,14 +16,17 @@
 
 #include "ChunkFile.h"			// ChunkFile
 #include "EmApplication.h"		// gApplication, GetBoundDevice, etc.
+#include "EmBankSRAM.h"			// EmBankSRAM::ReleaseMappedFile
 #include "EmCPU.h"				// EmCPU::Execute
 #include "EmDocument.h"			// gDocument
 #include "EmErrCodes.h"			// kError_InvalidSessionFile
 #include "EmEventPlayback.h"	// EmEventPlayback::ReplayingEvents
 #include "EmException.h"		// EmExceptionTopLevelAction
-#include "EmHAL.h"				// EmHAL::ButtonEvent
+#include "EmHAL.h"				// EmHAL::ButtonEvent, GetCycleCount
 #include "EmMemory.h"			// Memory::ResetBankHandlers
 #include "EmMinimize.h"			// EmMinimize::RealLoadInitialState
+#include "EmSessionContext.h"	// EmSessionContext, EM_SESSION_GLOBAL
+#include "EmSessionSnapshot.h"	// EmSessionSnapshot
 #include "EmStreamFile.h"		// EmStreamFile
 #include "ErrorHandling.h"		// Errors::Throw
 #include "Hordes.h"				// Hordes::AutoSaveState, etc.
@@ -32,6 +35,7 @@
 #include "PreferenceMgr.h"		// Preference
 #include "ROMStubs.h"			// EvtWakeup
 #include "SessionFile.h"		// SessionFile
+#include "Startup.h"			// Startup::Headless
 #include "Strings.r.h"			// kStr_EnterPen
 
 #include "EmMemory.h"			// Memory::Initialize ();
@@ -53,7 +57,20 @@
 EmSession*	gSession;
 
 static uint32	gLastButtonEvent;
+
+EM_SESSION_GLOBAL (gSession);
+EM_SESSION_GLOBAL (gLastButtonEvent);
+
 const uint32	kButtonEventThreshold = 100;
+const uint32	kButtonEventRecheck = 10;
+const uint32	kMaxSleepInterval = 1000;
+
+#if HAS_OMNI_THREAD
+// How long EmSession::Run waits for its turn at the emulator globals before
+// checking to see if it should be doing something else.
+
+const unsigned long	kContextWaitTime = 50;	// milliseconds
+#endif
 
 #ifndef NDEBUG
 Bool	gIterating = false;
@@ -99,21 +116,26 @@ void	PrvWakeUpCPU	(long strID);
 // ---------------------------------------------------------------------------
 //		 EmSession::EmSession
 // ---------------------------------------------------------------------------
-// EmSession constructor.  Initialize data members and point the global
-// "current EmSession" pointer to us.  This method does not explicitly
-// throw any exceptions, and really shouldn't fail unless we've exhausted
-// the free store.
+// EmSession constructor.  Initialize data members, create our set of
+// emulator globals, and point the global "current EmSession" pointer (which
+// is one of those globals) to us.  This method does not explicitly throw
+// any exceptions, and really shouldn't fail unless we've exhausted the free
+// store.
 
 EmSession::EmSession (void) :
 	fConfiguration (),
 	fFile (),
+	fHeadless (false),
 	fCPU (NULL),
+	fContext (new EmSessionContext),
+	fSnapshot (NULL),
 #if HAS_OMNI_THREAD
 	fThread (NULL),
 	fSharedLock (),
 	fSharedCondition (&fSharedLock),
 	fSleepLock (),
 	fSleepCondition (&fSleepLock),
+	fWakeUp (false),
 	fStop (false),
 #endif
 	fSuspendState (),
@@ -135,11 +157,21 @@ EmSession::EmSession (void) :
 	fKeyQueue (),
 	fPenQueue (),
 	fLastPenEvent (EmPoint (-1, -1), false),
-	fBootKeys (0)
+	fNextPenEvent (EmPoint (-1, -1), false),
+	fHaveNextPenEvent (false),
+	fLastPenDelivered (EmPoint (-1, -1), false),
+	fLastPenDeliveredCycle (0),
+	fBootKeys (0),
+	fUARTDoorbell (0)
         , fstop_count(0) //AndroidTODO: remove
 {
 	fSuspendState.fAllCounters = 0;
 
+	Preference<bool>	prefHeadless (kPrefKeyHeadless);
+	fHeadless = *prefHeadless || Startup::Headless ();
+
+	EmSessionContextLocker	lock (fContext);
+
 	EmAssert (gSession == NULL);
 	gSession = this;
 }
@@ -155,6 +187,9 @@ EmSession::EmSession (void) :
 EmSession::~EmSession (void)
 {
 	this->DestroyThread ();
+
+	EmSessionContext::Acquire (fContext);
+
 	this->Dispose ();
 
 	// Delete the CPU object here instead of in Dispose.  When reloading a
@@ -170,6 +205,17 @@ EmSession::~EmSession (void)
 
 	EmAssert (gSession == this);
 	gSession = NULL;
+
+	// Put back whatever globals we replaced before letting go of them.
+
+	EmSessionContext::Switch (NULL);
+	EmSessionContext::Release (fContext);
+
+	delete fContext;
+	fContext = NULL;
+
+	delete fSnapshot;
+	fSnapshot = NULL;
 }
 
 
@@ -186,6 +232,8 @@ void EmSession::CreateNew (const Configuration& cfg)
 {
 	EmAssert (!gApplication->IsBound ());
 
+	EmSessionContextLocker	lock (fContext);
+
 	this->Initialize (cfg);
 	this->Reset (kResetSoft);
 }
@@ -209,6 +257,8 @@ void EmSession::CreateOld (const EmFileRef& ref)
 	ChunkFile		chunkFile (stream);
 	SessionFile		sessionFile (chunkFile);
 
+	sessionFile.SetFileRef (ref);
+
 	// Load enough information so that we can initialize the system.
 
 	Configuration	cfg;
@@ -217,6 +267,8 @@ void EmSession::CreateOld (const EmFileRef& ref)
 		Errors::Throw (kError_InvalidSessionFile);
 	}
 
+	EmSessionContextLocker	lock (fContext);
+
 	this->Initialize (cfg);
 
 	// Now load the saved state.
@@ -246,6 +298,8 @@ void EmSession::CreateBound (void)
 	cfg.fRAMSize	= gApplication->GetBoundRAMSize ();
 //	cfg.fROMFile ignored in Initialize (gets the ROM from the resource)
 
+	EmSessionContextLocker	lock (fContext);
+
 	// Initialize the system.
 
 	this->Initialize (cfg);
@@ -513,9 +567,11 @@ void EmSession::Reset (EmResetType resetType)
 		fButtonQueue.Clear ();
 		fKeyQueue.Clear ();
 		fPenQueue.Clear ();
+		fHaveNextPenEvent = false;
 	}
 
 	fLastPenEvent = EmPenEvent (EmPoint (-1, -1), false);
+	fLastPenDelivered = EmPenEvent (EmPoint (-1, -1), false);
 
 	// All of meta-memory gets wiped out on reset; re-establish these.
 
@@ -559,6 +615,8 @@ void EmSession::Save (SessionFile& f)
 	// Write out the device type.
 
         PHEM_Log_Msg("Session::Save()");
+	EmSessionContextLocker	lock (fContext);
+
 	EmAssert (fConfiguration.fDevice.Supported ());
 	f.WriteDevice (fConfiguration.fDevice);
 
@@ -592,6 +650,8 @@ void EmSession::Load (SessionFile& f)
 	// information in this file.  As parts are loaded, the various
 	// sub-systems will have a chance to veto this optimistic assumption.
 
+	EmSessionContextLocker	lock (fContext);
+
 	f.SetCanReload (true);
 
 	// Ideally, we can load sub-systems in any order.  However,
@@ -647,13 +707,26 @@ void EmSession::Load (SessionFile& f)
 //		 EmSession::Save
 // ---------------------------------------------------------------------------
 
-void EmSession::Save (const EmFileRef& ref, Bool updateFileRef)
+void EmSession::Save (const EmFileRef& ref, Bool updateFileRef, Bool incremental)
 {
+	// RAM may be mapped from the file we're about to overwrite.
+
+	{
+		EmSessionContextLocker	lock (fContext);
+		EmBankSRAM::ReleaseMappedFile (ref);
+	}
+
 	EmStreamFile	stream (ref, kCreateOrEraseForUpdate,
 						kFileCreatorEmulator, kFileTypeSession);
 	ChunkFile		chunkFile (stream);
 	SessionFile		sessionFile (chunkFile);
 
+	Preference<bool>	prefUncompressed (kPrefKeySaveUncompressed);
+
+	sessionFile.SetFileRef (ref);
+	sessionFile.SetIncremental (incremental);
+	sessionFile.SetUncompressed (*prefUncompressed);
+
 	this->Save (sessionFile);
 
 	if (updateFileRef)
@@ -673,10 +746,86 @@ void EmSession::Load (const EmFileRef& ref)
 	ChunkFile		chunkFile (stream);
 	SessionFile		sessionFile (chunkFile);
 
+	sessionFile.SetFileRef (ref);
+
 	this->Load (sessionFile);
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmSession::SaveSnapshot
+// ---------------------------------------------------------------------------
+// Save the current state into memory.  This goes through the same Save
+// methods as saving to a file, so it captures the same things (CPU and
+// hardware registers, heap and patch state, etc.), but the chunks are
+// written to a block of memory, and the RAM and meta-memory images are
+// copied as-is instead of being compressed.
+
+void EmSession::SaveSnapshot (void)
+{
+	if (!fSnapshot)
+	{
+		fSnapshot = new EmSessionSnapshot;
+	}
+
+	Chunk&	state = fSnapshot->GetState ();
+	state.SetLength (0);
+
+	try
+	{
+		EmStreamChunk	stream (state);
+		ChunkFile		chunkFile (stream);
+		SessionFile		sessionFile (chunkFile);
+
+		sessionFile.SetSnapshot (fSnapshot);
+
+		this->Save (sessionFile);
+	}
+	catch (...)
+	{
+		// Don't leave a partial snapshot around to be restored later.
+
+		this->DiscardSnapshot ();
+		throw;
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSession::RestoreSnapshot
+// ---------------------------------------------------------------------------
+// Reload the state saved by SaveSnapshot.  The snapshot is kept, so it can
+// be restored again.  Restoring RAM only copies the pages that have changed
+// since the snapshot was taken.
+
+Bool EmSession::RestoreSnapshot (void)
+{
+	if (!fSnapshot)
+		return false;
+
+	EmStreamChunk	stream (fSnapshot->GetState ());
+	ChunkFile		chunkFile (stream);
+	SessionFile		sessionFile (chunkFile);
+
+	sessionFile.SetSnapshot (fSnapshot);
+
+	this->Load (sessionFile);
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSession::DiscardSnapshot
+// ---------------------------------------------------------------------------
+
+void EmSession::DiscardSnapshot (void)
+{
+	delete fSnapshot;
+	fSnapshot = NULL;
+}
+
+
 #pragma mark -
 
 // ---------------------------------------------------------------------------
@@ -811,9 +960,7 @@ Bool EmSession::SuspendThread (EmStopMethod how)
                 PHEM_Log_Place(fSuspendState.fAllCounters);
 		// Wake up the thread if it's sleeping.
 
-		fSleepLock.lock ();
-		fSleepCondition.broadcast ();
-		fSleepLock.unlock ();
+		this->WakeUp ();
 
                 PHEM_Log_Msg("SuspendThread: post-broadcast");
                 PHEM_Log_Place(fSuspendState.fAllCounters);
@@ -1067,13 +1214,79 @@ void EmSession::Sleep (unsigned long msecs)
 
 	fThread->get_time (&secs, &nsecs, secs, nsecs);
 
+	// If someone's tried to wake us up since the last time we slept,
+	// don't bother going to sleep; they may have done so just before
+	// we got here.
+
 	fSleepLock.lock ();
-	fSleepCondition.timedwait (secs, nsecs);
+
+	if (!fWakeUp)
+	{
+		fSleepCondition.timedwait (secs, nsecs);
+	}
+
+	fWakeUp = false;
+
 	fSleepLock.unlock ();
 }
 #endif
 
 
+// ---------------------------------------------------------------------------
+//		 EmSession::WakeUp
+// ---------------------------------------------------------------------------
+
+#if HAS_OMNI_THREAD
+void EmSession::WakeUp (void)
+{
+	omni_mutex_lock	lock (fSleepLock);
+
+	fWakeUp = true;
+	fSleepCondition.broadcast ();
+}
+#endif
+
+
+// ---------------------------------------------------------------------------
+//		 EmSession::SleepWhileStopped
+// ---------------------------------------------------------------------------
+// While the processor is stopped, nothing happens until an interrupt comes
+// along.  Rather than spinning, ask the hardware how long that could be
+// and sleep until then.  Posting input events or receiving serial data
+// wakes us up early.
+//
+// We hang onto the emulator globals while we sleep.  If another session
+// is waiting for them, CycleSlowly notices (with ShouldYield) once we
+// wake up, and gives them up then.
+
+#if HAS_OMNI_THREAD
+void EmSession::SleepWhileStopped (void)
+{
+	EmAssert (this->InCPUThread ());
+
+	uint32	msecs = EmHAL::GetSleepInterval ();
+
+	// Button events are doled out at a limited rate, so if there's one
+	// waiting its turn, come back around for it soon.
+
+	if (!fButtonQueue.IsEmpty () && (msecs == 0 || msecs > kButtonEventRecheck))
+	{
+		msecs = kButtonEventRecheck;
+	}
+
+	// Nothing should need us less often than this, but check back
+	// anyway in case something we haven't accounted for does.
+
+	if (msecs == 0 || msecs > kMaxSleepInterval)
+	{
+		msecs = kMaxSleepInterval;
+	}
+
+	this->Sleep (msecs);
+}
+#endif
+
+
 // ---------------------------------------------------------------------------
 //		 EmSession::InCPUThread
 // ---------------------------------------------------------------------------
@@ -1727,6 +1940,13 @@ void EmSession::PostButtonEvent (const EmButtonEvent& event, Bool postNow)
 	{
 		gLastButtonEvent = Platform::GetMilliseconds () - kButtonEventThreshold;
 	}
+
+#if HAS_OMNI_THREAD
+	// Buttons are picked up by the hardware emulation, so get the CPU
+	// thread out of SleepWhileStopped if it's in there.
+
+	this->WakeUp ();
+#endif
 }
 
 
@@ -1735,14 +1955,17 @@ Bool EmSession::HasButtonEvent (void)
 	// Don't feed hardware events out too quickly.  Otherwise, the OS
 	// may not have time to react to the register changes.
 
-	uint32	now = Platform::GetMilliseconds ();
+	// This gets polled a lot by the hardware emulation, so check the
+	// (lock-free) queue before asking for the time.
 
-	if (now - gLastButtonEvent < kButtonEventThreshold)
+	if (fButtonQueue.IsEmpty ())
 	{
 		return false;
 	}
 
-	return fButtonQueue.GetUsed () > 0;
+	uint32	now = Platform::GetMilliseconds ();
+
+	return now - gLastButtonEvent >= kButtonEventThreshold;
 }
 
 
@@ -1786,7 +2009,7 @@ void EmSession::PostKeyEvent (const EmKeyEvent& event)
 
 Bool EmSession::HasKeyEvent (void)
 {
-	return fKeyQueue.GetUsed () > 0;
+	return !fKeyQueue.IsEmpty ();
 }
 
 
@@ -1809,7 +2032,7 @@ EmKeyEvent EmSession::GetKeyEvent (void)
 //		 EmSession::GetPenEvent
 // ---------------------------------------------------------------------------
 
-void EmSession::PostPenEvent (const EmPenEvent& event)
+void EmSession::PostPenEvent (const EmPenEvent& inEvent)
 {
 	if (!::PrvCanBotherCPU())
 		return;
@@ -1817,11 +2040,20 @@ void EmSession::PostPenEvent (const EmPenEvent& event)
 	// If this pen-down event is the same as the last pen-down
 	// event, do nothing.
 
-	if (event.fPenIsDown && event == fLastPenEvent)
+	if (inEvent.fPenIsDown && inEvent == fLastPenEvent)
 	{
 		return;
 	}
 
+	// Mark moves, so that the CPU thread can merge the ones it hasn't
+	// gotten around to yet, and note when the event arrived in terms
+	// of the emulated clock.
+
+	EmPenEvent	event (inEvent);
+
+	event.fPenIsMove	= event.fPenIsDown && fLastPenEvent.fPenIsDown;
+	event.fPenTime		= EmHAL::GetCycleCount ();
+
 	// Add the event to our queue.
 
 	fPenQueue.Put (event);
@@ -1839,19 +2071,89 @@ void EmSession::PostPenEvent (const EmPenEvent& event)
 
 Bool EmSession::HasPenEvent (void)
 {
-	return fPenQueue.GetUsed () > 0;
+	return this->CoalescePenEvents () && this->PenEventDue ();
+}
+
+
+Bool EmSession::HasPendingPenEvent (void)
+{
+	return fHaveNextPenEvent || !fPenQueue.IsEmpty ();
 }
 
 
 EmPenEvent EmSession::PeekPenEvent (void)
 {
-	return fPenQueue.Peek ();
+	this->CoalescePenEvents ();
+
+	return fNextPenEvent;
 }
 
 
 EmPenEvent EmSession::GetPenEvent (void)
 {
-	return fPenQueue.Get ();
+	this->CoalescePenEvents ();
+
+	fHaveNextPenEvent = false;
+
+	fLastPenDelivered		= fNextPenEvent;
+	fLastPenDeliveredCycle	= EmHAL::GetCycleCount ();
+
+	return fNextPenEvent;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSession::CoalescePenEvents
+// ---------------------------------------------------------------------------
+// When the user drags the pen, the UI thread can post moves much faster
+// than Palm OS takes them.  Palm OS only cares where the pen is now, so
+// deliver just the latest of any moves that have piled up.  Pen-down and
+// pen-up events are never merged away, and a move is never merged with a
+// move from a different stroke, since there's a pen-up and pen-down event
+// between them.  The merged event keeps the latest move's time stamp.
+//
+// Called only from the consumer side, so it's free to look ahead in the
+// queue without a lock.
+
+Bool EmSession::CoalescePenEvents (void)
+{
+	if (!fHaveNextPenEvent)
+	{
+		if (fPenQueue.IsEmpty ())
+			return false;
+
+		fNextPenEvent = fPenQueue.Get ();
+		fHaveNextPenEvent = true;
+	}
+
+	while (fNextPenEvent.fPenIsMove &&
+		!fPenQueue.IsEmpty () && fPenQueue.Peek ().fPenIsMove)
+	{
+		fNextPenEvent = fPenQueue.Get ();
+	}
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSession::PenEventDue
+// ---------------------------------------------------------------------------
+// Events that piled up while the CPU was busy would otherwise go out back
+// to back, so that a pen held down for a second would look like a tap.
+// Within a stroke, keep each event as far behind the last one in emulated
+// time as it was when they were posted.  A stroke's first pen-down goes
+// out right away, so a delay in one stroke doesn't carry over to the next.
+
+Bool EmSession::PenEventDue (void)
+{
+	if (!fLastPenDelivered.fPenIsDown)
+		return true;
+
+	uint32	posted	= fNextPenEvent.fPenTime - fLastPenDelivered.fPenTime;
+	uint32	elapsed	= EmHAL::GetCycleCount () - fLastPenDeliveredCycle;
+
+	return elapsed >= posted;
 }
 
 
@@ -1874,6 +2176,30 @@ void EmSession::ReleaseBootKeys (void)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmSession::RingUARTDoorbell
+//		 EmSession::GetUARTDoorbell
+// ---------------------------------------------------------------------------
+
+void EmSession::RingUARTDoorbell (void)
+{
+	__atomic_add_fetch (&fUARTDoorbell, 1, __ATOMIC_RELEASE);
+
+#if HAS_OMNI_THREAD
+	// The UARTs are looked at by the hardware emulation, so get the CPU
+	// thread out of SleepWhileStopped if it's in there.
+
+	this->WakeUp ();
+#endif
+}
+
+
+uint32 EmSession::GetUARTDoorbell (void) const
+{
+	return __atomic_load_n (&fUARTDoorbell, __ATOMIC_ACQUIRE);
+}
+
+
 // ---------------------------------------------------------------------------
 //		 PrvCanBotherCPU
 // ---------------------------------------------------------------------------
@@ -1953,6 +2279,16 @@ EmDevice EmSession::GetDevice (void)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmSession::IsHeadless
+// ---------------------------------------------------------------------------
+
+Bool EmSession::IsHeadless (void)
+{
+	return fHeadless;
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmSession::GetBreakOnSysCall
 // ---------------------------------------------------------------------------
@@ -2528,33 +2864,65 @@ void EmSession::Run ()
                         PHEM_Log_Msg("Run, unocking shared...");
 			fSharedLock.unlock ();
 
+			// Wait for our turn at the emulator globals.  If another
+			// session has them, it'll give them up at the end of its time
+			// slice.  Check back every so often to see if we've been asked
+			// to suspend or stop in the meantime; otherwise, SuspendThread
+			// would be left waiting on us.
+
+			Bool	acquired = false;
+
+			while (!acquired)
+			{
+				acquired = EmSessionContext::Acquire (fContext, kContextWaitTime);
+
+				if (!acquired)
+				{
+					omni_mutex_lock	lock2 (fSharedLock);
+
+					if (fSuspendState.fAllCounters || fStop)
+						break;
+				}
+			}
+
 			// Execute the "fetch an opcode and emulate it" loop.  This
 			// function returns only if requested or an error occurs.
                         if (was_suspended) {
                           PHEM_Log_Msg("Invoking CPU after suspend.");
                         }
 
-			try
-			{
-				this->CallCPU ();
-			}
-			catch (EmExceptionReset& e)
+			if (acquired)
 			{
-				e.Display ();
-				e.DoAction ();
-			}
-			catch (EmExceptionTopLevelAction& e)
-			{
-				e.DoAction ();
-			}
-			catch (...)
-			{
-				EmAssert (false);
+				try
+				{
+					this->CallCPU ();
+				}
+				catch (EmExceptionReset& e)
+				{
+					e.Display ();
+					e.DoAction ();
+				}
+				catch (EmExceptionTopLevelAction& e)
+				{
+					e.DoAction ();
+				}
+				catch (...)
+				{
+					EmAssert (false);
+				}
+
+				EmSessionContext::Release (fContext);
 			}
 
                         PHEM_Log_Msg("Run, Locking shared...");
 			fSharedLock.lock ();
 
+			// A timeout suspend means that we used up our time slice, or
+			// that someone wanted us to come up for air.  Either way, we've
+			// done that, so pick up where we left off.
+
+			fSuspendState.fCounters.fSuspendByTimeout = 0;
+
 //			LogAppendMsg ("EmSession::Run (after CallCPU): fState = %ld", (long) fState);
 
 			EmAssert (fState == kRunning);
@@ -2601,6 +2969,15 @@ EmSessionStopper::EmSessionStopper (EmSession* cpu, EmStopMethod how) :
                 PHEM_Log_Place(fSession->fstop_count);
 		fStopped = fSession->SuspendThread (how);
                 PHEM_Log_Msg("Suspended.");
+
+		// Now that the CPU thread is out of the way, get the session's
+		// globals so that the caller can get at its memory, registers,
+		// etc.
+
+		if (fStopped)
+		{
+			EmSessionContext::Acquire (fSession->fContext);
+		}
 	}
 }
 
@@ -2613,6 +2990,8 @@ EmSessionStopper::~EmSessionStopper (void)
 {
 	if (fSession && fStopped)
 	{
+		EmSessionContext::Release (fSession->fContext);
+
                 fSession->fstop_count--;
                 PHEM_Log_Msg("~Stopper, count:");
                 PHEM_Log_Place(fSession->fstop_count);
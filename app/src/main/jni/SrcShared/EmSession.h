@@ -16,6 +16,7 @@
 
 #include "EmDevice.h"			// EmDevice
 #include "EmDlg.h"				// EmDlgItemID, EmCommonDialogFlags
+#include "EmInputQueue.h"		// EmInputQueue
 #include "EmThreadSafeQueue.h"	// EmThreadSafeQueue
 #include "Skins.h"				// SkinElementType
 
@@ -23,6 +24,9 @@
 #include "omnithread.h" 		// omni_thread, omni_mutex, omni_condition
 #endif
 
+class EmSessionContext;
+class EmSessionSnapshot;
+
 /*
 **	EmSession is the class used to manage an emulation session.  Its
 **	responsibilities are:
@@ -178,7 +182,7 @@ struct EmButtonEvent
 	Bool			fButtonIsDown;
 };
 
-typedef EmThreadSafeQueue<EmButtonEvent>	EmButtonQueue;
+typedef EmInputQueue<EmButtonEvent>		EmButtonQueue;
 
 
 // ---------------------------------------------------------------------------
@@ -214,7 +218,7 @@ struct EmKeyEvent
 	Bool	fWindowsDown;
 };
 
-typedef EmThreadSafeQueue<EmKeyEvent>	EmKeyQueue;
+typedef EmInputQueue<EmKeyEvent>		EmKeyQueue;
 
 
 // ---------------------------------------------------------------------------
@@ -224,18 +228,26 @@ typedef EmThreadSafeQueue<EmKeyEvent>	EmKeyQueue;
 /*
 **	Struct containing all data for a pen event (that is, when the user clicks
 **	the mouse in the touchscreen area).
+**
+**	fPenIsMove and fPenTime are filled in by EmSession::PostPenEvent.  A
+**	move is a pen-down event that follows another pen-down event; the
+**	time is the emulated CPU's cycle count when the event was posted.
 */
 
 struct EmPenEvent
 {
 	EmPenEvent (const EmPoint& point, Bool isDown) :
 		fPenPoint (point),
-		fPenIsDown (isDown)
+		fPenIsDown (isDown),
+		fPenIsMove (false),
+		fPenTime (0)
 	{
 	}
 
 	EmPoint	fPenPoint;
 	Bool	fPenIsDown;
+	Bool	fPenIsMove;
+	uint32	fPenTime;
 
 	bool operator==(const EmPenEvent& other) const
 	{
@@ -244,7 +256,7 @@ struct EmPenEvent
 	}
 };
 
-typedef EmThreadSafeQueue<EmPenEvent>	EmPenQueue;
+typedef EmInputQueue<EmPenEvent>		EmPenQueue;
 
 
 // ---------------------------------------------------------------------------
@@ -345,11 +357,25 @@ class EmSession
 		// Utility methods that create a SessionFile for the given file, and then
 		// call the above Save and Load methods.  If updateFileRef is true, then
 		// the EmFileRef is remembered as part of the session's "identity".
+		// If incremental is true, RAM may be saved as just the pages changed
+		// since the last full save, in which case the file can't be loaded
+		// without the one holding that full save.
 
 		void 					Save				(const EmFileRef&,
-													 Bool updateFileRef);
+													 Bool updateFileRef,
+													 Bool incremental = false);
 		void 					Load				(const EmFileRef&);
 
+		// Keep a copy of the current state in memory, for when the same
+		// state has to be reloaded many times (Gremlin Hordes going back
+		// to the root state, minimization going back to the initial state).
+		// RestoreSnapshot returns false if there's no snapshot.
+
+		void					SaveSnapshot		(void);
+		Bool					RestoreSnapshot		(void);
+		void					DiscardSnapshot		(void);
+		Bool					HasSnapshot			(void) { return fSnapshot != NULL; }
+
 		// Called by external thread to create and destroy the thread.  CreateThread
 		// is called after the EmSession is created.  If "suspended" is true, the
 		// client should also call ResumeThread.  If "suspended" is false, the
@@ -368,9 +394,16 @@ class EmSession
 		void					ResumeThread		(void);
 
 #if HAS_OMNI_THREAD
-		// Pause the thread by the given number of milliseconds.
+		// Pause the thread by the given number of milliseconds, or until
+		// someone calls WakeUp.  WakeUp can be called from any thread.
 
 		void					Sleep				(unsigned long msecs);
+		void					WakeUp				(void);
+
+		// Called by the CPU thread while the emulated processor is stopped.
+		// Sleeps until the hardware needs attention or input arrives.
+
+		void					SleepWhileStopped	(void);
 
 		// Return whether or not the calling function is executing in the context of
 		// the CPU thread or not.  If not, it's most likely executing in the UI
@@ -488,11 +521,19 @@ class EmSession
 
 		void					PostPenEvent		(const EmPenEvent&);
 		Bool					HasPenEvent			(void);
+		Bool					HasPendingPenEvent	(void);
 		EmPenEvent				PeekPenEvent		(void);
 		EmPenEvent				GetPenEvent			(void);
 
 		void					ReleaseBootKeys		(void);
 
+		// Called by the transports, from any thread, when serial bytes
+		// arrive.  The UART emulation remembers the last doorbell value
+		// it saw, and only refreshes its registers when it has changed.
+
+		void					RingUARTDoorbell	(void);
+		uint32					GetUARTDoorbell		(void) const;
+
 		// Method for getting information on the device we're emulating.
 		// Callable at any time from any thread.
 
@@ -500,6 +541,14 @@ class EmSession
 		EmFileRef				GetFile				(void);
 		EmDevice				GetDevice			(void);
 
+		// A headless session is one nobody's watching, run as fast as
+		// possible: the window is repainted only now and then, idle time
+		// isn't slept through, and the RTC follows the emulated clock.
+		// Set from kPrefKeyHeadless or -headless when the session is
+		// created.
+
+		Bool					IsHeadless			(void);
+
 		// Methods for determining if emulation should halt at certain
 		// points.  Called inside the CPU thread.
 
@@ -598,16 +647,37 @@ class EmSession
 
 		void					CallCPU				(void);
 
+		// Pull the next pen event off of the queue into fNextPenEvent,
+		// collapsing any run of moves behind it into the last one.
+
+		Bool					CoalescePenEvents	(void);
+
+		// Whether enough emulated time has gone by since the last pen
+		// event was delivered for fNextPenEvent to follow it.
+
+		Bool					PenEventDue			(void);
+
 	private:
 		friend class EmCPU;
 		friend class EmCPU68K;	// Accesses fSuspendState and fStop directly.
+		friend class EmSessionStopper;	// Accesses fContext.
 
 	private:
 		Configuration			fConfiguration;
 		EmFileRef				fFile;
+		Bool					fHeadless;
 
 		EmCPU*					fCPU;
 
+		// Our copy of the emulator globals.  Swapped in whenever we
+		// (or the UI thread on our behalf) need to touch them.
+
+		EmSessionContext*		fContext;
+
+		// In-memory copy of a saved state.  See SaveSnapshot.
+
+		EmSessionSnapshot*		fSnapshot;
+
 #if HAS_OMNI_THREAD
 		// Accessed from external thread only.
 
@@ -620,6 +690,7 @@ class EmSession
 
 		omni_mutex				fSleepLock;
 		omni_condition			fSleepCondition;
+		Bool					fWakeUp;			// Protected by fSleepLock.
 #endif
 
 		// ----------------------------------------------------------------------
@@ -686,8 +757,13 @@ class EmSession
 		EmKeyQueue				fKeyQueue;
 		EmPenQueue				fPenQueue;
 
-		EmPenEvent				fLastPenEvent;
+		EmPenEvent				fLastPenEvent;		// Last event posted.
+		EmPenEvent				fNextPenEvent;		// Next event to deliver, if fHaveNextPenEvent.
+		Bool					fHaveNextPenEvent;
+		EmPenEvent				fLastPenDelivered;	// Last event delivered.
+		uint32					fLastPenDeliveredCycle;	// When, in cycles.
 		uint32					fBootKeys;
+		uint32					fUARTDoorbell;		// Accessed atomically.
 
 	private:
 		InstructionBreakFuncList	fInstructionBreakFuncs;
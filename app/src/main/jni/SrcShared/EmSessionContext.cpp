@@ -0,0 +1,348 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#include "EmCommon.h"
+#include "EmSessionContext.h"
+
+#include "EmCodeCache.h"		// EmCodeCache::Flush
+#include "Platform.h"			// Platform::GetMilliseconds
+
+#include <string.h>				// memcpy
+
+#if HAS_OMNI_THREAD
+#include "omnithread.h" 		// omni_mutex, omni_condition
+#endif
+
+
+EmSessionGlobal*	EmSessionGlobal::fgFirst;
+int					EmSessionGlobal::fgCount;
+
+EmSessionContext*	EmSessionContext::fgCurrent;
+
+// How long a CPU thread gets to run before it has to let another session
+// have a turn.
+
+const uint32		kTimeSlice = 20;	// milliseconds
+
+#if HAS_OMNI_THREAD
+static omni_mutex			gContextMutex;
+static omni_condition		gContextCondition (&gContextMutex);
+#endif
+
+static EmSessionContext*	gOwner;			// Context holding the lock.
+static int					gOwnerDepth;	// Nesting level of Acquire calls.
+static EmSessionContext*	gPrevOwner;		// Last context to release it.
+static int					gWaiters;		// Contexts waiting in Acquire.
+static uint32				gSliceStart;	// When gOwner got the lock.
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionGlobal::EmSessionGlobal
+// ---------------------------------------------------------------------------
+
+EmSessionGlobal::EmSessionGlobal (void) :
+	fNext (fgFirst),
+	fIndex (fgCount++)
+{
+	fgFirst = this;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionGlobal::~EmSessionGlobal
+// ---------------------------------------------------------------------------
+
+EmSessionGlobal::~EmSessionGlobal (void)
+{
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionGlobalData::EmSessionGlobalData
+// ---------------------------------------------------------------------------
+
+EmSessionGlobalData::EmSessionGlobalData (void* global, size_t size) :
+	EmSessionGlobal (),
+	fGlobal (global),
+	fSize (size),
+	fInitial (Platform::AllocateMemory (size))
+{
+	memcpy (fInitial, fGlobal, fSize);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionGlobalData::~EmSessionGlobalData
+// ---------------------------------------------------------------------------
+
+EmSessionGlobalData::~EmSessionGlobalData (void)
+{
+	Platform::DisposeMemory (fInitial);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionGlobalData::NewCopy
+// ---------------------------------------------------------------------------
+
+void* EmSessionGlobalData::NewCopy (void)
+{
+	void*	copy = Platform::AllocateMemory (fSize);
+	memcpy (copy, fInitial, fSize);
+	return copy;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionGlobalData::DeleteCopy
+// ---------------------------------------------------------------------------
+
+void EmSessionGlobalData::DeleteCopy (void* copy)
+{
+	Platform::DisposeMemory (copy);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionGlobalData::Swap
+// ---------------------------------------------------------------------------
+// Exchange the live value with the copy a word at a time.  The larger
+// globals (like the memory bank table) are a whole number of words, so
+// the byte loop at the end only ever handles small ones.
+
+void EmSessionGlobalData::Swap (void* copy)
+{
+	uint32*	a = (uint32*) fGlobal;
+	uint32*	b = (uint32*) copy;
+	size_t	n = fSize / sizeof (uint32);
+
+	while (n--)
+	{
+		uint32	temp = *a;
+		*a++ = *b;
+		*b++ = temp;
+	}
+
+	uint8*	c = (uint8*) a;
+	uint8*	d = (uint8*) b;
+	n = fSize % sizeof (uint32);
+
+	while (n--)
+	{
+		uint8	temp = *c;
+		*c++ = *d;
+		*d++ = temp;
+	}
+}
+
+
+#pragma mark -
+
+// ---------------------------------------------------------------------------
+//		 EmSessionContext::EmSessionContext
+// ---------------------------------------------------------------------------
+
+EmSessionContext::EmSessionContext (void) :
+	fCopies (new void*[EmSessionGlobal::fgCount])
+{
+	EmSessionGlobal*	global = EmSessionGlobal::fgFirst;
+	while (global)
+	{
+		fCopies[global->fIndex] = global->NewCopy ();
+		global = global->fNext;
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionContext::~EmSessionContext
+// ---------------------------------------------------------------------------
+// Put back the globals we replaced, if we're current, and dispose of our
+// copies.  The caller should own the lock, as we may be touching the live
+// globals.
+
+EmSessionContext::~EmSessionContext (void)
+{
+	if (fgCurrent == this)
+	{
+		EmSessionContext::Switch (NULL);
+	}
+
+	EmSessionGlobal*	global = EmSessionGlobal::fgFirst;
+	while (global)
+	{
+		global->DeleteCopy (fCopies[global->fIndex]);
+		global = global->fNext;
+	}
+
+	delete [] fCopies;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionContext::Switch
+// ---------------------------------------------------------------------------
+// Swapping is its own inverse.  Swapping the current context's copies with
+// the live globals saves the current context's state and puts back what
+// was live before it was switched in.  Swapping in the new context then
+// makes its state live and leaves that previous state with it for next
+// time.  Passing NULL just switches out the current context.
+
+void EmSessionContext::Switch (EmSessionContext* context)
+{
+	if (context == fgCurrent)
+		return;
+
+	EmSessionGlobal*	global;
+
+	if (fgCurrent)
+	{
+		for (global = EmSessionGlobal::fgFirst; global; global = global->fNext)
+		{
+			global->Swap (fgCurrent->fCopies[global->fIndex]);
+		}
+	}
+
+	fgCurrent = context;
+
+	if (fgCurrent)
+	{
+		for (global = EmSessionGlobal::fgFirst; global; global = global->fNext)
+		{
+			global->Swap (fgCurrent->fCopies[global->fIndex]);
+		}
+	}
+
+	// Cached blocks are keyed by host address, and point into the memory
+	// of the session that recorded them.
+
+	EmCodeCache::Flush ();
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionContext::Acquire
+// ---------------------------------------------------------------------------
+// Wait until no other context owns the live globals, then take them over.
+// A context that has just released the lock waits until someone else has
+// had a turn, so that a CPU thread looping on Acquire/Release can't starve
+// the others.
+
+Bool EmSessionContext::Acquire (EmSessionContext* context, unsigned long msecs)
+{
+	EmAssert (context);
+
+#if HAS_OMNI_THREAD
+	omni_mutex_lock	lock (gContextMutex);
+
+	if (gOwner != context)
+	{
+		unsigned long	secs = 0;
+		unsigned long	nsecs = 0;
+
+		if (msecs)
+		{
+			omni_thread::get_time (&secs, &nsecs,
+				msecs / 1000, (msecs % 1000) * 1000000);
+		}
+
+		while (gOwner != NULL || (gPrevOwner == context && gWaiters > 0))
+		{
+			++gWaiters;
+
+			int	signalled = 1;
+
+			if (msecs)
+				signalled = gContextCondition.timedwait (secs, nsecs);
+			else
+				gContextCondition.wait ();
+
+			--gWaiters;
+
+			if (!signalled)
+			{
+				// Our giving up may be what the previous owner is
+				// waiting for.
+
+				gContextCondition.broadcast ();
+				return false;
+			}
+		}
+
+		gOwner = context;
+		gPrevOwner = NULL;
+		gSliceStart = Platform::GetMilliseconds ();
+	}
+
+	++gOwnerDepth;
+#else
+	UNUSED_PARAM (msecs)
+
+	gOwner = context;
+	++gOwnerDepth;
+#endif
+
+	EmSessionContext::Switch (context);
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionContext::Release
+// ---------------------------------------------------------------------------
+// Give up ownership of the live globals.  They're left as they are; the
+// next context to acquire them switches them out.
+
+void EmSessionContext::Release (EmSessionContext* context)
+{
+#if HAS_OMNI_THREAD
+	omni_mutex_lock	lock (gContextMutex);
+#endif
+
+	EmAssert (gOwner == context);
+	EmAssert (gOwnerDepth > 0);
+
+	if (--gOwnerDepth == 0)
+	{
+		gOwner = NULL;
+		gPrevOwner = context;
+
+#if HAS_OMNI_THREAD
+		gContextCondition.broadcast ();
+#endif
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionContext::ShouldYield
+// ---------------------------------------------------------------------------
+
+Bool EmSessionContext::ShouldYield (void)
+{
+#if HAS_OMNI_THREAD
+	// This is called from CycleSlowly, so keep the common case -- nobody
+	// waiting -- down to a single load.  Peek at gWaiters without the
+	// mutex; if we miss a waiter, we'll notice it next time.
+
+	if (__atomic_load_n (&gWaiters, __ATOMIC_RELAXED) == 0)
+		return false;
+
+	omni_mutex_lock	lock (gContextMutex);
+
+	return gWaiters > 0 && Platform::GetMilliseconds () - gSliceStart >= kTimeSlice;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,195 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#ifndef EmSessionContext_h
+#define EmSessionContext_h
+
+#include <algorithm>			// swap
+#include <stddef.h>				// size_t
+
+/*
+	Much of the emulated machine's state lives in globals: the UAE
+	registers, the memory bank table, the RAM and ROM buffers, the
+	hardware register handlers, and so on.  That's fine with one session
+	per process, but makes it impossible to have more than one.
+
+	EmSessionContext makes those globals per-session without having to
+	touch every place that uses them.  Each global that belongs to a
+	session is registered with EM_SESSION_GLOBAL (for PODs and arrays of
+	PODs) or EM_SESSION_OBJECT (for anything with a real copy
+	constructor, like STL containers).  An EmSessionContext holds a
+	private copy of every registered global.  Switching to a context
+	swaps its copies with the live globals; switching away swaps them
+	back.  The emulator code itself only ever sees the live globals.
+
+	Since there's only one set of live globals, only one session can be
+	emulating at a time.  The right to touch them is handed out with
+	Acquire and Release.  The lock is owned by a context rather than by a
+	thread, because a session's CPU thread and the UI thread take turns
+	touching the same session (the UI thread does so after stopping the
+	CPU thread with an EmSessionStopper).  A CPU thread gives up the lock
+	after running for a time slice if anyone else is waiting for it.
+
+	With only one session, there is only one context, it's switched to
+	once, and nothing else changes.
+*/
+
+class EmSessionContext;
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionGlobal
+// ---------------------------------------------------------------------------
+// Registry entry for a single session-scoped global.  Instances are
+// created at static initialization time by the EM_SESSION_GLOBAL and
+// EM_SESSION_OBJECT macros below, and are strung together in a list.
+
+class EmSessionGlobal
+{
+	public:
+								EmSessionGlobal		(void);
+		virtual					~EmSessionGlobal	(void);
+
+		// Create a copy of the global's initial value, dispose of such a
+		// copy, and exchange a copy with the live global.
+
+		virtual void*			NewCopy				(void) = 0;
+		virtual void			DeleteCopy			(void*) = 0;
+		virtual void			Swap				(void*) = 0;
+
+	private:
+		friend class EmSessionContext;
+
+		EmSessionGlobal*		fNext;
+		int						fIndex;
+
+		static EmSessionGlobal*	fgFirst;
+		static int				fgCount;
+};
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionGlobalData
+// ---------------------------------------------------------------------------
+// Registry entry for plain old data.  The value the global has when it's
+// registered is the value a new session starts out with.
+
+class EmSessionGlobalData : public EmSessionGlobal
+{
+	public:
+								EmSessionGlobalData	(void* global, size_t size);
+		virtual					~EmSessionGlobalData(void);
+
+		virtual void*			NewCopy				(void);
+		virtual void			DeleteCopy			(void*);
+		virtual void			Swap				(void*);
+
+	private:
+		void*					fGlobal;
+		size_t					fSize;
+		void*					fInitial;
+};
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionGlobalObject
+// ---------------------------------------------------------------------------
+// Registry entry for a global object.  A new session starts out with a
+// default-constructed object.
+
+template <class T>
+class EmSessionGlobalObject : public EmSessionGlobal
+{
+	public:
+								EmSessionGlobalObject	(T* global) : fGlobal (global) {}
+
+		virtual void*			NewCopy				(void) { return new T; }
+		virtual void			DeleteCopy			(void* copy) { delete (T*) copy; }
+		virtual void			Swap				(void* copy) { std::swap (*fGlobal, *(T*) copy); }
+
+	private:
+		T*						fGlobal;
+};
+
+
+#define EM_SESSION_CONCAT2(a, b)	a##b
+#define EM_SESSION_CONCAT(a, b)		EM_SESSION_CONCAT2 (a, b)
+#define EM_SESSION_NAME				EM_SESSION_CONCAT (gSessionGlobal_, __LINE__)
+
+#define EM_SESSION_GLOBAL(var)		\
+	static EmSessionGlobalData EM_SESSION_NAME (&(var), sizeof (var))
+
+#define EM_SESSION_OBJECT(type, var)	\
+	static EmSessionGlobalObject<type> EM_SESSION_NAME (&(var))
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionContext
+// ---------------------------------------------------------------------------
+
+class EmSessionContext
+{
+	public:
+								EmSessionContext	(void);
+								~EmSessionContext	(void);
+
+		// Make the given context's globals the live ones.  The caller
+		// must own the lock (or be the only session in town).
+
+		static void				Switch				(EmSessionContext*);
+		static EmSessionContext*	GetCurrent		(void) { return fgCurrent; }
+
+		// Get the right to touch the live globals on behalf of the given
+		// context, and switch to it.  Calls nest.  If msecs is non-zero,
+		// give up after that long and return false.
+
+		static Bool				Acquire				(EmSessionContext*, unsigned long msecs = 0);
+		static void				Release				(EmSessionContext*);
+
+		// Called periodically by the owner's CPU thread.  Returns true if
+		// it's been running for a full time slice and some other context
+		// is waiting for its turn.
+
+		static Bool				ShouldYield			(void);
+
+	private:
+		void**					fCopies;
+
+		static EmSessionContext*	fgCurrent;
+};
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionContextLocker
+// ---------------------------------------------------------------------------
+// Stack-based helper for Acquire and Release.
+
+class EmSessionContextLocker
+{
+	public:
+								EmSessionContextLocker	(EmSessionContext* context) :
+									fContext (context)
+								{
+									EmSessionContext::Acquire (fContext);
+								}
+
+								~EmSessionContextLocker	(void)
+								{
+									EmSessionContext::Release (fContext);
+								}
+
+	private:
+		EmSessionContext*		fContext;
+};
+
+#endif	/* EmSessionContext_h */
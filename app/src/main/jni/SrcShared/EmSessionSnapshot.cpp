@@ -0,0 +1,96 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#include "EmCommon.h"
+#include "EmSessionSnapshot.h"
+
+#include <string.h>				// memcmp, memcpy
+
+
+// Granularity at which restored images are compared and copied.
+
+const uint32	kSnapshotPageSize = 4096;
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionSnapshot::EmSessionSnapshot
+// ---------------------------------------------------------------------------
+
+EmSessionSnapshot::EmSessionSnapshot (void) :
+	fState ()
+{
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionSnapshot::~EmSessionSnapshot
+// ---------------------------------------------------------------------------
+
+EmSessionSnapshot::~EmSessionSnapshot (void)
+{
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionSnapshot::SaveImage
+// ---------------------------------------------------------------------------
+
+void EmSessionSnapshot::SaveImage (ImageID which, const void* image, uint32 size)
+{
+	EmAssert (which < kNumImages);
+
+	Chunk&	copy = fImages[which];
+
+	copy.SetLength (size);
+	memcpy (copy.GetPointer (), image, size);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmSessionSnapshot::RestoreImage
+// ---------------------------------------------------------------------------
+// Make the given image match the saved copy.  Rather than copying the whole
+// thing, compare it a page at a time and copy only the pages that changed
+// since the snapshot was taken (or last restored).  Comparing is a read-only
+// pass, so it's much cheaper than dirtying every page of a large image.
+// Returns false if there's no copy of the image, or it's a different size.
+
+Bool EmSessionSnapshot::RestoreImage (ImageID which, void* image, uint32 size)
+{
+	EmAssert (which < kNumImages);
+
+	const Chunk&	copy = fImages[which];
+
+	if (copy.GetLength () != (long) size)
+		return false;
+
+	const uint8*	src = (const uint8*) copy.GetPointer ();
+	uint8*			dest = (uint8*) image;
+	uint32			offset = 0;
+
+	while (offset < size)
+	{
+		uint32	len = size - offset;
+		if (len > kSnapshotPageSize)
+			len = kSnapshotPageSize;
+
+		if (memcmp (dest + offset, src + offset, len) != 0)
+		{
+			memcpy (dest + offset, src + offset, len);
+		}
+
+		offset += len;
+	}
+
+	return true;
+}
@@ -0,0 +1,65 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#ifndef EmSessionSnapshot_h
+#define EmSessionSnapshot_h
+
+#include "ChunkFile.h"			// Chunk
+
+/*
+	EmSessionSnapshot holds a copy of a session's state in memory, for
+	the cases where the same state gets reloaded over and over again:
+	Gremlin Hordes go back to the root state before every Gremlin, and
+	minimization reloads the initial state for every subset of events
+	it tries.  Going through a session file each time means compressing
+	and decompressing all of RAM, which swamps everything else.
+
+	Everything but the big memory images is saved with the normal
+	SessionFile machinery, into a ChunkFile kept in fState.  The RAM and
+	meta-memory images are handed to SaveImage and RestoreImage by the
+	banks that own them (they check SessionFile::GetSnapshot).  They're
+	kept uncompressed and in host byte order, and restoring one only
+	copies back the pages that differ from the copy, which after a
+	short Gremlin run is a small fraction of RAM.
+*/
+
+class EmSessionSnapshot
+{
+	public:
+								EmSessionSnapshot	(void);
+								~EmSessionSnapshot	(void);
+
+		enum ImageID
+		{
+			kRAMImage,
+			kMetaRAMImage,
+			kMetaROMImage,
+			kDirtyPagesImage,
+
+			kNumImages
+		};
+
+		Chunk&					GetState			(void) { return fState; }
+
+		void					SaveImage			(ImageID, const void*, uint32 size);
+		Bool					RestoreImage		(ImageID, void*, uint32 size);
+
+	private:
+								EmSessionSnapshot	(const EmSessionSnapshot&);
+		EmSessionSnapshot&		operator=			(const EmSessionSnapshot&);
+
+		Chunk					fState;
+		Chunk					fImages[kNumImages];
+};
+
+#endif	/* EmSessionSnapshot_h */
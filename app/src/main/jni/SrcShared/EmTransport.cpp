@@ -216,6 +216,27 @@ long EmTransport::BytesInBuffer (long /*minBytes*/)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	EmTransport::SpaceInBuffer
+ *
+ * DESCRIPTION:	Returns the number of bytes that can be written with
+ *				the Write method without any of them being dropped.
+ *				Transports that don't buffer what's written have no
+ *				limit.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	Number of bytes that can be written.
+ *
+ ***********************************************************************/
+
+long EmTransport::SpaceInBuffer (void)
+{
+	return 0x7FFFFFFF;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	EmTransport::CloseAllTransports
@@ -95,6 +95,7 @@ class EmTransport
 		virtual Bool			CanWrite			(void);
 
 		virtual long			BytesInBuffer		(long minBytes);
+		virtual long			SpaceInBuffer		(void);
 
 		virtual string			GetSpecificName		(void) = 0;
 
@@ -364,6 +364,28 @@ long EmTransportSerial::BytesInBuffer (long minBytes)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	EmTransportSerial::SpaceInBuffer
+ *
+ * DESCRIPTION:	Returns the number of bytes that can be written with
+ *				the Write method without any of them being dropped.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	Number of bytes that can be written.
+ *
+ ***********************************************************************/
+
+long EmTransportSerial::SpaceInBuffer (void)
+{
+	if (!fCommEstablished)
+		return 0;
+
+	return this->HostSpaceInBuffer ();
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	EmTransportSerial::GetSpecificName
@@ -85,6 +85,7 @@ class EmTransportSerial : public EmTransport
 		virtual Bool			CanRead					(void);
 		virtual Bool			CanWrite				(void);
 		virtual long			BytesInBuffer			(long minBytes);
+		virtual long			SpaceInBuffer			(void);
 		virtual string			GetSpecificName			(void);
 
 		ErrCode					SetConfig				(const ConfigSerial&);
@@ -113,6 +114,7 @@ class EmTransportSerial : public EmTransport
 		ErrCode					HostRead				(long&, void*);
 		ErrCode					HostWrite				(long&, const void*);
 		long					HostBytesInBuffer		(long minBytes);
+		long					HostSpaceInBuffer		(void);
 
 		ErrCode					HostSetConfig			(const ConfigSerial&);
 
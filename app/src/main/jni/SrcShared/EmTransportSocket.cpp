@@ -15,6 +15,7 @@
 #include "EmTransportSocket.h"
 
 #include "EmErrCodes.h"			// kError_CommOpen, kError_CommNotOpen, kError_NoError
+#include "EmSession.h"			// gSession, WakeUp
 #include "Logging.h"			// LogSerial
 #include "Platform.h"			// Platform::AllocateMemory
 
@@ -45,6 +46,11 @@
 
 #define PRINTF	if (!LogSerial ()) ; else LogAppendMsg
 
+// Size of the buffer between the socket and the emulated UART.  Bytes
+// arriving while it's full are dropped, as with a serial port overrun.
+
+const long	kSocketBufferSize = 64 * 1024;
+
 EmTransportSocket::OpenPortList	EmTransportSocket::fgOpenPorts;
 
 
@@ -68,8 +74,7 @@ EmTransportSocket::OpenPortList	EmTransportSocket::fgOpenPorts;
  ***********************************************************************/
 
 EmTransportSocket::EmTransportSocket (void) :
-	fReadMutex (),
-	fReadBuffer (),
+	fReadBuffer (kSocketBufferSize),
 	fDataConnectSocket (NULL),
 	fDataListenSocket (NULL),
 	fConfig (),
@@ -92,8 +97,7 @@ EmTransportSocket::EmTransportSocket (void) :
  ***********************************************************************/
 
 EmTransportSocket::EmTransportSocket (const EmTransportDescriptor& desc) :
-	fReadMutex (),
-	fReadBuffer (),
+	fReadBuffer (kSocketBufferSize),
 	fDataConnectSocket (NULL),
 	fDataListenSocket (NULL),
 	fConfig (),
@@ -146,8 +150,7 @@ EmTransportSocket::EmTransportSocket (const EmTransportDescriptor& desc) :
  ***********************************************************************/
 
 EmTransportSocket::EmTransportSocket (const ConfigSocket& config) :
-	fReadMutex (),
-	fReadBuffer (),
+	fReadBuffer (kSocketBufferSize),
 	fDataConnectSocket (NULL),
 	fDataListenSocket (NULL),
 	fConfig (config),
@@ -655,26 +658,52 @@ void EmTransportSocket::EventCallBack (CSocket* s, int event)
 			break;
 
 		case CSocket::kDataReceived:
-			while (s->HasUnreadData(1))
+		{
+			// Gather up what's arrived and hand it over a buffer-full
+			// at a time rather than byte by byte.
+			//
+			// Take no more than the ring has room for.  Whatever's left
+			// stays in the socket, so TCP's flow control holds the sender
+			// back.  CTCPSocket::Idle calls us again while there's unread
+			// data, so we pick up where we left off as soon as the UART
+			// drains the ring.
+
+			EmTransportSocket*	owner = ((CTCPClientSocket*)s)->GetOwner();
+
+			char	buf[1024];
+			long	total = 0;
+			Bool	more = true;
+
+			while (more)
 			{
-				long len = 1;
-				char buf;
+				more = total < owner->fReadBuffer.GetFree () && s->HasUnreadData(1);
+
+				if (more)
+				{
+					long len = 1;
 
-				s->Read(&buf, len, &len);
+					s->Read(&buf[total], len, &len);
 
-				if (len > 0)
+					total += len;
+					more = len > 0;
+				}
+
+				if (total > 0 && (!more || total == (long) sizeof (buf)))
 				{
 					// Log the data.
 					if (LogSerialData ())
-						LogAppendData (&buf, len, "EmTransportSocket::CommRead: Received data:");
+						LogAppendData (buf, total, "EmTransportSocket::CommRead: Received data:");
 					else
-						PRINTF ("EmTransportSocket::CommRead: Received %ld TCP bytes.", len);
+						PRINTF ("EmTransportSocket::CommRead: Received %ld TCP bytes.", total);
 
 					// Add the data to the EmTransportSocket object's buffer.
-					((CTCPClientSocket*)s)->GetOwner()->PutIncomingData (&buf, len);
+					owner->PutIncomingData (buf, total);
+
+					total = 0;
 				}
 			}
 			break;
+		}
 
 		case CSocket::kDisconnected:
 			break;
@@ -771,10 +800,13 @@ ErrCode EmTransportSocket::CloseCommPortListen (void)
  * FUNCTION:	EmTransportSocket::PutIncomingData
  *
  * DESCRIPTION:	Thread-safe method for adding data to the queue that
- *				holds data read from the TCP port.
+ *				holds data read from the TCP port.  The caller should
+ *				check that there's room first (see EventCallBack);
+ *				anything that doesn't fit is dropped.
  *
  * PARAMETERS:	data - pointer to the read data.
- *				len - number of bytes pointed to by "data".
+ *				len - on input, number of bytes pointed to by "data".
+ *					On exit, number of bytes added to the queue.
  *
  * RETURNED:	Nothing
  *
@@ -785,12 +817,18 @@ void EmTransportSocket::PutIncomingData	(const void* data, long& len)
 	if (len == 0)
 		return;
 
-	omni_mutex_lock lock (fReadMutex);
+	long	amtPut = fReadBuffer.Put (data, len);
+
+	if (amtPut < len)
+		PRINTF ("EmTransportSocket::PutIncomingData: Dropped %ld TCP bytes.", len - amtPut);
+
+	len = amtPut;
+
+	// Let the UART know there's new data, and make sure the CPU isn't
+	// sleeping through it.
 
-	char*	begin = (char*) data;
-	char*	end = begin + len;
-	while (begin < end)
-		fReadBuffer.push_back (*begin++);
+	if (gSession)
+		gSession->RingUARTDoorbell ();
 }
 
 
@@ -811,17 +849,7 @@ void EmTransportSocket::PutIncomingData	(const void* data, long& len)
 
 void EmTransportSocket::GetIncomingData	(void* data, long& len)
 {
-	omni_mutex_lock lock (fReadMutex);
-
-	if (len > (long) fReadBuffer.size ())
-		len = (long) fReadBuffer.size ();
-
-	char*	p = (char*) data;
-	deque<char>::iterator	begin = fReadBuffer.begin ();
-	deque<char>::iterator	end = begin + len;
-
-	copy (begin, end, p);
-	fReadBuffer.erase (begin, end);
+	len = fReadBuffer.Get (data, len);
 }
 
 
@@ -841,9 +869,7 @@ void EmTransportSocket::GetIncomingData	(void* data, long& len)
 
 long EmTransportSocket::IncomingDataSize (void)
 {
-	omni_mutex_lock lock (fReadMutex);
-
-	return fReadBuffer.size ();
+	return fReadBuffer.GetUsed ();
 }
 
 
@@ -14,10 +14,10 @@
 #ifndef EmTransportSocket_h
 #define EmTransportSocket_h
 
+#include "EmByteRing.h"			// EmByteRing
 #include "EmTransport.h"
 #include "SocketMessaging.h"
 
-#include <deque>
 #include <map>
 #include <vector>
 #include <string>
@@ -107,8 +107,9 @@ class EmTransportSocket : public EmTransport
 
 	public:
 
-		omni_mutex				fReadMutex;
-		deque<char>				fReadBuffer;
+		// Filled by EventCallBack on the UI thread, drained by the
+		// emulated UART on the CPU thread.
+		EmByteRing				fReadBuffer;
 
 		// CTCPClientSocket*		fDataSocket;
 		CTCPClientSocket*		fDataConnectSocket;
@@ -43,6 +43,7 @@ EmWindow::EmWindow (void) :
 	fCurrentButton (kElement_None),
 	fNeedWindowReset (false),
 	fNeedWindowInvalidate (false),
+	fLastHeadlessPaint (0),
 	fOldLCDOn (false),
 	fOldBacklightOn (false),
 	fOldLEDState (0),
@@ -403,6 +404,21 @@ void EmWindow::HandleGremlinMode (Bool gremlinMode)
 
 void EmWindow::HandleIdle (void)
 {
+	// Painting and checking the vibrator both stop the CPU thread.  A
+	// headless session only gets that done about once a second.
+
+	const uint32	kHeadlessPaintInterval = 1000;
+
+	if (gSession && gSession->IsHeadless () && !fNeedWindowReset)
+	{
+		uint32	now = Platform::GetMilliseconds ();
+
+		if (now - fLastHeadlessPaint < kHeadlessPaintInterval)
+			return;
+
+		fLastHeadlessPaint = now;
+	}
+
 	// Get the current mouse position.
         //PHEM_Log_Msg("Window:HandleIdle...");
 #if 0
@@ -723,9 +739,48 @@ void EmWindow::PaintLCDFrame (const EmScreenUpdateInfo&)
 // ---------------------------------------------------------------------------
 //		 EmWindow::PaintLCD
 // ---------------------------------------------------------------------------
-// Draw the LCD portion of the window.
+// Draw the LCD portion of the window.  Only the lines that have changed
+// are drawn.  Each run of changed lines is drawn separately, except that
+// runs separated by just a few unchanged lines are drawn as one in order
+// to cut down on the per-call overhead in the host routines.
 
 void EmWindow::PaintLCD (const EmScreenUpdateInfo& info)
+{
+	const long	kMaxCleanGap = 4;
+
+	long	line = info.fFirstLine;
+
+	while (line < info.fLastLine)
+	{
+		if (!info.IsLineDirty (line))
+		{
+			++line;
+			continue;
+		}
+
+		long	firstLine	= line;
+		long	lastLine	= line + 1;
+
+		for (line = lastLine; line < info.fLastLine && line - lastLine < kMaxCleanGap; ++line)
+		{
+			if (info.IsLineDirty (line))
+			{
+				lastLine = line + 1;
+			}
+		}
+
+		this->PaintLCDLines (info, firstLine, lastLine);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmWindow::PaintLCDLines
+// ---------------------------------------------------------------------------
+// Draw the given range of LCD scanlines.
+
+void EmWindow::PaintLCDLines (const EmScreenUpdateInfo& info,
+							  long firstLine, long lastLine)
 {
 	// Get the bounds of the LCD area.
 
@@ -735,8 +790,8 @@ void EmWindow::PaintLCD (const EmScreenUpdateInfo& info)
 
 	EmRect	destRect = ::SkinScaleDown (lcdRect);
 
-	destRect.fBottom	= destRect.fTop + info.fLastLine;
-	destRect.fTop		= destRect.fTop + info.fFirstLine;
+	destRect.fBottom	= destRect.fTop + lastLine;
+	destRect.fTop		= destRect.fTop + firstLine;
 
 	destRect = ::SkinScaleUp (destRect);
 
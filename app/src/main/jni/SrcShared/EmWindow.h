@@ -81,6 +81,8 @@ class EmWindow
 		void					PaintCase			(const EmScreenUpdateInfo& info);
 		void					PaintLCDFrame		(const EmScreenUpdateInfo& info);
 		void					PaintLCD			(const EmScreenUpdateInfo& info);
+		void					PaintLCDLines		(const EmScreenUpdateInfo& info,
+												 long firstLine, long lastLine);
 		void					PaintLED			(uint16 ledState);
 		void					PaintButtonFrames	(void);
 
@@ -161,6 +163,7 @@ class EmWindow
 
 		Bool					fNeedWindowReset;
 		Bool					fNeedWindowInvalidate;
+		uint32					fLastHeadlessPaint;
 
 		Bool					fOldLCDOn;
 		Bool					fOldBacklightOn;
@@ -22,6 +22,7 @@
 #include "EmBankSRAM.h"			// gRAMBank_Size, gRAM_Memory, gMemoryAccess
 #include "EmCPU.h"				// GetSP
 #include "EmCPU68K.h"			// gCPU68K
+#include "EmCodeCache.h"		// EmCodeCache::Invalidate
 #include "EmHAL.h"				// EmHAL
 #include "EmMemory.h"			// Memory::InitializeBanks, IsPCInRAM (implicitly, through META_CHECK)
 #include "EmPalmFunction.h"		// InSysLaunch
@@ -29,6 +30,7 @@
 #include "EmPatchState.h"		// META_CHECK calls EmPatchState::IsPCInMemMgr
 #include "EmScreen.h"			// EmScreen::MarkDirty
 #include "EmSession.h"			// gSession
+#include "EmSessionContext.h"	// EM_SESSION_GLOBAL
 #include "MetaMemory.h"			// MetaMemory
 #include "Profiling.h"			// WAITSTATES_DRAM
 
@@ -57,6 +59,7 @@ const emuptr	kGlobalStart = offsetof (LowMemHdrType, globals);
 // ----- Saved variables -----------------------------------------------------
 
 static uint32	gDynamicHeapSize;
+EM_SESSION_GLOBAL (gDynamicHeapSize);
 
 
 // ----- UnSaved variables ---------------------------------------------------
@@ -168,6 +171,15 @@ static inline void PrvScreenCheck (uint8* metaAddress, emuptr address, size_t si
 }
 
 
+static inline void PrvCodeCheck (uint8* metaAddress, emuptr address, size_t size)
+{
+	if (MetaMemory::IsCodeCached (metaAddress, size))
+	{
+		EmCodeCache::Invalidate (InlineGetRealAddress (address), metaAddress, size);
+	}
+}
+
+
 #pragma mark -
 
 // ===========================================================================
@@ -451,6 +463,9 @@ void EmBankDRAM::SetLong (emuptr address, uint32 value)
 	}
 
 	::PrvScreenCheck (metaAddress, address, sizeof (uint32));
+	::PrvCodeCheck (metaAddress, address, sizeof (uint32));
+
+	EmBankSRAM::MarkDirty (address, sizeof (uint32));
 
 #if (HAS_PROFILING)
 	CYCLE_PUTLONG (WAITSTATES_DRAM);
@@ -505,6 +520,9 @@ void EmBankDRAM::SetWord (emuptr address, uint32 value)
 	}
 
 	::PrvScreenCheck (metaAddress, address, sizeof (uint16));
+	::PrvCodeCheck (metaAddress, address, sizeof (uint16));
+
+	EmBankSRAM::MarkDirty (address, sizeof (uint16));
 
 #if (HAS_PROFILING)
 	CYCLE_PUTWORD (WAITSTATES_DRAM);
@@ -554,6 +572,9 @@ void EmBankDRAM::SetByte (emuptr address, uint32 value)
 	}
 
 	::PrvScreenCheck (metaAddress, address, sizeof (uint8));
+	::PrvCodeCheck (metaAddress, address, sizeof (uint8));
+
+	EmBankSRAM::MarkDirty (address, sizeof (uint8));
 
 #if (HAS_PROFILING)
 	CYCLE_PUTBYTE (WAITSTATES_DRAM);
@@ -618,6 +639,42 @@ void EmBankDRAM::AddOpcodeCycles (void)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmBankDRAM::GetFastPage
+// ---------------------------------------------------------------------------
+// Called by Memory::UpdateFastPages.  If the given range can be read (or
+// written) without any of the checks that the accessors above make, return
+// its host address.  Otherwise, return NULL.
+
+uint8* EmBankDRAM::GetFastPage (emuptr address, uint32 size, Bool forWrite)
+{
+	if (address > gDynamicHeapSize)
+		return EmBankSRAM::GetFastPage (address, size, forWrite);
+
+	// Don't bother with a range straddling the end of the dynamic heap.
+
+	if (address + size - 1 > gDynamicHeapSize)
+		return NULL;
+
+	// Anything marked in meta-memory needs META_CHECK, PrvScreenCheck,
+	// or PrvCodeCheck.
+
+	uint8*	metaAddress = InlineGetMetaAddress (address);
+
+	if (forWrite ? MetaMemory::HasWriteChecks (metaAddress, size) :
+				   MetaMemory::HasReadChecks (metaAddress, size))
+		return NULL;
+
+	// Anything in the current stack needs PrvCheckBelowStackPointerAccess.
+	// EmPalmOS::SetCurrentStack invalidates the pages when this changes.
+
+	if (gStackLow != EmMemNULL && address < gStackHigh && address + size > gStackLow)
+		return NULL;
+
+	return InlineGetRealAddress (address);
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmBankDRAM::AddressError
 // ---------------------------------------------------------------------------
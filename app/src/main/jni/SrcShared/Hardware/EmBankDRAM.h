@@ -39,6 +39,8 @@ class EmBankDRAM
 		static uint8*			GetMetaAddress		(emuptr address);
 		static void				AddOpcodeCycles		(void);
 
+		static uint8*			GetFastPage			(emuptr address, uint32 size, Bool forWrite);
+
 	private:
 		static void				AddressError		(emuptr address, long size, Bool forRead);
 		static void				InvalidAccess		(emuptr address, long size, Bool forRead);
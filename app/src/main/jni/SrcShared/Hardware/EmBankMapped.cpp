@@ -16,6 +16,7 @@
 
 #include "EmCPU68K.h"			// gCPU68K
 #include "EmMemory.h"			// Memory::InitializeBanks
+#include "EmSessionContext.h"	// EM_SESSION_OBJECT
 #include "Profiling.h"			// WAITSTATES_DUMMYBANK
 
 #include <vector>
@@ -68,6 +69,9 @@ typedef vector<MapRange>		MapRangeList;
 static MapRangeList				gMappedRanges;
 static MapRangeList::iterator	gLastIter;
 
+EM_SESSION_OBJECT (MapRangeList, gMappedRanges);
+EM_SESSION_OBJECT (MapRangeList::iterator, gLastIter);
+
 // Map in blocks starting at this address.  I used to have it way out of
 // the way at 0x60000000.  However, there's a check in SysGetAppInfo to
 // make sure that certain addresses are less than 0x20000000.  So set
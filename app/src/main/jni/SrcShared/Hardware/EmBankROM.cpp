@@ -16,12 +16,16 @@
 
 #include "Byteswapping.h"		// ByteswapWords
 #include "EmCPU68K.h"			// gCPU68K
+#include "EmCodeCache.h"		// EmCodeCache::Invalidate, Flush
 #include "EmErrCodes.h"			// kError_UnsupportedROM
 #include "EmHAL.h"				// EmHAL
 #include "EmMemory.h"			// Memory::InitializeBanks, EmMem_memset
 #include "EmPalmStructs.h"		// EmProxyCardHeaderType
 #include "EmSession.h"			// GetDevice, ScheduleDeferredError
+#include "EmSessionContext.h"	// EmSessionGlobalData, EM_SESSION_GLOBAL
+#include "EmSessionSnapshot.h"	// EmSessionSnapshot
 #include "ErrorHandling.h"		// Errors::Throw
+#include "MetaMemory.h"			// MetaMemory::IsCodeCached
 #include "Miscellaneous.h"		// StWordSwapper, NextPowerOf2
 #include "Profiling.h"			// WAITSTATES_ROM
 #include "SessionFile.h"		// WriteROMFileReference
@@ -46,6 +50,7 @@ class Card
 // static member initialization
 
 emuptr	  EmBankROM::gROMMemoryStart	  = kDefaultROMMemoryStart;
+EmSessionGlobalData	EmBankROM::gROMMemoryStartGlobal (&gROMMemoryStart, sizeof (gROMMemoryStart));
 
 // ===========================================================================
 //		 ROM Bank Accessors
@@ -74,6 +79,24 @@ static uint32	gROMBank_Mask;
 static uint8*	gROM_Memory;
 static uint8*	gROM_MetaMemory;
 
+EM_SESSION_GLOBAL (gROMBank_Size);
+EM_SESSION_GLOBAL (gManagedROMSize);
+EM_SESSION_GLOBAL (gROMImage_Size);
+EM_SESSION_GLOBAL (gROMBank_Mask);
+EM_SESSION_GLOBAL (gROM_Memory);
+EM_SESSION_GLOBAL (gROM_MetaMemory);
+
+
+static inline void PrvCodeCheck (emuptr address, size_t size)
+{
+	uint8*	metaAddress = gROM_MetaMemory + address;
+
+	if (MetaMemory::IsCodeCached (metaAddress, size))
+	{
+		EmCodeCache::Invalidate (gROM_Memory + address, metaAddress, size);
+	}
+}
+
 
 /***********************************************************************
  *
@@ -145,6 +168,13 @@ void EmBankROM::Save (SessionFile& f)
 	Configuration	cfg = gSession->GetConfiguration ();
 	f.WriteROMFileReference (cfg.fROMFile);
 
+	EmSessionSnapshot*	snapshot = f.GetSnapshot ();
+	if (snapshot)
+	{
+		snapshot->SaveImage (EmSessionSnapshot::kMetaROMImage, gROM_MetaMemory, gROMImage_Size);
+		return;
+	}
+
 	StWordSwapper	swapper1 (gROM_MetaMemory, gROMImage_Size);
 	f.WriteMetaROMImage (gROM_MetaMemory, gROMImage_Size);
 }
@@ -171,6 +201,17 @@ void EmBankROM::Load (SessionFile& f)
 
 	EmAssert (gROM_MetaMemory != NULL);
 
+	EmSessionSnapshot*	snapshot = f.GetSnapshot ();
+	if (snapshot)
+	{
+		if (!snapshot->RestoreImage (EmSessionSnapshot::kMetaROMImage, gROM_MetaMemory, gROMImage_Size))
+		{
+			f.SetCanReload (false);
+		}
+
+		return;
+	}
+
 	if (f.ReadMetaROMImage (gROM_MetaMemory))
 	{
 		ByteswapWords (gROM_MetaMemory, gROMImage_Size);
@@ -431,6 +472,8 @@ void EmBankROM::SetLong (emuptr address, uint32 value)
 
 	address &= gROMBank_Mask;
 
+	::PrvCodeCheck (address, sizeof (uint32));
+
 	EmMemDoPut32 (gROM_Memory + address, value);
 }
 
@@ -480,6 +523,8 @@ void EmBankROM::SetWord (emuptr address, uint32 value)
 
 	address &= gROMBank_Mask;
 
+	::PrvCodeCheck (address, sizeof (uint16));
+
 	EmMemDoPut16 (gROM_Memory + address, value);
 }
 
@@ -522,6 +567,8 @@ void EmBankROM::SetByte (emuptr address, uint32 value)
 
 	address &= gROMBank_Mask;
 
+	::PrvCodeCheck (address, sizeof (uint8));
+
 	EmMemDoPut8 (gROM_Memory + address, value);
 }
 
@@ -960,6 +1007,9 @@ static EmAddressBank	gFlashAddressBank =
 static int		gState = kAMDState_Normal;
 static Bool 	gEraseIsSetup;
 
+EM_SESSION_GLOBAL (gState);
+EM_SESSION_GLOBAL (gEraseIsSetup);
+
 
 /***********************************************************************
  *
@@ -1325,6 +1375,8 @@ void EmBankFlash::SetWord (emuptr address, uint32 value)
 					EmMem_memset (kSector4Start, kEraseValue, kSector4Size);
 				}
 
+				EmCodeCache::Flush ();
+
 				gState = kAMDState_EraseDone;
 				return;
 			}
@@ -1369,6 +1421,7 @@ void EmBankFlash::SetWord (emuptr address, uint32 value)
 			// ??? What happens on other operations?
 
 			address &= gROMBank_Mask;
+			::PrvCodeCheck (address, sizeof (uint16));
 			EmMemDoPut16 (gROM_Memory + address, value);
 
 			gState = kAMDState_ProgramDone;
@@ -14,6 +14,7 @@
 #ifndef EmBankROM_h
 #define EmBankROM_h
 
+class EmSessionGlobalData;
 class EmStream;
 class SessionFile;
 
@@ -49,6 +50,7 @@ class EmBankROM
 		static void				LoadROM				(EmStream& hROM);
 
 		static emuptr			gROMMemoryStart;
+		static EmSessionGlobalData	gROMMemoryStartGlobal;	// Registers gROMMemoryStart with EmSessionContext.
 };
 
 
@@ -19,6 +19,7 @@
 #include "EmCPU68K.h"			// gCPU68K
 #include "EmMemory.h"			// gMemAccessFlags, EmMemory::IsPCInRAM
 #include "EmSession.h"			// GetDevice, ScheduleDeferredError
+#include "EmSessionContext.h"	// EmSessionGlobalObject, EM_SESSION_GLOBAL
 #include "ErrorHandling.h"		// Errors::ReportErrHardwareRegisters
 #include "MetaMemory.h"			// MetaMemory::InRAMOSComponent
 #include "Profiling.h"			// WAITSTATES_PLD
@@ -80,10 +81,17 @@ static EmAddressBank	gAddressBank =
 EmRegsList		EmBankRegs::fgSubBanks;
 EmRegsList		EmBankRegs::fgDisabledSubBanks;
 
+EmSessionGlobalObject<EmRegsList>	EmBankRegs::fgSubBanksGlobal (&fgSubBanks);
+EmSessionGlobalObject<EmRegsList>	EmBankRegs::fgDisabledSubBanksGlobal (&fgDisabledSubBanks);
+
 static EmRegs*	gLastSubBank;
 static uint64	gLastStart;
 static uint32	gLastRange;
 
+EM_SESSION_GLOBAL (gLastSubBank);
+EM_SESSION_GLOBAL (gLastStart);
+EM_SESSION_GLOBAL (gLastRange);
+
 static void PrvSwitchBanks (EmRegsList& fromList, EmRegsList& toList, emuptr address);
 
 #pragma mark -
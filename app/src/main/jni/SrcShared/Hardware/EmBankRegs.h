@@ -16,6 +16,8 @@
 
 #include "EmRegs.h"				// EmRegsList
 
+template <class T> class EmSessionGlobalObject;
+
 class EmBankRegs
 {
 	public:
@@ -50,6 +52,11 @@ class EmBankRegs
 		static EmRegsList		fgSubBanks;
 		static EmRegsList		fgDisabledSubBanks;
 
+		// Registrations of the above with EmSessionContext.
+
+		static EmSessionGlobalObject<EmRegsList>	fgSubBanksGlobal;
+		static EmSessionGlobalObject<EmRegsList>	fgDisabledSubBanksGlobal;
+
 		friend class EmRegs;	// EmBankRegs::InvalidAccess
 };
 
@@ -17,14 +17,21 @@
 #include "Byteswapping.h"		// ByteswapWords
 #include "DebugMgr.h"			// Debug::CheckStepSpy
 #include "EmCPU68K.h"			// gCPU68K
+#include "EmCodeCache.h"		// EmCodeCache::Invalidate
+#include "EmFileRef.h"			// EmFileRef
 #include "EmMemory.h"			// gRAMBank_Size, gRAM_Memory, gMemoryAccess
 #include "EmScreen.h"			// EmScreen::MarkDirty
 #include "EmSession.h"			// GetDevice
+#include "EmSessionContext.h"	// EM_SESSION_GLOBAL
+#include "EmSessionSnapshot.h"	// EmSessionSnapshot
 #include "MetaMemory.h"			// MetaMemory::
 #include "Miscellaneous.h"		// StWordSwapper
+#include "Platform.h"			// Platform::GetMilliseconds
 #include "Profiling.h"			// WAITSTATES_SRAM
 #include "SessionFile.h"		// WriteRAMImage
 
+#include <time.h>				// time
+
 #include "PHEMNativeIF.h" // PHEM debug
 
 // ===========================================================================
@@ -61,6 +68,37 @@ uint32 		gRAMBank_Size;
 uint32 		gRAMBank_Mask;
 uint8* 		gRAM_Memory;
 uint8* 		gRAM_MetaMemory;
+uint8*		gRAM_DirtyPages;
+uint16*		gRAM_MetaPages;
+
+	// The last full RAM image saved to a file, which incremental saves
+	// record their changes against.  The ID is written to that file so
+	// that loading an incremental save can tell if the base file has
+	// since been replaced.  Zero means there's no base.
+
+static uint32		gRAM_BaseID;
+static EmFileRef	gRAM_BaseFile;
+
+	// The session file that RAM and meta-RAM are mapped from, if any.
+
+static EmFileRef	gRAM_MappedFile;
+
+EM_SESSION_GLOBAL (gMemoryStart);
+EM_SESSION_GLOBAL (gRAMBank_Size);
+EM_SESSION_GLOBAL (gRAMBank_Mask);
+EM_SESSION_GLOBAL (gRAM_Memory);
+EM_SESSION_GLOBAL (gRAM_MetaMemory);
+EM_SESSION_GLOBAL (gRAM_DirtyPages);
+EM_SESSION_GLOBAL (gRAM_MetaPages);
+EM_SESSION_GLOBAL (gRAM_BaseID);
+EM_SESSION_OBJECT (EmFileRef, gRAM_BaseFile);
+EM_SESSION_OBJECT (EmFileRef, gRAM_MappedFile);
+
+	// Once more than this fraction of RAM has been written since the base
+	// was saved, an incremental save doesn't buy much.  Write a full image
+	// instead, which then becomes the new base.
+
+const uint32	kMaxDirtyDivisor = 2;
 
 #if defined (_DEBUG)
 
@@ -81,6 +119,31 @@ static inline uint8* InlineGetMetaAddress (emuptr address)
 	return (uint8*) &(gRAM_MetaMemory[address]);
 }
 
+static inline uint32 PrvNumPages (void)
+{
+	return (gRAMBank_Size + kRAMDirtyPageSize - 1) >> kRAMDirtyPageShift;
+}
+
+static void PrvMarkMetaPagesMixed (void)
+{
+	uint32	numPages = PrvNumPages ();
+
+	for (uint32 ii = 0; ii < numPages; ++ii)
+	{
+		gRAM_MetaPages[ii] = kMetaPageMixed;
+	}
+}
+
+static uint32 PrvNewBaseID (void)
+{
+	uint32	id = (((uint32) time (NULL)) << 10) ^ Platform::GetMilliseconds ();
+
+	if (id == 0 || id == gRAM_BaseID)
+		id = gRAM_BaseID + 1;
+
+	return id;
+}
+
 static inline void PrvScreenCheck (uint8* metaAddress, emuptr address, size_t size)
 {
 #if defined (macintosh)
@@ -105,6 +168,14 @@ static inline void PrvScreenCheck (uint8* metaAddress, emuptr address, size_t si
 	}
 }
 
+static inline void PrvCodeCheck (uint8* metaAddress, emuptr phyAddress, size_t size)
+{
+	if (MetaMemory::IsCodeCached (metaAddress, size))
+	{
+		EmCodeCache::Invalidate (gRAM_Memory + phyAddress, metaAddress, size);
+	}
+}
+
 
 /***********************************************************************
  *
@@ -133,8 +204,29 @@ void EmBankSRAM::Initialize (RAMSizeType ramSize)
                 PHEM_Log_Place(ramSize);
                 PHEM_Log_Place(gRAMBank_Size);
 		gRAMBank_Mask	= gRAMBank_Size - 1;
-		gRAM_Memory 	= (uint8*) Platform::AllocateMemoryClear (gRAMBank_Size);
-		gRAM_MetaMemory = (uint8*) Platform::AllocateMemoryClear (gRAMBank_Size);
+
+		// Allocate whole pages, so that a session file can be mapped
+		// over them when it's loaded.
+
+		gRAM_Memory 	= (uint8*) Platform::AllocatePages (gRAMBank_Size);
+		gRAM_MetaMemory = (uint8*) Platform::AllocatePages (gRAMBank_Size);
+		gRAM_MappedFile	= EmFileRef ();
+
+		// Allocate one extra entry so that MarkDirty can look at the page
+		// after the last one without checking.  There's no base to compare
+		// against yet, so everything starts out dirty.
+
+		gRAM_DirtyPages	= (uint8*) Platform::AllocateMemory (PrvNumPages () + 1);
+		memset (gRAM_DirtyPages, 1, PrvNumPages () + 1);
+
+		// Freshly allocated pages are zero-filled, so every meta page
+		// starts out uniformly clear.
+
+		gRAM_MetaPages	= (uint16*) Platform::AllocateMemory (PrvNumPages () * sizeof (uint16));
+		memset (gRAM_MetaPages, 0, PrvNumPages () * sizeof (uint16));
+
+		gRAM_BaseID		= 0;
+		gRAM_BaseFile	= EmFileRef ();
 
 #if defined (_DEBUG)
 		// In debug mode, define a global variable that points to the
@@ -181,7 +273,26 @@ void EmBankSRAM::Initialize (RAMSizeType ramSize)
 
 void EmBankSRAM::Reset (Bool /*hardwareReset*/)
 {
-	memset (gRAM_MetaMemory, 0, gRAMBank_Size);
+	// Clear only the meta pages that aren't already known to be clear.
+	// Besides saving time, this leaves pages that have never been marked
+	// untouched, so that the host never has to commit memory for them.
+
+	uint32	numPages = PrvNumPages ();
+
+	for (uint32 ii = 0; ii < numPages; ++ii)
+	{
+		if (gRAM_MetaPages[ii] != 0)
+		{
+			uint32	offset	= ii << kRAMDirtyPageShift;
+			uint32	size	= gRAMBank_Size - offset;
+
+			if (size > kRAMDirtyPageSize)
+				size = kRAMDirtyPageSize;
+
+			memset (gRAM_MetaMemory + offset, 0, size);
+			gRAM_MetaPages[ii] = 0;
+		}
+	}
 }
 
 
@@ -200,11 +311,55 @@ void EmBankSRAM::Reset (Bool /*hardwareReset*/)
 
 void EmBankSRAM::Save (SessionFile& f)
 {
-	StWordSwapper	swapper1 (gRAM_Memory, gRAMBank_Size);
-	f.WriteRAMImage (gRAM_Memory, gRAMBank_Size);
+	EmSessionSnapshot*	snapshot = f.GetSnapshot ();
+	if (snapshot)
+	{
+		snapshot->SaveImage (EmSessionSnapshot::kRAMImage, gRAM_Memory, gRAMBank_Size);
+		snapshot->SaveImage (EmSessionSnapshot::kMetaRAMImage, gRAM_MetaMemory, gRAMBank_Size);
+		snapshot->SaveImage (EmSessionSnapshot::kDirtyPagesImage, gRAM_DirtyPages, PrvNumPages ());
+		f.WriteRAMBase (gRAM_BaseFile, gRAM_BaseID);
+		return;
+	}
 
-	StWordSwapper	swapper2 (gRAM_MetaMemory, gRAMBank_Size);
-	f.WriteMetaRAMImage (gRAM_MetaMemory, gRAMBank_Size);
+	if (EmBankSRAM::CanSaveIncremental (f))
+	{
+		EmBankSRAM::SaveIncremental (f);
+	}
+	else
+	{
+		if (f.GetUncompressed ())
+		{
+			f.WriteNativeRAMImage (gRAM_Memory, gRAMBank_Size);
+		}
+		else
+		{
+			StWordSwapper	swapper1 (gRAM_Memory, gRAMBank_Size);
+			f.WriteRAMImage (gRAM_Memory, gRAMBank_Size);
+		}
+
+		// If we know where this image is going, it can be the base for
+		// later incremental saves.
+
+		if (f.GetFileRef ().IsSpecified ())
+		{
+			gRAM_BaseID		= ::PrvNewBaseID ();
+			gRAM_BaseFile	= f.GetFileRef ();
+
+			f.WriteRAMBaseID (gRAM_BaseID);
+
+			EmBankSRAM::ClearDirty ();
+		}
+	}
+
+	if (f.GetUncompressed ())
+	{
+		f.WriteNativeMetaRAMImage (gRAM_MetaMemory, gRAMBank_Size);
+	}
+	else
+	{
+		StWordSwapper	swapper2 (gRAM_MetaMemory, gRAMBank_Size);
+		f.WriteMetaRAMImage (gRAM_MetaMemory, gRAMBank_Size);
+	}
 }
 
 
@@ -226,23 +381,95 @@ void EmBankSRAM::Load (SessionFile& f)
 	EmAssert (gRAM_Memory);
 	EmAssert (gRAM_MetaMemory);
 
-	if (f.ReadRAMImage (gRAM_Memory))
+	EmSessionSnapshot*	snapshot = f.GetSnapshot ();
+	if (snapshot)
 	{
-		ByteswapWords (gRAM_Memory, gRAMBank_Size);
+		if (!snapshot->RestoreImage (EmSessionSnapshot::kRAMImage, gRAM_Memory, gRAMBank_Size) ||
+			!snapshot->RestoreImage (EmSessionSnapshot::kMetaRAMImage, gRAM_MetaMemory, gRAMBank_Size))
+		{
+			f.SetCanReload (false);
+		}
+
+		// Nothing's known about the meta pages we just restored.
+		// MetaMemory will find the uniform ones again as it looks at them.
+
+		::PrvMarkMetaPagesMixed ();
+
+		// RAM is back the way it was when the snapshot was taken, so the
+		// dirty pages are, too.
+
+		if (!snapshot->RestoreImage (EmSessionSnapshot::kDirtyPagesImage, gRAM_DirtyPages, PrvNumPages ()) ||
+			!f.ReadRAMBase (gRAM_BaseFile, gRAM_BaseID))
+		{
+			gRAM_BaseID		= 0;
+			gRAM_BaseFile	= EmFileRef ();
+
+			EmBankSRAM::MarkAllDirty ();
+		}
+		else
+		{
+			Memory::InvalidateFastPages ();
+		}
+
+		return;
 	}
-	else
+
+	// Images saved in uncompressed mode are mapped in if possible, and
+	// need no byteswapping either way.  Anything else is read in over
+	// the whole image, so afterwards no pages are backed by a file.
+
+	Bool	ramMapped = false;
+	Bool	metaMapped = false;
+
+	if (!f.ReadNativeRAMImage (gRAM_Memory, gRAMBank_Size, ramMapped))
 	{
-		f.SetCanReload (false);
+		if (f.ReadRAMImage (gRAM_Memory))
+		{
+			ByteswapWords (gRAM_Memory, gRAMBank_Size);
+		}
+		else
+		{
+			f.SetCanReload (false);
+		}
 	}
 
-	if (f.ReadMetaRAMImage (gRAM_MetaMemory))
+	// If we just read a full image from a known file, that file can be the
+	// base for incremental saves.  Otherwise (it was an old file, or an
+	// incremental save itself), start over.
+
+	uint32	baseID;
+	if (f.GetCanReload () && f.ReadRAMBaseID (baseID) && f.GetFileRef ().IsSpecified ())
 	{
-		ByteswapWords (gRAM_MetaMemory, gRAMBank_Size);
+		gRAM_BaseID		= baseID;
+		gRAM_BaseFile	= f.GetFileRef ();
+
+		EmBankSRAM::ClearDirty ();
 	}
 	else
 	{
-		f.SetCanReload (false);
+		gRAM_BaseID		= 0;
+		gRAM_BaseFile	= EmFileRef ();
+
+		EmBankSRAM::MarkAllDirty ();
+	}
+
+	if (!f.ReadNativeMetaRAMImage (gRAM_MetaMemory, gRAMBank_Size, metaMapped))
+	{
+		if (f.ReadMetaRAMImage (gRAM_MetaMemory))
+		{
+			ByteswapWords (gRAM_MetaMemory, gRAMBank_Size);
+		}
+		else
+		{
+			f.SetCanReload (false);
+		}
 	}
+
+	gRAM_MappedFile = (ramMapped || metaMapped) ? f.GetFileRef () : EmFileRef ();
+
+	// As above, nothing's known about the meta pages we just loaded.
+
+	::PrvMarkMetaPagesMixed ();
 }
 
 
@@ -262,8 +489,45 @@ void EmBankSRAM::Load (SessionFile& f)
 
 void EmBankSRAM::Dispose (void)
 {
-	Platform::DisposeMemory (gRAM_Memory);
-	Platform::DisposeMemory (gRAM_MetaMemory);
+	Platform::DisposePages (gRAM_Memory, gRAMBank_Size);
+	Platform::DisposePages (gRAM_MetaMemory, gRAMBank_Size);
+	Platform::DisposeMemory (gRAM_DirtyPages);
+	Platform::DisposeMemory (gRAM_MetaPages);
+
+	gRAM_Memory		= NULL;
+	gRAM_MetaMemory	= NULL;
+	gRAM_DirtyPages	= NULL;
+	gRAM_MetaPages	= NULL;
+	gRAM_MappedFile	= EmFileRef ();
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EmBankSRAM::ReleaseMappedFile
+ *
+ * DESCRIPTION: If RAM and meta-RAM are mapped from the given file,
+ *				copy them into private memory.  Pages that haven't
+ *				been touched since the file was loaded are still
+ *				backed by the file, so it can't be overwritten (or
+ *				truncated, which would make those pages fault) until
+ *				this has been done.
+ *
+ * PARAMETERS:	ref - the file about to be overwritten.
+ *
+ * RETURNED:	Nothing.
+ *
+ ***********************************************************************/
+
+void EmBankSRAM::ReleaseMappedFile (const EmFileRef& ref)
+{
+	if (!gRAM_MappedFile.IsSpecified () || !(gRAM_MappedFile == ref))
+		return;
+
+	Platform::UnmapFilePages (gRAM_Memory, gRAMBank_Size);
+	Platform::UnmapFilePages (gRAM_MetaMemory, gRAMBank_Size);
+
+	gRAM_MappedFile = EmFileRef ();
 }
 
 
@@ -452,6 +716,9 @@ void EmBankSRAM::SetLong (emuptr address, uint32 value)
 	register uint8*	metaAddress = InlineGetMetaAddress (phyAddress);
 //	META_CHECK (metaAddress, address, SetLong, uint32, false);
 	::PrvScreenCheck (metaAddress, address, sizeof (uint32));
+	::PrvCodeCheck (metaAddress, phyAddress, sizeof (uint32));
+
+	EmBankSRAM::MarkDirty (phyAddress, sizeof (uint32));
 
 	EmMemDoPut32 (gRAM_Memory + phyAddress, value);
 
@@ -503,6 +770,9 @@ void EmBankSRAM::SetWord (emuptr address, uint32 value)
 	register uint8*	metaAddress = InlineGetMetaAddress (phyAddress);
 //	META_CHECK (metaAddress, address, SetLong, uint16, false);
 	::PrvScreenCheck (metaAddress, address, sizeof (uint16));
+	::PrvCodeCheck (metaAddress, phyAddress, sizeof (uint16));
+
+	EmBankSRAM::MarkDirty (phyAddress, sizeof (uint16));
 
 	EmMemDoPut16 (gRAM_Memory + phyAddress, value);
 
@@ -547,6 +817,9 @@ void EmBankSRAM::SetByte (emuptr address, uint32 value)
 	register uint8*	metaAddress = InlineGetMetaAddress (phyAddress);
 //	META_CHECK (metaAddress, address, SetLong, uint8, false);
 	::PrvScreenCheck (metaAddress, address, sizeof (uint8));
+	::PrvCodeCheck (metaAddress, phyAddress, sizeof (uint8));
+
+	EmBankSRAM::MarkDirty (phyAddress, sizeof (uint8));
 
 	EmMemDoPut8 (gRAM_Memory + phyAddress, value);
 
@@ -610,6 +883,176 @@ void EmBankSRAM::AddOpcodeCycles (void)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmBankSRAM::GetFastPage
+// ---------------------------------------------------------------------------
+// Called by Memory::UpdateFastPages.  If the given range can be read (or
+// written) without any of the checks that the accessors above make, return
+// its host address.  Otherwise, return NULL.
+
+uint8* EmBankSRAM::GetFastPage (emuptr address, uint32 size, Bool forWrite)
+{
+	// Writes are checked against fProtect_SRAMSet, which the Palm OS turns
+	// off and back on around every change to the storage heap.  That's
+	// too often to keep the write table in sync, so leave writes to the
+	// handlers.
+
+	if (forWrite)
+	{
+		if (PREVENT_USER_SRAM_SET || VALIDATE_SRAM_SET)
+			return NULL;
+
+		if (MetaMemory::HasWriteChecks (InlineGetMetaAddress (address & gRAMBank_Mask), size))
+			return NULL;
+	}
+	else
+	{
+		if (PREVENT_USER_SRAM_GET || VALIDATE_SRAM_GET)
+			return NULL;
+	}
+
+	return gRAM_Memory + (address & gRAMBank_Mask);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmBankSRAM::RealMarkDirty
+// ---------------------------------------------------------------------------
+// Record that the pages covering the given range have been written.  Pages
+// that aren't dirty are kept out of the fast write table so that the write
+// handlers see the first write to them.  Once a page is dirty, there's no
+// need to see any more, so let Memory::UpdateFastPages reconsider it.
+
+void EmBankSRAM::RealMarkDirty (emuptr offset, uint32 size)
+{
+	uint32	first	= offset >> kRAMDirtyPageShift;
+	uint32	last	= (offset + size - 1) >> kRAMDirtyPageShift;
+
+	for (uint32 ii = first; ii <= last; ++ii)
+	{
+		gRAM_DirtyPages[ii] = 1;
+	}
+
+	Memory::InvalidateFastPages (gRAM_MetaMemory + (first << kRAMDirtyPageShift),
+		(last - first + 1) << kRAMDirtyPageShift);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmBankSRAM::MarkAllDirty
+// ---------------------------------------------------------------------------
+
+void EmBankSRAM::MarkAllDirty (void)
+{
+	memset (gRAM_DirtyPages, 1, PrvNumPages () + 1);
+
+	// Pages left out of the fast write table only because they were clean
+	// can go back in.
+
+	Memory::InvalidateFastPages ();
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmBankSRAM::ClearDirty
+// ---------------------------------------------------------------------------
+
+void EmBankSRAM::ClearDirty (void)
+{
+	memset (gRAM_DirtyPages, 0, PrvNumPages ());
+
+	// Take every page out of the fast write table so that we see the next
+	// write to it.
+
+	Memory::InvalidateFastPages ();
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmBankSRAM::CountDirty
+// ---------------------------------------------------------------------------
+
+uint32 EmBankSRAM::CountDirty (void)
+{
+	uint32	numPages = PrvNumPages ();
+	uint32	result = 0;
+
+	for (uint32 ii = 0; ii < numPages; ++ii)
+	{
+		if (gRAM_DirtyPages[ii])
+			++result;
+	}
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmBankSRAM::CanSaveIncremental
+// ---------------------------------------------------------------------------
+// Return whether the RAM image can be saved to the given file as a list of
+// the pages changed since the base was saved.
+
+Bool EmBankSRAM::CanSaveIncremental (SessionFile& f)
+{
+	if (!f.GetIncremental ())
+		return false;
+
+	if (gRAM_BaseID == 0 || !gRAM_BaseFile.IsSpecified ())
+		return false;
+
+	// A file can't be its own base.
+
+	if (gRAM_BaseFile == f.GetFileRef ())
+		return false;
+
+	if (!gRAM_BaseFile.Exists ())
+		return false;
+
+	return EmBankSRAM::CountDirty () * kMaxDirtyDivisor <= PrvNumPages ();
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmBankSRAM::SaveIncremental
+// ---------------------------------------------------------------------------
+// Save the pages changed since the base was saved, along with a reference
+// to the base.  The pages are in the same byte order as a full image.
+
+void EmBankSRAM::SaveIncremental (SessionFile& f)
+{
+	EmAssert ((gRAMBank_Size & (kRAMDirtyPageSize - 1)) == 0);
+
+	uint32			numPages = PrvNumPages ();
+	uint32			numDirty = EmBankSRAM::CountDirty ();
+
+	Chunk			delta;
+	EmStreamChunk	s (delta);
+
+	s << (uint32) kRAMDirtyPageSize;
+	s << numDirty;
+
+	uint8			page[kRAMDirtyPageSize];
+
+	for (uint32 ii = 0; ii < numPages; ++ii)
+	{
+		if (gRAM_DirtyPages[ii])
+		{
+			uint32	offset = ii << kRAMDirtyPageShift;
+
+			memcpy (page, gRAM_Memory + offset, kRAMDirtyPageSize);
+			ByteswapWords (page, kRAMDirtyPageSize);
+
+			s << offset;
+			s.PutBytes (page, kRAMDirtyPageSize);
+		}
+	}
+
+	f.WriteRAMBase (gRAM_BaseFile, gRAM_BaseID);
+	f.WriteRAMDelta (delta, gRAMBank_Size);
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmBankSRAM::AddressError
 // ---------------------------------------------------------------------------
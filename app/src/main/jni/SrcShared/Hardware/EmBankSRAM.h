@@ -14,6 +14,7 @@
 #ifndef EmBankSRAM_h
 #define EmBankSRAM_h
 
+class EmFileRef;
 class SessionFile;
 
 extern emuptr	gMemoryStart;
@@ -24,6 +25,22 @@ extern uint32	gRAMBank_Mask;
 extern uint8*	gRAM_Memory;
 extern uint8*	gRAM_MetaMemory;
 
+	// One byte per page of RAM, non-zero if the page has been written
+	// since the last full RAM image was saved.  The pages are the same
+	// size as the fast pages in EmMemory.h.
+extern uint8*	gRAM_DirtyPages;
+
+#define kRAMDirtyPageShift		12
+#define kRAMDirtyPageSize		(1UL << kRAMDirtyPageShift)
+
+	// One entry per page of meta-RAM (the same pages as above).  A value
+	// less than kMetaPageMixed means that every meta byte in the page has
+	// that value; kMetaPageMixed means they may differ.  Maintained by
+	// MetaMemory, which uses it to skip work on uniform pages.
+extern uint16*	gRAM_MetaPages;
+
+#define kMetaPageMixed			0x0100
+
 
 class EmBankSRAM
 {
@@ -47,12 +64,59 @@ class EmBankSRAM
 		static uint8*			GetMetaAddress		(emuptr address);
 		static void				AddOpcodeCycles		(void);
 
+		static uint8*			GetFastPage			(emuptr address, uint32 size, Bool forWrite);
+
 		static emuptr			GetMemoryStart		(void) { return gMemoryStart; }
 
+		// Dirty page tracking for incremental saves.  Offsets are from the
+		// start of RAM (that is, after masking with gRAMBank_Mask).
+
+		static void				MarkDirty			(emuptr offset, uint32 size);	// Inlined, defined below
+		static Bool				IsDirty				(emuptr offset);				// Inlined, defined below
+		static void				MarkAllDirty		(void);
+		static void				ClearDirty			(void);
+		static uint32			CountDirty			(void);
+
+		// RAM and meta-RAM may be mapped from the session file they were
+		// loaded from.  Call this before overwriting a file; if it's the
+		// one that's mapped, the images are copied into private memory.
+
+		static void				ReleaseMappedFile	(const EmFileRef&);
+
 	private:
 		static void				AddressError		(emuptr address, long size, Bool forRead);
 		static void				InvalidAccess		(emuptr address, long size, Bool forRead);
 		static void				ProtectedAccess		(emuptr address, long size, Bool forRead);
+
+		static void				RealMarkDirty		(emuptr offset, uint32 size);
+		static Bool				CanSaveIncremental	(SessionFile&);
+		static void				SaveIncremental		(SessionFile&);
 };
 
+
+// ---------------------------------------------------------------------------
+//		 EmBankSRAM::MarkDirty
+// ---------------------------------------------------------------------------
+// Called by the SRAM and DRAM write handlers.  Only the first write to a
+// page since the last full save does any real work.
+
+inline void EmBankSRAM::MarkDirty (emuptr offset, uint32 size)
+{
+	if (!gRAM_DirtyPages[offset >> kRAMDirtyPageShift] ||
+		!gRAM_DirtyPages[(offset + size - 1) >> kRAMDirtyPageShift])
+	{
+		EmBankSRAM::RealMarkDirty (offset, size);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmBankSRAM::IsDirty
+// ---------------------------------------------------------------------------
+
+inline Bool EmBankSRAM::IsDirty (emuptr offset)
+{
+	return gRAM_DirtyPages[offset >> kRAMDirtyPageShift] != 0;
+}
+
 #endif /* EmBankSRAM_h */
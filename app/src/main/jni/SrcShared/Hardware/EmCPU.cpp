@@ -14,8 +14,11 @@
 #include "EmCommon.h"
 #include "EmCPU.h"
 
+#include "EmSessionContext.h"	// EM_SESSION_GLOBAL
+
 
 EmCPU*	gCPU;
+EM_SESSION_GLOBAL (gCPU);
 
 
 // ---------------------------------------------------------------------------
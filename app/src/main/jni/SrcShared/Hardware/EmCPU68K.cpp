@@ -17,11 +17,13 @@
 #include "Byteswapping.h"		// Canonical
 #include "DebugMgr.h"			// gExceptionAddress, gExceptionSize, gExceptionForRead
 #include "EmBankROM.h"			// EmBankROM::GetMemoryStart
+#include "EmCodeCache.h"		// EmCodeCache::Find, NewBlock, AddOp
 #include "EmEventPlayback.h"	// EmEventPlayback::ReplayingEvents
 #include "EmHAL.h"				// EmHAL::GetInterruptLevel
-#include "EmMemory.h"			// CEnableFullAccess
+#include "EmMemory.h"			// CEnableFullAccess, Memory::UpdateFastPages
 #include "EmMinimize.h"			// IsOn
 #include "EmSession.h"			// HandleInstructionBreak
+#include "EmSessionContext.h"	// EM_SESSION_GLOBAL, ShouldYield
 #include "Logging.h"			// LogAppendMsg
 #include "MetaMemory.h"			// IsCPUBreak
 #include "Platform.h"			// GetMilliseconds
@@ -73,6 +75,9 @@ emuptr	last_fault_for_exception_3; 		/* Address that generated the exception */
 struct regstruct	regs;					// (normally in newcpu.c)
 struct flag_struct	regflags;				// (normally in support.c)
 
+EM_SESSION_GLOBAL (regs);
+EM_SESSION_GLOBAL (regflags);
+
 
 // These variables should strictly be in a sub-system that implements
 // the stack overflow checking, etc.  However, for performance reasons,
@@ -86,6 +91,11 @@ uae_u32	gStackLowWarn;
 uae_u32	gStackLow;
 uae_u32	gKernelStackOverflowed;
 
+EM_SESSION_GLOBAL (gStackHigh);
+EM_SESSION_GLOBAL (gStackLowWarn);
+EM_SESSION_GLOBAL (gStackLow);
+EM_SESSION_GLOBAL (gKernelStackOverflowed);
+
 
 // Definitions of the stack frames used in EmCPU68K::ProcessException.
 
@@ -110,6 +120,7 @@ struct ExceptionStackFrame2
 
 
 EmCPU68K*	gCPU68K;
+EM_SESSION_GLOBAL (gCPU68K);
 
 
 // ---------------------------------------------------------------------------
@@ -289,6 +300,14 @@ void EmCPU68K::Execute (void)
 	// important that it run as quickly as possible.  To that end,
 	// fine tune register allocation as much as we can by hand.
 
+#if HAS_CODE_CACHE
+	if (EmCodeCache::IsEnabled ())
+	{
+		this->ExecuteCached ();
+		return;
+	}
+#endif
+
 #if defined(__powerc) || defined(powerc) || \
 	defined(__powerpc) || defined(powerpc) || \
 	defined(__ppc__) || defined(ppc)
@@ -545,6 +564,121 @@ StoppedLoop:
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmCPU68K::ExecuteCached
+// ---------------------------------------------------------------------------
+// Same as ExecuteSimple (below), except that straight-line runs of opcodes
+// are recorded into EmCodeCache the first time through and replayed from
+// there afterwards.  Replaying a block skips the opcode fetch, the
+// cpufunctbl lookup, and the IsCPUBreak check for all but the block's first
+// opcode.  EmCodeCache makes sure that none of a block's opcodes after the
+// first has an instruction break on it.
+//
+// Everything else happens exactly as it does in ExecuteSimple: CYCLE is
+// called after every opcode, and we leave the block to call ExecuteSpecial
+// as soon as spcflags is set, so interrupts are taken at the same opcode
+// boundaries.  Before each replayed opcode, we check that regs.pc_p still
+// points to where that opcode was recorded.  If the previous opcode
+// branched, took an exception, or caused the block to be invalidated, the
+// check fails and we fall back to the top of the loop.
+
+#if HAS_CODE_CACHE
+
+void EmCPU68K::ExecuteCached (void)
+{
+	int				counter		= 0;
+	cpuop_func**	functable	= cpufunctbl;
+	EmSession*		session		= fSession;
+
+	if ((regs.spcflags & SPCFLAG_STOP) != 0)
+		goto StoppedLoop;
+
+	while (1)
+	{
+		if (MetaMemory::IsCPUBreak (regs.pc_meta_oldp + (regs.pc_p - regs.pc_oldp)))
+		{
+			EmAssert (session);
+			session->HandleInstructionBreak ();
+		}
+
+		{
+			EmCodeBlock*	block = EmCodeCache::Find (regs.pc_p);
+
+			if (block)
+			{
+				// Replay the block.
+
+				const EmCodeOp*	op	= block->fOps;
+				const EmCodeOp*	end	= op + block->fCount;
+
+				do
+				{
+					fCycleCount += (op->fHandler) (op->fOpcode);
+					CYCLE (false);
+				}
+				while (!regs.spcflags && ++op < end && regs.pc_p == op->fPC);
+			}
+			else
+			{
+				// Execute opcodes the long way, recording them into a new
+				// block.  Stop recording when we leave straight-line code,
+				// when something needs ExecuteSpecial's attention, or when
+				// we reach an instruction break (which needs to start its
+				// own block so that it's checked).
+
+				block = EmCodeCache::NewBlock (m68k_getpc (), regs.pc_p);
+
+				uint8*	start = regs.pc_p;
+
+				while (1)
+				{
+					uint8*			opPC	= regs.pc_p;
+					uint8*			oldp	= regs.pc_oldp;
+					EmOpcode68K		opcode	= do_get_mem_word (opPC);
+					cpuop_func*		handler	= functable[opcode];
+
+					if (block)
+					{
+						EmCodeCache::AddOp (block, opPC,
+							regs.pc_meta_oldp + (opPC - oldp), handler, opcode);
+					}
+
+					fCycleCount += handler (opcode);
+					CYCLE (false);
+
+					// Note that the opcode we just executed may have
+					// invalidated the block (by writing to itself) or
+					// caused it to be replaced (by making a nested call
+					// into the ROM that executed code hashing to the same
+					// slot).  Stop recording if so.
+
+					if (!block || regs.spcflags ||
+						block->fStart != start ||
+						block->fCount == 0 ||
+						block->fCount >= EmCodeBlock::kMaxOps ||
+						regs.pc_oldp != oldp ||
+						regs.pc_p <= opPC ||
+						regs.pc_p > opPC + EmCodeCache::kMaxInstructionSize ||
+						MetaMemory::IsCPUBreak (regs.pc_meta_oldp + (regs.pc_p - regs.pc_oldp)))
+					{
+						break;
+					}
+				}
+			}
+		}
+
+StoppedLoop:
+		if (regs.spcflags)
+		{
+			if (this->ExecuteSpecial ())
+				break;
+		}
+	}
+}
+
+#endif
+
+
 // ---------------------------------------------------------------------------
 //		 EmCPU68K::ExecuteSimple
 // ---------------------------------------------------------------------------
@@ -819,6 +953,13 @@ Bool EmCPU68K::ExecuteStoppedLoop (void)
 
 	// While the CPU is stopped (because a STOP instruction was
 	// executed) do some idle tasks.
+	//
+	// Normally, we sleep between idle cycles until the hardware says
+	// something's due to happen.  Gremlins, event playback, and
+	// minimization want to get through idle time as fast as possible,
+	// so they just get the short Platform::Delay.  Headless sessions
+	// don't wait at all; the timers run off the cycle count, so the
+	// next interrupt comes along just the same.
 
 #if HAS_DEAD_MANS_SWITCH
 	// -----------------------------------------------------------------------
@@ -853,7 +994,22 @@ Bool EmCPU68K::ExecuteStoppedLoop (void)
 	ProfilerSetStatus (false);
 #endif
 
-		Platform::Delay ();
+		if (!session->IsHeadless ())
+		{
+#if HAS_OMNI_THREAD
+			if (session->InCPUThread () &&
+				!Hordes::IsOn () &&
+				!EmEventPlayback::ReplayingEvents () &&
+				!EmMinimize::IsOn ())
+			{
+				session->SleepWhileStopped ();
+			}
+			else
+#endif
+			{
+				Platform::Delay ();
+			}
+		}
 
 #if __profile__
 	ProfilerSetStatus (oldStatus);
@@ -901,12 +1057,25 @@ void EmCPU68K::CycleSlowly (Bool sleeping)
 
 	Platform::CycleSlowly ();
 
+	// Put back any RAM pages that were taken out of the fast page tables.
+
+	Memory::UpdateFastPages ();
+
 #if HAS_OMNI_THREAD
 	// Check to see if some external thread has asked us to quit.
 
 	EmAssert (fSession);
 	omni_mutex_lock	lock (fSession->fSharedLock);
 
+	// If other sessions are waiting for the emulator globals and we've
+	// had them for long enough, come up for air.  EmSession::Run will
+	// let them go and then wait for its next turn.
+
+	if (EmSessionContext::ShouldYield () && fSession->InCPUThread ())
+	{
+		fSession->fSuspendState.fCounters.fSuspendByTimeout = 1;
+	}
+
 	if (fSession->fSuspendState.fAllCounters)
 	{
 		this->CheckAfterCycle ();
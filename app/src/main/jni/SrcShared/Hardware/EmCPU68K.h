@@ -296,6 +296,7 @@ class EmCPU68K : public EmCPU
 		void					AddressError			(emuptr address, long size, Bool forRead);
 
 	private:
+		void					ExecuteCached			(void);
 		Bool 					ExecuteSpecial			(void);
 		Bool	 				ExecuteStoppedLoop		(void);
 
@@ -0,0 +1,213 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#include "EmCommon.h"
+#include "EmCodeCache.h"
+
+#include "EmBankDRAM.h"			// EmBankDRAM::GetMetaAddress
+#include "EmBankROM.h"			// EmBankROM::GetMetaAddress, EmBankFlash::GetMetaAddress
+#include "EmBankSRAM.h"			// EmBankSRAM::GetMetaAddress
+#include "EmMemory.h"			// EmMemGetBank, Memory::InvalidateFastPages
+#include "MetaMemory.h"			// MetaMemory::MarkCodeCached, etc.
+
+
+Bool			EmCodeCache::fgEnabled = true;
+EmCodeBlock		EmCodeCache::fgBlocks[kNumBlocks];
+
+
+// ---------------------------------------------------------------------------
+//		 PrvIsCacheable
+// ---------------------------------------------------------------------------
+// Only cache opcodes that live in RAM, ROM, or flash.  Those are the only
+// banks whose write handlers know to call EmCodeCache::Invalidate, and the
+// only ones whose host memory sticks around for the life of the session.
+
+static Bool PrvIsCacheable (emuptr pc)
+{
+	EmMemTranslateMetaFunc	fn = EmMemGetBank (pc).xlatemetaaddr;
+
+	return	fn == EmBankSRAM::GetMetaAddress ||
+			fn == EmBankDRAM::GetMetaAddress ||
+			fn == EmBankROM::GetMetaAddress ||
+			fn == EmBankFlash::GetMetaAddress;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 PrvClearBlock
+// ---------------------------------------------------------------------------
+// Mark all of the ops in a block as stale.  EmCPU68K::ExecuteCached may be
+// walking this block (say, if the current opcode modified its successor),
+// so clear fPC in each op in addition to emptying the block.  That way the
+// pc_p comparison it performs before each op will fail.
+
+static void PrvClearBlock (EmCodeBlock* block)
+{
+	for (uint32 ii = 0; ii < block->fCount; ++ii)
+	{
+		block->fOps[ii].fPC = NULL;
+	}
+
+	block->fStart = NULL;
+	block->fCount = 0;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmCodeCache::SetEnabled
+// ---------------------------------------------------------------------------
+
+void EmCodeCache::SetEnabled (Bool enabled)
+{
+	if (fgEnabled != enabled)
+	{
+		EmCodeCache::Flush ();
+		fgEnabled = enabled;
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmCodeCache::NewBlock
+// ---------------------------------------------------------------------------
+// Start a new block for the opcode at the given location, replacing
+// whatever block was in its slot.  Returns NULL if the opcode is in memory
+// we don't cache.
+
+EmCodeBlock* EmCodeCache::NewBlock (emuptr pc, uint8* pc_p)
+{
+	if (!::PrvIsCacheable (pc))
+		return NULL;
+
+	EmCodeBlock*	block = &fgBlocks[HashIndex (pc_p)];
+
+	::PrvClearBlock (block);
+
+	block->fStart = pc_p;
+
+	return block;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmCodeCache::AddOp
+// ---------------------------------------------------------------------------
+
+void EmCodeCache::AddOp (EmCodeBlock* block,
+						 uint8* pc_p, uint8* metaAddress,
+						 EmCodeHandler* handler, uint32 opcode)
+{
+	EmAssert (block->fCount < EmCodeBlock::kMaxOps);
+	EmAssert (pc_p >= block->fStart && pc_p < block->fStart + kMaxBlockSpan);
+
+	EmCodeOp&	op = block->fOps[block->fCount++];
+
+	op.fPC		= pc_p;
+	op.fHandler	= handler;
+	op.fOpcode	= opcode;
+
+	// Writes to this opcode now need to go through PrvCodeCheck.
+
+	if (!MetaMemory::IsCodeCached (metaAddress, 1))
+	{
+		MetaMemory::MarkCodeCached (metaAddress);
+		Memory::InvalidateFastPages (metaAddress, 1);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmCodeCache::Flush
+// ---------------------------------------------------------------------------
+
+void EmCodeCache::Flush (void)
+{
+	for (int ii = 0; ii < kNumBlocks; ++ii)
+	{
+		::PrvClearBlock (&fgBlocks[ii]);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmCodeCache::Invalidate
+// ---------------------------------------------------------------------------
+// Called when the memory at realAddress is about to change, or when an
+// instruction break is being set on it.  metaAddress is the corresponding
+// meta-memory location.  Drop every block holding an opcode in that range.
+
+void EmCodeCache::Invalidate (uint8* realAddress, uint8* metaAddress, uint32 size)
+{
+	// Opcodes are word-aligned, and only the meta byte for the first byte
+	// of an opcode gets tagged, so walk the range a word at a time.
+
+	uint32	offset	= ((uint32) realAddress) & 1;
+	uint8*	pc_p	= realAddress - offset;
+	uint8*	meta	= metaAddress - offset;
+	uint8*	end		= realAddress + size;
+	Bool	changed	= false;
+
+	for ( ; pc_p < end; pc_p += 2, meta += 2)
+	{
+		if (MetaMemory::IsCodeCached (meta, sizeof (uint16)))
+		{
+			changed = true;
+
+			EmCodeCache::InvalidateOne (pc_p);
+
+			// We only clear the kCodeCached bit for this opcode.  Other
+			// opcodes in the dropped blocks may also be held by blocks
+			// we're not dropping, and so their bits need to stay set.
+			// Leaving a stray bit set costs us a wasted call to this
+			// function later; nothing more.
+
+			MetaMemory::UnmarkCodeCached (meta);
+		}
+	}
+
+	// Let the fast page tables take another look at this memory; writes
+	// to it may not need to go through the handlers any more.
+
+	if (changed)
+	{
+		Memory::InvalidateFastPages (metaAddress, size);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmCodeCache::InvalidateOne
+// ---------------------------------------------------------------------------
+// Drop every block holding the opcode at pc_p.  Any block that does must
+// start within kMaxBlockSpan bytes before it, so probe each of those
+// starting locations.
+
+void EmCodeCache::InvalidateOne (uint8* pc_p)
+{
+	for (int offset = 0; offset < kMaxBlockSpan; offset += 2)
+	{
+		EmCodeBlock*	block = &fgBlocks[HashIndex (pc_p - offset)];
+
+		if (block->fStart != pc_p - offset)
+			continue;
+
+		for (uint32 ii = 0; ii < block->fCount; ++ii)
+		{
+			if (block->fOps[ii].fPC == pc_p)
+			{
+				::PrvClearBlock (block);
+				break;
+			}
+		}
+	}
+}
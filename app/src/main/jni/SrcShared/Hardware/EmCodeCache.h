@@ -0,0 +1,127 @@
+/* -*- mode: C++; tab-width: 4 -*- */
+/* ===================================================================== *\
+	Copyright (c) 2000-2001 Palm, Inc. or its subsidiaries.
+	All rights reserved.
+
+	This file is part of the Palm OS Emulator.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+\* ===================================================================== */
+
+#ifndef EmCodeCache_h
+#define EmCodeCache_h
+
+/*
+	EmCodeCache holds pre-decoded runs of 68K opcodes for
+	EmCPU68K::ExecuteCached.  A block is a straight-line run of opcodes
+	that was executed once the slow way.  For each opcode, we remember
+	where it lives in host memory (the value regs.pc_p had when it was
+	fetched), the opcode itself, and the UAE handler for it.  Replaying a
+	block then skips the opcode fetch, the cpufunctbl lookup, and the
+	IsCPUBreak check for every opcode but the first.
+
+	Blocks are keyed by host address, not by emulated address.  That
+	makes them immune to changes in the chip selects, and lets
+	ExecuteCached check that it's still on the recorded path with a
+	single pointer compare.
+
+	The meta-memory byte for every cached opcode is tagged with
+	MetaMemory::kCodeCached.  The RAM, ROM, and flash write handlers look
+	for that bit and call Invalidate when they see it, so self-modifying
+	code and code moved around by the Memory Manager are picked up.  The
+	same is done when an instruction breakpoint is set on a cached
+	opcode.  Anything that rewrites memory or meta-memory wholesale
+	(Reset, Load, etc.) calls Flush.
+*/
+
+// Same signature as UAE's cpuop_func.  Spelled out here so that the
+// memory bank handlers can include this file without pulling in UAE.h.
+
+typedef unsigned long EmCodeHandler (uint32);
+
+struct EmCodeOp
+{
+	uint8*			fPC;			// Host address of the opcode; NULL if stale.
+	EmCodeHandler*	fHandler;		// cpufunctbl[fOpcode]
+	uint32			fOpcode;
+};
+
+struct EmCodeBlock
+{
+	enum { kMaxOps = 16 };
+
+	uint8*			fStart;			// Host address of the first opcode.
+	uint32			fCount;			// Number of valid entries in fOps.
+	EmCodeOp		fOps[kMaxOps];
+};
+
+
+class EmCodeCache
+{
+	public:
+		static Bool				IsEnabled			(void) { return fgEnabled; }
+		static void				SetEnabled			(Bool);
+
+		// Called from EmCPU68K::ExecuteCached.
+
+		static EmCodeBlock*		Find				(uint8* pc_p);	// Inlined, defined below
+		static EmCodeBlock*		NewBlock			(emuptr pc, uint8* pc_p);
+		static void				AddOp				(EmCodeBlock* block,
+													 uint8* pc_p, uint8* metaAddress,
+													 EmCodeHandler* handler, uint32 opcode);
+
+		// Called when memory holding a cached opcode is changed.
+
+		static void				Flush				(void);
+		static void				Invalidate			(uint8* realAddress, uint8* metaAddress,
+													 uint32 size);
+
+		// The longest 68000 instruction (e.g., MOVE.L abs.L,abs.L) is
+		// five words long.  Recording stops if the next opcode is any
+		// further away than that, so no block spans more than
+		// kMaxBlockSpan bytes.
+
+		enum { kMaxInstructionSize = 10 };
+		enum { kMaxBlockSpan = EmCodeBlock::kMaxOps * kMaxInstructionSize };
+
+	private:
+		static uint32			HashIndex			(uint8* pc_p);	// Inlined, defined below
+		static void				InvalidateOne		(uint8* pc_p);
+
+		enum { kNumBlocks = 2048 };
+
+		static Bool				fgEnabled;
+		static EmCodeBlock		fgBlocks[kNumBlocks];
+};
+
+
+// ---------------------------------------------------------------------------
+//		 EmCodeCache::HashIndex
+// ---------------------------------------------------------------------------
+
+inline uint32 EmCodeCache::HashIndex (uint8* pc_p)
+{
+	// Opcodes are always on even addresses, so drop the low bit.
+
+	return (((uint32) pc_p) >> 1) & (kNumBlocks - 1);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmCodeCache::Find
+// ---------------------------------------------------------------------------
+
+inline EmCodeBlock* EmCodeCache::Find (uint8* pc_p)
+{
+	EmCodeBlock*	block = &fgBlocks[HashIndex (pc_p)];
+
+	if (block->fStart == pc_p && block->fCount > 0)
+		return block;
+
+	return NULL;
+}
+
+#endif	/* EmCodeCache_h */
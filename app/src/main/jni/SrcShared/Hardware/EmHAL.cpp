@@ -15,6 +15,7 @@
 #include "EmHAL.h"
 
 #include "EmTransportSerial.h"	// EmTransportSerial
+#include "EmSessionContext.h"	// EmSessionGlobalData
 #include "ErrorHandling.h"		// Errors::ReportErrCommPort
 #include "PreferenceMgr.h"		// gEmuPrefs
 
@@ -22,6 +23,18 @@
 
 
 EmHALHandler*		EmHAL::fgRootHandler;
+uint32				EmHAL::fgCycleCount;
+uint32				EmHAL::fgCycleDeadline = 1;
+
+EmSessionGlobalData	EmHAL::fgRootHandlerGlobal (&fgRootHandler, sizeof (fgRootHandler));
+EmSessionGlobalData	EmHAL::fgCycleCountGlobal (&fgCycleCount, sizeof (fgCycleCount));
+EmSessionGlobalData	EmHAL::fgCycleDeadlineGlobal (&fgCycleDeadline, sizeof (fgCycleDeadline));
+
+// Handlers get called at least this often, whether they ask to be or not.
+// It also keeps fgCycleDeadline from falling behind fgCycleCount and
+// waiting for it to wrap around.
+
+const uint32		kMaxCycleDelta = 0x10000;
 
 #define PRINTF	if (!0) ; else LogAppendMsg
 
@@ -124,6 +137,45 @@ void EmHAL::Cycle (Bool sleeping)
 #endif
 
 
+// ---------------------------------------------------------------------------
+//		 EmHAL::DispatchCycle
+// ---------------------------------------------------------------------------
+// Called from EmHAL::Cycle when the deadline set by ScheduleCycle has been
+// reached.  Push the deadline out as far as it will go, and let the handlers
+// pull it back in as they reschedule themselves.
+
+void EmHAL::DispatchCycle (Bool sleeping)
+{
+	fgCycleDeadline = fgCycleCount + kMaxCycleDelta;
+
+	EmAssert (EmHAL::GetRootHandler());
+	EmHAL::GetRootHandler()->Cycle (sleeping);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmHAL::ScheduleCycle
+// ---------------------------------------------------------------------------
+// Ask for EmHALHandler::Cycle to be called after "delta" more opcodes have
+// been executed.  All handlers get called when the earliest requested time
+// arrives, so each must cope with being called before it asked to be.
+
+void EmHAL::ScheduleCycle (uint32 delta)
+{
+	EmAssert (delta > 0);
+
+	if (delta > kMaxCycleDelta)
+		delta = kMaxCycleDelta;
+
+	uint32	when = fgCycleCount + delta;
+
+	if ((int32) (when - fgCycleDeadline) < 0)
+	{
+		fgCycleDeadline = when;
+	}
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmHAL::CycleSlowly
 // ---------------------------------------------------------------------------
@@ -345,6 +397,20 @@ Bool EmHAL::GetAsleep (void)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmHAL::GetSleepInterval
+// ---------------------------------------------------------------------------
+// Return how many milliseconds the CPU thread can sleep while the processor
+// is stopped before the hardware needs another (sleeping) cycle.  Zero
+// means that nothing but an outside event will wake the processor up.
+
+uint32 EmHAL::GetSleepInterval (void)
+{
+	EmAssert (EmHAL::GetRootHandler());
+	return EmHAL::GetRootHandler()->GetSleepInterval ();
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmHAL::GetPortInputValue
 // ---------------------------------------------------------------------------
@@ -784,6 +850,17 @@ Bool EmHALHandler::GetAsleep (void)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmHALHandler::GetSleepInterval
+// ---------------------------------------------------------------------------
+
+uint32 EmHALHandler::GetSleepInterval (void)
+{
+	EmAssert (this->GetNextHandler());
+	return this->GetNextHandler()->GetSleepInterval ();
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmHALHandler::GetPortInputValue
 // ---------------------------------------------------------------------------
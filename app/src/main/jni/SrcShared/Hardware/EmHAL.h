@@ -19,6 +19,7 @@
 class EmHAL;
 class EmPixMap;
 class EmScreenUpdateInfo;
+class EmSessionGlobalData;
 
 enum
 {
@@ -72,6 +73,7 @@ class EmHALHandler
 		virtual int32			GetSystemClockFrequency	(void);
 		virtual Bool			GetCanStop				(void);
 		virtual Bool			GetAsleep				(void);
+		virtual uint32			GetSleepInterval		(void);
 
 		virtual uint8			GetPortInputValue		(int);
 		virtual uint8			GetPortInternalValue	(int);
@@ -105,9 +107,12 @@ class EmHAL
 		static void				RemoveHandler			(EmHALHandler*);
 		static void				EnsureCoverage			(void);
 
-		static void				Cycle					(Bool sleeping);
+		static void				Cycle					(Bool sleeping);	// Inlined, defined below
 		static void				CycleSlowly				(Bool sleeping);
 
+		static uint32			GetCycleCount			(void) { return fgCycleCount; }
+		static void				ScheduleCycle			(uint32 delta);
+
 		static void				ButtonEvent				(SkinElementType, Bool buttonIsDown);
 		static void				TurnSoundOff			(void);
 		static void				ResetTimer				(void);
@@ -129,6 +134,7 @@ class EmHAL
 		static int32			GetSystemClockFrequency	(void);
 		static Bool				GetCanStop				(void);
 		static Bool				GetAsleep				(void);
+		static uint32			GetSleepInterval		(void);
 
 		static uint8			GetPortInputValue		(int);
 		static uint8			GetPortInternalValue	(int);
@@ -150,14 +156,42 @@ class EmHAL
 		static uint16			GetLEDState				(void);
 
 	private:
+		static void				DispatchCycle			(Bool sleeping);
+
 		static EmHALHandler*	GetRootHandler			(void) { return fgRootHandler; }
 		static EmHALHandler*	fgRootHandler;
+
+		static uint32			fgCycleCount;
+		static uint32			fgCycleDeadline;
+
+		// Registrations of the above with EmSessionContext.
+
+		static EmSessionGlobalData	fgRootHandlerGlobal;
+		static EmSessionGlobalData	fgCycleCountGlobal;
+		static EmSessionGlobalData	fgCycleDeadlineGlobal;
 };
 
+
+// ---------------------------------------------------------------------------
+//		 EmHAL::Cycle
+// ---------------------------------------------------------------------------
+// Called after every opcode.  Rather than walking the handler chain each
+// time, we just count the opcode.  Handlers that have periodic work to do
+// (timers, mostly) keep track of how many opcodes have gone by since they
+// last looked at GetCycleCount, and call ScheduleCycle to say when they next
+// have something to do.  We walk the chain only when that time arrives, or
+// when the CPU is sleeping (which is never on a fast path anyway).
+
 inline void EmHAL::Cycle (Bool sleeping)
 {
-	EmAssert (EmHAL::GetRootHandler());
-	EmHAL::GetRootHandler()->Cycle (sleeping);
+	if (sleeping)
+	{
+		EmHAL::DispatchCycle (true);
+	}
+	else if (++fgCycleCount == fgCycleDeadline)
+	{
+		EmHAL::DispatchCycle (false);
+	}
 }
 
 
@@ -20,7 +20,10 @@
 #include "EmBankRegs.h"			// EmBankRegs::Initialize
 #include "EmBankROM.h"			// EmBankROM::Initialize
 #include "EmBankSRAM.h"			// EmBankSRAM::Initialize
+#include "DebugMgr.h"			// gDebuggerGlobals
+#include "EmCodeCache.h"		// EmCodeCache::Flush
 #include "EmSession.h"			// gSession, GetDevice
+#include "EmSessionContext.h"	// EM_SESSION_GLOBAL
 #include "MetaMemory.h"			// MetaMemory::Initialize
 
 
@@ -236,6 +239,30 @@ MemAccessFlags	gMemAccessFlags =
 
 MemAccessFlags	kZeroMemAccessFlags;
 
+EM_SESSION_GLOBAL (gEmMemBanks);
+EM_SESSION_GLOBAL (gPCInRAM);
+EM_SESSION_GLOBAL (gPCInROM);
+EM_SESSION_GLOBAL (gMemAccessFlags);
+
+#if HAS_FAST_MEMORY
+emuptr			gEmMemFastStart;
+uint32			gEmMemFastSize;
+uint8**			gEmMemFastReadPages;
+uint8**			gEmMemFastWritePages;
+
+static uint8*	gFastPagesStale;		// Pages that need to be re-examined.
+static uint32	gFastPagesCount;		// Number of entries in the above tables.
+static Bool		gFastPagesPending;		// True if any page is marked stale.
+
+EM_SESSION_GLOBAL (gEmMemFastStart);
+EM_SESSION_GLOBAL (gEmMemFastSize);
+EM_SESSION_GLOBAL (gEmMemFastReadPages);
+EM_SESSION_GLOBAL (gEmMemFastWritePages);
+EM_SESSION_GLOBAL (gFastPagesStale);
+EM_SESSION_GLOBAL (gFastPagesCount);
+EM_SESSION_GLOBAL (gFastPagesPending);
+#endif
+
 
 #if PROFILE_MEMORY
 /*
@@ -372,6 +399,8 @@ void Memory::Initialize (	EmStream&		hROM,
 
 	MetaMemory::Initialize ();
 
+	EmCodeCache::Flush ();
+
 //	Memory::ResetBankHandlers ();	// Can't do this yet.  We can't set the
 									// bank handlers until we know how memory
 									// is laid out, and that information isn't
@@ -412,6 +441,11 @@ void Memory::Reset (Bool hardwareReset)
 	Memory::ResetBankHandlers ();
 
 	MetaMemory::Reset ();
+
+	// The banks just cleared out meta-memory, including the bits that
+	// tell us which opcodes are cached.
+
+	EmCodeCache::Flush ();
 }
 
 
@@ -474,6 +508,8 @@ void Memory::Load (SessionFile& f)
 	MetaMemory::Load (f);
 
 	Memory::ResetBankHandlers ();
+
+	EmCodeCache::Flush ();
 }
 
 
@@ -513,6 +549,23 @@ void Memory::Dispose (void)
 //		EmBankFlash::Dispose ();
 
 	MetaMemory::Dispose ();
+
+	EmCodeCache::Flush ();
+
+#if HAS_FAST_MEMORY
+	delete [] gEmMemFastReadPages;
+	delete [] gEmMemFastWritePages;
+	delete [] gFastPagesStale;
+
+	gEmMemFastReadPages		= NULL;
+	gEmMemFastWritePages	= NULL;
+	gFastPagesStale			= NULL;
+	gFastPagesCount			= 0;
+	gFastPagesPending		= false;
+
+	gEmMemFastStart			= EmMemNULL;
+	gEmMemFastSize			= 0;
+#endif
 }
 
 
@@ -563,6 +616,182 @@ void Memory::ResetBankHandlers (void)
 	EmAssert (gSession);
 	if (gSession->GetDevice ().HasFlash ())
 		EmBankFlash::SetBankHandlers ();
+
+#if HAS_FAST_MEMORY
+	// Size the fast page tables to cover all of RAM, as seen from
+	// gMemoryStart.  Which pages can use them depends on the handlers we
+	// just installed, so start over with all of them.
+
+	uint32	numPages = gRAMBank_Size >> EmMemFastPageShift;
+
+	if (numPages != gFastPagesCount)
+	{
+		delete [] gEmMemFastReadPages;
+		delete [] gEmMemFastWritePages;
+		delete [] gFastPagesStale;
+
+		gEmMemFastReadPages		= new uint8* [numPages];
+		gEmMemFastWritePages	= new uint8* [numPages];
+		gFastPagesStale			= new uint8 [numPages];
+		gFastPagesCount			= numPages;
+	}
+
+	gEmMemFastStart	= gMemoryStart;
+	gEmMemFastSize	= numPages << EmMemFastPageShift;
+
+	Memory::InvalidateFastPages ();
+#endif
+}
+
+
+// ---------------------------------------------------------------------------
+//		 PrvGetFastPage
+// ---------------------------------------------------------------------------
+// Return the host address of the RAM page starting at the given address if
+// EmMemGet32, etc., (or EmMemPut32, etc., if forWrite is true) can access it
+// directly.  Return NULL if the accesses need to go through the handlers.
+
+#if HAS_FAST_MEMORY
+static uint8* PrvGetFastPage (emuptr address, Bool forWrite)
+{
+	// Step spies and watchpoints look at every write.
+
+	if (forWrite && (gDebuggerGlobals.stepSpy || gDebuggerGlobals.watchEnabled))
+		return NULL;
+
+	// The chip selects may have something other than RAM here.  Pages are
+	// smaller than banks, so the whole page is handled by this one bank.
+
+	EmAddressBank&	bank = EmMemGetBank (address);
+
+	if (bank.lget != EmBankDRAM::GetLong && bank.lget != EmBankSRAM::GetLong)
+		return NULL;
+
+	// Pages that haven't been written since the last full save have to
+	// go through the handlers so that they can be marked as dirty.
+
+	if (forWrite && !EmBankSRAM::IsDirty (address & gRAMBank_Mask))
+		return NULL;
+
+	if (bank.lget == EmBankDRAM::GetLong)
+		return EmBankDRAM::GetFastPage (address, EmMemFastPageSize, forWrite);
+
+	return EmBankSRAM::GetFastPage (address, EmMemFastPageSize, forWrite);
+}
+#endif
+
+
+// ---------------------------------------------------------------------------
+//		 Memory::InvalidateFastPages
+// ---------------------------------------------------------------------------
+// Take pages out of the fast page tables.  Anything that changes what the
+// RAM bank handlers would do for a range of memory must call one of these
+// *before* the next memory access, since EmMemGet32, etc., won't call the
+// handlers for any page that's still in the tables.  The pages are then
+// re-examined (and put back if they're still eligible) the next time
+// UpdateFastPages is called.
+//
+// This version drops all of RAM.
+
+void Memory::InvalidateFastPages (void)
+{
+#if HAS_FAST_MEMORY
+	if (gFastPagesCount == 0)
+		return;
+
+	memset (gEmMemFastReadPages, 0, gFastPagesCount * sizeof (uint8*));
+	memset (gEmMemFastWritePages, 0, gFastPagesCount * sizeof (uint8*));
+	memset (gFastPagesStale, 1, gFastPagesCount);
+
+	gFastPagesPending = true;
+#endif
+}
+
+
+// This version drops the pages covering the given range of emulated memory.
+
+void Memory::InvalidateFastPages (emuptr begin, emuptr end)
+{
+#if HAS_FAST_MEMORY
+	if (begin >= end)
+		return;
+
+	EmMemTranslateMetaFunc	fn = EmMemGetBank (begin).xlatemetaaddr;
+
+	if (fn != EmBankDRAM::GetMetaAddress && fn != EmBankSRAM::GetMetaAddress)
+		return;
+
+	Memory::InvalidateFastPages (EmMemGetMetaAddress (begin), end - begin);
+#else
+	UNUSED_PARAM (begin);
+	UNUSED_PARAM (end);
+#endif
+}
+
+
+// This version drops the pages covering the given range of meta-memory.
+// This is handy for MetaMemory, which already has the meta-memory address
+// in hand.  Ranges that aren't in RAM's meta-memory are ignored.
+
+void Memory::InvalidateFastPages (const uint8* metaAddress, uint32 size)
+{
+#if HAS_FAST_MEMORY
+	if (gFastPagesCount == 0 || size == 0)
+		return;
+
+	if (metaAddress < gRAM_MetaMemory || metaAddress >= gRAM_MetaMemory + gEmMemFastSize)
+		return;
+
+	uint32	offset	= (uint32) (metaAddress - gRAM_MetaMemory);
+	uint32	first	= offset >> EmMemFastPageShift;
+	uint32	last	= (offset + size - 1) >> EmMemFastPageShift;
+
+	if (last >= gFastPagesCount)
+		last = gFastPagesCount - 1;
+
+	for (uint32 ii = first; ii <= last; ++ii)
+	{
+		gEmMemFastReadPages[ii]		= NULL;
+		gEmMemFastWritePages[ii]	= NULL;
+		gFastPagesStale[ii]			= 1;
+	}
+
+	gFastPagesPending = true;
+#else
+	UNUSED_PARAM (metaAddress);
+	UNUSED_PARAM (size);
+#endif
+}
+
+
+// ---------------------------------------------------------------------------
+//		 Memory::UpdateFastPages
+// ---------------------------------------------------------------------------
+// Re-examine any pages taken out of the fast page tables, putting back the
+// ones that can be accessed directly.  Called periodically from the CPU
+// loop rather than from InvalidateFastPages so that a burst of changes
+// (say, the Memory Manager re-marking the heap) costs only one pass.
+
+void Memory::UpdateFastPages (void)
+{
+#if HAS_FAST_MEMORY
+	if (!gFastPagesPending)
+		return;
+
+	gFastPagesPending = false;
+
+	for (uint32 ii = 0; ii < gFastPagesCount; ++ii)
+	{
+		if (gFastPagesStale[ii])
+		{
+			emuptr	address = gEmMemFastStart + (ii << EmMemFastPageShift);
+
+			gEmMemFastReadPages[ii]		= ::PrvGetFastPage (address, false);
+			gEmMemFastWritePages[ii]	= ::PrvGetFastPage (address, true);
+			gFastPagesStale[ii]			= 0;
+		}
+	}
+#endif
 }
 
 
@@ -99,167 +99,269 @@ typedef struct EmAddressBank
 
 
 // ---------------------------------------------------------------------------
-//		 EmMemGet32
+//		 EmMemDoGet32
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE uint32 EmMemGet32(emuptr addr)
+STATIC_INLINE uint32 EmMemDoGet32 (void* a)
 {
-    return EmMemCallGetFunc(lget, addr);
+#if WORDSWAP_MEMORY || !UNALIGNED_LONG_ACCESS
+	return	(((uint32) *(((uint16*) a) + 0)) << 16) |
+			(((uint32) *(((uint16*) a) + 1)));
+#else
+	return *(uint32*) a;
+#endif
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemGet16
+//		 EmMemDoGet16
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE uint32 EmMemGet16(emuptr addr)
+STATIC_INLINE uint16 EmMemDoGet16 (void* a)
 {
-    return EmMemCallGetFunc(wget, addr);
+	return *(uint16*) a;
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemGet8
+//		 EmMemDoGet8
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE uint32 EmMemGet8(emuptr addr)
+STATIC_INLINE uint8 EmMemDoGet8 (void* a)
 {
-    return EmMemCallGetFunc(bget, addr);
+#if WORDSWAP_MEMORY
+	return *(uint8*) ((long) a ^ 1);
+#else
+	return *(uint8*) a;
+#endif
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemPut32
+//		 EmMemDoPut32
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE void EmMemPut32(emuptr addr, uint32 l)
+STATIC_INLINE void EmMemDoPut32 (void* a, uint32 v)
 {
-    EmMemCallPutFunc(lput, addr, l);
+#if WORDSWAP_MEMORY || !UNALIGNED_LONG_ACCESS
+	*(((uint16*) a) + 0) = (uint16) (v >> 16);
+	*(((uint16*) a) + 1) = (uint16) (v);
+#else
+	*(uint32*) a = v;
+#endif
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemPut16
+//		 EmMemDoPut16
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE void EmMemPut16(emuptr addr, uint32 w)
+STATIC_INLINE void EmMemDoPut16 (void* a, uint16 v)
 {
-    EmMemCallPutFunc(wput, addr, w);
+	*(uint16*) a = v;
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemPut8
+//		 EmMemDoPut8
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE void EmMemPut8(emuptr addr, uint32 b)
+STATIC_INLINE void EmMemDoPut8 (void* a, uint8 v)
 {
-    EmMemCallPutFunc(bput, addr, b);
+#if WORDSWAP_MEMORY
+	*(uint8*) ((long) a ^ 1) = v;
+#else
+	*(uint8*) a = v;
+#endif
 }
 
+
+#if HAS_FAST_MEMORY
+
 // ---------------------------------------------------------------------------
-//		 EmMemGetRealAddress
+//		 Fast page tables
 // ---------------------------------------------------------------------------
+// RAM is divided into 4K pages.  For each page, gEmMemFastReadPages holds the
+// host address of that page if the bank handlers wouldn't do anything more
+// than a plain read from it, and NULL otherwise.  gEmMemFastWritePages does
+// the same for writes.  The tables are indexed by offset from gEmMemFastStart,
+// and are maintained by Memory::InvalidateFastPages and UpdateFastPages.
 
-STATIC_INLINE uint8* EmMemGetRealAddress(emuptr addr)
+#define EmMemFastPageShift		12
+#define EmMemFastPageSize		(1UL << EmMemFastPageShift)
+#define EmMemFastPageMask		(EmMemFastPageSize - 1)
+
+extern emuptr	gEmMemFastStart;
+extern uint32	gEmMemFastSize;
+extern uint8**	gEmMemFastReadPages;
+extern uint8**	gEmMemFastWritePages;
+
+// ---------------------------------------------------------------------------
+//		 EmMemGetFastAddress
+// ---------------------------------------------------------------------------
+// Return the host address for the given access, or NULL if it needs to go
+// through the bank handlers.  Odd word and long accesses always go through
+// the handlers so that they can raise the address error, as do long
+// accesses straddling two pages.
+
+STATIC_INLINE uint8* EmMemGetFastAddress(uint8** table, emuptr addr, uint32 size)
 {
-    return EmMemGetBank(addr).xlateaddr(addr);
+	uint32	offset = addr - gEmMemFastStart;
+	uint8*	page;
+
+	if (offset >= gEmMemFastSize)
+		return NULL;
+
+	if (size > 1 && ((offset & 1) != 0 || (offset & EmMemFastPageMask) > EmMemFastPageSize - size))
+		return NULL;
+
+	page = table[offset >> EmMemFastPageShift];
+
+	if (page == NULL)
+		return NULL;
+
+	return page + (offset & EmMemFastPageMask);
 }
 
+#endif	/* HAS_FAST_MEMORY */
+
+
 // ---------------------------------------------------------------------------
-//		 EmMemCheckAddress
+//		 EmMemGet32
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE int EmMemCheckAddress(emuptr addr, uint32 size)
+STATIC_INLINE uint32 EmMemGet32(emuptr addr)
 {
-    return EmMemGetBank(addr).checkaddr(addr, size);
+#if HAS_FAST_MEMORY
+	uint8*	p = EmMemGetFastAddress(gEmMemFastReadPages, addr, sizeof (uint32));
+
+	if (p)
+		return EmMemDoGet32(p);
+#endif
+
+    return EmMemCallGetFunc(lget, addr);
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemAddOpcodeCycles
+//		 EmMemGet16
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE void EmMemAddOpcodeCycles(emuptr addr)
+STATIC_INLINE uint32 EmMemGet16(emuptr addr)
 {
-	EmAssert (EmMemGetBank(addr).EmMemAddOpcodeCycles);
-    EmMemGetBank(addr).EmMemAddOpcodeCycles();
+#if HAS_FAST_MEMORY
+	uint8*	p = EmMemGetFastAddress(gEmMemFastReadPages, addr, sizeof (uint16));
+
+	if (p)
+		return EmMemDoGet16(p);
+#endif
+
+    return EmMemCallGetFunc(wget, addr);
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemGetMetaAddress
+//		 EmMemGet8
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE uint8* EmMemGetMetaAddress(emuptr addr)
+STATIC_INLINE uint32 EmMemGet8(emuptr addr)
 {
-	EmAssert(EmMemGetBank(addr).xlatemetaaddr);
-    return EmMemGetBank(addr).xlatemetaaddr(addr);
+#if HAS_FAST_MEMORY
+	uint8*	p = EmMemGetFastAddress(gEmMemFastReadPages, addr, sizeof (uint8));
+
+	if (p)
+		return EmMemDoGet8(p);
+#endif
+
+    return EmMemCallGetFunc(bget, addr);
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemDoGet32
+//		 EmMemPut32
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE uint32 EmMemDoGet32 (void* a)
+STATIC_INLINE void EmMemPut32(emuptr addr, uint32 l)
 {
-#if WORDSWAP_MEMORY || !UNALIGNED_LONG_ACCESS
-	return	(((uint32) *(((uint16*) a) + 0)) << 16) |
-			(((uint32) *(((uint16*) a) + 1)));
-#else
-	return *(uint32*) a;
+#if HAS_FAST_MEMORY
+	uint8*	p = EmMemGetFastAddress(gEmMemFastWritePages, addr, sizeof (uint32));
+
+	if (p)
+	{
+		EmMemDoPut32(p, l);
+		return;
+	}
 #endif
+
+    EmMemCallPutFunc(lput, addr, l);
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemDoGet16
+//		 EmMemPut16
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE uint16 EmMemDoGet16 (void* a)
+STATIC_INLINE void EmMemPut16(emuptr addr, uint32 w)
 {
-	return *(uint16*) a;
+#if HAS_FAST_MEMORY
+	uint8*	p = EmMemGetFastAddress(gEmMemFastWritePages, addr, sizeof (uint16));
+
+	if (p)
+	{
+		EmMemDoPut16(p, (uint16) w);
+		return;
+	}
+#endif
+
+    EmMemCallPutFunc(wput, addr, w);
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemDoGet8
+//		 EmMemPut8
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE uint8 EmMemDoGet8 (void* a)
+STATIC_INLINE void EmMemPut8(emuptr addr, uint32 b)
 {
-#if WORDSWAP_MEMORY
-	return *(uint8*) ((long) a ^ 1);
-#else
-	return *(uint8*) a;
+#if HAS_FAST_MEMORY
+	uint8*	p = EmMemGetFastAddress(gEmMemFastWritePages, addr, sizeof (uint8));
+
+	if (p)
+	{
+		EmMemDoPut8(p, (uint8) b);
+		return;
+	}
 #endif
+
+    EmMemCallPutFunc(bput, addr, b);
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemDoPut32
+//		 EmMemGetRealAddress
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE void EmMemDoPut32 (void* a, uint32 v)
+STATIC_INLINE uint8* EmMemGetRealAddress(emuptr addr)
 {
-#if WORDSWAP_MEMORY || !UNALIGNED_LONG_ACCESS
-	*(((uint16*) a) + 0) = (uint16) (v >> 16);
-	*(((uint16*) a) + 1) = (uint16) (v);
-#else
-	*(uint32*) a = v;
-#endif
+    return EmMemGetBank(addr).xlateaddr(addr);
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemDoPut16
+//		 EmMemCheckAddress
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE void EmMemDoPut16 (void* a, uint16 v)
+STATIC_INLINE int EmMemCheckAddress(emuptr addr, uint32 size)
 {
-	*(uint16*) a = v;
+    return EmMemGetBank(addr).checkaddr(addr, size);
 }
 
 // ---------------------------------------------------------------------------
-//		 EmMemDoPut8
+//		 EmMemAddOpcodeCycles
 // ---------------------------------------------------------------------------
 
-STATIC_INLINE void EmMemDoPut8 (void* a, uint8 v)
+STATIC_INLINE void EmMemAddOpcodeCycles(emuptr addr)
 {
-#if WORDSWAP_MEMORY
-	*(uint8*) ((long) a ^ 1) = v;
-#else
-	*(uint8*) a = v;
-#endif
+	EmAssert (EmMemGetBank(addr).EmMemAddOpcodeCycles);
+    EmMemGetBank(addr).EmMemAddOpcodeCycles();
+}
+
+// ---------------------------------------------------------------------------
+//		 EmMemGetMetaAddress
+// ---------------------------------------------------------------------------
+
+STATIC_INLINE uint8* EmMemGetMetaAddress(emuptr addr)
+{
+	EmAssert(EmMemGetBank(addr).xlatemetaaddr);
+    return EmMemGetBank(addr).xlatemetaaddr(addr);
 }
 
 
@@ -374,6 +476,11 @@ class Memory
 
 		static void				ResetBankHandlers	(void);
 
+		static void				InvalidateFastPages	(void);
+		static void				InvalidateFastPages	(emuptr begin, emuptr end);
+		static void				InvalidateFastPages	(const uint8* metaAddress, uint32 size);
+		static void				UpdateFastPages		(void);
+
 		static void				MapPhysicalMemory	(const void*, uint32);
 		static void				UnmapPhysicalMemory	(const void*);
 		static void				GetMappingInfo		(emuptr, void**, uint32*);
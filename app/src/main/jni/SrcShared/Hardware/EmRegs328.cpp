@@ -344,6 +344,7 @@ EmRegs328::EmRegs328 (void) :
 	fSec (0),
 	fTick (0),
 	fCycle (0),
+	fLastCycle (EmHAL::GetCycleCount ()),
 	fUART (NULL)
 {
 }
@@ -397,6 +398,11 @@ void EmRegs328::Reset (Bool hardwareReset)
 
 		Bool	sendTxData = false;
 		EmRegs328::UARTStateChanged (sendTxData);
+
+		// Start counting timer cycles from here.
+
+		fLastCycle = EmHAL::GetCycleCount ();
+		EmRegs328::ScheduleTimers ();
 	}
 }
 
@@ -409,6 +415,10 @@ void EmRegs328::Save (SessionFile& f)
 {
 	EmRegs::Save (f);
 
+	// Make sure the timer registers are current.
+
+	EmRegs328::SyncTimers ();
+
 	StWordSwapper		swapper1 (&f68328Regs, sizeof(f68328Regs));
 	f.WriteHwrDBallType (f68328Regs);
 	f.FixBug (SessionFile::kBugByteswappedStructs);
@@ -526,6 +536,11 @@ void EmRegs328::Load (SessionFile& f)
 	{
 		f.SetCanReload (false);
 	}
+
+	// Start counting timer cycles from here.
+
+	fLastCycle = EmHAL::GetCycleCount ();
+	EmRegs328::ScheduleTimers ();
 }
 
 
@@ -667,11 +682,11 @@ void EmRegs328::SetSubBankHandlers (void)
 	INSTALL_HANDLER (StdRead,			NullWrite,				tmr1Counter);
 	INSTALL_HANDLER (tmr1StatusRead,	tmr1StatusWrite,		tmr1Status);
 
-	INSTALL_HANDLER (StdRead,			StdWrite,				tmr2Control);
+	INSTALL_HANDLER (StdRead,			tmrRegisterWrite,		tmr2Control);
 	INSTALL_HANDLER (StdRead,			StdWrite,				tmr2Prescaler);
-	INSTALL_HANDLER (StdRead,			StdWrite,				tmr2Compare);
+	INSTALL_HANDLER (StdRead,			tmrRegisterWrite,		tmr2Compare);
 	INSTALL_HANDLER (StdRead,			StdWrite,				tmr2Capture);
-	INSTALL_HANDLER (StdRead,			NullWrite,				tmr2Counter);
+	INSTALL_HANDLER (tmrCounterRead,	NullWrite,				tmr2Counter);
 	INSTALL_HANDLER (tmr2StatusRead,	tmr2StatusWrite,		tmr2Status);
 
 	INSTALL_HANDLER (StdRead,			StdWrite,				wdControl);
@@ -752,14 +767,6 @@ uint32 EmRegs328::GetAddressRange (void)
 }
 
 
-// ---------------------------------------------------------------------------
-//		 EmRegs328::Cycle
-// ---------------------------------------------------------------------------
-// Handles periodic events that need to occur when the processor cycles (like
-// updating timer registers).  This function is called in two places from
-// Emulator::Execute.  Interestingly, the loop runs 3% FASTER if this function
-// is in its own separate function instead of being inline.
-
 #if 0
 static int		calibrated;
 static int		increment;
@@ -807,7 +814,167 @@ static void PrvCalibrate (uint16 tmrCompare)
 }
 #endif
 
+#if _DEBUG
+	#define increment	20
+#else
+	#define increment	4
+#endif
+
+
+// ---------------------------------------------------------------------------
+//		 PrvCyclesUntilPassed
+// ---------------------------------------------------------------------------
+// Return the number of cycles before "counter", going up by "increment" each
+// cycle, becomes greater than "compare".  If "counter" would wrap around at
+// "limit" before then, return the number of cycles until it wraps instead;
+// we'll take another look at that point.
+
+static uint32 PrvCyclesUntilPassed (uint32 counter, uint32 compare, uint32 limit)
+{
+	if (counter > compare)
+		return 1;
+
+	uint32	untilPassed	= (compare - counter) / increment + 1;
+	uint32	untilWrap	= (limit - counter) / increment + 1;
+
+	return untilPassed < untilWrap ? untilPassed : untilWrap;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegs328::Cycle
+// ---------------------------------------------------------------------------
+// Handles periodic events that need to occur when the processor cycles (like
+// updating timer registers).  EmHAL::Cycle calls this only when the deadline
+// we gave to EmHAL::ScheduleCycle has arrived (or when another handler's has),
+// and whenever the processor is sleeping.
+
 void EmRegs328::Cycle (Bool sleeping)
+{
+	// Catch up on the cycles that have gone by since we last looked.
+
+	this->SyncTimers ();
+
+	// A sleeping cycle doesn't get counted by EmHAL::Cycle, and it advances
+	// the timers differently, so handle it separately.
+
+	if (sleeping)
+	{
+		this->StepTimers (true);
+	}
+
+	this->ScheduleTimers ();
+
+	// Bring the UART state up to date if bytes have come in or are due
+	// to go out.
+
+	if (fUART->NeedsUpdate (sleeping))
+	{
+		EmRegs328::UpdateUARTState (false);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegs328::SyncTimers
+// ---------------------------------------------------------------------------
+// Bring the timer registers up to date with EmHAL::GetCycleCount.  Call this
+// before looking at or changing any of the state that StepTimers uses.
+//
+// Cycles on which StepTimers does nothing but bump counters are applied in
+// bulk with AdvanceTimers.  Any other cycle is run through StepTimers, so
+// the result is exactly the same as calling StepTimers for every cycle.
+
+void EmRegs328::SyncTimers (void)
+{
+	uint32	now		= EmHAL::GetCycleCount ();
+	uint32	elapsed	= now - fLastCycle;
+
+	fLastCycle = now;
+
+	while (elapsed > 0)
+	{
+		uint32	untilEvent = this->CyclesUntilTimerEvent ();
+
+		if (untilEvent > elapsed)
+		{
+			this->AdvanceTimers (elapsed);
+			break;
+		}
+
+		this->AdvanceTimers (untilEvent - 1);
+		this->StepTimers (false);
+
+		elapsed -= untilEvent;
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegs328::ScheduleTimers
+// ---------------------------------------------------------------------------
+// Ask EmHAL to call us back when the next interesting timer cycle comes
+// up.  Call this after SyncTimers and after changing any of the state that
+// StepTimers uses.
+
+void EmRegs328::ScheduleTimers (void)
+{
+	EmHAL::ScheduleCycle (this->CyclesUntilTimerEvent ());
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegs328::CyclesUntilTimerEvent
+// ---------------------------------------------------------------------------
+// Return the number of cycles until StepTimers does more than just bump a
+// counter: the timer passes its compare value, or the Gremlins clock ticks.
+// Erring on the early side is OK.
+
+uint32 EmRegs328::CyclesUntilTimerEvent (void)
+{
+	uint16	tmr2Compare	= READ_REGISTER (tmr2Compare);
+	uint32	result		= ::PrvCyclesUntilPassed (fCycle, tmr2Compare, 0xFFFFFFFF);
+
+	if ((READ_REGISTER (tmr2Control) & hwr328TmrControlEnable) != 0)
+	{
+		uint32	untilTimer = ::PrvCyclesUntilPassed (READ_REGISTER (tmr2Counter), tmr2Compare, 0xFFFF);
+
+		if (result > untilTimer)
+			result = untilTimer;
+	}
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegs328::AdvanceTimers
+// ---------------------------------------------------------------------------
+// Apply the given number of non-sleeping cycles, none of which may be one
+// that CyclesUntilTimerEvent would report.
+
+void EmRegs328::AdvanceTimers (uint32 cycles)
+{
+	if (cycles == 0)
+		return;
+
+	uint32	delta = cycles * increment;
+
+	if ((READ_REGISTER (tmr2Control) & hwr328TmrControlEnable) != 0)
+	{
+		WRITE_REGISTER (tmr2Counter, READ_REGISTER (tmr2Counter) + delta);
+	}
+
+	fCycle += delta;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegs328::StepTimers
+// ---------------------------------------------------------------------------
+// Update the timer registers for a single processor cycle.
+
+void EmRegs328::StepTimers (Bool sleeping)
 {
 #if 0
 	// Cycle is *very* sensitive to timing issue.  With this section
@@ -816,12 +983,6 @@ void EmRegs328::Cycle (Bool sleeping)
 	{
 		::PrvCalibrate (READ_REGISTER (tmr2Compare));
 	}
-#else
-	#if _DEBUG
-		#define increment	20
-	#else
-		#define increment	4
-	#endif
 #endif
 
 	// Determine whether timer 2 is enabled.
@@ -894,8 +1055,6 @@ void EmRegs328::Cycle (Bool sleeping)
 
 void EmRegs328::CycleSlowly (Bool sleeping)
 {
-	UNUSED_PARAM(sleeping)
-
 	// See if a hard button is pressed.
 
 	EmAssert (gSession);
@@ -912,9 +1071,14 @@ void EmRegs328::CycleSlowly (Bool sleeping)
 		}
 	}
 
-	// See if there's anything new ("Put the data on the bus")
+	// See if there's anything new ("Put the data on the bus").  The
+	// transports ring the session's UART doorbell when bytes come in,
+	// so there's nothing to do here unless they have.
 
-	EmRegs328::UpdateUARTState (false);
+	if (fUART->NeedsUpdate (sleeping))
+	{
+		EmRegs328::UpdateUARTState (false);
+	}
 
 	// Check to see if the RTC alarm is ready to go off.  First see
 	// if the RTC is enabled, and that the alarm event isn't already
@@ -933,7 +1097,7 @@ void EmRegs328::CycleSlowly (Bool sleeping)
 		long	nowHour;
 		long	nowMin;
 		long	nowSec;
-		::GetHostTime (&nowHour, &nowMin, &nowSec);
+		this->GetRTCTime (nowHour, nowMin, nowSec);
 		long	nowInSeconds = (nowHour * 60 * 60) + (nowMin * 60) + nowSec;
 
 		if (almInSeconds <= nowInSeconds)
@@ -962,7 +1126,11 @@ void EmRegs328::TurnSoundOff (void)
 
 void EmRegs328::ResetTimer (void)
 {
+	EmRegs328::SyncTimers ();
+
 	WRITE_REGISTER (tmr2Counter, 0);
+
+	EmRegs328::ScheduleTimers ();
 }
 
 
@@ -972,11 +1140,15 @@ void EmRegs328::ResetTimer (void)
 
 void EmRegs328::ResetRTC (void)
 {
+	EmRegs328::SyncTimers ();
+
 	fHour = 15;
 	fMin = 0;
 	fSec = 0;
 	fTick = 0;
 	fCycle = 0;
+
+	EmRegs328::ScheduleTimers ();
 }
 
 
@@ -1302,6 +1474,33 @@ Bool EmRegs328::GetAsleep (void)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmRegs328::GetSleepInterval
+// ---------------------------------------------------------------------------
+// Each sleeping cycle advances the timers by a tick, so if one's running,
+// come back in a tick (10 msecs).  The same goes for the UART when it has
+// bytes waiting in its TX FIFO.  Incoming bytes ring the UART doorbell,
+// which wakes us up, so there's no need to poll for them.  Otherwise, we
+// only need to check on the RTC alarm now and then.
+
+uint32 EmRegs328::GetSleepInterval (void)
+{
+	if ((READ_REGISTER (tmr1Control) & hwr328TmrControlEnable) != 0 ||
+		(READ_REGISTER (tmr2Control) & hwr328TmrControlEnable) != 0 ||
+		fUART->IsTransmitting ())
+	{
+		return 10;
+	}
+
+	if ((READ_REGISTER (rtcIntEnable) & hwr328RTCIntEnableAlarm) != 0)
+	{
+		return 100;
+	}
+
+	return 0;
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmRegs328::GetPortInputValue
 // ---------------------------------------------------------------------------
@@ -1608,17 +1807,37 @@ uint32 EmRegs328::uartRead (emuptr address, int size)
 
 
 // ---------------------------------------------------------------------------
-//		 EmRegs328::rtcHourMinSecRead
+//		 EmRegs328::tmrCounterRead
 // ---------------------------------------------------------------------------
 
-uint32 EmRegs328::rtcHourMinSecRead (emuptr address, int size)
+uint32 EmRegs328::tmrCounterRead (emuptr address, int size)
 {
-	// Get the desktop machine's time.
+	// Bring the counter up to date.
 
-	long	hour, min, sec;
+	EmRegs328::SyncTimers ();
 
-	if (Hordes::IsOn ())
+	// Finish up by doing a standard read.
+
+	return EmRegs328::StdRead (address, size);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegs328::GetRTCTime
+// ---------------------------------------------------------------------------
+// Return the time of day the RTC shows.  That's normally the desktop
+// machine's time.  While Gremlins are running or the session is headless,
+// it's the clock kept by StepTimers instead, which follows the emulated
+// cycle count so that runs can be repeated.
+
+void EmRegs328::GetRTCTime (long& hour, long& min, long& sec)
+{
+	EmAssert (gSession);
+
+	if (Hordes::IsOn () || gSession->IsHeadless ())
 	{
+		EmRegs328::SyncTimers ();
+
 		hour = fHour;
 		min = fMin;
 		sec = fSec;
@@ -1627,6 +1846,18 @@ uint32 EmRegs328::rtcHourMinSecRead (emuptr address, int size)
 	{
 		::GetHostTime (&hour, &min, &sec);
 	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegs328::rtcHourMinSecRead
+// ---------------------------------------------------------------------------
+
+uint32 EmRegs328::rtcHourMinSecRead (emuptr address, int size)
+{
+	long	hour, min, sec;
+
+	EmRegs328::GetRTCTime (hour, min, sec);
 
 	// Update the register.
 
@@ -1945,6 +2176,26 @@ void EmRegs328::wdCounterWrite (emuptr address, int size, uint32 value)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmRegs328::tmrRegisterWrite
+// ---------------------------------------------------------------------------
+
+void EmRegs328::tmrRegisterWrite (emuptr address, int size, uint32 value)
+{
+	// Run the timers up to this point under the old settings.
+
+	EmRegs328::SyncTimers ();
+
+	// Do a standard update of the register.
+
+	EmRegs328::StdWrite (address, size, value);
+
+	// Figure out when the timers next need attention under the new ones.
+
+	EmRegs328::ScheduleTimers ();
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmRegs328::spiMasterControlWrite
 // ---------------------------------------------------------------------------
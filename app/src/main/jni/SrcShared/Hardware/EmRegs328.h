@@ -66,6 +66,7 @@ class EmRegs328 : public EmRegs, public EmHALHandler
 		virtual int32			GetSystemClockFrequency	(void);
 		virtual Bool			GetCanStop				(void);
 		virtual Bool			GetAsleep				(void);
+		virtual uint32			GetSleepInterval		(void);
 
 		virtual uint8			GetPortInputValue		(int);
 		virtual uint8			GetPortInternalValue	(int);
@@ -78,6 +79,7 @@ class EmRegs328 : public EmRegs, public EmHALHandler
 		uint32					tmr2StatusRead			(emuptr address, int size);
 		uint32					uartRead				(emuptr address, int size);
 		uint32					rtcHourMinSecRead		(emuptr address, int size);
+		uint32					tmrCounterRead			(emuptr address, int size);
 
 		void					csASelect1Write			(emuptr address, int size, uint32 value);
 		void					csCSelect0Write			(emuptr address, int size, uint32 value);
@@ -91,6 +93,7 @@ class EmRegs328 : public EmRegs, public EmHALHandler
 		void					tmr2StatusWrite			(emuptr address, int size, uint32 value);
 		void					wdCounterWrite			(emuptr address, int size, uint32 value);
 		void					spiMasterControlWrite	(emuptr address, int size, uint32 value);
+		void					tmrRegisterWrite		(emuptr address, int size, uint32 value);
 		void					uartWrite				(emuptr address, int size, uint32 value);
 		void					lcdRegisterWrite		(emuptr address, int size, uint32 value);
 		void					rtcControlWrite			(emuptr address, int size, uint32 value);
@@ -103,6 +106,14 @@ class EmRegs328 : public EmRegs, public EmHALHandler
 		virtual uint8			GetKeyBits				(void);
 		virtual uint16			ButtonToBits			(SkinElementType);
 
+	private:
+		void					SyncTimers				(void);
+		void					GetRTCTime				(long& hour, long& min, long& sec);
+		void					ScheduleTimers			(void);
+		uint32					CyclesUntilTimerEvent	(void);
+		void					AdvanceTimers			(uint32 cycles);
+		void					StepTimers				(Bool sleeping);
+
 	protected:
 		void					UpdateInterrupts		(void);
 		void					UpdatePortDInterrupts	(void);
@@ -140,6 +151,8 @@ class EmRegs328 : public EmRegs, public EmHALHandler
 		uint32					fTick;
 		uint32					fCycle;
 
+		uint32					fLastCycle;				// EmHAL::GetCycleCount at last SyncTimers
+
 		EmUARTDragonball*		fUART;
 };
 
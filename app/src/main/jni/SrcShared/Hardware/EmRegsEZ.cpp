@@ -266,6 +266,7 @@ EmRegsEZ::EmRegsEZ (void) :
 	fSec (0),
 	fTick (0),
 	fCycle (0),
+	fLastCycle (EmHAL::GetCycleCount ()),
 	fUART (NULL)
 {
 }
@@ -318,6 +319,11 @@ void EmRegsEZ::Reset (Bool hardwareReset)
 
 		Bool	sendTxData = false;
 		EmRegsEZ::UARTStateChanged (sendTxData);
+
+		// Start counting timer cycles from here.
+
+		fLastCycle = EmHAL::GetCycleCount ();
+		EmRegsEZ::ScheduleTimers ();
 	}
 }
 
@@ -330,6 +336,10 @@ void EmRegsEZ::Save (SessionFile& f)
 {
 	EmRegs::Save (f);
 
+	// Make sure the timer registers are current.
+
+	EmRegsEZ::SyncTimers ();
+
 	StWordSwapper				swapper1 (&f68EZ328Regs, sizeof(f68EZ328Regs));
 //	StCanonical<HwrM68EZ328Type>	swapper2 (f68EZ328Regs);
 	f.WriteHwrDBallEZType (f68EZ328Regs);
@@ -439,6 +449,11 @@ void EmRegsEZ::Load (SessionFile& f)
 	{
 		f.SetCanReload (false);
 	}
+
+	// Start counting timer cycles from here.
+
+	fLastCycle = EmHAL::GetCycleCount ();
+	EmRegsEZ::ScheduleTimers ();
 }
 
 
@@ -543,11 +558,11 @@ void EmRegsEZ::SetSubBankHandlers (void)
 	INSTALL_HANDLER (StdRead,			StdWrite,				pwmPeriod);
 	INSTALL_HANDLER (StdRead,			NullWrite,				pwmCounter);
 
-	INSTALL_HANDLER (StdRead,			StdWrite,				tmr1Control);
+	INSTALL_HANDLER (StdRead,			tmrRegisterWrite,		tmr1Control);
 	INSTALL_HANDLER (StdRead,			StdWrite,				tmr1Prescaler);
-	INSTALL_HANDLER (StdRead,			StdWrite,				tmr1Compare);
+	INSTALL_HANDLER (StdRead,			tmrRegisterWrite,		tmr1Compare);
 	INSTALL_HANDLER (StdRead,			StdWrite,				tmr1Capture);
-	INSTALL_HANDLER (StdRead,			NullWrite,				tmr1Counter);
+	INSTALL_HANDLER (tmrCounterRead,	NullWrite,				tmr1Counter);
 	INSTALL_HANDLER (tmr1StatusRead,	tmr1StatusWrite,		tmr1Status);
 
 	INSTALL_HANDLER (StdRead,			StdWrite,				spiMasterData);
@@ -633,22 +648,168 @@ uint32 EmRegsEZ::GetAddressRange (void)
 }
 
 
+#if _DEBUG
+	#define increment	20
+#else
+	#define increment	4
+#endif
+
+
+// ---------------------------------------------------------------------------
+//		 PrvCyclesUntilPassed
+// ---------------------------------------------------------------------------
+// Return the number of cycles before "counter", going up by "increment" each
+// cycle, becomes greater than "compare".  If "counter" would wrap around at
+// "limit" before then, return the number of cycles until it wraps instead;
+// we'll take another look at that point.
+
+static uint32 PrvCyclesUntilPassed (uint32 counter, uint32 compare, uint32 limit)
+{
+	if (counter > compare)
+		return 1;
+
+	uint32	untilPassed	= (compare - counter) / increment + 1;
+	uint32	untilWrap	= (limit - counter) / increment + 1;
+
+	return untilPassed < untilWrap ? untilPassed : untilWrap;
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmRegsEZ::Cycle
 // ---------------------------------------------------------------------------
 // Handles periodic events that need to occur when the processor cycles (like
-// updating timer registers).  This function is called in two places from
-// Emulator::Execute.  Interestingly, the loop runs 3% FASTER if this function
-// is in its own separate function instead of being inline.
+// updating timer registers).  EmHAL::Cycle calls this only when the deadline
+// we gave to EmHAL::ScheduleCycle has arrived (or when another handler's has),
+// and whenever the processor is sleeping.
 
 void EmRegsEZ::Cycle (Bool sleeping)
 {
-#if _DEBUG
-	#define increment	20
-#else
-	#define increment	4
-#endif
+	// Catch up on the cycles that have gone by since we last looked.
+
+	this->SyncTimers ();
+
+	// A sleeping cycle doesn't get counted by EmHAL::Cycle, and it advances
+	// the timers differently, so handle it separately.
+
+	if (sleeping)
+	{
+		this->StepTimers (true);
+	}
+
+	this->ScheduleTimers ();
+
+	// Bring the UART state up to date if bytes have come in or are due
+	// to go out.
+
+	if (fUART->NeedsUpdate (sleeping))
+	{
+		EmRegsEZ::UpdateUARTState (false);
+	}
+}
 
+
+// ---------------------------------------------------------------------------
+//		 EmRegsEZ::SyncTimers
+// ---------------------------------------------------------------------------
+// Bring the timer registers up to date with EmHAL::GetCycleCount.  Call this
+// before looking at or changing any of the state that StepTimers uses.
+//
+// Cycles on which StepTimers does nothing but bump counters are applied in
+// bulk with AdvanceTimers.  Any other cycle is run through StepTimers, so
+// the result is exactly the same as calling StepTimers for every cycle.
+
+void EmRegsEZ::SyncTimers (void)
+{
+	uint32	now		= EmHAL::GetCycleCount ();
+	uint32	elapsed	= now - fLastCycle;
+
+	fLastCycle = now;
+
+	while (elapsed > 0)
+	{
+		uint32	untilEvent = this->CyclesUntilTimerEvent ();
+
+		if (untilEvent > elapsed)
+		{
+			this->AdvanceTimers (elapsed);
+			break;
+		}
+
+		this->AdvanceTimers (untilEvent - 1);
+		this->StepTimers (false);
+
+		elapsed -= untilEvent;
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsEZ::ScheduleTimers
+// ---------------------------------------------------------------------------
+// Ask EmHAL to call us back when the next interesting timer cycle comes
+// up.  Call this after SyncTimers and after changing any of the state that
+// StepTimers uses.
+
+void EmRegsEZ::ScheduleTimers (void)
+{
+	EmHAL::ScheduleCycle (this->CyclesUntilTimerEvent ());
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsEZ::CyclesUntilTimerEvent
+// ---------------------------------------------------------------------------
+// Return the number of cycles until StepTimers does more than just bump a
+// counter: the timer passes its compare value, or the Gremlins clock ticks.
+// Erring on the early side is OK.
+
+uint32 EmRegsEZ::CyclesUntilTimerEvent (void)
+{
+	uint16	tmr1Compare	= READ_REGISTER (tmr1Compare);
+	uint32	result		= ::PrvCyclesUntilPassed (fCycle, tmr1Compare, 0xFFFFFFFF);
+
+	if ((READ_REGISTER (tmr1Control) & hwrEZ328TmrControlEnable) != 0)
+	{
+		uint32	untilTimer = ::PrvCyclesUntilPassed (READ_REGISTER (tmr1Counter), tmr1Compare, 0xFFFF);
+
+		if (result > untilTimer)
+			result = untilTimer;
+	}
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsEZ::AdvanceTimers
+// ---------------------------------------------------------------------------
+// Apply the given number of non-sleeping cycles, none of which may be one
+// that CyclesUntilTimerEvent would report.
+
+void EmRegsEZ::AdvanceTimers (uint32 cycles)
+{
+	if (cycles == 0)
+		return;
+
+	uint32	delta = cycles * increment;
+
+	if ((READ_REGISTER (tmr1Control) & hwrEZ328TmrControlEnable) != 0)
+	{
+		WRITE_REGISTER (tmr1Counter, READ_REGISTER (tmr1Counter) + delta);
+	}
+
+	fCycle += delta;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsEZ::StepTimers
+// ---------------------------------------------------------------------------
+// Update the timer registers for a single processor cycle.
+
+void EmRegsEZ::StepTimers (Bool sleeping)
+{
 	// Determine whether timer is enabled.
 
 	if ((READ_REGISTER (tmr1Control) & hwrEZ328TmrControlEnable) != 0)
@@ -719,8 +880,6 @@ void EmRegsEZ::Cycle (Bool sleeping)
 
 void EmRegsEZ::CycleSlowly (Bool sleeping)
 {
-	UNUSED_PARAM(sleeping)
-
 	// See if a hard button is pressed.
 
 
@@ -738,9 +897,14 @@ void EmRegsEZ::CycleSlowly (Bool sleeping)
 		}
 	}
 
-	// See if there's anything new ("Put the data on the bus")
+	// See if there's anything new ("Put the data on the bus").  The
+	// transports ring the session's UART doorbell when bytes come in,
+	// so there's nothing to do here unless they have.
 
-	EmRegsEZ::UpdateUARTState (false);
+	if (fUART->NeedsUpdate (sleeping))
+	{
+		EmRegsEZ::UpdateUARTState (false);
+	}
 
 	// Check to see if the RTC alarm is ready to go off.  First see
 	// if the RTC is enabled, and that the alarm event isn't already
@@ -759,7 +923,7 @@ void EmRegsEZ::CycleSlowly (Bool sleeping)
 		long	nowHour;
 		long	nowMin;
 		long	nowSec;
-		::GetHostTime (&nowHour, &nowMin, &nowSec);
+		this->GetRTCTime (nowHour, nowMin, nowSec);
 		long	nowInSeconds = (nowHour * 60 * 60) + (nowMin * 60) + nowSec;
 
 		if (almInSeconds <= nowInSeconds)
@@ -788,7 +952,11 @@ void EmRegsEZ::TurnSoundOff (void)
 
 void EmRegsEZ::ResetTimer (void)
 {
+	EmRegsEZ::SyncTimers ();
+
 	WRITE_REGISTER (tmr1Counter, 0);
+
+	EmRegsEZ::ScheduleTimers ();
 }
 
 
@@ -798,11 +966,15 @@ void EmRegsEZ::ResetTimer (void)
 
 void EmRegsEZ::ResetRTC (void)
 {
+	EmRegsEZ::SyncTimers ();
+
 	fHour = 15;
 	fMin = 0;
 	fSec = 0;
 	fTick = 0;
 	fCycle = 0;
+
+	EmRegsEZ::ScheduleTimers ();
 }
 
 
@@ -1193,6 +1365,32 @@ Bool EmRegsEZ::GetAsleep (void)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmRegsEZ::GetSleepInterval
+// ---------------------------------------------------------------------------
+// Each sleeping cycle advances the timers by a tick, so if one's running,
+// come back in a tick (10 msecs).  The same goes for the UART when it has
+// bytes waiting in its TX FIFO.  Incoming bytes ring the UART doorbell,
+// which wakes us up, so there's no need to poll for them.  Otherwise, we
+// only need to check on the RTC alarm now and then.
+
+uint32 EmRegsEZ::GetSleepInterval (void)
+{
+	if ((READ_REGISTER (tmr1Control) & hwrEZ328TmrControlEnable) != 0 ||
+		fUART->IsTransmitting ())
+	{
+		return 10;
+	}
+
+	if ((READ_REGISTER (rtcIntEnable) & hwrEZ328RTCIntEnableAlarm) != 0)
+	{
+		return 100;
+	}
+
+	return 0;
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmRegsEZ::GetPortInputValue
 // ---------------------------------------------------------------------------
@@ -1378,6 +1576,8 @@ uint32 EmRegsEZ::portXDataRead (emuptr address, int)
 
 uint32 EmRegsEZ::tmr1StatusRead (emuptr address, int size)
 {
+	EmRegsEZ::SyncTimers ();
+
 	uint16	tmr1Counter = READ_REGISTER (tmr1Counter) + 16;
 	uint16	tmr1Compare = READ_REGISTER (tmr1Compare);
 	uint16	tmr1Control = READ_REGISTER (tmr1Control);
@@ -1407,6 +1607,8 @@ uint32 EmRegsEZ::tmr1StatusRead (emuptr address, int size)
 
 	fLastTmr1Status |= READ_REGISTER (tmr1Status);
 
+	EmRegsEZ::ScheduleTimers ();
+
 	// Finish up by doing a standard read.
 
 	return EmRegsEZ::StdRead (address, size);
@@ -1434,17 +1636,37 @@ uint32 EmRegsEZ::uartRead (emuptr address, int size)
 
 
 // ---------------------------------------------------------------------------
-//		 EmRegsEZ::rtcHourMinSecRead
+//		 EmRegsEZ::tmrCounterRead
 // ---------------------------------------------------------------------------
 
-uint32 EmRegsEZ::rtcHourMinSecRead (emuptr address, int size)
+uint32 EmRegsEZ::tmrCounterRead (emuptr address, int size)
 {
-	// Get the desktop machine's time.
+	// Bring the counter up to date.
 
-	long	hour, min, sec;
+	EmRegsEZ::SyncTimers ();
 
-	if (Hordes::IsOn ())
+	// Finish up by doing a standard read.
+
+	return EmRegsEZ::StdRead (address, size);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsEZ::GetRTCTime
+// ---------------------------------------------------------------------------
+// Return the time of day the RTC shows.  That's normally the desktop
+// machine's time.  While Gremlins are running or the session is headless,
+// it's the clock kept by StepTimers instead, which follows the emulated
+// cycle count so that runs can be repeated.
+
+void EmRegsEZ::GetRTCTime (long& hour, long& min, long& sec)
+{
+	EmAssert (gSession);
+
+	if (Hordes::IsOn () || gSession->IsHeadless ())
 	{
+		EmRegsEZ::SyncTimers ();
+
 		hour = fHour;
 		min = fMin;
 		sec = fSec;
@@ -1453,6 +1675,18 @@ uint32 EmRegsEZ::rtcHourMinSecRead (emuptr address, int size)
 	{
 		::GetHostTime (&hour, &min, &sec);
 	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsEZ::rtcHourMinSecRead
+// ---------------------------------------------------------------------------
+
+uint32 EmRegsEZ::rtcHourMinSecRead (emuptr address, int size)
+{
+	long	hour, min, sec;
+
+	EmRegsEZ::GetRTCTime (hour, min, sec);
 
 	// Update the register.
 
@@ -1716,6 +1950,26 @@ void EmRegsEZ::tmr1StatusWrite (emuptr address, int size, uint32 value)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmRegsEZ::tmrRegisterWrite
+// ---------------------------------------------------------------------------
+
+void EmRegsEZ::tmrRegisterWrite (emuptr address, int size, uint32 value)
+{
+	// Run the timers up to this point under the old settings.
+
+	EmRegsEZ::SyncTimers ();
+
+	// Do a standard update of the register.
+
+	EmRegsEZ::StdWrite (address, size, value);
+
+	// Figure out when the timers next need attention under the new ones.
+
+	EmRegsEZ::ScheduleTimers ();
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmRegsEZ::spiMasterControlWrite
 // ---------------------------------------------------------------------------
@@ -67,6 +67,7 @@ class EmRegsEZ : public EmRegs, public EmHALHandler
 		virtual int32			GetSystemClockFrequency	(void);
 		virtual Bool			GetCanStop				(void);
 		virtual Bool			GetAsleep				(void);
+		virtual uint32			GetSleepInterval		(void);
 
 		virtual uint8			GetPortInputValue		(int);
 		virtual uint8			GetPortInternalValue	(int);
@@ -80,6 +81,7 @@ class EmRegsEZ : public EmRegs, public EmHALHandler
 		uint32					tmr1StatusRead			(emuptr address, int size);
 		uint32					uartRead				(emuptr address, int size);
 		uint32					rtcHourMinSecRead		(emuptr address, int size);
+		uint32					tmrCounterRead			(emuptr address, int size);
 
 		void					csASelectWrite			(emuptr address, int size, uint32 value);
 		void					csDSelectWrite			(emuptr address, int size, uint32 value);
@@ -90,6 +92,7 @@ class EmRegsEZ : public EmRegs, public EmHALHandler
 		void					portDIntReqEnWrite		(emuptr address, int size, uint32 value);
 		void					tmr1StatusWrite			(emuptr address, int size, uint32 value);
 		void					spiMasterControlWrite	(emuptr address, int size, uint32 value);
+		void					tmrRegisterWrite		(emuptr address, int size, uint32 value);
 		void					uartWrite				(emuptr address, int size, uint32 value);
 		void					lcdRegisterWrite		(emuptr address, int size, uint32 value);
 		void					rtcControlWrite			(emuptr address, int size, uint32 value);
@@ -103,6 +106,14 @@ class EmRegsEZ : public EmRegs, public EmHALHandler
 		virtual uint16			ButtonToBits			(SkinElementType);
 		virtual EmSPISlave*		GetSPISlave				(void);
 
+	private:
+		void					SyncTimers				(void);
+		void					GetRTCTime				(long& hour, long& min, long& sec);
+		void					ScheduleTimers			(void);
+		uint32					CyclesUntilTimerEvent	(void);
+		void					AdvanceTimers			(uint32 cycles);
+		void					StepTimers				(Bool sleeping);
+
 	protected:
 		void					UpdateInterrupts		(void);
 		void					UpdatePortDInterrupts	(void);
@@ -137,6 +148,8 @@ class EmRegsEZ : public EmRegs, public EmHALHandler
 		uint32					fTick;
 		uint32					fCycle;
 
+		uint32					fLastCycle;				// EmHAL::GetCycleCount at last SyncTimers
+
 		EmUARTDragonball*		fUART;
 };
 
@@ -358,7 +358,9 @@ EmRegsVZ::EmRegsVZ (void) :
 	fMin (0),
 	fSec (0),
 	fTick (0),
-	fCycle (0)
+	fCycle (0),
+	fLastCycle (EmHAL::GetCycleCount ()),
+	fTmr2PrescaleCounter (0)
 {
 	fUART[0] = NULL;
 	fUART[1] = NULL;
@@ -415,6 +417,11 @@ void EmRegsVZ::Reset (Bool hardwareReset)
 		Bool	sendTxData = false;
 		EmRegsVZ::UARTStateChanged (sendTxData, 0);
 		EmRegsVZ::UARTStateChanged (sendTxData, 1);
+
+		// Start counting timer cycles from here.
+
+		fLastCycle = EmHAL::GetCycleCount ();
+		EmRegsVZ::ScheduleTimers ();
 	}
 }
 
@@ -427,6 +434,10 @@ void EmRegsVZ::Save (SessionFile& f)
 {
 	EmRegs::Save (f);
 
+	// Make sure the timer registers are current.
+
+	EmRegsVZ::SyncTimers ();
+
 	StWordSwapper	swapper (&f68VZ328Regs, sizeof(f68VZ328Regs));
 	f.WriteHwrDBallVZType (f68VZ328Regs);
 	f.FixBug (SessionFile::kBugByteswappedStructs);
@@ -538,6 +549,11 @@ void EmRegsVZ::Load (SessionFile& f)
 	{
 		f.SetCanReload (false);
 	}
+
+	// Start counting timer cycles from here.
+
+	fLastCycle = EmHAL::GetCycleCount ();
+	EmRegsVZ::ScheduleTimers ();
 }
 
 
@@ -670,18 +686,18 @@ void EmRegsVZ::SetSubBankHandlers (void)
 	INSTALL_HANDLER (StdRead,			StdWrite,				pwm2Width);
 	INSTALL_HANDLER (StdRead,			NullWrite,				pwm2Counter);
 
-	INSTALL_HANDLER (StdRead,			StdWrite,				tmr1Control);
+	INSTALL_HANDLER (StdRead,			tmrRegisterWrite,		tmr1Control);
 	INSTALL_HANDLER (StdRead,			StdWrite,				tmr1Prescaler);
-	INSTALL_HANDLER (StdRead,			StdWrite,				tmr1Compare);
+	INSTALL_HANDLER (StdRead,			tmrRegisterWrite,		tmr1Compare);
 	INSTALL_HANDLER (StdRead,			StdWrite,				tmr1Capture);
-	INSTALL_HANDLER (StdRead,			NullWrite,				tmr1Counter);
+	INSTALL_HANDLER (tmrCounterRead,	NullWrite,				tmr1Counter);
 	INSTALL_HANDLER (tmr1StatusRead,	tmr1StatusWrite,		tmr1Status);
 
-	INSTALL_HANDLER (StdRead,			StdWrite,				tmr2Control);
+	INSTALL_HANDLER (StdRead,			tmrRegisterWrite,		tmr2Control);
 	INSTALL_HANDLER (StdRead,			StdWrite,				tmr2Prescaler);
-	INSTALL_HANDLER (StdRead,			StdWrite,				tmr2Compare);
+	INSTALL_HANDLER (StdRead,			tmrRegisterWrite,		tmr2Compare);
 	INSTALL_HANDLER (StdRead,			StdWrite,				tmr2Capture);
-	INSTALL_HANDLER (StdRead,			NullWrite,				tmr2Counter);
+	INSTALL_HANDLER (tmrCounterRead,	NullWrite,				tmr2Counter);
 	INSTALL_HANDLER (tmr2StatusRead,	tmr2StatusWrite,		tmr2Status);
 
 	INSTALL_HANDLER (StdRead,			StdWrite,				spiRxD);
@@ -786,22 +802,193 @@ uint32 EmRegsVZ::GetAddressRange (void)
 }
 
 
+#if _DEBUG
+	#define increment	20
+#else
+	#define increment	4
+#endif
+
+
+// ---------------------------------------------------------------------------
+//		 PrvCyclesUntilPassed
+// ---------------------------------------------------------------------------
+// Return the number of cycles before "counter", going up by "increment" each
+// cycle, becomes greater than "compare".  If "counter" would wrap around at
+// "limit" before then, return the number of cycles until it wraps instead;
+// we'll take another look at that point.
+
+static uint32 PrvCyclesUntilPassed (uint32 counter, uint32 compare, uint32 limit)
+{
+	if (counter > compare)
+		return 1;
+
+	uint32	untilPassed	= (compare - counter) / increment + 1;
+	uint32	untilWrap	= (limit - counter) / increment + 1;
+
+	return untilPassed < untilWrap ? untilPassed : untilWrap;
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmRegsVZ::Cycle
 // ---------------------------------------------------------------------------
 // Handles periodic events that need to occur when the processor cycles (like
-// updating timer registers).  This function is called in two places from
-// Emulator::Execute.  Interestingly, the loop runs 3% FASTER if this function
-// is in its own separate function instead of being inline.
+// updating timer registers).  EmHAL::Cycle calls this only when the deadline
+// we gave to EmHAL::ScheduleCycle has arrived (or when another handler's has),
+// and whenever the processor is sleeping.
 
 void EmRegsVZ::Cycle (Bool sleeping)
 {
-#if _DEBUG
-	#define increment	20
-#else
-	#define increment	4
-#endif
+	// Catch up on the cycles that have gone by since we last looked.
+
+	this->SyncTimers ();
+
+	// A sleeping cycle doesn't get counted by EmHAL::Cycle, and it advances
+	// the timers differently, so handle it separately.
+
+	if (sleeping)
+	{
+		this->StepTimers (true);
+	}
+
+	this->ScheduleTimers ();
+
+	// Bring the UART state up to date if bytes have come in or are due
+	// to go out.
+
+	if (fUART[0]->NeedsUpdate (sleeping))
+	{
+		EmRegsVZ::UpdateUARTState (false, 0);
+	}
+
+	if (fUART[1]->NeedsUpdate (sleeping))
+	{
+		EmRegsVZ::UpdateUARTState (false, 1);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsVZ::SyncTimers
+// ---------------------------------------------------------------------------
+// Bring the timer registers up to date with EmHAL::GetCycleCount.  Call this
+// before looking at or changing any of the state that StepTimers uses.
+//
+// Cycles on which StepTimers does nothing but bump counters are applied in
+// bulk with AdvanceTimers.  Any other cycle is run through StepTimers, so
+// the result is exactly the same as calling StepTimers for every cycle.
+
+void EmRegsVZ::SyncTimers (void)
+{
+	uint32	now		= EmHAL::GetCycleCount ();
+	uint32	elapsed	= now - fLastCycle;
+
+	fLastCycle = now;
+
+	while (elapsed > 0)
+	{
+		uint32	untilEvent = this->CyclesUntilTimerEvent ();
+
+		if (untilEvent > elapsed)
+		{
+			this->AdvanceTimers (elapsed);
+			break;
+		}
+
+		this->AdvanceTimers (untilEvent - 1);
+		this->StepTimers (false);
+
+		elapsed -= untilEvent;
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsVZ::ScheduleTimers
+// ---------------------------------------------------------------------------
+// Ask EmHAL to call us back when the next interesting timer cycle comes
+// up.  Call this after SyncTimers and after changing any of the state that
+// StepTimers uses.
+
+void EmRegsVZ::ScheduleTimers (void)
+{
+	EmHAL::ScheduleCycle (this->CyclesUntilTimerEvent ());
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsVZ::CyclesUntilTimerEvent
+// ---------------------------------------------------------------------------
+// Return the number of cycles until StepTimers does more than just bump a
+// counter: a timer passes its compare value, timer 2's prescaler runs out,
+// or the Gremlins clock ticks.  Erring on the early side is OK.
+
+uint32 EmRegsVZ::CyclesUntilTimerEvent (void)
+{
+	uint16	tmr1Compare	= READ_REGISTER (tmr1Compare);
+	uint32	result		= ::PrvCyclesUntilPassed (fCycle, tmr1Compare, 0xFFFFFFFF);
+
+	if ((READ_REGISTER (tmr1Control) & hwrVZ328TmrControlEnable) != 0)
+	{
+		uint32	untilTmr1 = ::PrvCyclesUntilPassed (READ_REGISTER (tmr1Counter), tmr1Compare, 0xFFFF);
+
+		if (result > untilTmr1)
+			result = untilTmr1;
+	}
+
+	if ((READ_REGISTER (tmr2Control) & hwrVZ328TmrControlEnable) != 0)
+	{
+		// Timer 2 only counts when its prescaler runs out.
+
+		uint32	untilTmr2 = 1;
+
+		if (fTmr2PrescaleCounter > 0)
+		{
+			untilTmr2 = (fTmr2PrescaleCounter + increment - 1) / increment;
+		}
+
+		if (result > untilTmr2)
+			result = untilTmr2;
+	}
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsVZ::AdvanceTimers
+// ---------------------------------------------------------------------------
+// Apply the given number of non-sleeping cycles, none of which may be one
+// that CyclesUntilTimerEvent would report.
+
+void EmRegsVZ::AdvanceTimers (uint32 cycles)
+{
+	if (cycles == 0)
+		return;
+
+	uint32	delta = cycles * increment;
+
+	if ((READ_REGISTER (tmr1Control) & hwrVZ328TmrControlEnable) != 0)
+	{
+		WRITE_REGISTER (tmr1Counter, READ_REGISTER (tmr1Counter) + delta);
+	}
+
+	if ((READ_REGISTER (tmr2Control) & hwrVZ328TmrControlEnable) != 0)
+	{
+		fTmr2PrescaleCounter -= delta;
+	}
+
+	fCycle += delta;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsVZ::StepTimers
+// ---------------------------------------------------------------------------
+// Update the timer registers for a single processor cycle.
 
+void EmRegsVZ::StepTimers (Bool sleeping)
+{
 	// ===== Handle Timer 1 =====
 
 	// Determine whether timer is enabled.
@@ -849,11 +1036,9 @@ void EmRegsVZ::Cycle (Bool sleeping)
 		// a prescaler counter.  Only when this counter reaches zero
 		// do we increment the timer counter.
 
-		static int prescaleCounter;
-
-		if ((prescaleCounter -= (sleeping ? (increment * 1024) : increment)) <= 0)
+		if ((fTmr2PrescaleCounter -= (sleeping ? (increment * 1024) : increment)) <= 0)
 		{
-			prescaleCounter = READ_REGISTER (tmr2Prescaler) * 1024;
+			fTmr2PrescaleCounter = READ_REGISTER (tmr2Prescaler) * 1024;
 
 			// If so, increment the timer.
 
@@ -925,8 +1110,6 @@ void EmRegsVZ::Cycle (Bool sleeping)
 
 void EmRegsVZ::CycleSlowly (Bool sleeping)
 {
-	UNUSED_PARAM(sleeping)
-
 	// See if a hard button is pressed.
 
 	EmAssert (gSession);
@@ -943,10 +1126,19 @@ void EmRegsVZ::CycleSlowly (Bool sleeping)
 		}
 	}
 
-	// See if there's anything new ("Put the data on the bus")
+	// See if there's anything new ("Put the data on the bus").  The
+	// transports ring the session's UART doorbell when bytes come in,
+	// so there's nothing to do here unless they have.
 
-	EmRegsVZ::UpdateUARTState (false, 0);
-	EmRegsVZ::UpdateUARTState (false, 1);
+	if (fUART[0]->NeedsUpdate (sleeping))
+	{
+		EmRegsVZ::UpdateUARTState (false, 0);
+	}
+
+	if (fUART[1]->NeedsUpdate (sleeping))
+	{
+		EmRegsVZ::UpdateUARTState (false, 1);
+	}
 
 	// Check to see if the RTC alarm is ready to go off.  First see
 	// if the RTC is enabled, and that the alarm event isn't already
@@ -965,7 +1157,7 @@ void EmRegsVZ::CycleSlowly (Bool sleeping)
 		long	nowHour;
 		long	nowMin;
 		long	nowSec;
-		::GetHostTime (&nowHour, &nowMin, &nowSec);
+		this->GetRTCTime (nowHour, nowMin, nowSec);
 		long	nowInSeconds = (nowHour * 60 * 60) + (nowMin * 60) + nowSec;
 
 		if (almInSeconds <= nowInSeconds)
@@ -994,8 +1186,12 @@ void EmRegsVZ::TurnSoundOff (void)
 
 void EmRegsVZ::ResetTimer (void)
 {
+	EmRegsVZ::SyncTimers ();
+
 	WRITE_REGISTER (tmr1Counter, 0);
 	WRITE_REGISTER (tmr2Counter, 0);
+
+	EmRegsVZ::ScheduleTimers ();
 }
 
 
@@ -1005,11 +1201,15 @@ void EmRegsVZ::ResetTimer (void)
 
 void EmRegsVZ::ResetRTC (void)
 {
+	EmRegsVZ::SyncTimers ();
+
 	fHour = 15;
 	fMin = 0;
 	fSec = 0;
 	fTick = 0;
 	fCycle = 0;
+
+	EmRegsVZ::ScheduleTimers ();
 }
 
 
@@ -1432,6 +1632,34 @@ Bool EmRegsVZ::GetAsleep (void)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmRegsVZ::GetSleepInterval
+// ---------------------------------------------------------------------------
+// Each sleeping cycle advances the timers by a tick, so if one's running,
+// come back in a tick (10 msecs).  The same goes for a UART with bytes
+// waiting in its TX FIFO.  Incoming bytes ring the UART doorbell, which
+// wakes us up, so there's no need to poll for them.  Otherwise, we only
+// need to check on the RTC alarm now and then.
+
+uint32 EmRegsVZ::GetSleepInterval (void)
+{
+	if ((READ_REGISTER (tmr1Control) & hwrVZ328TmrControlEnable) != 0 ||
+		(READ_REGISTER (tmr2Control) & hwrVZ328TmrControlEnable) != 0 ||
+		fUART[0]->IsTransmitting () ||
+		fUART[1]->IsTransmitting ())
+	{
+		return 10;
+	}
+
+	if ((READ_REGISTER (rtcIntEnable) & hwrVZ328RTCIntEnableAlarm) != 0)
+	{
+		return 100;
+	}
+
+	return 0;
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmRegsVZ::GetPortInputValue
 // ---------------------------------------------------------------------------
@@ -1604,6 +1832,8 @@ uint32 EmRegsVZ::portXDataRead (emuptr address, int)
 
 uint32 EmRegsVZ::tmr1StatusRead (emuptr address, int size)
 {
+	EmRegsVZ::SyncTimers ();
+
 	uint16	tmr1Counter = READ_REGISTER (tmr1Counter) + 16;
 	uint16	tmr1Compare = READ_REGISTER (tmr1Compare);
 	uint16	tmr1Control = READ_REGISTER (tmr1Control);
@@ -1633,6 +1863,8 @@ uint32 EmRegsVZ::tmr1StatusRead (emuptr address, int size)
 
 	fLastTmr1Status |= READ_REGISTER (tmr1Status);
 
+	EmRegsVZ::ScheduleTimers ();
+
 	// Finish up by doing a standard read.
 
 	return EmRegsVZ::StdRead (address, size);
@@ -1645,6 +1877,8 @@ uint32 EmRegsVZ::tmr1StatusRead (emuptr address, int size)
 
 uint32 EmRegsVZ::tmr2StatusRead (emuptr address, int size)
 {
+	EmRegsVZ::SyncTimers ();
+
 	uint16	tmr2Counter = READ_REGISTER (tmr2Counter) + 16;
 	uint16	tmr2Compare = READ_REGISTER (tmr2Compare);
 	uint16	tmr2Control = READ_REGISTER (tmr2Control);
@@ -1674,6 +1908,8 @@ uint32 EmRegsVZ::tmr2StatusRead (emuptr address, int size)
 
 	fLastTmr2Status |= READ_REGISTER (tmr2Status);
 
+	EmRegsVZ::ScheduleTimers ();
+
 	// Finish up by doing a standard read.
 
 	return EmRegsVZ::StdRead (address, size);
@@ -1721,17 +1957,37 @@ uint32 EmRegsVZ::uart2Read (emuptr address, int size)
 
 
 // ---------------------------------------------------------------------------
-//		 EmRegsVZ::rtcHourMinSecRead
+//		 EmRegsVZ::tmrCounterRead
 // ---------------------------------------------------------------------------
 
-uint32 EmRegsVZ::rtcHourMinSecRead (emuptr address, int size)
+uint32 EmRegsVZ::tmrCounterRead (emuptr address, int size)
 {
-	// Get the desktop machine's time.
+	// Bring the counter up to date.
 
-	long	hour, min, sec;
+	EmRegsVZ::SyncTimers ();
+
+	// Finish up by doing a standard read.
 
-	if (Hordes::IsOn ())
+	return EmRegsVZ::StdRead (address, size);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsVZ::GetRTCTime
+// ---------------------------------------------------------------------------
+// Return the time of day the RTC shows.  That's normally the desktop
+// machine's time.  While Gremlins are running or the session is headless,
+// it's the clock kept by StepTimers instead, which follows the emulated
+// cycle count so that runs can be repeated.
+
+void EmRegsVZ::GetRTCTime (long& hour, long& min, long& sec)
+{
+	EmAssert (gSession);
+
+	if (Hordes::IsOn () || gSession->IsHeadless ())
 	{
+		EmRegsVZ::SyncTimers ();
+
 		hour = fHour;
 		min = fMin;
 		sec = fSec;
@@ -1740,6 +1996,18 @@ uint32 EmRegsVZ::rtcHourMinSecRead (emuptr address, int size)
 	{
 		::GetHostTime (&hour, &min, &sec);
 	}
+}
+
+
+// ---------------------------------------------------------------------------
+//		 EmRegsVZ::rtcHourMinSecRead
+// ---------------------------------------------------------------------------
+
+uint32 EmRegsVZ::rtcHourMinSecRead (emuptr address, int size)
+{
+	long	hour, min, sec;
+
+	EmRegsVZ::GetRTCTime (hour, min, sec);
 
 	// Update the register.
 
@@ -2080,6 +2348,26 @@ void EmRegsVZ::tmr2StatusWrite (emuptr address, int size, uint32 value)
 }
 
 
+// ---------------------------------------------------------------------------
+//		 EmRegsVZ::tmrRegisterWrite
+// ---------------------------------------------------------------------------
+
+void EmRegsVZ::tmrRegisterWrite (emuptr address, int size, uint32 value)
+{
+	// Run the timers up to this point under the old settings.
+
+	EmRegsVZ::SyncTimers ();
+
+	// Do a standard update of the register.
+
+	EmRegsVZ::StdWrite (address, size, value);
+
+	// Figure out when the timers next need attention under the new ones.
+
+	EmRegsVZ::ScheduleTimers ();
+}
+
+
 // ---------------------------------------------------------------------------
 //		 EmRegsVZ::spiCont1Write
 // ---------------------------------------------------------------------------
@@ -66,6 +66,7 @@ class EmRegsVZ : public EmRegs, public EmHALHandler
 		virtual int32			GetSystemClockFrequency	(void);
 		virtual Bool			GetCanStop				(void);
 		virtual Bool			GetAsleep				(void);
+		virtual uint32			GetSleepInterval		(void);
 
 		virtual uint8			GetPortInputValue		(int);
 		virtual uint8			GetPortInternalValue	(int);
@@ -81,6 +82,7 @@ class EmRegsVZ : public EmRegs, public EmHALHandler
 		uint32					uart1Read				(emuptr address, int size);
 		uint32					uart2Read				(emuptr address, int size);
 		uint32					rtcHourMinSecRead		(emuptr address, int size);
+		uint32					tmrCounterRead			(emuptr address, int size);
 
 		void					csControl1Write			(emuptr address, int size, uint32 value);
 		void					csASelectWrite			(emuptr address, int size, uint32 value);
@@ -92,6 +94,7 @@ class EmRegsVZ : public EmRegs, public EmHALHandler
 		void					portDIntReqEnWrite		(emuptr address, int size, uint32 value);
 		void					tmr1StatusWrite			(emuptr address, int size, uint32 value);
 		void					tmr2StatusWrite			(emuptr address, int size, uint32 value);
+		void					tmrRegisterWrite		(emuptr address, int size, uint32 value);
 		void					spiCont1Write			(emuptr address, int size, uint32 value);
 		void					spiMasterControlWrite	(emuptr address, int size, uint32 value);
 		void					uart1Write				(emuptr address, int size, uint32 value);
@@ -108,6 +111,14 @@ class EmRegsVZ : public EmRegs, public EmHALHandler
 		virtual uint16			ButtonToBits			(SkinElementType);
 		virtual EmSPISlave*		GetSPISlave				(void);
 
+	private:
+		void					SyncTimers				(void);
+		void					GetRTCTime				(long& hour, long& min, long& sec);
+		void					ScheduleTimers			(void);
+		uint32					CyclesUntilTimerEvent	(void);
+		void					AdvanceTimers			(uint32 cycles);
+		void					StepTimers				(Bool sleeping);
+
 	protected:
 		void					UpdateInterrupts		(void);
 		void					UpdatePortDInterrupts	(void);
@@ -139,6 +150,9 @@ class EmRegsVZ : public EmRegs, public EmHALHandler
 		uint32					fTick;
 		uint32					fCycle;
 
+		uint32					fLastCycle;				// EmHAL::GetCycleCount at last SyncTimers
+		int32					fTmr2PrescaleCounter;
+
 		EmUARTDragonball*		fUART[2];
 };
 
@@ -104,6 +104,15 @@ void EmRegsVZHandEra330::Initialize(void)
     SD.Initialize();
 }
 
+void EmRegsVZHandEra330::Save (SessionFile& f)
+{
+    EmRegsVZ::Save(f);
+
+    // The SD card image lives outside the session file; just make sure
+    // it's up to date.
+    SD.Flush();
+}
+
 void EmRegsVZHandEra330::Dispose (void)
 {
     EmRegsVZ::Dispose();
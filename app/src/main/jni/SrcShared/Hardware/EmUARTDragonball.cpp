@@ -15,6 +15,7 @@
 #include "EmUARTDragonball.h"
 
 #include "EmHAL.h"				// EmHAL, EmUARTDeviceType
+#include "EmSession.h"			// gSession, GetUARTDoorbell
 #include "EmTransportSerial.h"	// EmTransportSerial
 #include "Logging.h"			// LogAppendMsg
 #include "Preferences.h"		// gEmuPrefs
@@ -59,6 +60,11 @@
 
 static const int	kMaxFifoSize	= 64;
 
+// The timer emulation counts four system clocks for each opcode that
+// EmHAL::Cycle counts.  Pace the transmitter the same way.
+
+static const uint32	kClocksPerCycle	= 4;
+
 static Bool			PrvPinBaud		(EmTransportSerial::Baud& newBaud);
 static Bool			PrvPinBaud		(EmTransportSerial::Baud& newBaud,
 									 EmTransportSerial::Baud testBaud);
@@ -85,7 +91,9 @@ EmUARTDragonball::EmUARTDragonball (UART_Type type, int uartNum) :
 	fUARTNum (uartNum),
 	fState (type),
 	fRxFIFO (this->PrvFIFOSize (true)),
-	fTxFIFO (this->PrvFIFOSize (false))
+	fTxFIFO (this->PrvFIFOSize (false)),
+	fLastDoorbell (0),
+	fTxReadyCycle (EmHAL::GetCycleCount ())
 {
 }
 
@@ -440,12 +448,14 @@ void EmUARTDragonball::UpdateState (State& state, Bool refreshRxData)
 {
 	EmAssert (fState.UART_TYPE == state.UART_TYPE);
 
-	// Update the RxFIFO if there's been any buffered data.
+	// Update the RxFIFO if there's been any buffered data, and send any
+	// bytes in the TxFIFO that the transmitter has gotten to.
 
 	EmTransport*	transport = this->GetTransport ();
 	if (transport)
 	{
 		this->ReceiveRxFIFO (transport);
+		this->TransmitTxFIFO (transport);
 	}
 
 	// === RX_FIFO_FULL ===
@@ -610,7 +620,11 @@ void EmUARTDragonball::UpdateState (State& state, Bool refreshRxData)
  *
  * FUNCTION:	EmUARTDragonball::TransmitTxFIFO
  *
- * DESCRIPTION:	Transmit any bytes in the TX FIFO out the serial port.
+ * DESCRIPTION:	Transmit any bytes in the TX FIFO out the serial port
+ *				that the transmitter has gotten to by now.  The
+ *				transmitter takes one byte per character time at the
+ *				current baud rate; if more are waiting, ask EmHAL to
+ *				cycle us when the next one is due.
  *				Assumes that the serial port is open.
  *
  * PARAMETERS:	None
@@ -629,14 +643,11 @@ void EmUARTDragonball::TransmitTxFIFO (EmTransport* transport)
 
 		ErrCode	err = errNone;
 		char	buffer[kMaxFifoSize];
-		long	spaceInTxFIFO = fTxFIFO.GetUsed ();
+		long	spaceInTxFIFO = this->PrvTxBytesDue (transport->SpaceInBuffer ());
 
 		if (spaceInTxFIFO > 0)
 		{
-			for (long ii = 0; ii < spaceInTxFIFO; ++ii)
-			{
-				buffer[ii] = fTxFIFO.Get ();
-			}
+			spaceInTxFIFO = fTxFIFO.Get (buffer, spaceInTxFIFO);
 
 			if (LogSerialData ())
 				LogAppendData (buffer, spaceInTxFIFO, "UART: Transmitted data:");
@@ -645,6 +656,20 @@ void EmUARTDragonball::TransmitTxFIFO (EmTransport* transport)
 
 			err = transport->Write (spaceInTxFIFO, buffer);
 		}
+
+		if (fTxFIFO.GetUsed () > 0)
+		{
+			// If the transport couldn't take everything that was due,
+			// the transmitter is already behind; try again in a
+			// character time.
+
+			uint32	now = EmHAL::GetCycleCount ();
+
+			if ((int32) (fTxReadyCycle - now) > 0)
+				EmHAL::ScheduleCycle (fTxReadyCycle - now);
+			else
+				EmHAL::ScheduleCycle (this->PrvCyclesPerChar ());
+		}
 	}
 }
 
@@ -700,19 +725,10 @@ void EmUARTDragonball::ReceiveRxFIFO (EmTransport* transport)
 		if (bytesToBuffer > 0 && (fState.RTS_CONT == 1 || fState.RTS == 1))
 		{
 			// If there are still bytes to be read, read them in and insert them
-			// into the RX FIFO.  If the buffer was previously empty, Hardware::Cycle
-			// will notice that there are now bytes in there and update the
-			// UART registers.
-			//
-			// !!! TBD: Hardware::Cycle is called after every opcode execution.
-			// Since it is very rare that serial bytes are coming in, the overhead
-			// incurred for checking to see if there are serial bytes does not pay
-			// off.  We may want to figure out a way to update the UART registers
-			// here, and take the check out of Hardware::Cycle.  I'd do that here,
-			// but (a) Hardware::Cycle takes a "sleeping" parameter that I'd have
-			// to determine here, and (b) the similar solution on Windows is more
-			// difficult, as I'd have to stop the CPU thread, update the registers,
-			// and restart the thread.
+			// into the RX FIFO.  We get here when the UART registers are
+			// accessed, or when the transport has rung the session's UART
+			// doorbell (see NeedsUpdate), so there's no polling for bytes
+			// that aren't there.
 
 			err = transport->Read (bytesToBuffer, buffer);
 
@@ -724,16 +740,104 @@ void EmUARTDragonball::ReceiveRxFIFO (EmTransport* transport)
 				else
 					PRINTF ("UART: Received %ld serial bytes.", bytesToBuffer);
 
-				for (long ii = 0; ii < bytesToBuffer; ++ii)
-				{
-					fRxFIFO.Put (buffer[ii]);
-				}	// end loop that puts bytes into FIFO
+				fRxFIFO.Put (buffer, bytesToBuffer);
 			}	// end no-error-from-EmTransport::Read
 		}	// end BytesInBuffer-returned-non-zero
 	}	// end is-serial-port-open
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	EmUARTDragonball::NeedsUpdate
+ *
+ * DESCRIPTION:	Determine whether the UART state needs to be brought up
+ *				to date with UpdateState.  Called from the hardware's
+ *				Cycle and CycleSlowly methods, so it needs to be cheap
+ *				when there's no serial activity.
+ *
+ * PARAMETERS:	sleeping - true if the processor is sleeping.  A
+ *					sleeping cycle stands for a whole tick, so the
+ *					transmitter is allowed to catch up on the TX FIFO.
+ *
+ * RETURNED:	True if bytes have arrived since we last looked, or if
+ *				the next byte in the TX FIFO is due to go out.
+ *
+ ***********************************************************************/
+
+Bool EmUARTDragonball::NeedsUpdate (Bool sleeping)
+{
+	Bool	result = false;
+
+	// See if the transport has received anything.
+
+	EmAssert (gSession);
+	uint32	doorbell = gSession->GetUARTDoorbell ();
+
+	if (doorbell != fLastDoorbell)
+	{
+		fLastDoorbell = doorbell;
+		result = true;
+	}
+
+	// See if the transmitter is ready for another byte.
+
+	uint32	now		= EmHAL::GetCycleCount ();
+	long	used	= fTxFIFO.GetUsed ();
+
+	if (used == 0)
+	{
+		// Keep an idle transmitter's clock from falling so far behind
+		// that the comparison below wraps around.
+
+		if ((int32) (now - fTxReadyCycle) > 0)
+		{
+			fTxReadyCycle = now;
+		}
+	}
+	else
+	{
+		if (sleeping)
+		{
+			fTxReadyCycle = now - used * this->PrvCyclesPerChar ();
+		}
+
+		if ((int32) (now - fTxReadyCycle) >= 0)
+		{
+			result = true;
+		}
+		else
+		{
+			// Not yet.  EmHAL::Cycle forgets our deadline when it calls
+			// the handlers, so ask for it again.
+
+			EmHAL::ScheduleCycle (fTxReadyCycle - now);
+		}
+	}
+
+	return result;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EmUARTDragonball::IsTransmitting
+ *
+ * DESCRIPTION:	Determine whether there are bytes in the TX FIFO waiting
+ *				for the transmitter.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	True if the TX FIFO is not empty.
+ *
+ ***********************************************************************/
+
+Bool EmUARTDragonball::IsTransmitting (void)
+{
+	return fTxFIFO.GetUsed () > 0;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	EmUARTDragonball::GetTransport
@@ -861,6 +965,96 @@ int EmUARTDragonball::PrvLevelMarker (Bool forRX)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	EmUARTDragonball::PrvCyclesPerChar
+ *
+ * DESCRIPTION:	Return how many EmHAL cycles it takes to send one
+ *				character with the current settings.  The baud rate
+ *				generator gives a bit every (65 - PRESCALER) * 2^DIVIDE
+ *				* 16 system clocks (see StateChanged), and a character
+ *				is a start bit, 7 or 8 data bits, an optional parity
+ *				bit, and 1 or 2 stop bits.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	The number of cycles; never zero.
+ *
+ ***********************************************************************/
+
+uint32 EmUARTDragonball::PrvCyclesPerChar (void)
+{
+	uint32	clocksPerBit	= (65 - fState.PRESCALER) * (1 << fState.DIVIDE) * 16;
+	uint32	bitsPerChar		= 1 + (fState.CHAR8_7 ? 8 : 7) +
+							  (fState.PARITY_EN ? 1 : 0) + (fState.STOP_BITS ? 2 : 1);
+	uint32	result			= clocksPerBit * bitsPerChar / kClocksPerCycle;
+
+	return result > 0 ? result : 1;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EmUARTDragonball::PrvTxBytesDue
+ *
+ * DESCRIPTION:	Return how many bytes at the front of the TX FIFO the
+ *				transmitter has gotten to by now, and move the time
+ *				at which it's ready for the next one past them.  An
+ *				idle transmitter takes its first byte right away.
+ *
+ *				No more than maxBytes are taken.  Any others that are
+ *				due stay in the FIFO, and are due right away next
+ *				time; so a transport that fills up holds the
+ *				transmitter back rather than losing bytes.
+ *
+ * PARAMETERS:	maxBytes - the most bytes the transport can take.
+ *
+ * RETURNED:	The number of bytes to send.
+ *
+ ***********************************************************************/
+
+long EmUARTDragonball::PrvTxBytesDue (long maxBytes)
+{
+	uint32	now		= EmHAL::GetCycleCount ();
+	long	used	= fTxFIFO.GetUsed ();
+
+	if (used == 0 || maxBytes <= 0 || (int32) (now - fTxReadyCycle) < 0)
+	{
+		return 0;
+	}
+
+	uint32	perChar	= this->PrvCyclesPerChar ();
+
+	// However long the transport has held us back, no more than a FIFO's
+	// worth of bytes can be overdue.  Don't let the clock fall so far
+	// behind that the comparison above wraps around.
+
+	if (now - fTxReadyCycle > used * perChar)
+	{
+		fTxReadyCycle = now - used * perChar;
+	}
+
+	uint32	due		= (now - fTxReadyCycle) / perChar + 1;
+
+	if (due > (uint32) used && used <= maxBytes)
+	{
+		// The FIFO runs dry before now.  Say that the last byte went
+		// into the shift register just now.
+
+		fTxReadyCycle = now + perChar;
+		return used;
+	}
+
+	if (due > (uint32) maxBytes)
+	{
+		due = maxBytes;
+	}
+
+	fTxReadyCycle += due * perChar;
+	return (long) due;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	PrvPinBaud
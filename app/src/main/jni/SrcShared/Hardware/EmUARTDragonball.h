@@ -14,7 +14,7 @@
 #ifndef EmUARTDragonball_h
 #define EmUARTDragonball_h
 
-#include "EmThreadSafeQueue.h"	// EmByteQueue
+#include "EmByteRing.h"			// EmByteRing
 
 class EmTransport;
 class SessionFile;
@@ -133,17 +133,29 @@ class EmUARTDragonball
 		void					TransmitTxFIFO		(EmTransport*);
 		void					ReceiveRxFIFO		(EmTransport*);
 
+		// Called from the hardware's Cycle and CycleSlowly.  Returns true
+		// if UpdateState needs to be called: the transports have rung the
+		// session's UART doorbell, or the next byte in the TX FIFO is due
+		// to go out.
+
+		Bool					NeedsUpdate			(Bool sleeping);
+		Bool					IsTransmitting		(void);
+
 		EmTransport*			GetTransport		(void);
 
 	private:
 		int						PrvFIFOSize			(Bool forRX);
 		int						PrvLevelMarker		(Bool forRX);
+		uint32					PrvCyclesPerChar	(void);
+		long					PrvTxBytesDue		(long maxBytes);
 
 	private:
 		int						fUARTNum;
 		State					fState;
-		EmByteQueue				fRxFIFO;
-		EmByteQueue				fTxFIFO;
+		EmByteRing				fRxFIFO;
+		EmByteRing				fTxFIFO;
+		uint32					fLastDoorbell;
+		uint32					fTxReadyCycle;		// When the transmitter can take the next byte.
 };
 
 #endif /* EmUARTDragonball_h */
@@ -32,6 +32,7 @@ class EmRegsCFAta
 		void			Initialize(EmDiskTypeID DiskTypeID);
 		void			Reset					(void);
 		void			Dispose					(void);
+		void			Flush					(void);
         void			ReadByte(uint32 offset, uint8 * val);
         void			WriteByte(uint32 offset, uint8 val);
         void			ReadWord(uint32 offset, _Word * val);
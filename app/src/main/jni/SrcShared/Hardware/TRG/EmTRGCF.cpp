@@ -74,6 +74,9 @@ void EmRegsCFMemCard::Reset (Bool /*hardwareReset*/)
 // ---------------------------------------------------------------------------
 void EmRegsCFMemCard::Save (SessionFile& /*f*/)
 {
+     // The card image lives outside the session file; just make sure
+     // it's up to date.
+     Ata.Flush();
 }
 
 
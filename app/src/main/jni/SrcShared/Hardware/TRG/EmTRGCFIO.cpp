@@ -73,6 +73,14 @@ void EmCFIO::Dispose (void)
     DiskIO.Dispose();
 }
 
+// ---------------------------------------------------------------------------
+//		 EmCFIO::Flush
+// ---------------------------------------------------------------------------
+void EmCFIO::Flush (void)
+{
+    DiskIO.Flush();
+}
+
 
 // ---------------------------------------------------------------------------
 //		 EmCFIO::ReadSector
@@ -179,6 +187,7 @@ void EmCFIO::StartRead(DiskIOParams * params)
 	State.NumSectorsCompleted = 0;
 	State.SectorIndex    = 0;
 	State.Error  = 0;
+	DiskIO.ReadAhead(State.Lba, State.NumSectorsRequested);
 	State.Status = ReadSector();
 }
 
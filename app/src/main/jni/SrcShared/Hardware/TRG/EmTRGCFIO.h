@@ -64,6 +64,7 @@ public:
 	void			Initialize(EmDiskTypeID DiskTypeID);
 	void			Dispose(void);
 	void            Reset(void);
+	void			Flush(void);
 	void			StartDriveID(void);
 	void			ReadNextDataByte(uint8 * val);
 	void			WriteNextDataByte(uint8 val);
@@ -18,6 +18,7 @@
  * This class handles the generic low level disk access.
  ************************************************************************/
 #include <stdio.h>
+#include <string.h>
 
 #include "EmCommon.h"
 #include "EmTRGDiskIO.h"
@@ -31,11 +32,16 @@
 EmTRGDiskIO::EmTRGDiskIO()
 {
     m_driveNo = UNKNOWN_DRIVE;
+    m_fp = NULL;
+    m_numSectors = 0;
+    m_lastSector = (uint32) -1;
+    Invalidate();
 }
 
 
 EmTRGDiskIO::~EmTRGDiskIO()
 {
+    Dispose();
 }
 
 
@@ -63,6 +69,10 @@ int EmTRGDiskIO::Format(void)
     uint32    num, lba;
     FILE      *fp;
 
+    // Whatever we had open or cached belongs to the image being replaced.
+    Close();
+    Invalidate();
+
    	fp = fopen(GetFilePath(m_driveNo), "wb");
     if (fp == NULL)
         return -1;
@@ -84,52 +94,132 @@ int EmTRGDiskIO::Format(void)
         }
 	}
     delete buffer;
+    fclose(fp);
 
 	return 0;
 }
 
-int EmTRGDiskIO::Read(uint32 sectorNum, void *buffer)
+int EmTRGDiskIO::Open(void)
 {
-    FILE *fp;
+    if (m_fp == NULL)
+        m_fp = fopen(GetFilePath(m_driveNo), "r+b");
 
-    if ((fp = fopen(GetFilePath(m_driveNo), "rb")) == NULL)
-        return -1;
+    return (m_fp == NULL) ? -1 : 0;
+}
 
-    if (fseek(fp, sectorNum * SECTOR_SIZE, SEEK_SET) == -1)
+void EmTRGDiskIO::Close(void)
+{
+    if (m_fp != NULL)
     {
-        fclose(fp);
-        return -1;
+        fclose(m_fp);
+        m_fp = NULL;
     }
+}
 
-    if (fread(buffer, SECTOR_SIZE, 1, fp) != 1)
+void EmTRGDiskIO::Invalidate(void)
+{
+    for (int i=0; i<CACHE_SECTORS; i++)
     {
-        fclose(fp);
+        m_cache[i].valid = false;
+        m_cache[i].dirty = false;
+    }
+}
+
+// Read up to count sectors starting at sectorNum into the cache with a
+// single fread.  Sectors already cached are left alone, as they may
+// hold data not yet written back.
+int EmTRGDiskIO::Fill(uint32 sectorNum, uint32 count)
+{
+    EmSectorCacheLine *line;
+    size_t             num, i;
+
+    if (Open() != 0)
+        return -1;
+
+    if (count > READ_AHEAD_SECTORS)
+        count = READ_AHEAD_SECTORS;
+
+    // Don't read ahead past the end of the disk.
+    if (sectorNum < m_numSectors && sectorNum + count > m_numSectors)
+        count = m_numSectors - sectorNum;
+
+    if (fseek(m_fp, sectorNum * SECTOR_SIZE, SEEK_SET) == -1)
+        return -1;
+
+    if ((num = fread(m_readAhead, SECTOR_SIZE, count, m_fp)) == 0)
         return -1;
+
+    for (i=0; i<num; i++)
+    {
+        line = &m_cache[(sectorNum + i) % CACHE_SECTORS];
+        if (line->valid && line->sectorNum == sectorNum + i)
+            continue;
+
+        if (line->valid && line->dirty && WriteBack(line) != 0)
+            return -1;
+
+        memcpy(&line->data, &m_readAhead[i], SECTOR_SIZE);
+        line->sectorNum = sectorNum + i;
+        line->valid = true;
+        line->dirty = false;
     }
-    fclose(fp);
 
     return 0;
 }
 
-int EmTRGDiskIO::Write(uint32 sectorNum, void *buffer)
+int EmTRGDiskIO::WriteBack(EmSectorCacheLine *line)
 {
-    FILE *fp;
+    if (Open() != 0)
+        return -1;
 
-    if ((fp = fopen(GetFilePath(m_driveNo), "r+b")) == NULL)
+    if (fseek(m_fp, line->sectorNum * SECTOR_SIZE, SEEK_SET) == -1)
         return -1;
 
-    if (fseek(fp, sectorNum * SECTOR_SIZE, SEEK_SET) == -1)
-    {
-        fclose(fp);
+    if (fwrite(&line->data, SECTOR_SIZE, 1, m_fp) != 1)
         return -1;
-    }
 
-    if (fwrite(buffer, SECTOR_SIZE, 1, fp) != 1)
+    line->dirty = false;
+
+    return 0;
+}
+
+int EmTRGDiskIO::Read(uint32 sectorNum, void *buffer)
+{
+    EmSectorCacheLine *line = &m_cache[sectorNum % CACHE_SECTORS];
+
+    if (!line->valid || line->sectorNum != sectorNum)
     {
-        fclose(fp);
+        // Reading the sector after the last one we read means someone
+        // is walking the disk, so grab the next few while we're there.
+        uint32 count = (sectorNum == m_lastSector + 1) ? READ_AHEAD_SECTORS : 1;
+
+        if (Fill(sectorNum, count) != 0)
+            return -1;
+    }
+
+    memcpy(buffer, &line->data, SECTOR_SIZE);
+    m_lastSector = sectorNum;
+
+    return 0;
+}
+
+int EmTRGDiskIO::Write(uint32 sectorNum, void *buffer)
+{
+    EmSectorCacheLine *line = &m_cache[sectorNum % CACHE_SECTORS];
+
+    if (Open() != 0)
         return -1;
+
+    if (line->valid && line->sectorNum != sectorNum && line->dirty)
+    {
+        if (WriteBack(line) != 0)
+            return -1;
     }
-    fclose(fp);
+
+    memcpy(&line->data, buffer, SECTOR_SIZE);
+    line->sectorNum = sectorNum;
+    line->valid = true;
+    line->dirty = true;
 
     return 0;
 }
@@ -137,12 +227,45 @@ int EmTRGDiskIO::Write(uint32 sectorNum, void *buffer)
 
 void EmTRGDiskIO::Initialize(EmDiskTypeID DiskTypeID, int driveNo)
 {
+    Dispose();
+
     m_diskTypeID = DiskTypeID;
     m_driveNo = driveNo;
+    m_numSectors = m_currDisk.GetNumSectors(m_diskTypeID);
+    m_lastSector = (uint32) -1;
 }
 
 void EmTRGDiskIO::Dispose(void)
 {
+    Flush();
+    Close();
+    Invalidate();
+}
+
+// Write every dirty sector out to the image.
+int EmTRGDiskIO::Flush(void)
+{
+    int retval = 0;
+
+    for (int i=0; i<CACHE_SECTORS; i++)
+    {
+        if (m_cache[i].valid && m_cache[i].dirty && WriteBack(&m_cache[i]) != 0)
+            retval = -1;
+    }
+
+    if (m_fp != NULL && fflush(m_fp) != 0)
+        retval = -1;
+
+    return retval;
+}
+
+// Called at the start of a multi-sector read so that the whole run
+// comes in with one fread (per READ_AHEAD_SECTORS).  A failure here is
+// left for ReadSector to deal with.
+void EmTRGDiskIO::ReadAhead(uint32 sectorNum, uint32 count)
+{
+    if (count > 1)
+        Fill(sectorNum, count);
 }
 
 int EmTRGDiskIO::ReadSector(uint32 sectorNum, void *buffer)
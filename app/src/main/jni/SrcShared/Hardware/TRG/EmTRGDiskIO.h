@@ -20,12 +20,29 @@
 #include "EmTRGCFDefs.h"
 #include "EmTRGDiskType.h"
 
+#include <stdio.h>				// FILE
+
 #define UNKNOWN_DRIVE 0
 #define CF_DRIVE  1
 #define SD_DRIVE  2
 
 #define SECTOR_SIZE 512
 
+// The disk image is kept open for the life of the drive, and sectors go
+// through a direct-mapped write-back cache.  Dirty sectors reach the
+// image when they are evicted or on Flush (called on session save and
+// on Dispose).  Sequential reads fill the cache READ_AHEAD_SECTORS at
+// a time.
+#define CACHE_SECTORS       64
+#define READ_AHEAD_SECTORS  16
+
+typedef struct {
+    uint32      sectorNum;
+    bool        valid;
+    bool        dirty;
+    EmSector    data;
+} EmSectorCacheLine;
+
 class EmTRGDiskIO 
 {
 private:
@@ -33,9 +50,21 @@ private:
     EmDiskTypeID    m_diskTypeID;
 	EmCurrDiskType	m_currDisk;
 
+    FILE           *m_fp;
+    uint32          m_numSectors;
+    uint32          m_lastSector;
+    EmSectorCacheLine m_cache[CACHE_SECTORS];
+    EmSector        m_readAhead[READ_AHEAD_SECTORS];
+
     int     Format(void);
     char   *GetFilePath(int driveNo);
 
+    int     Open(void);
+    void    Close(void);
+    void    Invalidate(void);
+    int     Fill(uint32 sectorNum, uint32 count);
+    int     WriteBack(EmSectorCacheLine *line);
+
     int     Read(uint32 sectorNum, void *buffer);
     int     Write(uint32 sectorNum, void *buffer);
 
@@ -48,6 +77,9 @@ public:
 
     int  ReadSector(uint32 sectorNum, void *buffer);
     int  WriteSector(uint32 sectorNum, void *buffer);
+
+    void ReadAhead(uint32 sectorNum, uint32 count);
+    int  Flush(void);
 };
 
 #endif	/* EmTRGDiskIO_h */
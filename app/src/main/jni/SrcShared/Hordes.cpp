@@ -25,17 +25,18 @@
 #include "EmStreamFile.h"		// kCreateOrOpenForWrite
 #include "ErrorHandling.h"		// Errors::ThrowIfPalmError
 #include "Logging.h"			// LogStartNew, etc.
-#include "Platform.h"			// Platform::GetMilliseconds
+#include "Platform.h"			// Platform::GetMilliseconds, StartHordeWorker
 #include "PreferenceMgr.h"		// Preference, gEmuPrefs
 #include "ROMStubs.h"			// EvtWakeup
 #include "SessionFile.h"		// Chunk, EmStreamChunk
-#include "Startup.h"			// HordeQuitWhenDone
+#include "Startup.h"			// HordeQuitWhenDone, HordeWorker
 #include "StringConversions.h"	// ToString, FromString;
 #include "Strings.r.h"			// kStr_CmdOpen, etc.
 #include "SystemMgr.h"			// sysGetROMVerMajor
 
 #include <math.h>				// sqrt
 #include <time.h>				// time, localtime
+#include <unistd.h>				// sysconf
 /* Update for GCC 4 */
 #include <string.h>
 
@@ -67,6 +68,16 @@ static	EmDirRef	gHomeForHordesFiles;
 static Bool			gForceNewHordesDirectory;
 static EmDirRef		gGremlinDir;
 
+// A Horde can be split across several processes, each running every
+// gWorkerCount'th Gremlin starting at gGremlinStartNumber + gWorkerIndex.
+// Worker #0 is the original process; it starts the others, and keeps
+// their IDs and the directories they leave their results in.
+
+static int32		gWorkerIndex;
+static int32		gWorkerCount = 1;
+static vector<long>		gWorkerIDs;
+static vector<EmDirRef>	gWorkerDirs;
+
 Bool				gWarningHappened;
 Bool				gErrorHappened;
 
@@ -175,6 +186,7 @@ void Hordes::Load (SessionFile& f)
 
 void Hordes::Dispose (void)
 {
+	Hordes::StopWorkers ();
 	gTheGremlin.Reset ();
 }
 
@@ -209,6 +221,23 @@ Hordes::New(const HordeInfo& info)
 	gCurrentDepth			= 0;
 	gCurrentGremlin			= gGremlinStartNumber;
 
+	// If another process started us to run part of its Horde (see
+	// StartWorkers), we start at the Gremlin for our worker number.
+
+	long		workerIndex;
+	long		workerCount;
+	EmDirRef	workerDir;
+
+	gWorkerIndex	= 0;
+	gWorkerCount	= 1;
+
+	if (Startup::HordeWorker (workerIndex, workerCount, workerDir))
+	{
+		gWorkerIndex	= workerIndex;
+		gWorkerCount	= workerCount;
+		gCurrentGremlin	= gGremlinStartNumber + gWorkerIndex;
+	}
+
 	if (gSwitchDepth == 0)
 		gSwitchDepth = -1;
 
@@ -236,7 +265,17 @@ Hordes::New(const HordeInfo& info)
 
 	EmDlg::GremlinControlOpen ();
 
-	Hordes::UseNewAutoSaveDirectory ();
+	// A worker keeps its files in the directory it was given.
+
+	if (gWorkerIndex != 0)
+	{
+		gForceNewHordesDirectory	= false;
+		gGremlinDir					= workerDir;
+	}
+	else
+	{
+		Hordes::UseNewAutoSaveDirectory ();
+	}
 
 	EmEventPlayback::Clear ();
 
@@ -252,6 +291,16 @@ Hordes::New(const HordeInfo& info)
 
 	Hordes::StartLog ();
 
+	if (gWorkerIndex != 0)
+	{
+		LogAppendMsg ("Gremlin worker #%ld of %ld running every %ldth Gremlin from #%ld",
+			gWorkerIndex, gWorkerCount, gWorkerCount, gCurrentGremlin);
+	}
+	else
+	{
+		Hordes::StartWorkers ();
+	}
+
 	LogAppendMsg ("New Gremlin #%ld started anew to %ld events",
 					gremInfo.fNumber, gremInfo.fSteps);
 
@@ -547,6 +596,30 @@ Hordes::EndHordes (void)
 
 	Hordes::TurnOn (true);
 
+	// A worker process leaves its share of the results where worker #0
+	// can find them, and quits.
+
+	if (gWorkerIndex != 0)
+	{
+		Hordes::SaveWorkerResults ();
+
+		LogAppendMsg ("*************   Gremlin worker #%ld done", gWorkerIndex);
+		LogDump ();
+
+		Hordes::TurnOn (false);
+
+		LogClear ();
+		EmEventPlayback::Clear ();
+
+		EmAssert (gSession);
+		gSession->DiscardSnapshot ();
+
+		EmAssert (gApplication);
+		gApplication->ScheduleQuit ();
+
+		return;
+	}
+
 	if (!Hordes::InSingleGremlinMode ())
 	{
 		LogAppendMsg ("*************   Gremlin Horde ended at Gremlin #%ld\n", gGremlinStopNumber);
@@ -589,7 +662,10 @@ Hordes::EndHordes (void)
 	LogAppendMsg ("RAM size:                %d KB\n", (long) ramSize);
 
 	// Let's come up with some statistics from our new field in 
-	// gGremlinHaltedInError.
+	// gGremlinHaltedInError.  Collect the entries filled in by any
+	// worker processes first.
+
+	Hordes::MergeWorkerResults ();
 
 	int32 min, max, avg, stdDev, smallErrorIndex;
 	Hordes::ComputeStatistics (min, max, avg, stdDev, smallErrorIndex);
@@ -622,6 +698,12 @@ Hordes::EndHordes (void)
 	LogClear();
 	EmEventPlayback::Clear ();
 
+	// Nothing restores the root state after this but the reload below,
+	// and that can come from the root state file.
+
+	EmAssert (gSession);
+	gSession->DiscardSnapshot ();
+
 	if (!Hordes::InSingleGremlinMode ())
 	{
 		EmDlg::GremlinControlClose ();
@@ -643,6 +725,279 @@ Hordes::EndHordes (void)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	Hordes::StartWorkers
+ *
+ * DESCRIPTION: Splits the Horde across worker processes, if asked to
+ *				with -horde_workers.  Called once the root state has
+ *				been saved: each worker is a copy of the emulator with
+ *				no UI that opens the root state file and runs every
+ *				Nth Gremlin of the Horde on a core of its own.  This
+ *				process is worker #0.
+ *
+ * PARAMETERS:	none
+ *
+ * RETURNED:	none
+ *
+ ***********************************************************************/
+
+void
+Hordes::StartWorkers (void)
+{
+	Hordes::StopWorkers ();
+
+	gWorkerIndex	= 0;
+	gWorkerCount	= 1;
+
+	long	workers = Startup::HordeWorkers ();
+
+	if (workers <= 0)
+	{
+		workers = sysconf (_SC_NPROCESSORS_ONLN);
+	}
+
+	workers = min (workers, (long) (gGremlinStopNumber - gGremlinStartNumber + 1));
+
+	if (workers <= 1)
+		return;
+
+	// Give the workers the same Horde we were given, less the options
+	// that only the user interface needs.  Switch and maximum depths
+	// of zero mean "none", as -1 does here.
+
+	EmFileRef	rootFile = Hordes::SuggestFileRef (kHordeRootFile);
+	string		appNames;
+
+	DatabaseInfoList::iterator	appIter = gGremlinAppList.begin ();
+
+	while (appIter != gGremlinAppList.end ())
+	{
+		if (!appNames.empty ())
+			appNames += ',';
+
+		appNames += appIter->name;
+
+		++appIter;
+	}
+
+	for (int32 worker = 1; worker < workers; ++worker)
+	{
+		// Each worker keeps its log and other files in a directory of
+		// its own, under ours.
+
+		char	buffer[32];
+		sprintf (buffer, "Worker_%02ld", (long) worker);
+
+		EmDirRef	workerDir (Hordes::GetGremlinDirectory (), buffer);
+
+		try
+		{
+			if (!workerDir.Exists ())
+				workerDir.Create ();
+		}
+		catch (...)
+		{
+			break;
+		}
+
+		StringList	options;
+
+		options.push_back ("-psf");
+		options.push_back (rootFile.GetFullPath ());
+		options.push_back ("-horde_first");
+		options.push_back (::ToString (gGremlinStartNumber));
+		options.push_back ("-horde_last");
+		options.push_back (::ToString (gGremlinStopNumber));
+		options.push_back ("-horde_depth_switch");
+		options.push_back (::ToString (gSwitchDepth == -1 ? 0 : gSwitchDepth));
+		options.push_back ("-horde_depth_max");
+		options.push_back (::ToString (gMaxDepth == -1 ? 0 : gMaxDepth));
+		options.push_back ("-horde_save_freq");
+		options.push_back (::ToString (gGremlinSaveFrequency));
+
+		if (!appNames.empty ())
+		{
+			options.push_back ("-horde_apps");
+			options.push_back (appNames);
+		}
+
+		sprintf (buffer, "%ld,%ld", (long) worker, workers);
+
+		options.push_back ("-horde_quit_when_done");
+		options.push_back ("-horde_worker");
+		options.push_back (buffer);
+		options.push_back ("-horde_worker_dir");
+		options.push_back (workerDir.GetFullPath ());
+
+		long	workerID = Platform::StartHordeWorker (options);
+
+		if (workerID < 0)
+			break;
+
+		gWorkerIDs.push_back (workerID);
+		gWorkerDirs.push_back (workerDir);
+	}
+
+	// The workers that did start all think there are "workers" of them.
+	// If we couldn't start them all, call them off and go it alone.
+
+	if ((long) gWorkerIDs.size () + 1 != workers)
+	{
+		LogAppendMsg ("Unable to start %ld Gremlin workers; running the Horde in one process", workers);
+
+		Hordes::StopWorkers ();
+		return;
+	}
+
+	gWorkerCount = workers;
+
+	LogAppendMsg ("Gremlin Horde split across %ld worker processes", gWorkerCount);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	Hordes::StopWorkers
+ *
+ * DESCRIPTION: Kills any worker processes that are still running, as
+ *				when the session is closed in the middle of a Horde.
+ *
+ * PARAMETERS:	none
+ *
+ * RETURNED:	none
+ *
+ ***********************************************************************/
+
+void
+Hordes::StopWorkers (void)
+{
+	vector<long>::iterator	iter = gWorkerIDs.begin ();
+
+	while (iter != gWorkerIDs.end ())
+	{
+		Platform::KillHordeWorker (*iter);
+
+		++iter;
+	}
+
+	gWorkerIDs.clear ();
+	gWorkerDirs.clear ();
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	Hordes::SaveWorkerResults
+ *
+ * DESCRIPTION: Writes the gGremlinHaltedInError entries for the Gremlins
+ *				this worker ran to its results file.
+ *
+ * PARAMETERS:	none
+ *
+ * RETURNED:	none
+ *
+ ***********************************************************************/
+
+void
+Hordes::SaveWorkerResults (void)
+{
+	StringStringMap	results;
+
+	for (int32 counter = gGremlinStartNumber + gWorkerIndex;
+		 counter <= gGremlinStopNumber;
+		 counter += gWorkerCount)
+	{
+		const EmGremlinThreadInfo&	info = gGremlinHaltedInError[counter];
+
+		char	buffer[64];
+		sprintf (buffer, "%d %ld %ld", info.fHalted ? 1 : 0,
+			(long) info.fErrorEvent, (long) info.fMessageID);
+
+		results[::ToString (counter)] = buffer;
+	}
+
+	EmFileRef	resultsFile = Hordes::SuggestFileRef (kHordeWorkerResultsFile, gWorkerIndex);
+
+	EmMapFile::Write (resultsFile, results);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	Hordes::MergeWorkerResults
+ *
+ * DESCRIPTION: Waits for the worker processes to finish, and copies the
+ *				gGremlinHaltedInError entries they saved into ours, so
+ *				that the statistics cover the whole Horde.
+ *
+ * PARAMETERS:	none
+ *
+ * RETURNED:	none
+ *
+ ***********************************************************************/
+
+void
+Hordes::MergeWorkerResults (void)
+{
+	if (gWorkerIDs.empty ())
+		return;
+
+	LogAppendMsg ("*************   Waiting for %ld Gremlin workers", (long) gWorkerIDs.size ());
+	LogDump ();
+
+	for (size_t ii = 0; ii < gWorkerIDs.size (); ++ii)
+	{
+		int32	worker = ii + 1;
+
+		if (!Platform::WaitForHordeWorker (gWorkerIDs[ii]))
+		{
+			LogAppendMsg ("Gremlin worker #%ld did not finish; its Gremlins are not counted", worker);
+			continue;
+		}
+
+		EmFileRef		resultsFile (gWorkerDirs[ii],
+							Hordes::SuggestFileName (kHordeWorkerResultsFile, worker));
+		StringStringMap	results;
+
+		if (!EmMapFile::Read (resultsFile, results))
+		{
+			LogAppendMsg ("Gremlin worker #%ld left no results; its Gremlins are not counted", worker);
+			continue;
+		}
+
+		StringStringMap::iterator	iter = results.begin ();
+
+		while (iter != results.end ())
+		{
+			int32	counter;
+			int		halted;
+			long	errorEvent;
+			long	messageID;
+
+			if (::FromString (iter->first, counter) &&
+				counter >= gGremlinStartNumber && counter <= gGremlinStopNumber &&
+				sscanf (iter->second.c_str (), "%d %ld %ld", &halted, &errorEvent, &messageID) == 3)
+			{
+				gGremlinHaltedInError[counter].fHalted		= halted != 0;
+				gGremlinHaltedInError[counter].fErrorEvent	= errorEvent;
+				gGremlinHaltedInError[counter].fMessageID	= messageID;
+			}
+
+			++iter;
+		}
+
+		resultsFile.Delete ();
+	}
+
+	gWorkerIDs.clear ();
+	gWorkerDirs.clear ();
+
+	gWorkerIndex	= 0;
+	gWorkerCount	= 1;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	Hordes::ProposeNextGremlin
@@ -664,12 +1019,12 @@ void
 Hordes::ProposeNextGremlin (long& outNextGremlin, long& outNextDepth,
 							long inFromGremlin, long inFromDepth)
 {
-	outNextGremlin	= inFromGremlin + 1;
+	outNextGremlin	= inFromGremlin + gWorkerCount;
 	outNextDepth	= inFromDepth;
 
-	if (outNextGremlin == gGremlinStopNumber + 1)
+	if (outNextGremlin > gGremlinStopNumber)
 	{
-		outNextGremlin = gGremlinStartNumber;
+		outNextGremlin = gGremlinStartNumber + gWorkerIndex;
 
 		if (outNextDepth >= 0)
 			++outNextDepth;
@@ -786,9 +1141,14 @@ Hordes::SetGremlinStatePathFromControlFile (EmFileRef& controlFile)
 void
 Hordes::NextGremlin (void)
 {
-	Hordes::Stop ();
+	Hordes::StopGremlin ();
 
-	Hordes::SaveSearchProgress ();
+	// The progress file only describes a Horde run in one process.
+
+	if (gWorkerCount == 1)
+	{
+		Hordes::SaveSearchProgress ();
+	}
 
 	// Find the next Gremlin to run.
 
@@ -1101,6 +1461,35 @@ Hordes::Resume()
 
 void
 Hordes::Stop (void)
+{
+	Hordes::StopGremlin ();
+
+	// Let go of the in-memory copy of the root state.  If the Horde is
+	// resumed, LoadRootState falls back to the root state file.
+
+	if (gSession)
+	{
+		gSession->DiscardSnapshot ();
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	Hordes::StopGremlin
+ *
+ * DESCRIPTION: Stops the currently running Gremlin, leaving the rest
+ *				of the Horde alone.  Used between Gremlins, where
+ *				the root state is about to be needed again.
+ *
+ * PARAMETERS:	none
+ *
+ * RETURNED:	none
+ *
+ ***********************************************************************/
+
+void
+Hordes::StopGremlin (void)
 {
 	gStopTime = Platform::GetMilliseconds ();
 
@@ -1143,6 +1532,7 @@ string Hordes::SuggestFileName (HordeFileType category, uint32 num)
 	static const char kStrAutoSaveFile[]		= "Gremlin_%03ld_Event_%08ld.psf";
 	static const char kStrEventFile[]			= "Gremlin_%03ld_Events.pev";
 	static const char kStrMinimalEventFile []	= "Gremlin_%03ld_Interim_Event_File_%08ld.pev";
+	static const char kStrWorkerResultsFile[]	= "Gremlin_Worker_%02ld_Results.dat";
 
 	char fileName[64];
 
@@ -1197,6 +1587,11 @@ string Hordes::SuggestFileName (HordeFileType category, uint32 num)
 			sprintf (fileName, kStrMinimalEventFile, gremlinNumber, time);
 			break;
 
+		case kHordeWorkerResultsFile:
+
+			sprintf (fileName, kStrWorkerResultsFile, (long) num);
+			break;
+
 		default:
 
 			*fileName = '\0';
@@ -1545,8 +1940,13 @@ Hordes::AutoSaveState (void)
 {
 	EmFileRef	fileRef = Hordes::SuggestFileRef (kHordeAutoCurrentFile);
 
+	// Auto-saves are made every few events, and the RAM image makes up
+	// most of them.  Save just the pages changed since the root state (or
+	// last full auto-save).  They live in the same directory as the root
+	// state, so the base stays with them.
+
 	EmAssert (gSession);
-	gSession->Save (fileRef, false);
+	gSession->Save (fileRef, false, true);
 }
 
 
@@ -1577,6 +1977,11 @@ Hordes::SaveRootState (void)
 	EmAssert (gSession);
 	gSession->Save (fileRef, false);
 
+	// Every Gremlin in the horde starts from the root state, so keep a
+	// copy in memory for LoadRootState.
+
+	gSession->SaveSnapshot ();
+
 	Hordes::TurnOn (hordesWasOn);
 }
 
@@ -1636,7 +2041,33 @@ Hordes::LoadRootState (void)
 {
 	EmFileRef	fileRef = Hordes::SuggestFileRef (kHordeRootFile);
 
-	ErrCode		result = Hordes::LoadState (fileRef);
+	ErrCode		result = errNone;
+
+	// Use the copy SaveRootState kept in memory if we have it; it's much
+	// faster than going through the file.
+
+	EmAssert (gSession);
+
+	Bool	restored = false;
+
+	try
+	{
+		restored = gSession->RestoreSnapshot ();
+	}
+	catch (ErrCode errCode)
+	{
+		Hordes::TurnOn (false);
+
+		Errors::SetParameter ("%filename", fileRef.GetName ());
+		Errors::ReportIfError (kStr_CmdOpen, errCode, 0, true);
+
+		return errCode;
+	}
+
+	if (!restored)
+	{
+		result = Hordes::LoadState (fileRef);
+	}
 
 	if (result == 0)
 	{
@@ -1745,12 +2176,21 @@ Hordes::SaveEvents (void)
 	EmFileRef		rootRef = Hordes::SuggestFileRef (kHordeRootFile);
 	EmStreamFile	rootStream (rootRef, kOpenExistingForRead,
 						kFileCreatorEmulator, kFileTypeEvents);
+	ChunkFile		rootChunkFile (rootStream);
+
+	// Copy it chunk by chunk (rather than as a block of bytes) so that
+	// eventChunkFile knows about every chunk and can write a directory.
 
 	{
-		int32		length = rootStream.GetLength ();
-		ByteList	buffer (length);
-		rootStream.GetBytes (&buffer[0], length);
-		eventStream.PutBytes (&buffer[0], length);
+		int				index = 0;
+		ChunkFile::Tag	tag;
+		Chunk			chunk;
+
+		while (rootChunkFile.ReadChunk (index, tag, chunk))
+		{
+			eventChunkFile.WriteChunk (tag, chunk);
+			++index;
+		}
 	}
 
 	// Finally, write the events to the file.
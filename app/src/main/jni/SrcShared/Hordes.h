@@ -26,7 +26,8 @@ enum HordeFileType
 	kHordeSuspendFile		= 0x02,
 	kHordeEventFile			= 0x03,
 	kHordeMinimalEventFile	= 0x04,
-	kHordeAutoCurrentFile	= 0x05
+	kHordeAutoCurrentFile	= 0x05,
+	kHordeWorkerResultsFile	= 0x06
 };
 
 
@@ -138,6 +139,12 @@ class Hordes
 														 long inFromGremlin,
 														 long inFromDepth);
 		static void				EndHordes				(void);
+		static void				StopGremlin				(void);
+
+		static void				StartWorkers			(void);
+		static void				StopWorkers				(void);
+		static void				SaveWorkerResults		(void);
+		static void				MergeWorkerResults		(void);
 
 		static ErrCode			LoadState				(const EmFileRef& ref);
 
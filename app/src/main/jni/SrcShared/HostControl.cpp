@@ -26,7 +26,7 @@
 #include "EmExgMgr.h"			// EmExgMgr::GetExgMgr
 #include "EmFileImport.h"		// EmFileImport::LoadPalmFileList
 #include "EmFileRef.h"			// EmFileRefList
-#include "EmMemory.h"			// EmMem_strlen, EmMem_strcpy
+#include "EmMemory.h"			// EmMem_strlen, EmMem_strcpy, Memory::InvalidateFastPages
 #include "EmPalmStructs.h"		// EmAliasErr
 #include "EmPatchState.h"		// EmPatchState::UIInitialized
 #include "EmRPC.h"				// RPC::HandlingPacket, RPC::DeferCurrentPacket
@@ -3986,6 +3986,10 @@ static void _HostDbgSetDataBreak (void)
 	{
 		gDebuggerGlobals.watchAddr = addr;
 		gDebuggerGlobals.watchBytes = size;
+
+		// Writes need to go through the handlers for CheckStepSpy to see them.
+
+		Memory::InvalidateFastPages ();
 	}
 
 	// Return the result.
@@ -15,6 +15,7 @@
 #include "Logging.h"
 
 #include "EmApplication.h"		// gApplication, IsBound
+#include "EmByteRing.h"			// EmByteRing
 #include "EmMemory.h"			// EmMemGet32, EmMemGet16, EmMem_strcpy, EmMem_strncat
 #include "EmStreamFile.h"		// EmStreamFile
 #include "Hordes.h"				// Hordes::IsOn, Hordes::EventCounter
@@ -25,6 +26,7 @@
 #include "StringData.h"			// virtual key descriptions
 
 #include <ctype.h>				// isprint
+#include <string.h>				// memcpy
 #include <cstddef>
 
 //#define LOG_TO_TRACE
@@ -100,6 +102,74 @@ const long		kFindUniqueFile			= -1;
 const uint32	kInvalidTimestamp		= (uint32) -1;
 const int32		kInvalidGremlinCounter	= -2;
 const long		kEventTextMaxLen		= 255;
+const int		kPrintfMaxLen			= 2000;
+
+// Logging threads don't touch the text buffer themselves.  Each one
+// posts binary records -- the text it formatted, or the raw bytes for a
+// hex dump -- into a ring of its own, and a writer thread drains the
+// rings into LogStreamInner, merging them back into the order they were
+// logged in.  Threads that come along once all the rings are claimed
+// share one more ring behind fSharedMutex.
+
+const int		kLogRingCount			= 8;
+const long		kLogRingSize			= 64 * 1024L;
+const long		kLogRecordMaxData		= 4096;		// Multiple of 16 so that hex dumps split on line boundaries.
+
+enum
+{
+	kLogRecordHex		= 0x0001,		// Data is dumped as hex, not appended as text.
+	kLogRecordNewLine	= 0x0002		// Text ends the line (long text is split over several records).
+};
+
+struct LogRecord
+{
+	uint32		fSequence;
+	uint32		fTime;					// kInvalidTimestamp if the text isn't stamped.
+	int32		fEventCounter;			// kInvalidGremlinCounter if no Gremlin is running.
+	uint16		fFlags;
+	uint16		fSize;					// Number of data bytes following the record.
+};
+
+struct LogRing
+{
+				LogRing (void) :
+					fRing (kLogRingSize),
+					fOwned (0),
+					fHasPending (false)
+				{
+				}
+
+	EmByteRing	fRing;
+	uint32		fOwned;					// Non-zero while a thread is posting to it.
+
+	// The writer thread's lookahead for merging the rings.
+
+	Bool		fHasPending;
+	LogRecord	fPending;
+	uint8		fPendingData[kLogRecordMaxData];
+};
+
+
+static int32 PrvEventCounter (void)
+{
+	return Hordes::IsOn () ? Hordes::EventCounter () : kInvalidGremlinCounter;
+}
+
+
+static int PrvVSPrintf (char* buffer, const char* fmt, va_list args)
+{
+	int n = vsnprintf (buffer, kPrintfMaxLen, fmt, args);
+
+	// debug check, watch for buffer overflows here
+	if (n < 0 || n >= kPrintfMaxLen)
+	{
+		Platform::Debugger();
+
+		n = n < 0 ? 0 : kPrintfMaxLen - 1;
+	}
+
+	return n;
+}
 
 
 /***********************************************************************
@@ -121,8 +191,22 @@ const long		kEventTextMaxLen		= 255;
 
 LogStream::LogStream (const char* baseName) :
 	fMutex (),
-	fInner (baseName)
+	fWriterCondition (&fMutex),
+	fInner (baseName),
+	fRings (new LogRing[kLogRingCount + 1]),
+	fSharedMutex (),
+	fNextSequence (0),
+	fNextToEmit (0),
+	fWriterIdle (0),
+	fWriterThread (NULL),
+	fTimeToQuit (false)
 {
+	// A thread's ring is handed back when it exits.
+
+	pthread_key_create (&fRingKey, &LogStream::ReleaseRing);
+
+	fWriterThread = omni_thread::create (WriterThread, this);
+
 	gPrefs->AddNotification (PrefChanged, kPrefKeyLogFileSize, this);
 }
 
@@ -144,8 +228,25 @@ LogStream::~LogStream (void)
 {
 	gPrefs->RemoveNotification (PrefChanged);
 
-	omni_mutex_lock lock (fMutex);
-	fInner.DumpToFile ();
+	// Stop the writer thread and wait for it to quit.
+
+	fMutex.lock ();
+	fTimeToQuit = true;
+	fWriterCondition.signal ();
+	fMutex.unlock ();
+
+	fWriterThread->join (NULL);
+	fWriterThread = NULL;
+
+	pthread_key_delete (fRingKey);
+
+	{
+		omni_mutex_lock lock (fMutex);
+		this->Drain ();
+		fInner.DumpToFile ();
+	}
+
+	delete [] fRings;
 }
 
 
@@ -170,16 +271,16 @@ int LogStream::Printf (const char* fmt, ...)
 {
 	int		n;
 	va_list	arg;
-
-	omni_mutex_lock	lock (fMutex);
+	char	buffer[kPrintfMaxLen];
 
 	va_start (arg, fmt);
 
-	n = fInner.VPrintf (fmt, arg);
+	n = ::PrvVSPrintf (buffer, fmt, arg);
 
 	va_end (arg);
 
-//	fInner.DumpToFile ();
+	this->PostText (buffer, n, true);
+
 	return n;
 }
 
@@ -188,16 +289,16 @@ int LogStream::PrintfNoTime (const char* fmt, ...)
 {
 	int		n;
 	va_list	arg;
-
-	omni_mutex_lock	lock (fMutex);
+	char	buffer[kPrintfMaxLen];
 
 	va_start (arg, fmt);
 
-	n = fInner.VPrintf (fmt, arg, false);
+	n = ::PrvVSPrintf (buffer, fmt, arg);
 
 	va_end (arg);
 
-//	fInner.DumpToFile ();
+	this->PostText (buffer, n, false);
+
 	return n;
 }
 
@@ -226,18 +327,22 @@ int LogStream::PrintfNoTime (const char* fmt, ...)
 
 int LogStream::DataPrintf (const void* data, long dataLen, const char* fmt, ...)
 {
-	omni_mutex_lock	lock (fMutex);
-
 	int		n;
 	va_list	arg;
+	char	buffer[kPrintfMaxLen];
 
 	va_start (arg, fmt);
 
-	n = fInner.VPrintf (fmt, arg);
+	n = ::PrvVSPrintf (buffer, fmt, arg);
+
+	va_end (arg);
+
+	this->PostText (buffer, n, true);
 
-	// Dump the data nicely formatted
+	// Dump the data nicely formatted.  The writer thread does the
+	// formatting; all we hand it are the bytes.
 
-	n += fInner.DumpHex (data, dataLen);
+	this->PostData (data, dataLen);
 
 	return n;
 }
@@ -260,9 +365,12 @@ int LogStream::DataPrintf (const void* data, long dataLen, const char* fmt, ...)
 
 int LogStream::VPrintf (const char* fmt, va_list args)
 {
-	omni_mutex_lock	lock (fMutex);
+	char	buffer[kPrintfMaxLen];
+	int		n = ::PrvVSPrintf (buffer, fmt, args);
 
-	return fInner.VPrintf (fmt, args);
+	this->PostText (buffer, n, true);
+
+	return n;
 }
 
 
@@ -280,9 +388,9 @@ int LogStream::VPrintf (const char* fmt, va_list args)
 
 int LogStream::Write (const void* buffer, long size)
 {
-	omni_mutex_lock	lock (fMutex);
+	this->PostText (buffer, size, true);
 
-	return fInner.Write (buffer, size);
+	return size;
 }
 
 
@@ -302,6 +410,7 @@ void LogStream::Clear (void)
 {
 	omni_mutex_lock	lock (fMutex);
 
+	this->Drain ();
 	fInner.Clear ();
 }
 
@@ -344,6 +453,7 @@ void LogStream::SetLogSize (long size)
 {
 	omni_mutex_lock	lock (fMutex);
 
+	this->Drain ();
 	fInner.SetLogSize (size);
 }
 
@@ -393,6 +503,7 @@ void LogStream::DumpToFile (void)
 {
 	omni_mutex_lock	lock (fMutex);
 
+	this->Drain ();
 	fInner.DumpToFile ();
 }
 
@@ -416,6 +527,420 @@ void LogStream::PrefChanged (PrefKeyType, PrefRefCon data)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	LogStream::PostText
+ *
+ * DESCRIPTION:	Posts a line of text to the calling thread's ring.
+ *				Text too long for one record is split over several,
+ *				only the first of which is timestamped and only the
+ *				last of which ends the line.
+ *
+ * PARAMETERS:	buffer - text to log.
+ *
+ *				size - length of the text.
+ *
+ *				timestamp - true if the line is to be preceded by
+ *					a timestamp.
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void LogStream::PostText (const void* buffer, long size, Bool timestamp)
+{
+	LogRecord	record;
+
+	record.fTime = timestamp ? Platform::GetMilliseconds () : kInvalidTimestamp;
+	record.fEventCounter = ::PrvEventCounter ();
+	record.fFlags = kLogRecordNewLine;
+
+	this->Post (record, buffer, size);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LogStream::PostData
+ *
+ * DESCRIPTION:	Posts binary data to the calling thread's ring, to be
+ *				dumped in hex by the writer thread.
+ *
+ * PARAMETERS:	data - binary data to be included in the output
+ *
+ *				dataLen - length of binary data
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void LogStream::PostData (const void* data, long dataLen)
+{
+	if (!data || dataLen <= 0)
+		return;
+
+	LogRecord	record;
+
+	record.fTime = Platform::GetMilliseconds ();
+	record.fEventCounter = ::PrvEventCounter ();
+	record.fFlags = kLogRecordHex;
+
+	this->Post (record, data, dataLen);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LogStream::Post
+ *
+ * DESCRIPTION:	Adds text or data to a ring.  A thread posts to its
+ *				own ring without taking any lock; threads that
+ *				couldn't get a ring take turns on the shared one.
+ *
+ *				Anything longer than kLogRecordMaxData is split over
+ *				several records.  Sequence numbers for all of them
+ *				are taken at once, so no other thread's records can
+ *				land between them.  Split text is timestamped on the
+ *				first record only, and ends the line (if it's meant
+ *				to) on the last one only.
+ *
+ *				Nothing is dropped: if the ring is full, the writer
+ *				thread has fallen behind, and the posting thread
+ *				drains the rings itself.
+ *
+ * PARAMETERS:	ring - ring to post to.
+ *
+ *				record - the first record to post.  Its sequence
+ *					number and size are filled in here, as is its
+ *					timestamp if it has one.
+ *
+ *				data - bytes to post.
+ *
+ *				size - number of bytes to post.
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void LogStream::Post (LogRecord& record, const void* data, long size)
+{
+	LogRing*	ring = this->GetRing ();
+
+	if (ring)
+	{
+		this->Post (*ring, record, data, size);
+	}
+	else
+	{
+		omni_mutex_lock	lock (fSharedMutex);
+
+		this->Post (fRings[kLogRingCount], record, data, size);
+	}
+}
+
+
+void LogStream::Post (LogRing& ring, LogRecord& record, const void* data, long size)
+{
+	const uint8*	p		= (const uint8*) data;
+	long			count	= size > kLogRecordMaxData ? (size + kLogRecordMaxData - 1) / kLogRecordMaxData : 1;
+	uint16			flags	= record.fFlags;
+
+	for (long ii = 0; ii < count; ++ii)
+	{
+		long	amtToPost = size > kLogRecordMaxData ? kLogRecordMaxData : size;
+
+		while (ring.fRing.GetFree () < (long) sizeof (LogRecord) + amtToPost)
+		{
+			this->Flush ();
+		}
+
+		if (ii == 0)
+		{
+			record.fSequence = __atomic_fetch_add (&fNextSequence, (uint32) count, __ATOMIC_RELAXED);
+
+			// Stamp the record now rather than before waiting for room
+			// above, so that the times follow the sequence numbers.
+
+			if (record.fTime != kInvalidTimestamp)
+			{
+				record.fTime = Platform::GetMilliseconds ();
+			}
+		}
+		else
+		{
+			++record.fSequence;
+
+			if ((flags & kLogRecordHex) == 0)
+			{
+				record.fTime = kInvalidTimestamp;
+			}
+		}
+
+		record.fFlags = ii == count - 1 ? flags : (flags & ~kLogRecordNewLine);
+
+		this->PutRecord (ring, record, p, amtToPost);
+
+		p += amtToPost;
+		size -= amtToPost;
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LogStream::PutRecord
+ *
+ * DESCRIPTION:	Puts one record into a ring that has room for it, and
+ *				wakes the writer thread if it's waiting for something
+ *				to do.
+ *
+ * PARAMETERS:	ring - ring to put the record in.
+ *
+ *				record - record to put.  Its size is filled in here.
+ *
+ *				data - bytes following the record.
+ *
+ *				size - number of bytes following the record.
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void LogStream::PutRecord (LogRing& ring, LogRecord& record, const void* data, long size)
+{
+	uint8	buffer[sizeof (LogRecord) + kLogRecordMaxData];
+	long	recordSize = sizeof (LogRecord) + size;
+
+	EmAssert (size <= kLogRecordMaxData);
+
+	record.fSize = (uint16) size;
+
+	// Put the record and its data in with a single call so that the
+	// writer thread never sees one without the other.
+
+	memcpy (buffer, &record, sizeof (LogRecord));
+	memcpy (buffer + sizeof (LogRecord), data, size);
+
+	ring.fRing.Put (buffer, recordSize);
+
+	// The writer thread holds fMutex from the time it says it's idle
+	// until it's waiting on fWriterCondition, so taking the mutex here
+	// makes sure the signal isn't lost.  Only the first record posted
+	// after it goes idle has to do this.
+
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+	if (__atomic_exchange_n (&fWriterIdle, 0, __ATOMIC_SEQ_CST))
+	{
+		omni_mutex_lock	lock (fMutex);
+
+		fWriterCondition.signal ();
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LogStream::GetRing
+ *
+ * DESCRIPTION:	Returns the calling thread's ring, claiming a free one
+ *				the first time the thread logs anything.
+ *
+ * PARAMETERS:	none
+ *
+ * RETURNED:	The thread's ring, or NULL if they've all been claimed.
+ *
+ ***********************************************************************/
+
+LogRing* LogStream::GetRing (void)
+{
+	LogRing*	ring = (LogRing*) pthread_getspecific (fRingKey);
+
+	if (ring == NULL)
+	{
+		for (int ii = 0; ii < kLogRingCount; ++ii)
+		{
+			uint32	unowned = 0;
+
+			if (__atomic_compare_exchange_n (&fRings[ii].fOwned, &unowned, 1,
+				false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			{
+				ring = &fRings[ii];
+				pthread_setspecific (fRingKey, ring);
+				break;
+			}
+		}
+	}
+
+	return ring;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LogStream::ReleaseRing
+ *
+ * DESCRIPTION:	Hands a thread's ring back when the thread exits.  Any
+ *				records still in it are drained as usual.
+ *
+ * PARAMETERS:	ring - the ring to release.
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void LogStream::ReleaseRing (void* ring)
+{
+	__atomic_store_n (&((LogRing*) ring)->fOwned, 0, __ATOMIC_RELEASE);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LogStream::Flush
+ *
+ * DESCRIPTION:	Drains the rings into the text buffer.
+ *
+ * PARAMETERS:	none
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void LogStream::Flush (void)
+{
+	omni_mutex_lock	lock (fMutex);
+
+	this->Drain ();
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LogStream::Drain
+ *
+ * DESCRIPTION:	Drains the rings into the text buffer, in the order
+ *				the records were posted.  A sequence number is taken
+ *				before its record is put in the ring, so we may find
+ *				a later record before an earlier one shows up; if so,
+ *				we stop at the gap and pick up from there next time.
+ *				Only records posted before the call are taken, so
+ *				that a busy thread can't keep us in here forever.
+ *				fMutex must be held.
+ *
+ * PARAMETERS:	none
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void LogStream::Drain (void)
+{
+	uint32	end = __atomic_load_n (&fNextSequence, __ATOMIC_ACQUIRE);
+
+	while (fNextToEmit != end)
+	{
+		LogRing*	next = NULL;
+
+		for (int ii = 0; ii <= kLogRingCount; ++ii)
+		{
+			LogRing&	ring = fRings[ii];
+
+			if (!ring.fHasPending && ring.fRing.GetUsed () >= (long) sizeof (LogRecord))
+			{
+				ring.fRing.Get (&ring.fPending, sizeof (LogRecord));
+				ring.fRing.Get (ring.fPendingData, ring.fPending.fSize);
+				ring.fHasPending = true;
+			}
+
+			if (ring.fHasPending && ring.fPending.fSequence == fNextToEmit)
+			{
+				next = &ring;
+			}
+		}
+
+		// Records in a ring are in sequence, so if the one we want isn't
+		// at the head of any of them, it hasn't been put yet.
+
+		if (!next)
+			break;
+
+		this->Emit (next->fPending, next->fPendingData);
+		next->fHasPending = false;
+
+		++fNextToEmit;
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LogStream::Emit
+ *
+ * DESCRIPTION:	Formats a record into the text buffer.
+ *
+ * PARAMETERS:	record - the record to format.
+ *
+ *				data - the bytes following the record.
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void LogStream::Emit (const LogRecord& record, const uint8* data)
+{
+	if (record.fFlags & kLogRecordHex)
+	{
+		fInner.DumpHex (data, record.fSize, record.fTime, record.fEventCounter);
+	}
+	else
+	{
+		fInner.Write (data, record.fSize, record.fTime, record.fEventCounter,
+			(record.fFlags & kLogRecordNewLine) != 0);
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LogStream::WriterThread
+ *
+ * DESCRIPTION:	Drains the rings whenever something is posted to them,
+ *				until the stream is destroyed.  In between, it waits
+ *				on fWriterCondition without a timeout, so a quiet log
+ *				doesn't wake it up at all.
+ *
+ * PARAMETERS:	data - the LogStream.
+ *
+ * RETURNED:	NULL
+ *
+ ***********************************************************************/
+
+void* LogStream::WriterThread (void* data)
+{
+	LogStream*		self = (LogStream*) data;
+	omni_mutex_lock	lock (self->fMutex);
+
+	while (!self->fTimeToQuit)
+	{
+		// Say we're idle before draining, so that anything posted after
+		// Drain has looked at its ring wakes us up (see PutRecord).
+
+		__atomic_store_n (&self->fWriterIdle, 1, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+		self->Drain ();
+
+		if (!self->fTimeToQuit)
+		{
+			self->fWriterCondition.wait ();
+		}
+	}
+
+	return NULL;
+}
+
+
 #pragma mark -
 
 /***********************************************************************
@@ -489,7 +1014,7 @@ LogStreamInner::~LogStreamInner (void)
  *
  ***********************************************************************/
 
-int LogStreamInner::DumpHex (const void* data, long dataLen)
+int LogStreamInner::DumpHex (const void* data, long dataLen, uint32 when, int32 eventCounter)
 {
 	int n = 0;
 	const uint8*	dataP = (const uint8*) data;
@@ -532,7 +1057,7 @@ int LogStreamInner::DumpHex (const void* data, long dataLen)
 
 			EmAssert (p - text <= (ptrdiff_t) sizeof (text));
 
-			this->Write (text, p - text);
+			this->Write (text, p - text, when, eventCounter);
 		}
 	}	
 
@@ -540,39 +1065,6 @@ int LogStreamInner::DumpHex (const void* data, long dataLen)
 }
 
 
-/***********************************************************************
- *
- * FUNCTION:	LogStreamInner::VPrintf
- *
- * DESCRIPTION:	A vprintf-like function for adding text to the log file.
- *
- * PARAMETERS:	fmt - a vprintf-like string for formatting the output
- *				text.
- *
- *				args - additional vprintf-like parameters.
- *
- * RETURNED:	nothing
- *
- ***********************************************************************/
-
-int LogStreamInner::VPrintf (const char* fmt, va_list args, Bool timestamp)
-{
-	char	buffer[2000];
-
-	int n = vsprintf (buffer, fmt, args);
-
-	// debug check, watch for buffer overflows here
-	if (n < 0 || n >= (int) sizeof (buffer))
-	{
-		Platform::Debugger();
-	}
-
-	this->Write (buffer, n, timestamp);
-
-	return n;
-}
-
-
 /***********************************************************************
  *
  * FUNCTION:	LogStreamInner::Write
@@ -585,13 +1077,15 @@ int LogStreamInner::VPrintf (const char* fmt, va_list args, Bool timestamp)
  *
  ***********************************************************************/
 
-int LogStreamInner::Write (const void* buffer, long size, Bool timestamp)
+int LogStreamInner::Write (const void* buffer, long size, uint32 when, int32 eventCounter, Bool newLine)
 {
-	if (timestamp)
-		this->Timestamp ();
+	if (when != kInvalidTimestamp)
+		this->Timestamp (when, eventCounter);
 
 	this->Append ((const char*) buffer, size);
-	this->NewLine ();
+
+	if (newLine)
+		this->NewLine ();
 
 	return size;
 }
@@ -857,16 +1351,19 @@ EmFileRef LogStreamInner::CreateFileReference (void)
  *
  * DESCRIPTION:	Outputs a timestamp to the log stream.
  *
- * PARAMETERS:	none
+ * PARAMETERS:	when - time the text was logged.
+ *
+ *				eventCounter - Gremlin event number at that time, or
+ *					kInvalidGremlinCounter if no Gremlin was running.
  *
  * RETURNED:	nothing
  *
  ***********************************************************************/
 
-void LogStreamInner::Timestamp (void)
+void LogStreamInner::Timestamp (uint32 when, int32 eventCounter)
 {
 	Bool	reformat = false;
-	uint32	now = Platform::GetMilliseconds ();
+	uint32	now = when;
 
 	// This may be a case of pre-optimization, but we try to keep around
 	// a formatted timestamp string for as long as possible.  If either
@@ -876,7 +1373,7 @@ void LogStreamInner::Timestamp (void)
 	if (fLastTimestampTime != now)
 		reformat = true;
 
-	if (!reformat && Hordes::IsOn () && fLastGremlinEventCounter != Hordes::EventCounter ())
+	if (!reformat && fLastGremlinEventCounter != eventCounter)
 		reformat = true;
 
 	if (reformat)
@@ -894,9 +1391,10 @@ void LogStreamInner::Timestamp (void)
 		// If a Gremlin is running, use a formatting string that includes
 		// the event number.  Otherwise, use a format string that omits it.
 
-		if (Hordes::IsOn ())
+		fLastGremlinEventCounter = eventCounter;
+
+		if (eventCounter != kInvalidGremlinCounter)
 		{
-			fLastGremlinEventCounter = Hordes::EventCounter ();
 			sprintf (fLastTimestampString, "%ld.%03ld (%ld):\t", now / 1000, now % 1000, fLastGremlinEventCounter);
 		}
 		else
@@ -17,28 +17,32 @@
 #include "Hordes.h"				// Hordes::IsOn
 #include "Miscellaneous.h"		// StMemory
 #include "PreferenceMgr.h"		// FOR_EACH_PREF
-#include "omnithread.h"			// omni_mutex
+#include "omnithread.h"			// omni_mutex, omni_condition, omni_thread
 
+#include <pthread.h>			// pthread_key_t
 #include <stdarg.h>				// va_list
 #include <deque>				// deque
 
 typedef deque<uint8>	ByteDeque;
 
 class EmStreamFile;
+struct LogRecord;
+struct LogRing;
 
 
 class LogStreamInner
 {
 	// Non-multithread-safe version of LogStream.  LogStream
 	// acquires a "logging mutex" and calls these functions.
+	// The time and Gremlin event number to stamp each line with
+	// are passed in, as they were recorded when the text was logged.
 
 	public:
 								LogStreamInner	(const char* baseName);
 								~LogStreamInner	(void);
 
-		int						DumpHex			(const void*, long dataLen);
-		int						VPrintf			(const char* fmt, va_list args, Bool timestamp = true);
-		int						Write			(const void* buffer, long size, Bool timestamp = true);
+		int						DumpHex			(const void*, long dataLen, uint32 when, int32 eventCounter);
+		int						Write			(const void* buffer, long size, uint32 when, int32 eventCounter, Bool newLine = true);
 
 		void					Clear			(void);
 
@@ -51,7 +55,7 @@ class LogStreamInner
 	private:
 		void					DumpToFile			(EmStreamFile&, const char*, long size);
 		EmFileRef				CreateFileReference	(void);
-		void					Timestamp			(void);
+		void					Timestamp			(uint32 when, int32 eventCounter);
 		void					NewLine				(void);
 		void					Append				(const char* buffer, long size);
 		void					TrimLeading			(void);
@@ -94,9 +98,39 @@ class LogStream
 	private:
 		static void				PrefChanged			(PrefKeyType, PrefRefCon);	
 
+		// Producer side.  Each logging thread gets a ring of its own
+		// and posts binary records to it without taking any lock.
+
+		void					PostText		(const void*, long size, Bool timestamp);
+		void					PostData		(const void*, long dataLen);
+		void					Post			(LogRecord&, const void*, long size);
+		void					Post			(LogRing&, LogRecord&, const void*, long size);
+		void					PutRecord		(LogRing&, LogRecord&, const void*, long size);
+		LogRing*				GetRing			(void);
+		static void				ReleaseRing		(void*);
+
+		// Consumer side.  Called with fMutex held, either by the
+		// writer thread or by anyone who needs the text up to date.
+
+		void					Flush			(void);
+		void					Drain			(void);
+		void					Emit			(const LogRecord&, const uint8*);
+		static void*			WriterThread	(void*);
+
 	private:
 		omni_mutex				fMutex;
+		omni_condition			fWriterCondition;
 		LogStreamInner			fInner;
+
+		LogRing*				fRings;
+		omni_mutex				fSharedMutex;		// Guards the ring shared by threads without one of their own.
+		pthread_key_t			fRingKey;
+		uint32					fNextSequence;
+		uint32					fNextToEmit;		// Sequence number Drain is waiting for.  Guarded by fMutex.
+		uint32					fWriterIdle;		// Non-zero while the writer thread waits for something to do.
+
+		omni_thread*			fWriterThread;
+		Bool					fTimeToQuit;
 };
 
 void		LogEvtAddEventToQueue		(const EventType& event);
@@ -25,6 +25,7 @@
 #include "EmPalmStructs.h"		// EmAliasWindowType, EmAliasFormType
 #include "EmPatchState.h"		// IsInSysBinarySearch, OSMajorMinorVersion
 #include "EmSession.h"			// gSession->ScheduleDeferredError
+#include "EmSessionContext.h"	// EM_SESSION_GLOBAL, EM_SESSION_OBJECT
 #include "Logging.h"			// ReportUIMgrDataAccess
 #include "Miscellaneous.h"		// FindFunctionName
 #include "ROMStubs.h"			// SysKernelInfo
@@ -53,6 +54,12 @@ static EmTaggedPalmChunk		gLastChunk;
 static vector<MemHandle>		gBitmapHandleList;
 static vector<MemPtr>			gBitmapPointerList;
 
+EM_SESSION_OBJECT (EmTaggedPalmChunkList, gTaggedChunks);
+EM_SESSION_GLOBAL (gHaveLastChunk);
+EM_SESSION_OBJECT (EmTaggedPalmChunk, gLastChunk);
+EM_SESSION_OBJECT (vector<MemHandle>, gBitmapHandleList);
+EM_SESSION_OBJECT (vector<MemPtr>, gBitmapPointerList);
+
 enum
 {
 	kUIWindow,
@@ -769,90 +776,73 @@ Bool MetaMemory::IsAllocatedChunk (emuptr testAddress, uint32 size)
 
 
 // ---------------------------------------------------------------------------
-//		 MetaMemory::MarkRange
+//		 PrvMarkUnmarkBytes
 // ---------------------------------------------------------------------------
+// Set each meta byte in the given range to (byte & andValue) | orValue,
+// working a long at a time where possible.
 
-void MetaMemory::MarkRange (emuptr start, emuptr end, uint8 v)
+static void PrvMarkUnmarkBytes (uint8* p, uint8* endP, uint8 andValue, uint8 orValue)
 {
-	// If there's no meta-memory (not needed for dedicated framebuffers)
-	// just leave.
-
-	if (EmMemGetBank(start).xlatemetaaddr == NULL)
-		return;
-
-	// If the beginning and end of the buffer are not in the same address
-	// space, just leave.  This can happen while initializing the Dragonball's
-	// LCD -- for a while, the LCD framebuffer range falls off the end
-	// of the dynamic heap.
-
-	if (start >= 0 && start < 0 + gRAMBank_Size
-		&& end >= 0 + gRAMBank_Size)
-	{
-		end = gRAMBank_Size - 1;
-	}
-
-	if (start >= gMemoryStart && start < gMemoryStart + gRAMBank_Size
-		&& end >= gMemoryStart + gRAMBank_Size)
-	{
-		end = gMemoryStart + gRAMBank_Size - 1;
-	}
-
-	uint8*	startP	= EmMemGetMetaAddress (start);
-	uint8*	endP	= startP + (end - start);	// EmMemGetMetaAddress (end);
-	uint8*	end4P	= (uint8*) (((uint32) endP) & ~3);
-	uint8*	p		= startP;
-
-	EmAssert (end >= start);
-	EmAssert (endP >= startP);
-	EmAssert (endP - startP == (ptrdiff_t) (end - start));
-
-#if 1
 	// Optimization: if there are no middle longs to fill, just
 	// do everything a byte at a time.
 
-	if (end - start < 12)
-	{
-		while (p < endP)
-		{
-			*p++ &= v;
-		}
-	}
-	else
+	if (endP - p >= 12)
 	{
-		uint32	longValue = v;
-		longValue |= (longValue << 8);
-		longValue |= (longValue << 16);
+		uint8*	end4P	= (uint8*) (((uint32) endP) & ~3);
+		uint32	longAnd	= META_BITS_32 (andValue);
+		uint32	longOr	= META_BITS_32 (orValue);
 
 		while (((uint32) p) & 3)		// while there are leading bytes
 		{
-			*p++ |= v;
+			*p = (*p & andValue) | orValue;
+			++p;
 		}
 
 		while (p < end4P)				// while there are middle longs
 		{
-			*(uint32*) p |= longValue;
+			*(uint32*) p = ((*(uint32*) p) & longAnd) | longOr;
 			p += sizeof (uint32);
 		}
-
-		while (p < endP)				// while there are trailing bytes
-		{
-			*p++ |= v;
-		}
 	}
-#else
-	for (p = startP; p < endP; ++p)
+
+	while (p < endP)					// while there are trailing bytes
 	{
-		*p |= v;
+		*p = (*p & andValue) | orValue;
+		++p;
 	}
-#endif
 }
 
 
 // ---------------------------------------------------------------------------
+//		 MetaMemory::MarkRange
 //		 MetaMemory::UnmarkRange
 // ---------------------------------------------------------------------------
 
+void MetaMemory::MarkRange (emuptr start, emuptr end, uint8 v)
+{
+	MarkUnmarkRange (start, end, 0xFF, v);
+}
+
+
 void MetaMemory::UnmarkRange (emuptr start, emuptr end, uint8 v)
+{
+	MarkUnmarkRange (start, end, ~v, 0x00);
+}
+
+
+// ---------------------------------------------------------------------------
+//		 MetaMemory::MarkUnmarkRange
+// ---------------------------------------------------------------------------
+// Set each meta byte in the given range to (byte & andValue) | orValue.
+//
+// RAM's meta bytes are handled a page at a time (see gRAM_MetaPages).  If
+// a page is uniform, the result is the same for every byte in it, so the
+// page is left alone if that doesn't change anything, and filled if it
+// does.  Re-marking chunks that are already marked, as Resync does after
+// most Memory Manager calls, then costs next to nothing.
+
+void MetaMemory::MarkUnmarkRange (emuptr start, emuptr end,
+							uint8 andValue, uint8 orValue)
 {
 	// If there's no meta-memory (not needed for dedicated framebuffers)
 	// just leave.
@@ -879,159 +869,191 @@ void MetaMemory::UnmarkRange (emuptr start, emuptr end, uint8 v)
 
 	uint8*	startP	= EmMemGetMetaAddress (start);
 	uint8*	endP	= startP + (end - start);	// EmMemGetMetaAddress (end);
-	uint8*	end4P	= (uint8*) (((uint32) endP) & ~3);
 	uint8*	p		= startP;
 
 	EmAssert (end >= start);
 	EmAssert (endP >= startP);
 	EmAssert (endP - startP == (ptrdiff_t) (end - start));
 
-	v = ~v;
-
-#if 1
-	// Optimization: if there are no middle longs to fill, just
-	// do everything a byte at a time.
+	// Meta-memory outside of RAM doesn't have a page table.  (Just in case
+	// a range hangs over the edge of RAM, forget what we know about any RAM
+	// pages it covers.)
 
-	if (end - start < 12)
+	if (startP < gRAM_MetaMemory || endP > gRAM_MetaMemory + gRAMBank_Size)
 	{
-		while (p < endP)
+		for (uint8* q = startP; q < endP; q += kRAMDirtyPageSize)
 		{
-			*p++ &= v;
+			MarkPageMixed (q);
 		}
-	}
-	else
-	{
-		uint32	longValue = v;
-		longValue |= (longValue << 8);
-		longValue |= (longValue << 16);
 
-		while (((uint32) p) & 3)		// while there are leading bytes
+		if (endP > startP)
 		{
-			*p++ &= v;
+			MarkPageMixed (endP - 1);
 		}
 
-		while (p < end4P)				// while there are middle longs
+		Memory::InvalidateFastPages (startP, endP - startP);
+		::PrvMarkUnmarkBytes (startP, endP, andValue, orValue);
+		return;
+	}
+
+	while (p < endP)
+	{
+		uint32	page		= (p - gRAM_MetaMemory) >> kRAMDirtyPageShift;
+		uint8*	pageStart	= gRAM_MetaMemory + (page << kRAMDirtyPageShift);
+		uint8*	pageEnd		= pageStart + kRAMDirtyPageSize;
+
+		if (pageEnd > gRAM_MetaMemory + gRAMBank_Size)
+			pageEnd = gRAM_MetaMemory + gRAMBank_Size;
+
+		uint8*	segEnd		= endP < pageEnd ? endP : pageEnd;
+		Bool	wholePage	= p == pageStart && segEnd == pageEnd;
+		uint16	pageBits	= gRAM_MetaPages[page];
+
+		if (pageBits != kMetaPageMixed)
 		{
-			*(uint32*) p &= longValue;
-			p += sizeof (uint32);
-		}
+			uint8	newBits = (((uint8) pageBits) & andValue) | orValue;
+
+			if (newBits != pageBits)
+			{
+				Memory::InvalidateFastPages (p, segEnd - p);
+				memset (p, newBits, segEnd - p);
 
-		while (p < endP)				// while there are trailing bytes
+				gRAM_MetaPages[page] = wholePage ? newBits : kMetaPageMixed;
+			}
+		}
+		else
 		{
-			*p++ &= v;
+			Memory::InvalidateFastPages (p, segEnd - p);
+			::PrvMarkUnmarkBytes (p, segEnd, andValue, orValue);
+
+			// If all the bits were replaced, the page is uniform now.
+
+			if (wholePage && andValue == 0x00)
+			{
+				gRAM_MetaPages[page] = orValue;
+			}
 		}
+
+		p = segEnd;
 	}
-#else
-	for (p = startP; p < endP; ++p)
-	{
-		*p &= v;
-	}
-#endif
 }
 
 
 // ---------------------------------------------------------------------------
-//		 MetaMemory::MarkUnmarkRange
+//		 MetaMemory::GetRangeBits
 // ---------------------------------------------------------------------------
+// Return all of the bits set in any of the meta bytes in the given range.
+// Uniform pages are answered from gRAM_MetaPages.  Mixed pages have to be
+// scanned, and if a whole one turns out to be uniform after all, it's
+// recorded as such for next time.
 
-void MetaMemory::MarkUnmarkRange (emuptr start, emuptr end,
-							uint8 andValue, uint8 orValue)
+uint8 MetaMemory::GetRangeBits (uint8* metaAddress, uint32 size)
 {
-	// If there's no meta-memory (not needed for dedicated framebuffers)
-	// just leave.
+	uint8*	p		= metaAddress;
+	uint8*	endP	= metaAddress + size;
+	uint8	result	= 0;
 
-	if (EmMemGetBank(start).xlatemetaaddr == NULL)
-		return;
+	// Meta-memory outside of RAM doesn't have a page table.
 
-	// If the beginning and end of the buffer are not in the same address
-	// space, just leave.  This can happen while initializing the Dragonball's
-	// LCD -- for a while, the LCD framebuffer range falls off the end
-	// of the dynamic heap.
+	Bool	inRAM	= p >= gRAM_MetaMemory && endP <= gRAM_MetaMemory + gRAMBank_Size;
 
-	if (start >= 0 && start < 0 + gRAMBank_Size
-		&& end >= 0 + gRAMBank_Size)
+	while (p < endP)
 	{
-		end = gRAMBank_Size - 1;
-	}
+		uint8*	segEnd		= endP;
+		uint32	page		= 0;
+		Bool	wholePage	= false;
 
-	if (start >= gMemoryStart && start < gMemoryStart + gRAMBank_Size
-		&& end >= gMemoryStart + gRAMBank_Size)
-	{
-		end = gMemoryStart + gRAMBank_Size - 1;
-	}
+		if (inRAM)
+		{
+			page = (p - gRAM_MetaMemory) >> kRAMDirtyPageShift;
 
-	uint8*	startP	= EmMemGetMetaAddress (start);
-	uint8*	endP	= startP + (end - start);	// EmMemGetMetaAddress (end);
-	uint8*	end4P	= (uint8*) (((uint32) endP) & ~3);
-	uint8*	p		= startP;
+			uint8*	pageStart	= gRAM_MetaMemory + (page << kRAMDirtyPageShift);
+			uint8*	pageEnd		= pageStart + kRAMDirtyPageSize;
 
-	EmAssert (end >= start);
-	EmAssert (endP >= startP);
-	EmAssert (endP - startP == (ptrdiff_t) (end - start));
+			if (pageEnd > gRAM_MetaMemory + gRAMBank_Size)
+				pageEnd = gRAM_MetaMemory + gRAMBank_Size;
 
-	if (andValue == 0xFF)
-	{
-		while (p < endP)
-		{
-			*p++ |= orValue;
-		}
-	}
-	else if (orValue == 0x00)
-	{
-		while (p < endP)
-		{
-			*p++ &= andValue;
-		}
-	}
-	else
-	{
-#if 1
-		// Optimization: if there are no middle longs to fill, just
-		// do everything a byte at a time.
+			if (segEnd > pageEnd)
+				segEnd = pageEnd;
 
-		if (end - start < 12)
-		{
-			while (p < endP)				// while there are trailing bytes
+			uint16	pageBits = gRAM_MetaPages[page];
+
+			if (pageBits != kMetaPageMixed)
 			{
-				*p = (*p & andValue) | orValue;
-				p += sizeof (char);
+				result |= (uint8) pageBits;
+				p = segEnd;
+				continue;
 			}
+
+			wholePage = p == pageStart && segEnd == pageEnd;
 		}
-		else
-		{
-			uint32	longAnd = andValue;
-			longAnd |= (longAnd << 8);
-			longAnd |= (longAnd << 16);
 
-			uint32	longOr = orValue;
-			longOr |= (longOr << 8);
-			longOr |= (longOr << 16);
+		// Collect the bits set in any byte and the bits set in all of them.
+		// If those are the same, every byte is the same.
 
-			while (((uint32) p) & 3)		// while there are leading bytes
-			{
-				*p = (*p & andValue) | orValue;
-				p += sizeof (char);
-			}
+		uint32	anyBits	= 0;
+		uint32	allBits	= 0xFFFFFFFF;
 
-			while (p < end4P)				// while there are middle longs
+		if (segEnd - p >= 12)
+		{
+			uint8*	end4P = (uint8*) (((uint32) segEnd) & ~3);
+
+			while (((uint32) p) & 3)
 			{
-				*(uint32*) p = ((*(uint32*) p) & longAnd) | longOr;
-				p += sizeof (long);
+				anyBits |= META_BITS_32 (*p);
+				allBits &= META_BITS_32 (*p);
+				++p;
 			}
 
-			while (p < endP)				// while there are trailing bytes
+			while (p < end4P)
 			{
-				*p = (*p & andValue) | orValue;
-				p += sizeof (char);
+				anyBits |= *(uint32*) p;
+				allBits &= *(uint32*) p;
+				p += sizeof (uint32);
 			}
 		}
-#else
-		for (p = startP; p < endP; ++p)
+
+		while (p < segEnd)
 		{
-			*p = (*p & andValue) | orValue;
+			anyBits |= META_BITS_32 (*p);
+			allBits &= META_BITS_32 (*p);
+			++p;
 		}
-#endif
+
+		if (wholePage && anyBits == allBits && anyBits == (META_BITS_32 ((uint8) anyBits)))
+		{
+			gRAM_MetaPages[page] = (uint8) anyBits;
+		}
+
+		result |= (uint8) (anyBits | (anyBits >> 8) | (anyBits >> 16) | (anyBits >> 24));
 	}
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 MetaMemory::HasReadChecks
+// ---------------------------------------------------------------------------
+// Return whether or not any byte in the given range has bits that the RAM
+// bank read handlers need to look at.  Used to decide whether or not reads
+// can bypass those handlers (see Memory::UpdateFastPages).
+
+Bool MetaMemory::HasReadChecks (uint8* metaAddress, uint32 size)
+{
+	return (GetRangeBits (metaAddress, size) & kAccessBitMask) != 0;
+}
+
+
+// ---------------------------------------------------------------------------
+//		 MetaMemory::HasWriteChecks
+// ---------------------------------------------------------------------------
+// Same as above, but for the write handlers, which also need to know about
+// screen memory and cached opcodes.
+
+Bool MetaMemory::HasWriteChecks (uint8* metaAddress, uint32 size)
+{
+	return (GetRangeBits (metaAddress, size) & (kAccessBitMask | kScreenBuffer | kCodeCached)) != 0;
 }
 
 
@@ -14,6 +14,8 @@
 #ifndef _METAMEMORY_H_
 #define _METAMEMORY_H_
 
+#include "EmBankSRAM.h"			// gRAM_MetaPages, kMetaPageMixed
+#include "EmCodeCache.h"		// EmCodeCache::Invalidate
 #include "EmMemory.h"			// EmMemGetMetaAddress
 #include "EmPalmHeap.h"			// EmPalmHeap, EmPalmChunkList
 #include "ErrorHandling.h"		// Errors::EAccessType
@@ -157,6 +159,17 @@ class MetaMemory
 		static Bool				IsCPUBreak				(emuptr opcodeLocation);
 		static Bool				IsCPUBreak				(uint8* metaLocation);
 
+		static void				MarkCodeCached			(uint8* metaAddress);	// Inlined, defined below
+		static void				UnmarkCodeCached		(uint8* metaAddress);	// Inlined, defined below
+		static Bool				IsCodeCached			(uint8* metaAddress, uint32 size);	// Inlined, defined below
+
+		// Used to decide whether or not accesses can bypass the RAM bank
+		// handlers.  Uniform meta pages (see gRAM_MetaPages) are answered
+		// without looking at their meta bytes.
+
+		static Bool				HasReadChecks			(uint8* metaAddress, uint32 size);
+		static Bool				HasWriteChecks			(uint8* metaAddress, uint32 size);
+
 	private:
 		struct ChunkCheck
 		{
@@ -178,6 +191,9 @@ class MetaMemory
 		static void				MarkUnmarkRange			(emuptr start, emuptr end,
 														 uint8 andValue, uint8 orValue);
 
+		static uint8			GetRangeBits			(uint8* metaAddress, uint32 size);
+		static void				MarkPageMixed			(uint8* metaAddress);	// Inlined, defined below
+
 		static void				SyncOneChunk			(const EmPalmChunk& chunk);
 
 		static void				GWH_ExamineHeap			(const EmPalmHeap& heap,
@@ -225,7 +241,7 @@ class MetaMemory
 			kNoAppAccess		= 0x0001,
 			kNoSystemAccess		= 0x0002,
 			kNoMemMgrAccess		= 0x0004,
-			kUnusedMeta1		= 0x0008,
+			kCodeCached			= 0x0008,	// Opcode is held in EmCodeCache; invalidate if changed.
 			kStackBuffer		= 0x0010,	// Stack buffer; check to see if below-SP access is made.
 			kScreenBuffer		= 0x0020,	// Screen buffer; update host screen if these bytes are changed.
 			kInstructionBreak	= 0x0040,	// Halt CPU emulation and check to see why.
@@ -428,6 +444,50 @@ inline Bool MetaMemory::IsCPUBreak (uint8* metaLocation)
 }
 
 
+inline void MetaMemory::MarkCodeCached (uint8* metaAddress)
+{
+	MarkPageMixed (metaAddress);
+	*metaAddress |= kCodeCached;
+}
+
+
+inline void MetaMemory::UnmarkCodeCached (uint8* metaAddress)
+{
+	MarkPageMixed (metaAddress);
+	*metaAddress &= ~kCodeCached;
+}
+
+
+// Called when a single meta byte is about to be changed.  The page it's in
+// can no longer be assumed to be uniform.  Meta bytes outside of RAM (if
+// any) aren't tracked.
+
+inline void MetaMemory::MarkPageMixed (uint8* metaAddress)
+{
+	if (metaAddress >= gRAM_MetaMemory && metaAddress < gRAM_MetaMemory + gRAMBank_Size)
+	{
+		gRAM_MetaPages[(metaAddress - gRAM_MetaMemory) >> kRAMDirtyPageShift] = kMetaPageMixed;
+	}
+}
+
+
+// Only the meta byte for the first byte of a cached opcode gets the
+// kCodeCached bit, so check the even addresses in the given range.  Note
+// that for a 1-byte access, metaAddress may be odd.
+
+inline Bool MetaMemory::IsCodeCached (uint8* metaAddress, uint32 size)
+{
+	if (size == 4)
+	{
+		return ((metaAddress[0] | metaAddress[2]) & kCodeCached) != 0;
+	}
+
+	uint8*	evenAddress = (uint8*) (((uint32) metaAddress) & ~1);
+
+	return ((*evenAddress) & kCodeCached) != 0;
+}
+
+
 #define META_CHECK(metaAddress, address, op, size, forRead)		\
 do {															\
 	if (Memory::IsPCInRAM ())									\
@@ -627,6 +687,15 @@ inline void MetaMemory::MarkInstructionBreak (emuptr opcodeLocation)
 
 	uint8*	ptr = EmMemGetMetaAddress (opcodeLocation);
 
+	// A cached block skips the IsCPUBreak check for all but its first
+	// opcode, so drop any block holding this one.
+
+	if ((*ptr & kCodeCached) != 0)
+	{
+		EmCodeCache::Invalidate (EmMemGetRealAddress (opcodeLocation), ptr, 2);
+	}
+
+	MarkPageMixed (ptr);
 	*ptr |= kInstructionBreak;
 }
 
@@ -641,6 +710,7 @@ inline void MetaMemory::UnmarkInstructionBreak (emuptr opcodeLocation)
 
 	uint8*	ptr = EmMemGetMetaAddress (opcodeLocation);
 
+	MarkPageMixed (ptr);
 	*ptr &= ~kInstructionBreak;
 }
 
@@ -1820,6 +1820,331 @@ long GzipWorstSize (long srcBytes)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	Lz4Encode
+ *
+ * DESCRIPTION: Pack data in the LZ4 block format.  The output is a
+ *				series of sequences, each consisting of:
+ *
+ *					token: upper 4 bits are the literal count, lower
+ *						4 bits are the match length minus 4.  A value
+ *						of 15 in either means more length bytes follow.
+ *					extra literal count bytes: each added to the count;
+ *						a byte of 255 means another byte follows.
+ *					literals: copied as-is.
+ *					offset: 2 bytes, Little Endian, back from the
+ *						current output position to the match.
+ *					extra match length bytes: as for the literal count.
+ *
+ *				The last sequence has no offset or match, and the last
+ *				5 bytes are always literals.  Unlike GzipEncode, this
+ *				keeps no global state, so blocks can be packed on
+ *				several threads at once.
+ *
+ *				Matches are found with a single-entry hash table of
+ *				4-byte sequences.  The step between probes grows the
+ *				longer nothing matches, so incompressible data is
+ *				skipped over quickly.
+ *
+ * PARAMETERS:	srcPP - pointer to the pointer to the source bytes.  The
+ *					referenced pointer gets udpated to point past the
+ *					last byte included the packed output.
+ *
+ *				dstPP - pointer to the pointer to the destination buffer.
+ *					The referenced pointer gets updated to point past
+ *					the last byte stored in the output buffer.
+ *
+ *				srcBytes - length of the buffer referenced by srcPP
+ *
+ *				dstBytes - length of the buffer referenced by dstPP.
+ *					Must be at least Lz4WorstSize (srcBytes).
+ *
+ * RETURNED:	Nothing.
+ *
+ ***********************************************************************/
+
+#define kLz4MinMatch	4
+#define kLz4LastLiterals	5
+#define kLz4MatchLimit	12			// No match may start in the last 12 bytes
+#define kLz4MaxOffset	65535
+#define kLz4HashLog		12
+
+static inline uint32 PrvLz4Read32 (const uint8* p)
+{
+	return	((uint32) p[0]) |
+			((uint32) p[1] << 8) |
+			((uint32) p[2] << 16) |
+			((uint32) p[3] << 24);
+}
+
+static inline uint32 PrvLz4Hash (uint32 v)
+{
+	return ((v * 2654435761UL) & 0xFFFFFFFFUL) >> (32 - kLz4HashLog);
+}
+
+static inline uint8* PrvLz4PutLength (uint8* dstP, long len)
+{
+	while (len >= 255)
+	{
+		*dstP++ = 255;
+		len -= 255;
+	}
+
+	*dstP++ = (uint8) len;
+
+	return dstP;
+}
+
+static uint8* PrvLz4PutSequence (uint8* dstP, const uint8* litP, long litLen,
+								 long offset, long matchLen)
+{
+	uint8*	tokenP = dstP++;
+
+	*tokenP = (uint8) ((litLen >= 15 ? 15 : litLen) << 4);
+
+	if (litLen >= 15)
+		dstP = ::PrvLz4PutLength (dstP, litLen - 15);
+
+	memcpy (dstP, litP, litLen);
+	dstP += litLen;
+
+	if (matchLen > 0)
+	{
+		*dstP++ = (uint8) (offset & 0xFF);
+		*dstP++ = (uint8) (offset >> 8);
+
+		matchLen -= kLz4MinMatch;
+
+		*tokenP |= (uint8) (matchLen >= 15 ? 15 : matchLen);
+
+		if (matchLen >= 15)
+			dstP = ::PrvLz4PutLength (dstP, matchLen - 15);
+	}
+
+	return dstP;
+}
+
+void Lz4Encode (void** srcPP, void** dstPP, long srcBytes, long dstBytes)
+{
+	UNUSED_PARAM(dstBytes)
+
+	const uint8*	srcP = (const uint8*) *srcPP;
+	const uint8*	srcEndP = srcP + srcBytes;
+	const uint8*	anchorP = srcP;
+	uint8*			dstP = (uint8*) *dstPP;
+
+	if (srcBytes > kLz4MatchLimit)
+	{
+		long	table[1 << kLz4HashLog];
+		for (int ii = 0; ii < (1 << kLz4HashLog); ++ii)
+			table[ii] = -1;
+
+		const uint8*	ipP = srcP;
+		const uint8*	matchStartLimitP = srcEndP - kLz4MatchLimit;
+		const uint8*	matchEndLimitP = srcEndP - kLz4LastLiterals;
+
+		while (ipP < matchStartLimitP)
+		{
+			uint32	seq = ::PrvLz4Read32 (ipP);
+			uint32	hash = ::PrvLz4Hash (seq);
+			long	pos = ipP - srcP;
+			long	ref = table[hash];
+
+			table[hash] = pos;
+
+			if (ref < 0 || pos - ref > kLz4MaxOffset ||
+				::PrvLz4Read32 (srcP + ref) != seq)
+			{
+				ipP += 1 + ((ipP - anchorP) >> 6);
+				continue;
+			}
+
+			// Found a match; see how far it goes.
+
+			const uint8*	matchP = srcP + ref;
+			const uint8*	endP = ipP + kLz4MinMatch;
+			const uint8*	refEndP = matchP + kLz4MinMatch;
+
+			while (endP < matchEndLimitP && *endP == *refEndP)
+			{
+				++endP;
+				++refEndP;
+			}
+
+			dstP = ::PrvLz4PutSequence (dstP, anchorP, ipP - anchorP,
+						ipP - matchP, endP - ipP);
+
+			ipP = endP;
+			anchorP = ipP;
+		}
+	}
+
+	// Whatever's left goes out as literals.
+
+	dstP = ::PrvLz4PutSequence (dstP, anchorP, srcEndP - anchorP, 0, 0);
+
+	*srcPP = (void*) srcEndP;
+	*dstPP = (void*) dstP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	Lz4Decode
+ *
+ * DESCRIPTION: Unpack data packed by Lz4Encode.  The input is checked
+ *				as it's read; decoding stops at the first sequence that
+ *				would read or write outside the given buffers.  Callers
+ *				can tell whether the data was intact by checking that
+ *				both pointers were advanced by the full buffer lengths.
+ *
+ * PARAMETERS:	srcPP - pointer to the pointer to the source bytes.  The
+ *					referenced pointer gets updated to point past the
+ *					last byte consumed.
+ *
+ *				dstPP - pointer to the pointer to the destination buffer.
+ *					The referenced pointer gets updated to point past
+ *					the last byte stored in the output buffer.
+ *
+ *				srcBytes - length of the buffer referenced by srcPP
+ *
+ *				dstBytes - length of the buffer referenced by dstPP
+ *
+ * RETURNED:	Nothing.
+ *
+ ***********************************************************************/
+
+static inline Bool PrvLz4GetLength (const uint8*& srcP, const uint8* srcEndP, long& len)
+{
+	if (len == 15)
+	{
+		uint8	b;
+		do
+		{
+			if (srcP >= srcEndP)
+				return false;
+
+			b = *srcP++;
+			len += b;
+		}
+		while (b == 255);
+	}
+
+	return true;
+}
+
+static Bool PrvLz4GetSequence (const uint8*& srcP, const uint8* srcEndP,
+							   uint8*& dstP, uint8* dstStartP, uint8* dstEndP)
+{
+	uint8	token = *srcP++;
+
+	// Copy the literals.
+
+	long	litLen = token >> 4;
+
+	if (!::PrvLz4GetLength (srcP, srcEndP, litLen))
+		return false;
+
+	if (litLen > srcEndP - srcP || litLen > dstEndP - dstP)
+		return false;
+
+	memcpy (dstP, srcP, litLen);
+	srcP += litLen;
+	dstP += litLen;
+
+	// The last sequence has no match.
+
+	if (srcP == srcEndP)
+		return true;
+
+	// Copy the match.
+
+	if (srcEndP - srcP < 2)
+		return false;
+
+	long	offset = srcP[0] | (srcP[1] << 8);
+	srcP += 2;
+
+	if (offset == 0 || offset > dstP - dstStartP)
+		return false;
+
+	long	matchLen = token & 0x0F;
+
+	if (!::PrvLz4GetLength (srcP, srcEndP, matchLen))
+		return false;
+
+	matchLen += kLz4MinMatch;
+
+	if (matchLen > dstEndP - dstP)
+		return false;
+
+	const uint8*	matchP = dstP - offset;
+
+	if (offset >= matchLen)
+	{
+		memcpy (dstP, matchP, matchLen);
+		dstP += matchLen;
+	}
+	else
+	{
+		// Overlapping copy (e.g., a run of one repeated byte).
+
+		while (matchLen--)
+			*dstP++ = *matchP++;
+	}
+
+	return true;
+}
+
+void Lz4Decode (void** srcPP, void** dstPP, long srcBytes, long dstBytes)
+{
+	const uint8*	srcP = (const uint8*) *srcPP;
+	const uint8*	srcEndP = srcP + srcBytes;
+	uint8*			dstStartP = (uint8*) *dstPP;
+	uint8*			dstP = dstStartP;
+	uint8*			dstEndP = dstStartP + dstBytes;
+
+	while (srcP < srcEndP)
+	{
+		const uint8*	seqP = srcP;
+
+		if (!::PrvLz4GetSequence (srcP, srcEndP, dstP, dstStartP, dstEndP))
+		{
+			// Leave the source pointer at the start of the bad sequence.
+
+			srcP = seqP;
+			break;
+		}
+	}
+
+	*srcPP = (void*) srcP;
+	*dstPP = (void*) dstP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	Lz4WorstSize
+ *
+ * DESCRIPTION: Calculate the largest buffer needed when packing a
+ *				buffer "srcBytes" long with Lz4Encode: all literals,
+ *				plus the token and literal count bytes.
+ *
+ * PARAMETERS:	srcBytes - number of bytes in the buffer to be encoded.
+ *
+ * RETURNED:	Largest buffer size needed to encode source buffer.
+ *
+ ***********************************************************************/
+
+long Lz4WorstSize (long srcBytes)
+{
+	long	maxDestBytes = srcBytes + (srcBytes / 255) + 16;
+
+	return maxDestBytes;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	PrvGzipReadProc
@@ -132,6 +132,10 @@ void		GzipEncode				(void** srcPP, void** dstPP, long srcBytes, long dstBytes);
 void		GzipDecode				(void** srcPP, void** dstPP, long srcBytes, long dstBytes);
 long		GzipWorstSize			(long);
 
+void		Lz4Encode				(void** srcPP, void** dstPP, long srcBytes, long dstBytes);
+void		Lz4Decode				(void** srcPP, void** dstPP, long srcBytes, long dstBytes);
+long		Lz4WorstSize			(long);
+
 int			CountBits				(uint32 v);
 inline int	CountBits				(uint16 v) { return CountBits ((uint32) (uint16) v); }
 inline int	CountBits				(uint8 v) { return CountBits ((uint32) (uint8) v); }
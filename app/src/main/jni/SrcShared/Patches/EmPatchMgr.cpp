@@ -1069,6 +1069,14 @@ void EmPatchMgr::PuppetString (CallROMType& callROM, Bool& clearTimeout)
 			StubAppEnqueuePt (&palmPen);
 		}
 
+		// A pen event that isn't due yet (see EmSession::PenEventDue).
+		// Make sure we get back here to deliver it.
+
+		else if (gSession->HasPendingPenEvent ())
+		{
+			clearTimeout = true;
+		}
+
 		// E. None of the above.  Let's see if there's an app
 		//	  we're itching to switch to.
 
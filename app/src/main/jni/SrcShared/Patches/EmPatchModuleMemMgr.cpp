@@ -59,8 +59,8 @@ const int			kPtrResizeValue		= 0x93;
 const int			kPtrFreeValue		= 0x95;
 #endif
 
-static void			PrvRememberHeapAndPtr	(EmPalmHeap* h, emuptr p);
-static EmPalmHeap*	PrvGetRememberedHeap	(emuptr p);
+static void			PrvRememberHeapAndPtr	(EmPalmHeap* h, emuptr p, emuptr body);
+static EmPalmHeap*	PrvGetRememberedHeap	(emuptr p, emuptr& body);
 
 static void			PrvRememberChunk		(emuptr);
 static void			PrvRememberHandle		(emuptr);
@@ -133,7 +133,7 @@ CallROMType MemMgrHeadpatch::MemChunkFree (void)
 	// we need to resync with that heap.
 
 	EmPalmHeap*	heap = const_cast<EmPalmHeap*>(EmPalmHeap::GetHeapByPtr (p));
-	::PrvRememberHeapAndPtr (heap, (emuptr) (MemPtr) p);
+	::PrvRememberHeapAndPtr (heap, (emuptr) (MemPtr) p, (emuptr) (MemPtr) p);
 
 	// In case this chunk contained a stack, forget all references
 	// to that stack (or those stacks).
@@ -198,7 +198,8 @@ CallROMType MemMgrHeadpatch::MemHandleFree (void)
 	// we need to resync with that heap.
 
 	EmPalmHeap*	heap = const_cast<EmPalmHeap*>(EmPalmHeap::GetHeapByHdl (h));
-	::PrvRememberHeapAndPtr (heap, (emuptr) (MemHandle) h);
+	emuptr		body = h ? (emuptr) EmPalmHeap::DerefHandle (h) : EmMemNULL;
+	::PrvRememberHeapAndPtr (heap, (emuptr) (MemHandle) h, body);
 
 	// In case this chunk contained a stack, forget all references
 	// to that stack (or those stacks).
@@ -230,6 +231,37 @@ CallROMType MemMgrHeadpatch::MemHandleFree (void)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	MemMgrHeadpatch::MemHandleResize
+ *
+ * DESCRIPTION:	Remember where the chunk was before it was resized, so
+ *				that the tailpatch can tell whether it moved.
+ *
+ * PARAMETERS:	none
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+CallROMType MemMgrHeadpatch::MemHandleResize (void)
+{
+	// Err MemHandleResize(MemHandle h,  UInt32 newSize) 
+
+	EmPatchState::EnterMemMgr ("MemHandleResize");
+
+	CALLED_SETUP ("Err", "MemHandle h,  UInt32 newSize");
+
+	CALLED_GET_PARAM_VAL (MemHandle, h);
+
+	EmPalmHeap*	heap = const_cast<EmPalmHeap*>(EmPalmHeap::GetHeapByHdl (h));
+	emuptr		body = h ? (emuptr) EmPalmHeap::DerefHandle (h) : EmMemNULL;
+	::PrvRememberHeapAndPtr (heap, (emuptr) (MemHandle) h, body);
+
+	return kExecuteROM;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	MemMgrHeadpatch::MemHandleUnlock
@@ -419,10 +451,11 @@ void MemMgrTailpatch::MemChunkFree (void)
 
 	CALLED_GET_PARAM_VAL (MemPtr, p);
 
-	EmPalmHeap*	heap = ::PrvGetRememberedHeap ((emuptr) (MemPtr) p);
+	emuptr		body;
+	EmPalmHeap*	heap = ::PrvGetRememberedHeap ((emuptr) (MemPtr) p, body);
 
 	EmPalmChunkList	delta;
-	EmPalmHeap::MemChunkFree (heap, &delta);
+	EmPalmHeap::MemChunkFree (heap, (MemPtr) body, &delta);
 	MetaMemory::Resync (delta);
 
 	{
@@ -555,10 +588,11 @@ void MemMgrTailpatch::MemHandleFree (void)
 
 	CALLED_GET_PARAM_VAL (MemHandle, h);
 
-	EmPalmHeap*	heap = ::PrvGetRememberedHeap ((emuptr) (MemHandle) h);
+	emuptr		body;
+	EmPalmHeap*	heap = ::PrvGetRememberedHeap ((emuptr) (MemHandle) h, body);
 
 	EmPalmChunkList	delta;
-	EmPalmHeap::MemHandleFree (heap, &delta);
+	EmPalmHeap::MemHandleFree (heap, (MemPtr) body, &delta);
 	MetaMemory::Resync (delta);
 
 	EmPatchState::ExitMemMgr ("MemHandleFree");
@@ -743,8 +777,11 @@ void MemMgrTailpatch::MemHandleResize (void)
 
 #endif
 
+	emuptr		body;
+	EmPalmHeap*	heap = ::PrvGetRememberedHeap ((emuptr) (MemHandle) h, body);
+
 	EmPalmChunkList	delta;
-	EmPalmHeap::MemHandleResize ((MemHandle) h, &delta);
+	EmPalmHeap::MemHandleResize (heap, (MemHandle) h, (MemPtr) body, &delta);
 	MetaMemory::Resync (delta);
 
 	EmPatchState::ExitMemMgr ("MemHandleResize");
@@ -1170,11 +1207,11 @@ void MemMgrTailpatch::MemPtrUnlock (void)
  *
  ***********************************************************************/
 
-void PrvRememberHeapAndPtr (EmPalmHeap* h, emuptr p)
+void PrvRememberHeapAndPtr (EmPalmHeap* h, emuptr p, emuptr body)
 {
 	EmAssert (EmPatchState::fgData.fRememberedHeaps.find (p) == EmPatchState::fgData.fRememberedHeaps.end ());
 
-	EmPatchState::fgData.fRememberedHeaps[p] = h;
+	EmPatchState::fgData.fRememberedHeaps[p] = EmHeapAndChunk (h, body);
 }
 
 
@@ -1190,14 +1227,17 @@ void PrvRememberHeapAndPtr (EmPalmHeap* h, emuptr p)
  *
  ***********************************************************************/
 
-EmPalmHeap* PrvGetRememberedHeap (emuptr p)
+EmPalmHeap* PrvGetRememberedHeap (emuptr p, emuptr& body)
 {
 	EmPalmHeap*	result = NULL;
 
-	map<emuptr, EmPalmHeap*>::iterator	iter = EmPatchState::fgData.fRememberedHeaps.find (p);
+	body = EmMemNULL;
+
+	EmHeapMap::iterator	iter = EmPatchState::fgData.fRememberedHeaps.find (p);
 	if (iter != EmPatchState::fgData.fRememberedHeaps.end ())
 	{
-		result = iter->second;
+		result = iter->second.first;
+		body = iter->second.second;
 		EmPatchState::fgData.fRememberedHeaps.erase (iter);
 	}
 
@@ -216,7 +216,6 @@ class SysTailpatch
 	DO_TO_FUNCTION(MemPtrResize)			\
 	DO_TO_FUNCTION(MemPtrResetLock)			\
 	DO_TO_FUNCTION(MemHandleNew)			\
-	DO_TO_FUNCTION(MemHandleResize)			\
 	DO_TO_FUNCTION(MemHandleLock)			\
 	DO_TO_FUNCTION(MemHandleResetLock)		\
 	DO_TO_FUNCTION(MemLocalIDToLockedPtr)	\
@@ -234,6 +233,7 @@ class SysTailpatch
 #define FOR_EACH_STUB_NOPATCH_FUNCTION(DO_TO_FUNCTION)	\
 	DO_TO_FUNCTION(MemChunkFree)			\
 	DO_TO_FUNCTION(MemHandleFree)			\
+	DO_TO_FUNCTION(MemHandleResize)			\
 	DO_TO_FUNCTION(MemHandleUnlock)			\
 	DO_TO_FUNCTION(MemPtrUnlock)			\
 
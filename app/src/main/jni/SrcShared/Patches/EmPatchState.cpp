@@ -19,6 +19,7 @@
 
 #include "EmApplication.h"		// ScheduleQuit
 #include "EmMemory.h"			// EmMem_strcpy
+#include "EmSessionContext.h"	// EM_SESSION_OBJECT
 #include "Miscellaneous.h"		// SysTrapIndex, SystemCallContext
 #include "PreferenceMgr.h"		// Preference, kPrefKeyReportMemMgrLeaks
 #include "ROMStubs.h"
@@ -35,6 +36,7 @@ EmStream& operator << (EmStream& inStream, const EmTrackedChunk& inInfo);
 // STATIC class data:
 
 EmPatchStateData EmPatchState::fgData;
+EM_SESSION_OBJECT (EmPatchStateData, EmPatchState::fgData);
 
 
 Err EmPatchState::Initialize (void)
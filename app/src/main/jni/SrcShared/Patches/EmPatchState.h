@@ -27,7 +27,11 @@
 const UInt32	kOSUndeterminedVersion = ~0;
 
 
-typedef map<emuptr, EmPalmHeap*>	EmHeapMap;
+// Maps a pointer or handle being freed to its heap and the body of its
+// chunk, so that the tailpatch can resync just that part of the heap.
+
+typedef pair<EmPalmHeap*, emuptr>	EmHeapAndChunk;
+typedef map<emuptr, EmHeapAndChunk>	EmHeapMap;
 
 
 
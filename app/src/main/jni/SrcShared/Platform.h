@@ -137,6 +137,18 @@ class Platform
 								}
 		static void 			RealDisposeMemory		(void* p);
 
+			// Page-aligned, zeroed memory that a file can later be
+			// mapped over (copy-on-write) with MapFilePages.  If the
+			// mapping fails, the contents of the pages are undefined,
+			// but they're still usable.  UnmapFilePages copies mapped
+			// pages into private memory at the same address, so that
+			// the file can be overwritten.
+		static void*			AllocatePages			(size_t size);
+		static void 			DisposePages			(void* p, size_t size);
+		static Bool				MapFilePages			(void* p, size_t size,
+														 const EmFileRef& f, long offset);
+		static void				UnmapFilePages			(void* p, size_t size);
+
 			// Aliases for DisposeMemory, because I can never remember
 			// what the real name is...
 		template <class T>
@@ -148,6 +160,17 @@ class Platform
 		static Bool				ForceStartupScreen		(void);
 		static Bool 			StopOnResetKeyDown		(void);
 
+			// Start a copy of the emulator with no UI to run part of a
+			// Gremlin Horde, passing it the given command line options
+			// (see Hordes::StartWorkers).  StartHordeWorker returns an
+			// ID for the worker, or -1 if it couldn't be started.
+			// WaitForHordeWorker waits for it to quit, and returns
+			// whether it did so normally.  KillHordeWorker makes it
+			// quit now.
+		static long				StartHordeWorker		(const StringList& options);
+		static Bool				WaitForHordeWorker		(long worker);
+		static void				KillHordeWorker			(long worker);
+
 	// Parse up the command line in a platform-specific fashion.  In particular,
 	// FLTK likes to take over the iteration so that it can scarf up any
 	// standard X options.  We have to let *it* do the iteration in order to
@@ -371,6 +371,9 @@ extern EmulatorPreferences* gEmuPrefs;
 	DO_TO_PREF(FillDisposedBlocks,	bool,				(false))				\
 	DO_TO_PREF(FillStack,			bool,				(false))				\
 																				\
+	DO_TO_PREF(SaveUncompressed,	bool,				(false))				\
+	DO_TO_PREF(Headless,			bool,				(false))				\
+																				\
 	DO_TO_PREF(LastConfiguration,	Configuration,		(EmDevice ("PalmIII"), 1024, EmFileRef()))	\
 																				\
 	DO_TO_PREF(GremlinInfo,			GremlinInfo,		())						\
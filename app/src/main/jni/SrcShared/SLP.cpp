@@ -29,6 +29,12 @@
 
 #define PRINTF	if (!this->LogFlow ()) ; else LogAppendMsg
 
+// Maximum number of already-received packets to gather up before
+// dispatching them.  Keeps a client that streams requests from
+// starving the rest of the UI thread.
+
+const size_t	kMaxQueuedPackets = 64;
+
 static void PrvPrintHeader	(const EmAliasSlkPktHeaderType<LAS>& header);
 static void PrvPrintHeader	(const EmProxySlkPktHeaderType& header);
 static void PrvPrintBody	(const EmAliasSysPktBodyType<LAS>& body);
@@ -54,6 +60,7 @@ SLP::SLP (void) :
 	fHeader (),
 	fBody (),
 	fFooter (),
+	fLargeBody (),
 	fHavePacket(false),
 	fSendReply (true)
 {
@@ -77,6 +84,7 @@ SLP::SLP (CSocket* s) :
 	fHeader (),
 	fBody (),
 	fFooter (),
+	fLargeBody (),
 	fHavePacket (false),
 	fSendReply (true)
 {
@@ -100,6 +108,7 @@ SLP::SLP (const SLP& other) :
 	fHeader (other.fHeader),
 	fBody (other.fBody),
 	fFooter (other.fFooter),
+	fLargeBody (other.fLargeBody),
 	fHavePacket (other.fHavePacket),
 	fSendReply (other.fSendReply)
 {
@@ -129,8 +138,11 @@ SLP::~SLP (void)
  * FUNCTION:	SLP::EventCallback
  *
  * DESCRIPTION: Standard callback for handling SLP packets.  If data
- *				is received, we stop the emulator thread and call
- *				HandleDataReceived to read the dispatch the packet.
+ *				is received, we read every packet the client has
+ *				already sent and hand them to HandlePackets, which
+ *				stops the emulator thread and dispatches them.
+ *				Clients that pipeline their requests thus get them
+ *				served without a CPU stop/resume cycle per packet.
  *				Nothing is done by default on connect and disconnect
  *				events.
  *
@@ -156,8 +168,26 @@ void SLP::EventCallback (CSocket* s, int event)
 		{
 			ErrCode	result;
 			do {
-				SLP slp (s);
-				result = slp.HandleDataReceived ();
+				SLPList	packets;
+
+				do {
+					SLP slp (s);
+					result = slp.ReadPacket ();
+					if (result != errNone)
+						break;
+
+					// !!! Body is too small ... what to do?
+
+					if (slp.Header ().bodySize >= 2)
+						packets.push_back (slp);
+				} while (packets.size () < kMaxQueuedPackets && s->HasUnreadData (0));
+
+				// Dispatch whatever we got, even if the connection
+				// dropped while reading a later packet.
+
+				ErrCode	dispatchResult = SLP::HandlePackets (packets);
+				if (result == errNone)
+					result = dispatchResult;
 			} while (result == errNone && s->HasUnreadData (500));
 			break;
 		}
@@ -179,9 +209,8 @@ void SLP::EventCallback (CSocket* s, int event)
  * FUNCTION:	SLP::HandleDataReceived
  *
  * DESCRIPTION: Called when received data is pending in the socket.
- *				Read that data, break it down into header, body, and
- *				footer sections, and call HandleNewPacket to dispatch
- *				it to the right sub-system.
+ *				Read one packet with ReadPacket and call HandleNewPacket
+ *				to dispatch it to the right sub-system.
  *
  * PARAMETERS:	None
  *
@@ -190,49 +219,83 @@ void SLP::EventCallback (CSocket* s, int event)
  ***********************************************************************/
 
 ErrCode SLP::HandleDataReceived (void)
+{
+	ErrCode result = this->ReadPacket ();
+
+	if (result == errNone)
+	{
+		if (this->Header ().bodySize >= 2)
+			result = this->HandleNewPacket ();
+		else
+			result = errNone;	// !!! Body is too small ... what to do?
+	}
+
+	return result;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SLP::ReadPacket
+ *
+ * DESCRIPTION: Read one packet from the socket, breaking it down into
+ *				header, body, and footer sections.  Bodies larger than
+ *				a standard system packet body are kept whole in
+ *				fLargeBody, with their leading bytes also copied into
+ *				fBody so that Body().command can be examined as usual.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	An error indicating what bad things happened.  Non-zero
+ *				if the connection was closed before a full header
+ *				could be read.
+ *
+ ***********************************************************************/
+
+ErrCode SLP::ReadPacket (void)
 {
 	ErrCode result = errNone;
 
-//	do {
-		EmAssert (fSocket);
+	EmAssert (fSocket);
+
+	long		amtRead;
+	ErrCode 	err = fSocket->Read (	this->Header ().GetPtr (),
+										this->Header ().GetSize (),
+										&amtRead);
 
-		long		amtRead;
-		ErrCode 	err = fSocket->Read (	this->Header ().GetPtr (),
-											this->Header ().GetSize (),
-											&amtRead);
+	if (err == errNone && amtRead == (long) this->Header ().GetSize ())
+	{
+		fHavePacket = true;
 
-		if (err == errNone && amtRead == (long) this->Header ().GetSize ())
+		long	bodySize = this->Header ().bodySize;
+
+		if (bodySize > (long) this->Body ().GetSize ())
 		{
-			fHavePacket = true;
+			fLargeBody.resize (bodySize);
 
-			if (this->Header ().bodySize > 0)
-			{
-				fSocket->Read (	this->Body ().GetPtr (),
-								this->Header ().bodySize,
-								NULL);
-			}
+			fSocket->Read (&fLargeBody[0], bodySize, NULL);
 
-			if (!fSocket->ShortPacketHack ())
-			{
-				fSocket->Read (	this->Footer ().GetPtr (),
-								this->Footer ().GetSize (),
-								NULL);
-			}
+			memcpy (this->Body ().GetPtr (), &fLargeBody[0], this->Body ().GetSize ());
+		}
+		else if (bodySize > 0)
+		{
+			fSocket->Read (this->Body ().GetPtr (), bodySize, NULL);
+		}
 
-			if (this->Header ().bodySize >= 2)
-				result = this->HandleNewPacket ();
-			else
-				result = errNone;	// !!! Body is too small ... what to do?
+		if (!fSocket->ShortPacketHack ())
+		{
+			fSocket->Read (	this->Footer ().GetPtr (),
+							this->Footer ().GetSize (),
+							NULL);
 		}
-		else
+	}
+	else
+	{
+		if (err == errNone)
 		{
-//			fSocket = NULL; // Disconnected?
-			if (err == errNone)
-			{
-				result = 1;
-			}
+			result = 1;
 		}
-//	} while (result == errNone && fSocket && fSocket->HasUnreadData (500));
+	}
 
 	return result;
 }
@@ -275,17 +338,12 @@ ErrCode SLP::HandleNewPacket ()
 		EmSessionStopper	stopper (gSession, kStopNow);
 		if (stopper.Stopped ())
 		{
-			PrvPrintHeader (this->Header ());
-			PrvPrintBody (this->Body ());
-			PrvPrintFooter (this->Footer ());
+			this->LogNewPacket ();
 		}
 	}
-	else if (this->LogFlow ())
+	else
 	{
-		if (PacketName (this->Body().command))
-			LogAppendMsg (" Received %s packet.", PacketName (this->Body().command));
-		else
-			LogAppendMsg (" Received unknown (0x%02X) packet.", (UInt8) this->Body().command);
+		this->LogNewPacket ();
 	}
 
 	// Dispatch the packet to the right sub-system.
@@ -297,51 +355,18 @@ ErrCode SLP::HandleNewPacket ()
 			EmSessionStopper	stopper (gSession, kStopNow);
 			if (stopper.Stopped ())
 			{
-				try
-				{
-					result = Debug::HandleNewPacket (*this);
-				}
-				catch (EmExceptionReset&)
-				{
-					gSession->Reset (kResetSoft);
-					throw;
-				}
+				result = this->DispatchPacket ();
 			}
 		}
 		break;
 
 		case slkSocketConsole:
-		{
-			EmSessionStopper	stopper (gSession, kStopOnSysCall);
-			if (stopper.Stopped ())
-			{
-				try
-				{
-					result = Debug::HandleNewPacket (*this);
-				}
-				catch (EmExceptionReset&)
-				{
-					gSession->Reset (kResetSoft);
-					throw;
-				}
-			}
-		}
-		break;
-
 		case slkSocketRPC:
 		{
 			EmSessionStopper	stopper (gSession, kStopOnSysCall);
 			if (stopper.Stopped ())
 			{
-				try
-				{
-					result = RPC::HandleNewPacket (*this);
-				}
-				catch (EmExceptionReset&)
-				{
-					gSession->Reset (kResetSoft);
-					throw;
-				}
+				result = this->DispatchPacket ();
 			}
 		}
 		break;
@@ -358,6 +383,166 @@ ErrCode SLP::HandleNewPacket ()
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	SLP::HandlePackets
+ *
+ * DESCRIPTION: Dispatch a list of packets read off the same socket, in
+ *				order.  Each run of consecutive RPC packets is served
+ *				under a single CPU stop instead of stopping and
+ *				resuming the emulator thread around each one.  Other
+ *				packets go through HandleNewPacket individually, as
+ *				the debugger sockets care about the CPU state between
+ *				packets (for instance, after a Continue).
+ *
+ * PARAMETERS:	packets - the packets to dispatch.
+ *
+ * RETURNED:	The result of the last packet handled.
+ *
+ ***********************************************************************/
+
+ErrCode SLP::HandlePackets (SLPList& packets)
+{
+	ErrCode 			result = kError_NoError;
+	SLPList::iterator	iter = packets.begin ();
+
+	while (iter != packets.end ())
+	{
+		if (iter->Header ().dest != slkSocketRPC)
+		{
+			result = iter->HandleNewPacket ();
+			++iter;
+			continue;
+		}
+
+		EmSessionStopper	stopper (gSession, kStopOnSysCall);
+		if (!stopper.Stopped ())
+		{
+			// Same as HandleNewPacket: if we couldn't stop the
+			// CPU, the packets go unanswered.
+
+			while (iter != packets.end () && iter->Header ().dest == slkSocketRPC)
+				++iter;
+
+			continue;
+		}
+
+		while (iter != packets.end () && iter->Header ().dest == slkSocketRPC)
+		{
+			result = iter->HandleStoppedPacket ();
+			++iter;
+		}
+	}
+
+	return result;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SLP::HandleStoppedPacket
+ *
+ * DESCRIPTION: Same as HandleNewPacket, but for use when the caller
+ *				has already stopped the CPU thread.
+ *
+ * PARAMETERS:	None.
+ *
+ * RETURNED:	An error indicating what bad things happened.
+ *
+ ***********************************************************************/
+
+ErrCode SLP::HandleStoppedPacket (void)
+{
+	PRINTF ("Entering SLP::HandleStoppedPacket.");
+
+	this->LogNewPacket ();
+
+	ErrCode result = this->DispatchPacket ();
+
+	PRINTF ("Exiting SLP::HandleStoppedPacket.");
+
+	return result;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SLP::DispatchPacket
+ *
+ * DESCRIPTION: Hand the packet off to the sub-system handling its
+ *				destination socket.  The CPU thread must already be
+ *				stopped.
+ *
+ * PARAMETERS:	None.
+ *
+ * RETURNED:	An error indicating what bad things happened.
+ *
+ ***********************************************************************/
+
+ErrCode SLP::DispatchPacket (void)
+{
+	ErrCode result = kError_NoError;
+
+	try
+	{
+		switch (this->Header().dest)
+		{
+			case slkSocketDebugger:
+			case slkSocketConsole:
+				result = Debug::HandleNewPacket (*this);
+				break;
+
+			case slkSocketRPC:
+				result = RPC::HandleNewPacket (*this);
+				break;
+
+			default:
+				result = slkErrWrongDestSocket;
+				PRINTF ("Unknown destination: %ld.", (long) this->Header ().dest);
+				break;
+		}
+	}
+	catch (EmExceptionReset&)
+	{
+		gSession->Reset (kResetSoft);
+		throw;
+	}
+
+	return result;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SLP::LogNewPacket
+ *
+ * DESCRIPTION: Log the receipt of a packet, if requested.  When logging
+ *				packet data, the CPU thread must already be stopped.
+ *
+ * PARAMETERS:	None.
+ *
+ * RETURNED:	Nothing.
+ *
+ ***********************************************************************/
+
+void SLP::LogNewPacket (void)
+{
+	if (this->LogData ())
+	{
+		PrvPrintHeader (this->Header ());
+		PrvPrintBody (this->Body ());
+		PrvPrintFooter (this->Footer ());
+	}
+	else if (this->LogFlow ())
+	{
+		if (PacketName (this->Body().command))
+			LogAppendMsg (" Received %s packet.", PacketName (this->Body().command));
+		else
+			LogAppendMsg (" Received unknown (0x%02X) packet.", (UInt8) this->Body().command);
+	}
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	SLP::SendPacket
@@ -599,6 +784,28 @@ EmProxySysPktBodyType& SLP::Body (void)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	SLP::GetBodyPtr
+ *
+ * DESCRIPTION: Return a pointer to the complete packet body, which may
+ *				be larger than the SysPktBodyType returned by Body.
+ *
+ * PARAMETERS:	None
+ *
+ * RETURNED:	Pointer to the body bytes.
+ *
+ ***********************************************************************/
+
+const void* SLP::GetBodyPtr (void) const
+{
+	if (!fLargeBody.empty ())
+		return &fLargeBody[0];
+
+	return fBody.GetPtr ();
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	SLP:: Footer
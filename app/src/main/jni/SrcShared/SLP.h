@@ -15,9 +15,13 @@
 #define SLP_H_
 
 #include "EmPalmStructs.h"		// SlkPktHeaderType, SysPktBodyType, LAS
+#include "EmStructs.h"			// ByteList
 #include "EmTypes.h"			// ErrCode
 
 class CSocket;
+class SLP;
+
+typedef vector<SLP>		SLPList;
 
 class SLP
 {
@@ -29,8 +33,10 @@ class SLP
 
 		static void 			EventCallback	(CSocket* s, int event);
 		ErrCode 				HandleDataReceived	(void);
+		ErrCode 				ReadPacket		(void);
 
 		ErrCode 				HandleNewPacket (void);
+		static ErrCode			HandlePackets	(SLPList&);
 		ErrCode 				SendPacket		(const void* body, long size);
 
 		Bool					HavePacket		(void) const;
@@ -44,11 +50,20 @@ class SLP
 		EmProxySysPktBodyType&			Body	(void);
 		EmProxySlkPktFooterType&		Footer	(void);
 
+		// The whole packet body.  Same as Body().GetPtr() unless the
+		// body is larger than a standard system packet body, as can
+		// happen with batched memory requests.
+		const void*				GetBodyPtr		(void) const;
+
 		void					DeferReply		(Bool);
 
 		Bool					HasSocket		(CSocket* s) { return s == fSocket; }
 
 	private:
+		ErrCode 				HandleStoppedPacket	(void);
+		ErrCode 				DispatchPacket	(void);
+		void					LogNewPacket	(void);
+
 		void					SetHeader		(void);
 		void					SetBody			(void);
 		void					SetFooter		(void);
@@ -65,6 +80,7 @@ class SLP
 		EmProxySlkPktHeaderType	fHeader;
 		EmProxySysPktBodyType	fBody;
 		EmProxySlkPktFooterType	fFooter;
+		ByteList				fLargeBody;
 
 		Bool					fHavePacket;
 		Bool					fSendReply;
@@ -15,13 +15,22 @@
 #include "SessionFile.h"
 
 #include "Byteswapping.h"		// Canonical
+#include "EmBankSRAM.h"			// kRAMDirtyPageSize
 #include "EmErrCodes.h"			// kError_InvalidDevice
 #include "EmPalmStructs.h"		// EmProxySED1376RegsType
 #include "EmStreamFile.h"		// EmStreamFile
 #include "ErrorHandling.h"		// Errors::Throw
 #include "Miscellaneous.h"		// StMemory, RunLengthEncode, GzipEncode, etc.
+#include "Platform.h"			// Platform::MapFilePages
 #include "UAE.h"				// regstruct
 
+#if HAS_OMNI_THREAD
+#include "omnithread.h"			// omni_thread, omni_mutex
+#endif
+
+#include <string.h>				// memcpy, memmove
+#include <unistd.h>				// sysconf
+
 
 /***********************************************************************
  *
@@ -43,7 +52,11 @@ SessionFile::SessionFile (ChunkFile& f) :
 	fCfg (),
 	fReadBugFixes (false),
 	fChangedBugFixes (false),
-	fBugFixes (0)
+	fBugFixes (0),
+	fSnapshot (NULL),
+	fFileRef (),
+	fIncremental (false),
+	fUncompressed (false)
 {
 }
 
@@ -160,7 +173,10 @@ Bool SessionFile::ReadROMFileReference (EmFileRef& f)
 
 Bool SessionFile::ReadRAMImage (void* image)
 {
-	Bool	result = this->ReadChunk (kRAMDataTag, image, kGzipCompression);
+	Bool	result = this->ReadChunk (kBlockRAMDataTag, image, kBlockCompression);
+
+	if (!result)
+		result = this->ReadChunk (kRAMDataTag, image, kGzipCompression);
 
 	if (!result)
 		result = this->ReadChunk (kRLERAMDataTag, image, kRLECompression);
@@ -168,10 +184,111 @@ Bool SessionFile::ReadRAMImage (void* image)
 	if (!result)
 		result = this->ReadChunk (kUncompRAMDataTag, image, kNoCompression);
 
+	if (!result)
+	{
+		// Native images are in host layout; callers expect it to be
+		// canonical.
+
+		long	size = this->FindNativeImage (kNativeRAMDataTag);
+		if (size != ChunkFile::kChunkNotFound)
+		{
+			fFile.ReadChunk (size, image);
+			::ByteswapWords (image, size);
+			result = true;
+		}
+	}
+
+	if (!result)
+		result = this->ReadRAMDelta (image);
+
 	return result;
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::ReadRAMDelta
+ *
+ * DESCRIPTION:	Read an incremental RAM image.  The full image is read
+ *				from the base file named in this one, and then the pages
+ *				recorded in this file are applied to it.  The base file
+ *				must still have the ID it had when this file was saved.
+ *
+ * PARAMETERS:	image - pointer to the buffer to receive the RAM image.
+ *
+ * RETURNED:	True if the image was found and could be read in.
+ *
+ ***********************************************************************/
+
+Bool SessionFile::ReadRAMDelta (void* image)
+{
+	EmFileRef	baseRef;
+	uint32		baseID;
+	uint32		ramSize;
+	Chunk		delta;
+
+	if (!this->ReadRAMBase (baseRef, baseID))
+		return false;
+
+	if (!fFile.ReadInt (kRAMDeltaSizeTag, ramSize))
+		return false;
+
+	if (!this->ReadChunk (kBlockRAMDeltaTag, delta, kBlockCompression) &&
+		!this->ReadChunk (kRAMDeltaTag, delta, kGzipCompression))
+		return false;
+
+	if (!baseRef.Exists ())
+		return false;
+
+	// Read the base image.
+
+	{
+		EmStreamFile	stream (baseRef, kOpenExistingForRead);
+		ChunkFile		chunkFile (stream);
+		SessionFile		baseFile (chunkFile);
+
+		uint32	id;
+		if (!baseFile.ReadRAMBaseID (id) || id != baseID)
+			return false;
+
+		if (baseFile.GetRAMImageSize () != (long) ramSize)
+			return false;
+
+		if (!baseFile.ReadRAMImage (image))
+			return false;
+	}
+
+	// Apply the changed pages.
+
+	EmStreamChunk	s (delta);
+	uint32			pageSize;
+	uint32			numPages;
+
+	s >> pageSize;
+	s >> numPages;
+
+	// Don't trust the file: the pages must be the size we write, and
+	// each one must lie wholly within the RAM image.  (Compare against
+	// ramSize - pageSize so that a bogus offset can't wrap around.)
+
+	if (pageSize != kRAMDirtyPageSize || ramSize < pageSize)
+		return false;
+
+	while (numPages--)
+	{
+		uint32	offset;
+		s >> offset;
+
+		if (offset > ramSize - pageSize)
+			return false;
+
+		s.GetBytes (((uint8*) image) + offset, pageSize);
+	}
+
+	return true;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	SessionFile::ReadMetaRAMImage
@@ -192,15 +309,142 @@ Bool SessionFile::ReadRAMImage (void* image)
 
 Bool SessionFile::ReadMetaRAMImage (void* image)
 {
-	Bool	result = this->ReadChunk (kMetaRAMDataTag, image, kGzipCompression);
+	Bool	result = this->ReadChunk (kBlockMetaRAMDataTag, image, kBlockCompression);
+
+	if (!result)
+		result = this->ReadChunk (kMetaRAMDataTag, image, kGzipCompression);
 
 	if (!result)
 		result = this->ReadChunk (kRLEMetaRAMDataTag, image, kRLECompression);
 
+	if (!result)
+	{
+		long	size = this->FindNativeImage (kNativeMetaRAMDataTag);
+		if (size != ChunkFile::kChunkNotFound)
+		{
+			fFile.ReadChunk (size, image);
+			::ByteswapWords (image, size);
+			result = true;
+		}
+	}
+
 	return result;
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::ReadNativeRAMImage
+ *
+ * DESCRIPTION:	Read the RAM image if it was written in uncompressed
+ *				mode.  If possible, the image is mapped in from the
+ *				file rather than read, so that pages are only read
+ *				from disk when they're touched.  Unlike ReadRAMImage,
+ *				the image is left in host layout.
+ *
+ * PARAMETERS:	image - pointer to memory from Platform::AllocatePages
+ *					to receive the image.
+ *
+ *				size - size of the image.  The image in the file must
+ *					be exactly this size.
+ *
+ *				mapped - set to true if the image was mapped from the
+ *					file.  The file must not be overwritten while it's
+ *					mapped.
+ *
+ * RETURNED:	True if the image was found and could be read in.
+ *
+ ***********************************************************************/
+
+Bool SessionFile::ReadNativeRAMImage (void* image, uint32 size, Bool& mapped)
+{
+	return this->ReadNativeImage (kNativeRAMDataTag, image, size, mapped);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::ReadNativeMetaRAMImage
+ *
+ * DESCRIPTION:	Read the MetaRAM image if it was written in
+ *				uncompressed mode.  See ReadNativeRAMImage.
+ *
+ * PARAMETERS:	image - pointer to memory from Platform::AllocatePages
+ *					to receive the image.
+ *
+ *				size - size of the image.
+ *
+ *				mapped - set to true if the image was mapped from the
+ *					file.
+ *
+ * RETURNED:	True if the image was found and could be read in.
+ *
+ ***********************************************************************/
+
+Bool SessionFile::ReadNativeMetaRAMImage (void* image, uint32 size, Bool& mapped)
+{
+	return this->ReadNativeImage (kNativeMetaRAMDataTag, image, size, mapped);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::ReadRAMBaseID
+ *
+ * DESCRIPTION:	Read the ID of the full RAM image in this file.  Only
+ *				files that can serve as the base for incremental saves
+ *				have one.
+ *
+ * PARAMETERS:	id - reference to the integer to receive the ID.
+ *
+ * RETURNED:	True if the value was found and could be read in.
+ *
+ ***********************************************************************/
+
+Bool SessionFile::ReadRAMBaseID (uint32& id)
+{
+	return fFile.ReadInt (kRAMBaseIDTag, id);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::ReadRAMBase
+ *
+ * DESCRIPTION:	Read the reference to the base file that the RAM image
+ *				in this file is relative to.
+ *
+ * PARAMETERS:	ref - reference to the EmFileRef to receive the base.
+ *
+ *				id - reference to the integer to receive the ID of
+ *					the base's RAM image.
+ *
+ * RETURNED:	True if the value was found and could be read in.
+ *
+ ***********************************************************************/
+
+Bool SessionFile::ReadRAMBase (EmFileRef& ref, uint32& id)
+{
+	Chunk	chunk;
+	if (!fFile.ReadChunk (kRAMBaseTag, chunk))
+		return false;
+
+	EmStreamChunk	s (chunk);
+	string			prefString;
+
+	s >> id;
+	s >> prefString;
+
+	if (prefString.empty ())
+	{
+		ref = EmFileRef ();
+		return true;
+	}
+
+	return ref.FromPrefString (prefString);
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	SessionFile::ReadMetaROMImage
@@ -221,7 +465,10 @@ Bool SessionFile::ReadMetaRAMImage (void* image)
 
 Bool SessionFile::ReadMetaROMImage (void* image)
 {
-	Bool	result = this->ReadChunk (kMetaROMDataTag, image, kGzipCompression);
+	Bool	result = this->ReadChunk (kBlockMetaROMDataTag, image, kBlockCompression);
+
+	if (!result)
+		result = this->ReadChunk (kMetaROMDataTag, image, kGzipCompression);
 
 	return result;
 }
@@ -533,15 +780,31 @@ long SessionFile::GetRAMImageSize (void)
 {
 	long	numBytes;
 
-	Chunk	chunk;
-	if (fFile.ReadChunk (kRAMDataTag, chunk) || fFile.ReadChunk (kRLERAMDataTag, chunk))
+	// Compressed images start with their unpacked size, so there's no
+	// need to read in the rest of the chunk.
+
+	if (fFile.FindChunk (kBlockRAMDataTag) != ChunkFile::kChunkNotFound ||
+		fFile.FindChunk (kRAMDataTag) != ChunkFile::kChunkNotFound ||
+		fFile.FindChunk (kRLERAMDataTag) != ChunkFile::kChunkNotFound)
 	{
-		EmStreamChunk	s (chunk);
-		s >> numBytes;
+		fFile.ReadChunk (sizeof (numBytes), &numBytes);
+		Canonical (numBytes);
 	}
 	else
 	{
-		numBytes = fFile.FindChunk (kUncompRAMDataTag);
+		numBytes = this->FindNativeImage (kNativeRAMDataTag);
+
+		if (numBytes == ChunkFile::kChunkNotFound)
+			numBytes = fFile.FindChunk (kUncompRAMDataTag);
+	}
+
+	if (numBytes == ChunkFile::kChunkNotFound)
+	{
+		uint32	deltaSize;
+		if (fFile.ReadInt (kRAMDeltaSizeTag, deltaSize))
+		{
+			numBytes = deltaSize;
+		}
 	}
 
 	return numBytes;
@@ -600,7 +863,7 @@ void SessionFile::WriteROMFileReference (const EmFileRef& f)
 
 void SessionFile::WriteRAMImage (const void* image, uint32 size)
 {
-	this->WriteChunk (kRAMDataTag, size, image, kGzipCompression);
+	this->WriteChunk (kBlockRAMDataTag, size, image, kBlockCompression);
 	fCfg.fRAMSize = size / 1024;
 }
 
@@ -624,7 +887,7 @@ void SessionFile::WriteRAMImage (const void* image, uint32 size)
 
 void SessionFile::WriteMetaRAMImage (const void* image, uint32 size)
 {
-	this->WriteChunk (kMetaRAMDataTag, size, image, kGzipCompression);
+	this->WriteChunk (kBlockMetaRAMDataTag, size, image, kBlockCompression);
 }
 
 
@@ -647,7 +910,124 @@ void SessionFile::WriteMetaRAMImage (const void* image, uint32 size)
 
 void SessionFile::WriteMetaROMImage (const void* image, uint32 size)
 {
-	this->WriteChunk (kMetaROMDataTag, size, image, kGzipCompression);
+	this->WriteChunk (kBlockMetaROMDataTag, size, image, kBlockCompression);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::WriteRAMBaseID
+ *
+ * DESCRIPTION:	Write the ID of the full RAM image in this file, so that
+ *				incremental saves based on it can tell if it's been
+ *				replaced.
+ *
+ * PARAMETERS:	id - the ID to write.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void SessionFile::WriteRAMBaseID (uint32 id)
+{
+	fFile.WriteInt (kRAMBaseIDTag, id);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::WriteRAMBase
+ *
+ * DESCRIPTION:	Write a reference to the file holding the full RAM image
+ *				that the RAM image in this file is relative to.
+ *
+ * PARAMETERS:	ref - the base file.
+ *
+ *				id - the ID of the base's RAM image.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void SessionFile::WriteRAMBase (const EmFileRef& ref, uint32 id)
+{
+	Chunk			chunk;
+	EmStreamChunk	s (chunk);
+
+	s << id;
+	s << (ref.IsSpecified () ? ref.ToPrefString () : string ());
+
+	fFile.WriteChunk (kRAMBaseTag, chunk);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::WriteRAMDelta
+ *
+ * DESCRIPTION:	Write an incremental RAM image.  WriteRAMBase should
+ *				also be called to record what it's relative to.
+ *
+ * PARAMETERS:	delta - the page size, the number of pages, and then
+ *					the offset and contents of each page.
+ *
+ *				size - the size of the full RAM image.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void SessionFile::WriteRAMDelta (const Chunk& delta, uint32 size)
+{
+	fFile.WriteInt (kRAMDeltaSizeTag, size);
+	this->WriteChunk (kBlockRAMDeltaTag, delta, kBlockCompression);
+	fCfg.fRAMSize = size / 1024;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::WriteNativeRAMImage
+ *
+ * DESCRIPTION:	Write the given data as the RAM image for the session
+ *				file, uncompressed and in host layout, so that it can
+ *				be mapped back in by ReadNativeRAMImage.
+ *
+ * PARAMETERS:	image - pointer to the data to be written.  Unlike
+ *					WriteRAMImage, the data is not expected to have
+ *					been byteswapped.
+ *
+ *				size - number of bytes in the image.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void SessionFile::WriteNativeRAMImage (const void* image, uint32 size)
+{
+	this->WriteNativeImage (kNativeRAMDataTag, image, size);
+	fCfg.fRAMSize = size / 1024;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::WriteNativeMetaRAMImage
+ *
+ * DESCRIPTION:	Write the given data as the MetaRAM image for the
+ *				session file, uncompressed and in host layout.
+ *
+ * PARAMETERS:	image - pointer to the data to be written.
+ *
+ *				size - number of bytes in the image.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void SessionFile::WriteNativeMetaRAMImage (const void* image, uint32 size)
+{
+	this->WriteNativeImage (kNativeMetaRAMDataTag, image, size);
 }
 
 
@@ -919,6 +1299,303 @@ Bool SessionFile::IncludesBugFix (BugFix val)
 }
 
 
+#pragma mark -
+
+// ---------------------------------------------------------------------------
+//		Block compression
+// ---------------------------------------------------------------------------
+// Images written with kBlockCompression are split into blocks that are each
+// packed with Lz4Encode.  The blocks don't depend on each other, so they're
+// packed and unpacked on several threads at once.  After the unpacked size
+// stored at the start of every compressed chunk comes:
+//
+//		block size: 4 bytes
+//		block count: 4 bytes
+//		packed sizes: 4 bytes per block; kBlockStored is set if the block
+//			didn't compress and is stored as-is
+//		packed blocks
+//
+// All integers are Big Endian.
+
+const uint32	kBlockSize			= 256 * 1024L;
+const uint32	kBlockStored		= 0x80000000;
+const int		kMaxBlockThreads	= 8;
+
+struct PrvBlockJob
+{
+	const uint8*	fSrc;
+	long			fSrcSize;
+	uint8*			fDest;
+	long			fDestSize;
+	long			fPackedSize;
+	Bool			fStored;
+	Bool			fOK;
+};
+
+struct PrvBlockWork
+{
+	PrvBlockJob*	fJobs;
+	long			fNumJobs;
+	long			fNextJob;
+	Bool			fEncode;
+#if HAS_OMNI_THREAD
+	omni_mutex		fMutex;
+#endif
+};
+
+
+static inline void PrvPutBlockInt (uint8* p, uint32 v)
+{
+	p[0] = (uint8) (v >> 24);
+	p[1] = (uint8) (v >> 16);
+	p[2] = (uint8) (v >> 8);
+	p[3] = (uint8) (v);
+}
+
+
+static inline uint32 PrvGetBlockInt (const uint8* p)
+{
+	return	((uint32) p[0] << 24) |
+			((uint32) p[1] << 16) |
+			((uint32) p[2] << 8) |
+			((uint32) p[3]);
+}
+
+
+static void PrvDoBlockJob (PrvBlockJob& job, Bool encode)
+{
+	void*	src = (void*) job.fSrc;
+	void*	dest = job.fDest;
+
+	if (encode)
+	{
+		::Lz4Encode (&src, &dest, job.fSrcSize, job.fDestSize);
+
+		job.fPackedSize = (uint8*) dest - job.fDest;
+		job.fStored = job.fPackedSize >= job.fSrcSize;
+		job.fOK = true;
+
+		if (job.fStored)
+		{
+			memcpy (job.fDest, job.fSrc, job.fSrcSize);
+			job.fPackedSize = job.fSrcSize;
+		}
+	}
+	else if (job.fStored)
+	{
+		job.fOK = job.fSrcSize == job.fDestSize;
+
+		if (job.fOK)
+		{
+			memcpy (job.fDest, job.fSrc, job.fSrcSize);
+		}
+	}
+	else
+	{
+		::Lz4Decode (&src, &dest, job.fSrcSize, job.fDestSize);
+
+		job.fOK =
+			(const uint8*) src == job.fSrc + job.fSrcSize &&
+			(uint8*) dest == job.fDest + job.fDestSize;
+	}
+}
+
+
+static void* PrvBlockThread (void* arg)
+{
+	PrvBlockWork&	work = *(PrvBlockWork*) arg;
+
+	for (;;)
+	{
+		PrvBlockJob*	job;
+
+		{
+#if HAS_OMNI_THREAD
+			omni_mutex_lock	lock (work.fMutex);
+#endif
+			if (work.fNextJob >= work.fNumJobs)
+				break;
+
+			job = &work.fJobs[work.fNextJob++];
+		}
+
+		::PrvDoBlockJob (*job, work.fEncode);
+	}
+
+	return NULL;
+}
+
+
+static void PrvRunBlockJobs (PrvBlockWork& work)
+{
+#if HAS_OMNI_THREAD
+	// One thread per processor, counting this one, and no more
+	// than there are blocks.
+
+	long	numThreads = 0;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	numThreads = sysconf (_SC_NPROCESSORS_ONLN) - 1;
+#endif
+
+	if (numThreads > work.fNumJobs - 1)
+		numThreads = work.fNumJobs - 1;
+
+	if (numThreads > kMaxBlockThreads)
+		numThreads = kMaxBlockThreads;
+
+	omni_thread*	threads[kMaxBlockThreads];
+
+	for (long ii = 0; ii < numThreads; ++ii)
+	{
+		threads[ii] = new omni_thread (&::PrvBlockThread, &work);
+		threads[ii]->start ();
+	}
+#endif
+
+	::PrvBlockThread (&work);
+
+#if HAS_OMNI_THREAD
+	// The thread objects delete themselves when joined.
+
+	for (long ii = 0; ii < numThreads; ++ii)
+	{
+		threads[ii]->join (NULL);
+	}
+#endif
+}
+
+
+static long PrvBlockWorstSize (long srcBytes)
+{
+	long	numBlocks = (srcBytes + kBlockSize - 1) / kBlockSize;
+
+	return 8 + numBlocks * (4 + ::Lz4WorstSize (kBlockSize));
+}
+
+
+static void PrvBlockEncode (void** srcPP, void** dstPP, long srcBytes, long dstBytes)
+{
+	UNUSED_PARAM(dstBytes)
+
+	const uint8*	src = (const uint8*) *srcPP;
+	uint8*			dest = (uint8*) *dstPP;
+	long			numBlocks = (srcBytes + kBlockSize - 1) / kBlockSize;
+	long			worstBlockSize = ::Lz4WorstSize (kBlockSize);
+	uint8*			tableP = dest + 8;
+	uint8*			dataP = tableP + numBlocks * 4;
+
+	// Pack each block into its own worst-case sized slot.
+
+	vector<PrvBlockJob>	jobs (numBlocks);
+
+	for (long ii = 0; ii < numBlocks; ++ii)
+	{
+		long	offset = ii * kBlockSize;
+
+		jobs[ii].fSrc		= src + offset;
+		jobs[ii].fSrcSize	= min ((long) kBlockSize, srcBytes - offset);
+		jobs[ii].fDest		= dataP + ii * worstBlockSize;
+		jobs[ii].fDestSize	= worstBlockSize;
+	}
+
+	PrvBlockWork	work;
+
+	work.fJobs		= numBlocks ? &jobs[0] : NULL;
+	work.fNumJobs	= numBlocks;
+	work.fNextJob	= 0;
+	work.fEncode	= true;
+
+	::PrvRunBlockJobs (work);
+
+	// Write the header, and close up the gaps between the blocks.
+
+	::PrvPutBlockInt (dest, kBlockSize);
+	::PrvPutBlockInt (dest + 4, numBlocks);
+
+	uint8*	outP = dataP;
+
+	for (long ii = 0; ii < numBlocks; ++ii)
+	{
+		::PrvPutBlockInt (tableP + ii * 4,
+			jobs[ii].fPackedSize | (jobs[ii].fStored ? kBlockStored : 0));
+
+		memmove (outP, jobs[ii].fDest, jobs[ii].fPackedSize);
+		outP += jobs[ii].fPackedSize;
+	}
+
+	*srcPP = (void*) (src + srcBytes);
+	*dstPP = (void*) outP;
+}
+
+
+static Bool PrvBlockDecode (void** srcPP, void** dstPP, long srcBytes, long dstBytes)
+{
+	const uint8*	src = (const uint8*) *srcPP;
+	uint8*			dest = (uint8*) *dstPP;
+
+	if (srcBytes < 8)
+		return false;
+
+	uint32	blockSize = ::PrvGetBlockInt (src);
+	uint32	numBlocks = ::PrvGetBlockInt (src + 4);
+
+	if (blockSize == 0 || numBlocks != (dstBytes + blockSize - 1) / blockSize)
+		return false;
+
+	if (numBlocks > (uint32) (srcBytes - 8) / 4)
+		return false;
+
+	const uint8*	tableP = src + 8;
+	const uint8*	dataP = tableP + numBlocks * 4;
+	long			remaining = srcBytes - (dataP - src);
+
+	vector<PrvBlockJob>	jobs (numBlocks);
+
+	for (uint32 ii = 0; ii < numBlocks; ++ii)
+	{
+		uint32	entry = ::PrvGetBlockInt (tableP + ii * 4);
+		long	packedSize = entry & ~kBlockStored;
+		long	offset = ii * blockSize;
+
+		if (packedSize > remaining)
+			return false;
+
+		jobs[ii].fSrc		= dataP;
+		jobs[ii].fSrcSize	= packedSize;
+		jobs[ii].fDest		= dest + offset;
+		jobs[ii].fDestSize	= min ((long) blockSize, dstBytes - offset);
+		jobs[ii].fStored	= (entry & kBlockStored) != 0;
+		jobs[ii].fOK		= false;
+
+		dataP += packedSize;
+		remaining -= packedSize;
+	}
+
+	PrvBlockWork	work;
+
+	work.fJobs		= numBlocks ? &jobs[0] : NULL;
+	work.fNumJobs	= numBlocks;
+	work.fNextJob	= 0;
+	work.fEncode	= false;
+
+	::PrvRunBlockJobs (work);
+
+	for (uint32 ii = 0; ii < numBlocks; ++ii)
+	{
+		if (!jobs[ii].fOK)
+			return false;
+	}
+
+	*srcPP = (void*) dataP;
+	*dstPP = (void*) (dest + dstBytes);
+
+	return true;
+}
+
+
+#pragma mark -
+
 /***********************************************************************
  *
  * FUNCTION:	SessionFile::ReadChunk
@@ -991,7 +1668,12 @@ Bool SessionFile::ReadChunk (ChunkFile::Tag tag, void* image,
 
 			// Decompress the data into the dest buffer.
 
-			if (compType == kGzipCompression)
+			if (compType == kBlockCompression)
+			{
+				if (!::PrvBlockDecode (&src, &dest, chunkSize - sizeof (long), unpackedSize))
+					return false;
+			}
+			else if (compType == kGzipCompression)
 				::GzipDecode (&src, &dest, chunkSize - sizeof (long), unpackedSize);
 			else
 				::RunLengthDecode (&src, &dest, chunkSize - sizeof (long), unpackedSize);
@@ -1051,7 +1733,12 @@ Bool SessionFile::ReadChunk (ChunkFile::Tag tag, Chunk& chunk,
 
 			// Decompress the data into the dest buffer.
 
-			if (compType == kGzipCompression)
+			if (compType == kBlockCompression)
+			{
+				if (!::PrvBlockDecode (&src, &dest, chunkSize - sizeof (long), unpackedSize))
+					return false;
+			}
+			else if (compType == kGzipCompression)
 				::GzipDecode (&src, &dest, chunkSize - sizeof (long), unpackedSize);
 			else
 				::RunLengthDecode (&src, &dest, chunkSize - sizeof (long), unpackedSize);
@@ -1098,7 +1785,9 @@ void SessionFile::WriteChunk (ChunkFile::Tag tag, uint32 size,
 		// Get the worst-case size for the compressed data.
 
 		long		worstPackedSize = sizeof (long) +
-						((compType == kGzipCompression)
+						((compType == kBlockCompression)
+							? ::PrvBlockWorstSize (size)
+						: (compType == kGzipCompression)
 							? ::GzipWorstSize (size)
 							: ::RunLengthWorstSize (size));
 
@@ -1121,7 +1810,9 @@ void SessionFile::WriteChunk (ChunkFile::Tag tag, uint32 size,
 
 		// Compress the data.
 
-		if (compType == kGzipCompression)
+		if (compType == kBlockCompression)
+			::PrvBlockEncode (&src, &dest, size, worstPackedSize);
+		else if (compType == kGzipCompression)
 			::GzipEncode (&src, &dest, size, worstPackedSize);
 		else
 			::RunLengthEncode (&src, &dest, size, worstPackedSize);
@@ -1140,3 +1831,143 @@ void SessionFile::WriteChunk (ChunkFile::Tag tag, const Chunk& chunk, Compressio
 {
 	this->WriteChunk (tag, chunk.GetLength (), chunk.GetPointer (), compType);
 }
+
+
+#pragma mark -
+
+// ---------------------------------------------------------------------------
+//		Native images
+// ---------------------------------------------------------------------------
+// Images written in uncompressed mode are stored as they are in memory.  The
+// chunk starts with a byte order mark and a pad size, both in host order,
+// followed by "pad size" zero bytes and then the image.  The padding puts the
+// image on a kNativeImageAlign boundary in the file, which is a multiple of
+// any page size we're likely to run on, so that it can be mapped.  Files
+// written on a host with a different byte order don't match the mark, and
+// are ignored.
+
+const uint32	kNativeByteOrderMark	= 0x01020304;
+const long		kNativeImageAlign		= 64 * 1024L;
+const long		kNativeHeaderSize		= 2 * sizeof (uint32);
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::FindNativeImage
+ *
+ * DESCRIPTION:	Find a native image and check its header.  If
+ *				successful, the file marker will be pointing to the
+ *				image itself.
+ *
+ * PARAMETERS:	tag - marker identifying the image.
+ *
+ * RETURNED:	Size of the image, in bytes.  If the image can't be
+ *				found or wasn't written on this kind of host,
+ *				ChunkFile::kChunkNotFound is returned.
+ *
+ ***********************************************************************/
+
+long SessionFile::FindNativeImage (ChunkFile::Tag tag)
+{
+	long	chunkSize = fFile.FindChunk (tag);
+	if (chunkSize == ChunkFile::kChunkNotFound || chunkSize < kNativeHeaderSize)
+	{
+		return ChunkFile::kChunkNotFound;
+	}
+
+	uint32	header[2];
+	fFile.ReadChunk (sizeof (header), header);
+
+	uint32	mark = header[0];
+	uint32	padSize = header[1];
+
+	if (mark != kNativeByteOrderMark || padSize > (uint32) (chunkSize - kNativeHeaderSize))
+	{
+		return ChunkFile::kChunkNotFound;
+	}
+
+	fFile.GetStream ().SetMarker (padSize, kStreamFromMarker);
+
+	return chunkSize - kNativeHeaderSize - padSize;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::ReadNativeImage
+ *
+ * DESCRIPTION:	Map or read in a native image.  Mapping is only tried
+ *				if we know which file we're reading from.
+ *
+ * PARAMETERS:	tag - marker identifying the image.
+ *
+ *				image - pointer to the buffer to receive the image.
+ *
+ *				size - expected size of the image.
+ *
+ *				mapped - set to true if the image was mapped.
+ *
+ * RETURNED:	True if the image was found and could be read in.
+ *
+ ***********************************************************************/
+
+Bool SessionFile::ReadNativeImage (ChunkFile::Tag tag, void* image, uint32 size,
+								   Bool& mapped)
+{
+	mapped = false;
+
+	long	imageSize = this->FindNativeImage (tag);
+	if (imageSize == ChunkFile::kChunkNotFound || imageSize != (long) size)
+	{
+		return false;
+	}
+
+	long	offset = fFile.GetStream ().GetMarker ();
+
+	if (fFileRef.IsSpecified () &&
+		Platform::MapFilePages (image, size, fFileRef, offset))
+	{
+		mapped = true;
+	}
+	else
+	{
+		fFile.ReadChunk (size, image);
+	}
+
+	return true;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SessionFile::WriteNativeImage
+ *
+ * DESCRIPTION:	Write a native image, padding the header so that the
+ *				image lands on a kNativeImageAlign boundary.
+ *
+ * PARAMETERS:	tag - marker used to later retrieve the image.
+ *
+ *				image - pointer to the image to write.
+ *
+ *				size - number of bytes in the image.
+ *
+ * RETURNED:	Nothing
+ *
+ ***********************************************************************/
+
+void SessionFile::WriteNativeImage (ChunkFile::Tag tag, const void* image, uint32 size)
+{
+	// The image follows the chunk's tag and size, and then our header.
+
+	long	imageOffset = fFile.GetStream ().GetMarker () +
+						sizeof (ChunkFile::Tag) + sizeof (uint32) +
+						kNativeHeaderSize;
+	long	padSize = (kNativeImageAlign - imageOffset % kNativeImageAlign) % kNativeImageAlign;
+
+	StMemory	header (kNativeHeaderSize + padSize, true);
+
+	((uint32*) header.Get ())[0] = kNativeByteOrderMark;
+	((uint32*) header.Get ())[1] = padSize;
+
+	fFile.WriteChunk (tag, kNativeHeaderSize + padSize, header.Get (), size, image);
+}
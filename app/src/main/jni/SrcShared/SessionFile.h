@@ -19,6 +19,8 @@
 #include "EmStructs.h"			// Configuration, RGBType
 #include "Platform.h"			// Platform
 
+class EmSessionSnapshot;
+
 struct HwrJerryPLDType;
 struct HwrM68328Type;
 struct HwrM68EZ328Type;
@@ -87,6 +89,10 @@ class SessionFile
 		Bool					ReadRAMImage			(void*);
 		Bool					ReadMetaRAMImage		(void*);
 		Bool					ReadMetaROMImage		(void*);
+		Bool					ReadRAMBaseID			(uint32&);
+		Bool					ReadRAMBase				(EmFileRef&, uint32&);
+		Bool					ReadNativeRAMImage		(void*, uint32, Bool& mapped);
+		Bool					ReadNativeMetaRAMImage	(void*, uint32, Bool& mapped);
 
 		Bool					ReadBugFixes			(BugFixes&);
 
@@ -135,6 +141,11 @@ class SessionFile
 		void					WriteRAMImage			(const void*, uint32);
 		void					WriteMetaRAMImage		(const void*, uint32);
 		void					WriteMetaROMImage		(const void*, uint32);
+		void					WriteRAMBaseID			(uint32);
+		void					WriteRAMBase			(const EmFileRef&, uint32);
+		void					WriteRAMDelta			(const Chunk&, uint32);
+		void					WriteNativeRAMImage		(const void*, uint32);
+		void					WriteNativeMetaRAMImage	(const void*, uint32);
 
 		void					WriteBugFixes			(const BugFixes&);
 
@@ -156,12 +167,39 @@ class SessionFile
 		void					FixBug					(BugFix);
 		Bool					IncludesBugFix			(BugFix);
 
+		// When saving to or loading from an in-memory snapshot, the RAM and
+		// meta-memory images bypass the chunk file and go straight to the
+		// snapshot.  Sub-systems owning those images check for this.
+
+		void					SetSnapshot				(EmSessionSnapshot* s) { fSnapshot = s; }
+		EmSessionSnapshot*		GetSnapshot				(void) { return fSnapshot; }
+
+		// The file being read or written, if known.  A full RAM image
+		// written to a known file becomes the base for incremental saves,
+		// which store only the pages written since then.  Incremental saves
+		// are only made if asked for, as the file isn't usable without its
+		// base.
+
+		void					SetFileRef				(const EmFileRef& f) { fFileRef = f; }
+		const EmFileRef&		GetFileRef				(void) { return fFileRef; }
+
+		void					SetIncremental			(Bool b) { fIncremental = b; }
+		Bool					GetIncremental			(void) { return fIncremental; }
+
+		// In uncompressed mode, the RAM and meta-RAM images are written
+		// as they are in memory, aligned in the file so that they can be
+		// mapped back in when the file is loaded.
+
+		void					SetUncompressed			(Bool b) { fUncompressed = b; }
+		Bool					GetUncompressed			(void) { return fUncompressed; }
+
 	private:
 		enum CompressionType
 		{
 			kNoCompression,
 			kRLECompression,
-			kGzipCompression
+			kGzipCompression,
+			kBlockCompression
 		};
 
 		Bool					ReadChunk				(ChunkFile::Tag tag,
@@ -181,6 +219,15 @@ class SessionFile
 														 const Chunk& chunk,
 														 CompressionType);
 
+		Bool					ReadRAMDelta			(void*);
+
+		long					FindNativeImage			(ChunkFile::Tag tag);
+		Bool					ReadNativeImage			(ChunkFile::Tag tag,
+														 void*, uint32,
+														 Bool& mapped);
+		void					WriteNativeImage		(ChunkFile::Tag tag,
+														 const void*, uint32);
+
 		// These functions access kROMAliasTag, kROMNameTag, kROMPathTag
 		friend Bool Platform::ReadROMFileReference (ChunkFile&, EmFileRef&);
 		friend void Platform::WriteROMFileReference (ChunkFile&, const EmFileRef&);
@@ -234,11 +281,24 @@ class SessionFile
 			kTimeDelta			= 'Time',	// Delta between the actual time and the time set by
 											// the user via the General preference panel.
 
-			kRAMDataTag			= 'zram',	// gzip compressed RAM image
-			kMetaRAMDataTag		= 'zmrm',	// gzip compressed meta-RAM image
-			kMetaROMDataTag		= 'zmro',	// gzip compressed meta-ROM image
+			kBlockRAMDataTag	= 'bram',	// LZ4 block compressed RAM image
+			kBlockMetaRAMDataTag= 'bmrm',	// LZ4 block compressed meta-RAM image
+			kBlockMetaROMDataTag= 'bmro',	// LZ4 block compressed meta-ROM image
+
+			kNativeRAMDataTag	= 'nram',	// Uncompressed RAM image in host layout
+			kNativeMetaRAMDataTag= 'nmrm',	// Uncompressed meta-RAM image in host layout
+
+			kRAMDataTag			= 'zram',	// gzip compressed RAM image - read only
+			kMetaRAMDataTag		= 'zmrm',	// gzip compressed meta-RAM image - read only
+			kMetaROMDataTag		= 'zmro',	// gzip compressed meta-ROM image - read only
 
 			kBugsTag			= 'bugz',	// bit flags indicating bug fixes in file format
+
+			kRAMBaseIDTag		= 'rbid',	// ID of the full RAM image in this file
+			kRAMBaseTag			= 'rbas',	// Base file and ID an incremental RAM image applies to
+			kBlockRAMDeltaTag	= 'bdrm',	// LZ4 block compressed pages changed since the base
+			kRAMDeltaTag		= 'dram',	// gzip compressed pages changed since the base - read only
+			kRAMDeltaSizeTag	= 'drsz',	// Size of the RAM image in an incremental save
 			
 			kRLERAMDataTag		= 'cram',	// RLE compressed RAM image - obsolete
 			kRLEMetaRAMDataTag	= 'mram',	// RLE compressed meta-RAM image - obsolete
@@ -252,6 +312,10 @@ class SessionFile
 		bool					fReadBugFixes;
 		bool					fChangedBugFixes;
 		BugFixes				fBugFixes;
+		EmSessionSnapshot*		fSnapshot;
+		EmFileRef				fFileRef;
+		Bool					fIncremental;
+		Bool					fUncompressed;
 };
 
 #endif	// _SESSIONFILE_H_
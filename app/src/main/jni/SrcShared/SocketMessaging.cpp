@@ -386,7 +386,9 @@ CTCPSocket::CTCPSocket (EventCallback fn, int port) :
 	fPort (port),
 	fSocketState (kSocketState_Unconnected),
 	fListeningSocket (INVALID_SOCKET),
-	fConnectedSocket (INVALID_SOCKET)
+	fConnectedSocket (INVALID_SOCKET),
+	fReadBufferStart (0),
+	fReadBufferEnd (0)
 {
 }
 
@@ -535,6 +537,10 @@ ErrCode CTCPSocket::Close (void)
 
 	fSocketState = kSocketState_Unconnected;
 
+	// Anything still buffered belonged to the old connection.
+
+	fReadBufferStart = fReadBufferEnd = 0;
+
 	// Tell the callback function that the socket is now disconnected
 	// (and not even listening).  Send out this notification at this
 	// point so that the callback function can put the socket back into
@@ -651,7 +657,9 @@ ErrCode CTCPSocket::Write (const void* buffer, long amountToWrite, long* amtWrit
  *
  * DESCRIPTION: Read bytes from the socket.  At most sizeOfBuffer bytes
  *				are read.  It is assumed that HasUnreadData has already
- *				been called and returned true.
+ *				been called and returned true.  Data is pulled off the
+ *				wire a buffer-full at a time, so successive small reads
+ *				are usually satisfied without another recv.
  *
  * PARAMETERS:	buffer - pointer to the buffer to put the data.
  *
@@ -679,7 +687,28 @@ ErrCode CTCPSocket::Read (void* buffer, long sizeOfBuffer, long* amtRead)
 	{
 		while (*amtRead < sizeOfBuffer)
 		{
-			long	r = recv (fConnectedSocket, ((char*) buffer) + *amtRead, sizeOfBuffer - *amtRead, 0);
+			// Hand out what we already have first.
+
+			long	amtBuffered = fReadBufferEnd - fReadBufferStart;
+
+			if (amtBuffered > 0)
+			{
+				long	amtToCopy = sizeOfBuffer - *amtRead;
+				if (amtToCopy > amtBuffered)
+					amtToCopy = amtBuffered;
+
+				memcpy (((char*) buffer) + *amtRead, &fReadBuffer[fReadBufferStart], amtToCopy);
+
+				fReadBufferStart += amtToCopy;
+				*amtRead += amtToCopy;
+				continue;
+			}
+
+			// Refill the buffer with whatever has arrived.
+
+			fReadBufferStart = fReadBufferEnd = 0;
+
+			long	r = recv (fConnectedSocket, fReadBuffer, kReadBufferSize, 0);
 
 			// More from the sockets manual for the select() function:
 			//
@@ -710,13 +739,13 @@ ErrCode CTCPSocket::Read (void* buffer, long sizeOfBuffer, long* amtRead)
 
 			if (r > 0)
 			{
-				*amtRead += r;
+				fReadBufferEnd = r;
 
 				if (LogLLDebuggerData ())
-					LogAppendData (((char*) buffer) + *amtRead - r, r,
-								"...got %ld of %ld bytes of data.", *amtRead, sizeOfBuffer);
+					LogAppendData (fReadBuffer, r,
+								"...got %ld bytes of data for a %ld byte read.", r, sizeOfBuffer);
 				else
-					PRINTF ("...got %ld of %ld bytes of data.", *amtRead, sizeOfBuffer);
+					PRINTF ("...got %ld bytes of data for a %ld byte read.", r, sizeOfBuffer);
 			}
 		}
 	}
@@ -987,6 +1016,13 @@ Bool CTCPSocket::HasUnreadData (long msecs)
 {
 	Bool	hasData = false;
 
+	// Data already pulled off the wire by Read counts, too.
+
+	if (fReadBufferEnd > fReadBufferStart)
+	{
+		return true;
+	}
+
 	// From the sockets manual for the select() function:
 	//
 	// The parameter readfds identifies the sockets that are to be
@@ -89,6 +89,16 @@ class CTCPSocket : public CSocket
 		int						fSocketState;
 		SOCKET					fListeningSocket;
 		SOCKET					fConnectedSocket;
+
+		// Data received but not yet handed out by Read.  Lets a
+		// packet's header, body, and footer (and any packets queued
+		// behind it) come off the wire with a single recv.
+
+		enum { kReadBufferSize = 4096 };
+
+		char					fReadBuffer[kReadBufferSize];
+		long					fReadBufferStart;
+		long					fReadBufferEnd;
 };
 
 #endif /* _SOCKETMESSAGING_H_ */
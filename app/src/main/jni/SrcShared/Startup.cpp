@@ -40,7 +40,12 @@ static Bool				gMinimize;
 // Post-startup actions.
 static Bool				gStartNewHorde;
 static Bool				gHordeQuitWhenDone;
+static long				gHordeWorkers = 1;
+static long				gHordeWorkerIndex;
+static long				gHordeWorkerCount;
+static EmDirRef			gHordeWorkerDir;
 static Bool				gMinimizeQuitWhenDone;
+static Bool				gHeadless;
 // Quit actions.
 static Bool				gQuitOnExit;
 
@@ -83,6 +88,10 @@ static const char		kOptHordeSaveFreq[]		= "horde_save_freq";
 static const char		kOptHordeDepthMax[]		= "horde_depth_max";
 static const char		kOptHordeDepthSwitch[]	= "horde_depth_switch";
 static const char		kOptHordeQuitWhenDone[]	= "horde_quit_when_done";
+static const char		kOptHordeWorkers[]		= "horde_workers";
+static const char		kOptHordeWorker[]		= "horde_worker";
+static const char		kOptHordeWorkerDir[]	= "horde_worker_dir";
+static const char		kOptHeadless[]			= "headless";
 
 
 // These are the options the user can specify on the command line.
@@ -117,7 +126,11 @@ kOptionMap [] =
 	{ "-horde_save_freq",		kOptHordeSaveFreq,		1 },
 	{ "-horde_depth_max",		kOptHordeDepthMax,		1 },
 	{ "-horde_depth_switch",	kOptHordeDepthSwitch,	1 },
-	{ "-horde_quit_when_done",	kOptHordeQuitWhenDone,	0 }
+	{ "-horde_quit_when_done",	kOptHordeQuitWhenDone,	0 },
+	{ "-horde_workers",			kOptHordeWorkers,		1 },
+	{ "-horde_worker",			kOptHordeWorker,		1 },
+	{ "-horde_worker_dir",		kOptHordeWorkerDir,		1 },
+	{ "-headless",				kOptHeadless,			0 }
 };
 
 
@@ -322,6 +335,7 @@ void Startup::PrvPrintHelp (void)
 	printf (" -load_apps <name(s)> Comma-seperated list of names of .prc files to load at startup\n");
 	printf (" -run_app <name>      Name of file to automatically run at startup\n");
 	printf (" -quit_on_exit        Cause Poser to quit after -run application exits\n");
+	printf (" -headless            Run sessions without showing them, as fast as possible\n");
 	printf (" -pref <key=value>    Change a preference setting\n");
 	printf ("\n");
 
@@ -735,6 +749,9 @@ Bool Startup::PrvHandleCreateSessionParameters (OptionList& options)
  *					kOptHordeDepthMax
  *					kOptHordeDepthSwitch
  *					kOptHordeQuitWhenDone
+ *					kOptHordeWorkers
+ *					kOptHordeWorker
+ *					kOptHordeWorkerDir
  *
  * PARAMETERS:  options - the OptionList containing the complete set
  *					of parsed switches and parameters.
@@ -755,6 +772,9 @@ Bool Startup::PrvHandleNewHordeParameters (OptionList& options)
 	DEFINE_VARS(HordeDepthMax);
 	DEFINE_VARS(HordeDepthSwitch);
 	DEFINE_VARS(HordeQuitWhenDone);
+	DEFINE_VARS(HordeWorkers);
+	DEFINE_VARS(HordeWorker);
+	DEFINE_VARS(HordeWorkerDir);
 
 	UNUSED_PARAM(optHordeQuitWhenDone);
 
@@ -841,6 +861,36 @@ Bool Startup::PrvHandleNewHordeParameters (OptionList& options)
 
 	gHordeQuitWhenDone = haveHordeQuitWhenDone;
 
+	// A worker count of zero means one per processor; see Hordes::StartWorkers.
+
+	gHordeWorkers = haveHordeWorkers ? atoi (optHordeWorkers.c_str ()) : 1;
+
+	// Hordes::StartWorkers passes "-horde_worker <index>,<count>" and
+	// -horde_worker_dir to the processes it runs parts of a Horde in.
+
+	gHordeWorkerIndex = 0;
+	gHordeWorkerCount = 0;
+
+	if (haveHordeWorker && haveHordeWorkerDir)
+	{
+		if (sscanf (optHordeWorker.c_str (), "%ld,%ld",
+				&gHordeWorkerIndex, &gHordeWorkerCount) != 2 ||
+			gHordeWorkerIndex < 1 || gHordeWorkerIndex >= gHordeWorkerCount)
+		{
+			gHordeWorkerIndex = 0;
+			gHordeWorkerCount = 0;
+
+			Startup::PrvDontUnderstand (optHordeWorker.c_str ());
+			return false;
+		}
+
+		gHordeWorkerDir = EmDirRef (optHordeWorkerDir);
+
+		// Nobody's looking at a worker, so let it run flat out.
+
+		gHeadless = true;
+	}
+
 	return true;
 }
 
@@ -891,6 +941,38 @@ Bool Startup::PrvHandleAutoLoadParameters (OptionList& options)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:    PrvHandleHeadlessParameters
+ *
+ * DESCRIPTION: Handle the following command line options:
+ *
+ *					kOptHeadless
+ *
+ * PARAMETERS:  options - the OptionList containing the complete set
+ *					of parsed switches and parameters.
+ *
+ * RETURNED:    True if everything when OK.  If there's something wrong
+ *				with the specifications, this function displays an
+ *				error message and return false.
+ *
+ ***********************************************************************/
+
+Bool Startup::PrvHandleHeadlessParameters (OptionList& options)
+{
+	DEFINE_VARS(Headless);
+
+	UNUSED_PARAM (optHeadless)
+
+	if (haveHeadless)
+	{
+		gHeadless = true;
+	}
+
+	return true;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:    PrvHandleSkinParameters
@@ -1020,8 +1102,9 @@ Bool Startup::PrvParseCommandLine (int argc, char** argv)
 		goto BadParameter;
 
 	// Handle kOptHordeFirst, kOptHordeLast, kOptHordeApps, kOptHordeSaveDir,
-	// kOptHordeSaveFreq, kOptHordeDepthMax, kOptHordeDepthSwitch, and
-	// kOptHordeQuitWhenDone.
+	// kOptHordeSaveFreq, kOptHordeDepthMax, kOptHordeDepthSwitch,
+	// kOptHordeQuitWhenDone, kOptHordeWorkers, kOptHordeWorker, and
+	// kOptHordeWorkerDir.
 
         PHEM_Log_Msg("Handle horde?");
 	if (!Startup::PrvHandleNewHordeParameters (options))
@@ -1033,6 +1116,11 @@ Bool Startup::PrvParseCommandLine (int argc, char** argv)
 	if (!Startup::PrvHandleAutoLoadParameters (options))
 		goto BadParameter;
 
+	// Handle kOptHeadless.
+
+	if (!Startup::PrvHandleHeadlessParameters (options))
+		goto BadParameter;
+
         PHEM_Log_Msg("Handle skin?");
 	// Handle kOptSkin
 	if (!Startup::PrvHandleSkinParameters (options))
@@ -1479,6 +1567,74 @@ Bool Startup::HordeQuitWhenDone (void)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:    Startup::HordeWorkers
+ *
+ * DESCRIPTION: Return the number of processes a Horde should be split
+ *				across, as given with -horde_workers.
+ *
+ * PARAMETERS:  none.
+ *
+ * RETURNED:    The number of workers.  Zero means one per processor.
+ *
+ ***********************************************************************/
+
+long Startup::HordeWorkers (void)
+{
+	return gHordeWorkers;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:    Startup::HordeWorker
+ *
+ * DESCRIPTION: Return whether we were started to run part of a Horde,
+ *				as given with -horde_worker and -horde_worker_dir.
+ *
+ * PARAMETERS:  index - receives which worker we are.
+ *
+ *				count - receives the number of workers running the
+ *					Horde, including the original process.
+ *
+ *				dir - receives the directory to put our files in.
+ *
+ * RETURNED:    True if we're a worker.
+ *
+ ***********************************************************************/
+
+Bool Startup::HordeWorker (long& index, long& count, EmDirRef& dir)
+{
+	index	= gHordeWorkerIndex;
+	count	= gHordeWorkerCount;
+	dir		= gHordeWorkerDir;
+
+	return gHordeWorkerCount != 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:    Startup::Headless
+ *
+ * DESCRIPTION: Return whether sessions should run headless (see
+ *				EmSession::IsHeadless), as given with -headless.
+ *				The kPrefKeyHeadless preference does the same thing
+ *				from the preferences file.
+ *
+ * PARAMETERS:  none.
+ *
+ * RETURNED:    True if so.
+ *
+ ***********************************************************************/
+
+Bool Startup::Headless (void)
+{
+	return gHeadless;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:    Startup::MinimizeQuitWhenDone
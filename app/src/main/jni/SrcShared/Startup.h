@@ -43,7 +43,10 @@ class Startup
 		static Bool				Minimize				(EmFileRef&);
 		static Bool				NewHorde				(HordeInfo*);
 		static Bool				HordeQuitWhenDone		(void);
+		static long				HordeWorkers			(void);
+		static Bool				HordeWorker				(long& index, long& count, EmDirRef& dir);
 		static Bool				MinimizeQuitWhenDone	(void);
+		static Bool				Headless				(void);
 		static Bool				CloseSession			(EmFileRef&);
 		static Bool				QuitOnExit				(void);
 
@@ -66,6 +69,7 @@ class Startup
 		static Bool				PrvHandleCreateSessionParameters	(OptionList& options);
 		static Bool				PrvHandleNewHordeParameters			(OptionList& options);
 		static Bool				PrvHandleAutoLoadParameters			(OptionList& options);
+		static Bool				PrvHandleHeadlessParameters			(OptionList& options);
 		static Bool				PrvHandleSkinParameters				(OptionList& options);
 		static Bool				PrvHandlePreferenceParameters		(PreferenceList& prefs);
 		static Bool				PrvParseCommandLine		(int argc, char** argv);
@@ -178,6 +178,37 @@
 #define NATIVE_DISPATCHING		1
 
 
+// Define HAS_CODE_CACHE to 1 to have the CPU loop replay straight-line
+// runs of opcodes out of EmCodeCache.  It's turned off when profiling or
+// recording register history, since both of those want to see every
+// opcode go through the full loop in EmCPU68K::Execute.
+
+#if HAS_PROFILING || REGISTER_HISTORY
+	#define HAS_CODE_CACHE			0
+#else
+	#define HAS_CODE_CACHE			1
+#endif
+
+
+// Define HAS_FAST_MEMORY to 1 to have EmMemGet32, EmMemPut32, etc., read
+// and write plain RAM pages directly instead of calling through the
+// memory bank handlers.  It's turned off when profiling, since the
+// handlers are what count the memory access cycles.
+
+#if HAS_PROFILING || PROFILE_MEMORY
+	#define HAS_FAST_MEMORY			0
+#else
+	#define HAS_FAST_MEMORY			1
+#endif
+
+
+// Define BENCHMARK_PIXMAPS to 1 to have EmPixMap time its scanline
+// converters when the application starts up, and write the results to
+// the log.
+
+#define BENCHMARK_PIXMAPS		0
+
+
 // Define HAS_TRACER to 1 to include Tracer facility.
 
 #if PLATFORM_MAC || PLATFORM_WINDOWS
@@ -20,13 +20,14 @@
 #include "EmCPU68K.h"			// gCPU68K->UpdateRegistersFromSR
 #include "EmErrCodes.h"			// kError_NoError
 #include "EmLowMem.h"			// EmLowMem_GetGlobal
-#include "EmMemory.h"			// EmMem_memcpy
+#include "EmMemory.h"			// EmMem_memcpy, Memory::InvalidateFastPages
 #include "EmPalmFunction.h"		// FindFunctionName
 #include "EmPalmStructs.h"		// EmSysPktRPCType, etc
 #include "EmRPC.h"				// slkSocketRPC
 #include "EmSession.h"			// EmSession::Reset
 #include "HostControl.h"		// hostSelectorWaitForIdle
 #include "Logging.h"			// LogAppendMsg
+#include "Miscellaneous.h"		// StMemory
 #include "Platform.h"			// Platform::ExitDebugger
 #include "SLP.h"				// SLP
 
@@ -88,6 +89,7 @@
 			sysPktWriteMemCmd
 			sysPktRPCCmd
 			sysPktRPC2Cmd
+			sysPktMemBatchCmd
 
 	The Console and RPC sockets will always handle the packet they receive
 	(assuming that the UI thread has first synchronized with the CPU thread
@@ -337,45 +339,10 @@ ErrCode SystemPacket::WriteMem (SLP& slp)
 	}
 
 	// If we just altered low memory, recalculate the low-memory checksum.
-	// Make sure we're on a ROM that has this field!  Determine this by
-	// seeing that the address of sysLowMemChecksum is below the memCardInfo
-	// fields that come after the FixedGlobals.
-	//
-	// !!! This chunk of code should be in some more generally accessible location.
 
-	if (offsetof (LowMemType, fixed.globals.sysLowMemChecksum) < EmLowMem_GetGlobal (memCardInfoP))
+	if ((emuptr) packet.address < (emuptr) 0x100)
 	{
-		if ((emuptr) packet.address < (emuptr) 0x100)
-		{
-			UInt32		checksum	= 0;
-			emuptr		csP		= EmMemNULL;
-
-			// First, calculate the checksum
-
-			while (csP < (emuptr) 0x100)
-			{
-				UInt32	data = EmMemGet32 (csP);
-
-				// Don't do these trap vectors since they change whenever the
-				// debugger is set to break on any a-trap or breakpoint.
-
-				if (csP == offsetof (M68KExcTableType, trapN[sysDispatchTrapNum]))
-					data = 0;
-
-				if (csP == offsetof (M68KExcTableType, trapN[sysDbgBreakpointTrapNum]))
-					data = 0;
-
-				if (csP == offsetof (M68KExcTableType, trace))
-					data = 0;
-
-				checksum += data;
-				csP += 4;
-			}
-
-			// Save new checksum
-
-			EmLowMem_SetGlobal (sysLowMemChecksum, checksum);
-		}
+		SystemPacket::UpdateLowMemChecksum ();
 	}
 
 	EXIT_CODE ("WriteMem", sysPktWriteMemRsp);
@@ -550,6 +517,11 @@ ErrCode SystemPacket::Continue (SLP& slp)
 	// ssCount is ignored?
 	gDebuggerGlobals.ssValue	= packet.ssCheckSum;
 
+	// Writes need to go through the handlers for CheckStepSpy to see them.
+
+	if (gDebuggerGlobals.stepSpy)
+		Memory::InvalidateFastPages ();
+
 	ErrCode result = Debug::ExitDebugger ();
 
 	// Perform any platform-specific actions.
@@ -810,6 +782,157 @@ ErrCode SystemPacket::RPC2 (SLP& slp)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	SystemPacket::MemBatch
+ *
+ * DESCRIPTION: Perform a list of memory reads and writes in order and
+ *				send back the read data in one response.  See EmRPC.h
+ *				for the packet layout.  The whole request is checked
+ *				before any of it is performed; a malformed request
+ *				gets a sysPktBadFormatRsp response.
+ *
+ * PARAMETERS:	None.
+ *
+ * RETURNED:	Nothing.
+ *
+ ***********************************************************************/
+
+ErrCode SystemPacket::MemBatch (SLP& slp)
+{
+	PRINTF ("Entering SystemPacket::MemBatch.");
+
+	const long	kBatchHeaderSize	= 4;	// command, _filler, numOps
+	const long	kBatchOpSize		= 8;	// kind, _filler, address, numBytes
+
+	char*		bodyP		= (char*) slp.GetBodyPtr ();
+	long		bodySize	= slp.Header ().bodySize;
+	long		rspSize		= kBatchHeaderSize;
+	UInt16		numOps		= 0;
+	Bool		wellFormed	= bodySize >= kBatchHeaderSize;
+
+	// First pass: make sure all the ops are there and add up the
+	// size of the response.
+
+	if (wellFormed)
+	{
+		EmAliasUInt16<LAS>	numOpsField (bodyP + 2);
+		long				offset = kBatchHeaderSize;
+
+		numOps = numOpsField;
+
+		for (UInt16 ii = 0; wellFormed && ii < numOps; ++ii)
+		{
+			if (offset + kBatchOpSize > bodySize)
+			{
+				wellFormed = false;
+				break;
+			}
+
+			UInt8				kind = bodyP[offset];
+			EmAliasUInt16<LAS>	numBytes (bodyP + offset + 6);
+
+			offset += kBatchOpSize;
+
+			if (kind == kMemBatchRead)
+			{
+				rspSize += numBytes;
+			}
+			else if (kind == kMemBatchWrite)
+			{
+				offset += numBytes;
+				wellFormed = offset <= bodySize;
+			}
+			else
+			{
+				wellFormed = false;
+			}
+		}
+
+		// The response size has to fit in the SLP header.
+
+		if (rspSize > 0xFFFF)
+		{
+			wellFormed = false;
+		}
+	}
+
+	if (!wellFormed)
+	{
+		PRINTF ("Malformed batch packet.");
+		EXIT_CODE ("MemBatch", sysPktBadFormatRsp);
+	}
+
+	// Second pass: do the reads and writes.
+
+	StMemory	response (rspSize);
+	char*		rspP		= (char*) response.Get ();
+	long		offset		= kBatchHeaderSize;
+	long		rspOffset	= kBatchHeaderSize;
+	Bool		wroteLowMem	= false;
+
+	for (UInt16 ii = 0; ii < numOps; ++ii)
+	{
+		UInt8				kind = bodyP[offset];
+		EmAliasUInt32<LAS>	address (bodyP + offset + 2);
+		EmAliasUInt16<LAS>	numBytes (bodyP + offset + 6);
+		emuptr				addr = (emuptr) (UInt32) address;
+		UInt16				len = numBytes;
+
+		offset += kBatchOpSize;
+
+		Bool	validRange = len > 0 &&
+							 EmMemCheckAddress (addr, 1) &&
+							 EmMemCheckAddress (addr + len - 1, 1);
+
+		if (kind == kMemBatchRead)
+		{
+			void*	dest = rspP + rspOffset;
+
+			memset (dest, 0xFF, len);	// Clear buffer in case of failure.
+
+			if (validRange)
+			{
+				EmMem_memcpy (dest, addr, len);
+			}
+
+			rspOffset += len;
+		}
+		else
+		{
+			if (validRange)
+			{
+				EmMem_memcpy (addr, bodyP + offset, len);
+
+				if (addr < (emuptr) 0x100)
+				{
+					wroteLowMem = true;
+				}
+			}
+
+			offset += len;
+		}
+	}
+
+	if (wroteLowMem)
+	{
+		SystemPacket::UpdateLowMemChecksum ();
+	}
+
+	EmAliasUInt16<LAS>	rspNumOps (rspP + 2);
+
+	rspP[0]		= sysPktMemBatchRsp;
+	rspP[1]		= 0;
+	rspNumOps	= numOps;
+
+	ErrCode result = SystemPacket::SendPacket (slp, rspP, rspSize);
+
+	PRINTF ("Exiting SystemPacket::MemBatch.");
+
+	return result;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	SystemPacket::GetBreakpoints
@@ -1154,6 +1277,61 @@ ErrCode SystemPacket::SendPacket (SLP& slp, const void* body, long bodySize)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	SystemPacket::UpdateLowMemChecksum
+ *
+ * DESCRIPTION: Recalculate the low-memory checksum after low memory has
+ *				been altered by a packet.  Make sure we're on a ROM that
+ *				has this field!  Determine this by seeing that the
+ *				address of sysLowMemChecksum is below the memCardInfo
+ *				fields that come after the FixedGlobals.
+ *
+ *				!!! This chunk of code should be in some more generally
+ *				accessible location.
+ *
+ * PARAMETERS:	None.
+ *
+ * RETURNED:	Nothing.
+ *
+ ***********************************************************************/
+
+void SystemPacket::UpdateLowMemChecksum (void)
+{
+	if (offsetof (LowMemType, fixed.globals.sysLowMemChecksum) < EmLowMem_GetGlobal (memCardInfoP))
+	{
+		UInt32		checksum	= 0;
+		emuptr		csP		= EmMemNULL;
+
+		// First, calculate the checksum
+
+		while (csP < (emuptr) 0x100)
+		{
+			UInt32	data = EmMemGet32 (csP);
+
+			// Don't do these trap vectors since they change whenever the
+			// debugger is set to break on any a-trap or breakpoint.
+
+			if (csP == offsetof (M68KExcTableType, trapN[sysDispatchTrapNum]))
+				data = 0;
+
+			if (csP == offsetof (M68KExcTableType, trapN[sysDbgBreakpointTrapNum]))
+				data = 0;
+
+			if (csP == offsetof (M68KExcTableType, trace))
+				data = 0;
+
+			checksum += data;
+			csP += 4;
+		}
+
+		// Save new checksum
+
+		EmLowMem_SetGlobal (sysLowMemChecksum, checksum);
+	}
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	SystemPacket::GetRegs
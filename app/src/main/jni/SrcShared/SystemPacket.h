@@ -30,6 +30,7 @@ class SystemPacket
 		static ErrCode			Continue			(SLP&);
 		static ErrCode			RPC 				(SLP&);
 		static ErrCode			RPC2 				(SLP&);
+		static ErrCode			MemBatch			(SLP&);
 		static ErrCode			GetBreakpoints		(SLP&);
 		static ErrCode			SetBreakpoints		(SLP&);
 		static ErrCode			ToggleBreak 		(SLP&);
@@ -45,6 +46,8 @@ class SystemPacket
 		static ErrCode			SendResponse		(SLP&, UInt8 code);
 		static ErrCode			SendPacket			(SLP&, const void* body, long bodySize);
 
+		static void 			UpdateLowMemChecksum	(void);
+
 		static void 			GetRegs 			(M68KRegsType&);
 		static void 			SetRegs 			(const M68KRegsType&);
 };